@@ -0,0 +1,496 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "client/draw/glyph_atlas.h"
+
+#include <string>
+#include <vector>
+
+#include <common/logger.h>
+#include <common/macros.h>  // for UNUSED
+
+#define DOTS_TEXT "..."
+
+#define TTF_VERSION_NUM SDL_VERSIONNUM(SDL_TTF_MAJOR_VERSION, SDL_TTF_MINOR_VERSION, SDL_TTF_PATCHLEVEL)
+
+namespace fastotv {
+namespace client {
+namespace draw {
+
+namespace {
+
+size_t DecodeUtf8(const std::string& text, size_t pos, uint32_t* code_point) {
+  const unsigned char lead = static_cast<unsigned char>(text[pos]);
+  size_t len = 1;
+  uint32_t cp = lead;
+  if (lead >= 0xF0) {
+    len = 4;
+    cp = lead & 0x07;
+  } else if (lead >= 0xE0) {
+    len = 3;
+    cp = lead & 0x0F;
+  } else if (lead >= 0xC0) {
+    len = 2;
+    cp = lead & 0x1F;
+  }
+
+  if (pos + len > text.size()) {
+    *code_point = '?';
+    return 1;
+  }
+
+  for (size_t i = 1; i < len; ++i) {
+    cp = (cp << 6) | (static_cast<unsigned char>(text[pos + i]) & 0x3F);
+  }
+  *code_point = cp;
+  return len;
+}
+
+std::string EncodeUtf8(uint32_t cp) {
+  std::string out;
+  if (cp < 0x80) {
+    out.push_back(static_cast<char>(cp));
+  } else if (cp < 0x800) {
+    out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+    out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+  } else if (cp < 0x10000) {
+    out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+    out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+  } else {
+    out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+    out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+  }
+  return out;
+}
+
+std::vector<std::string> SplitLines(const std::string& text) {
+  std::vector<std::string> lines;
+  size_t start = 0;
+  while (true) {
+    size_t end = text.find('\n', start);
+    if (end == std::string::npos) {
+      lines.push_back(text.substr(start));
+      break;
+    }
+    lines.push_back(text.substr(start, end - start));
+    start = end + 1;
+  }
+  return lines;
+}
+
+}  // namespace
+
+GlyphAtlas::GlyphAtlas(TTF_Font* font)
+    : font_(font),
+      line_height_(font ? TTF_FontLineSkip(font) : 0),
+      kerning_(font && TTF_GetFontKerning(font)),
+      surface_(nullptr),
+      texture_(nullptr),
+      texture_render_(nullptr),
+      texture_dirty_(true),
+      pen_x_(0),
+      pen_y_(0),
+      shelf_height_(0),
+      restarted_(false),
+      glyphs_(),
+      batch_() {
+  surface_ = SDL_CreateRGBSurfaceWithFormat(0, atlas_width, atlas_height, 32, SDL_PIXELFORMAT_ARGB8888);
+  if (!surface_) {
+    WARNING_LOG() << "Can't create glyph atlas surface: " << SDL_GetError();
+    return;
+  }
+
+  Reset();
+  // printable ascii is used by every overlay, rasterise it up front
+  for (uint32_t cp = 0x20; cp < 0x7F; ++cp) {
+    FindOrRasterize(cp);
+  }
+}
+
+GlyphAtlas::~GlyphAtlas() {
+  ReleaseTexture();
+  if (surface_) {
+    SDL_FreeSurface(surface_);
+    surface_ = nullptr;
+  }
+}
+
+TTF_Font* GlyphAtlas::GetFont() const {
+  return font_;
+}
+
+int GlyphAtlas::GetLineHeight() const {
+  return line_height_;
+}
+
+int GlyphAtlas::CalcTextWidth(const std::string& line) {
+  int width = 0;
+  uint32_t prev = 0;
+  for (size_t pos = 0; pos < line.size();) {
+    uint32_t cp;
+    pos += DecodeUtf8(line, pos, &cp);
+    const Glyph* glyph = FindOrRasterize(cp);
+    if (glyph) {
+      width += GetKerning(prev, cp) + glyph->advance;
+    }
+    prev = cp;
+  }
+  return width;
+}
+
+std::string GlyphAtlas::DotText(const std::string& line, int max_width) {
+  if (CalcTextWidth(line) <= max_width) {
+    return line;
+  }
+
+  const int dots_width = CalcTextWidth(DOTS_TEXT);
+  int width = 0;
+  uint32_t prev = 0;
+  size_t pos = 0;
+  while (pos < line.size()) {
+    uint32_t cp;
+    size_t len = DecodeUtf8(line, pos, &cp);
+    const Glyph* glyph = FindOrRasterize(cp);
+    int advance = glyph ? GetKerning(prev, cp) + glyph->advance : 0;
+    if (width + advance + dots_width > max_width) {
+      break;
+    }
+    width += advance;
+    prev = cp;
+    pos += len;
+  }
+  return line.substr(0, pos) + DOTS_TEXT;
+}
+
+void GlyphAtlas::DrawText(SDL_Renderer* render,
+                          const std::string& text,
+                          const SDL_Rect& rect,
+                          const SDL_Color& color,
+                          DrawType dt) {
+  if (!render || !surface_ || text.empty() || rect.w <= 0 || rect.h <= 0) {
+    return;
+  }
+
+  // an atlas reset while laying out invalidates the quads collected so far, so lay out once more
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    batch_.clear();
+    restarted_ = false;
+    if (dt == fastoplayer::gui::FontWindow::CENTER_TEXT) {
+      const std::vector<std::string> lines = SplitLines(text);
+      const int total_height = static_cast<int>(lines.size()) * line_height_;
+      int y = rect.y + (rect.h - total_height) / 2;
+      for (const std::string& line : lines) {
+        const int line_width = CalcTextWidth(line);
+        DrawLine(line, rect.x + (rect.w - line_width) / 2, y, rect);
+        y += line_height_;
+      }
+    } else {
+      const std::vector<std::string> lines = WrapLines(text, rect.w);
+      int y = rect.y;
+      for (const std::string& line : lines) {
+        DrawLine(line, rect.x, y, rect);
+        y += line_height_;
+      }
+    }
+
+    if (!restarted_) {
+      break;
+    }
+  }
+
+  SDL_Texture* texture = GetTexture(render);
+  if (texture) {
+    Flush(render, texture, color);
+  }
+  batch_.clear();
+}
+
+const GlyphAtlas::Glyph* GlyphAtlas::FindOrRasterize(uint32_t code_point) {
+  auto it = glyphs_.find(code_point);
+  if (it != glyphs_.end()) {
+    return &it->second;
+  }
+
+  if (!surface_) {
+    return nullptr;
+  }
+
+  Glyph glyph;
+  if (!Rasterize(code_point, &glyph)) {
+    // atlas is full, start from scratch, glyphs in use will be rasterised again on demand
+    Reset();
+    if (!Rasterize(code_point, &glyph)) {
+      return nullptr;
+    }
+  }
+
+  auto inserted = glyphs_.insert(std::make_pair(code_point, glyph));
+  return &inserted.first->second;
+}
+
+bool GlyphAtlas::Rasterize(uint32_t code_point, Glyph* glyph) {
+  glyph->src = {0, 0, 0, 0};
+  glyph->offset = 0;
+  glyph->advance = 0;
+
+  // the pen moves by the advance of the font, the rendered surface is as wide as the ink and starts at a negative
+  // bearing instead of the pen
+  int minx = 0;
+  int advance = -1;
+#if TTF_VERSION_NUM >= SDL_VERSIONNUM(2, 0, 18)
+  if (TTF_GlyphMetrics32(font_, code_point, &minx, nullptr, nullptr, nullptr, &advance) != 0) {
+    advance = -1;
+  }
+#else
+  if (code_point > 0xFFFF ||
+      TTF_GlyphMetrics(font_, static_cast<Uint16>(code_point), &minx, nullptr, nullptr, nullptr, &advance) != 0) {
+    advance = -1;
+  }
+#endif
+
+  const std::string str = EncodeUtf8(code_point);
+  static const SDL_Color white = {255, 255, 255, SDL_ALPHA_OPAQUE};
+  SDL_Surface* rendered = TTF_RenderUTF8_Blended(font_, str.c_str(), white);
+  if (!rendered) {
+    // zero width or missing glyph, remember it as empty
+    glyph->advance = advance > 0 ? advance : 0;
+    return true;
+  }
+
+  SDL_Surface* converted = SDL_ConvertSurfaceFormat(rendered, SDL_PIXELFORMAT_ARGB8888, 0);
+  SDL_FreeSurface(rendered);
+  if (!converted) {
+    return true;
+  }
+
+  if (pen_x_ + converted->w + glyph_padding > atlas_width) {
+    pen_x_ = 0;
+    pen_y_ += shelf_height_ + glyph_padding;
+    shelf_height_ = 0;
+  }
+
+  if (pen_y_ + converted->h > atlas_height || converted->w > atlas_width) {
+    SDL_FreeSurface(converted);
+    return false;
+  }
+
+  SDL_Rect dst = {pen_x_, pen_y_, converted->w, converted->h};
+  SDL_SetSurfaceBlendMode(converted, SDL_BLENDMODE_NONE);
+  SDL_BlitSurface(converted, nullptr, surface_, &dst);
+  SDL_FreeSurface(converted);
+
+  pen_x_ += dst.w + glyph_padding;
+  if (dst.h > shelf_height_) {
+    shelf_height_ = dst.h;
+  }
+  texture_dirty_ = true;
+
+  glyph->src = dst;
+  if (advance >= 0) {
+    glyph->offset = minx < 0 ? minx : 0;
+    glyph->advance = advance;
+  } else {
+    glyph->advance = dst.w;  // no metrics for it in the font
+  }
+  return true;
+}
+
+void GlyphAtlas::Reset() {
+  if (!glyphs_.empty()) {
+    DEBUG_LOG() << "Glyph atlas is full, glyphs cached: " << glyphs_.size();
+  }
+  glyphs_.clear();
+  pen_x_ = 0;
+  pen_y_ = 0;
+  shelf_height_ = 0;
+  SDL_FillRect(surface_, nullptr, SDL_MapRGBA(surface_->format, 0, 0, 0, 0));
+  texture_dirty_ = true;
+  if (!batch_.empty()) {
+    batch_.clear();
+    restarted_ = true;
+  }
+}
+
+int GlyphAtlas::GetKerning(uint32_t prev, uint32_t code_point) const {
+  if (!kerning_ || !prev) {
+    return 0;
+  }
+
+#if TTF_VERSION_NUM >= SDL_VERSIONNUM(2, 0, 18)
+  return TTF_GetFontKerningSizeGlyphs32(font_, prev, code_point);
+#elif TTF_VERSION_NUM >= SDL_VERSIONNUM(2, 0, 14)
+  if (prev > 0xFFFF || code_point > 0xFFFF) {
+    return 0;
+  }
+  return TTF_GetFontKerningSizeGlyphs(font_, static_cast<Uint16>(prev), static_cast<Uint16>(code_point));
+#else
+  UNUSED(code_point);
+  return 0;
+#endif
+}
+
+SDL_Texture* GlyphAtlas::GetTexture(SDL_Renderer* render) {
+  if (texture_render_ != render) {
+    // textures belong to the renderer they were created with, the glyphs are uploaded again from the surface
+    ReleaseTexture();
+    texture_render_ = render;
+  }
+
+  if (!texture_) {
+    texture_ = SDL_CreateTexture(render, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, atlas_width, atlas_height);
+    if (!texture_) {
+      WARNING_LOG() << "Can't create glyph atlas texture: " << SDL_GetError();
+      return nullptr;
+    }
+    SDL_SetTextureBlendMode(texture_, SDL_BLENDMODE_BLEND);
+    texture_dirty_ = true;
+  }
+
+  if (texture_dirty_) {
+    SDL_UpdateTexture(texture_, nullptr, surface_->pixels, surface_->pitch);
+    texture_dirty_ = false;
+  }
+  return texture_;
+}
+
+void GlyphAtlas::ReleaseTexture() {
+  if (texture_) {
+    SDL_DestroyTexture(texture_);
+    texture_ = nullptr;
+  }
+  texture_dirty_ = true;
+}
+
+std::vector<std::string> GlyphAtlas::WrapLines(const std::string& text, int max_width) {
+  std::vector<std::string> result;
+  const std::vector<std::string> paragraphs = SplitLines(text);
+  for (const std::string& paragraph : paragraphs) {
+    if (CalcTextWidth(paragraph) <= max_width) {
+      result.push_back(paragraph);
+      continue;
+    }
+
+    std::string line;
+    int line_width = 0;
+    size_t last_space = std::string::npos;
+    int width_at_space = 0;
+    uint32_t prev = 0;
+    for (size_t pos = 0; pos < paragraph.size();) {
+      uint32_t cp;
+      const size_t len = DecodeUtf8(paragraph, pos, &cp);
+      const Glyph* glyph = FindOrRasterize(cp);
+      int advance = glyph ? GetKerning(prev, cp) + glyph->advance : 0;
+      if (line_width + advance > max_width && !line.empty()) {
+        if (last_space != std::string::npos) {
+          result.push_back(line.substr(0, last_space));
+          line = line.substr(last_space + 1);
+          line_width -= width_at_space;
+        } else {
+          result.push_back(line);
+          line.clear();
+          line_width = 0;
+          advance = glyph ? glyph->advance : 0;  // no kerning at the start of a line
+        }
+        last_space = std::string::npos;
+      }
+
+      if (cp == ' ') {
+        last_space = line.size();
+        width_at_space = line_width + advance;
+      }
+      line.append(paragraph, pos, len);
+      line_width += advance;
+      prev = cp;
+      pos += len;
+    }
+    result.push_back(line);
+  }
+  return result;
+}
+
+void GlyphAtlas::DrawLine(const std::string& line, int x, int y, const SDL_Rect& clip) {
+  if (y < clip.y || y + line_height_ > clip.y + clip.h) {
+    return;
+  }
+
+  int pen = x;
+  uint32_t prev = 0;
+  for (size_t pos = 0; pos < line.size();) {
+    uint32_t cp;
+    pos += DecodeUtf8(line, pos, &cp);
+    const Glyph* glyph = FindOrRasterize(cp);
+    if (restarted_) {
+      return;
+    }
+    if (!glyph) {
+      continue;
+    }
+
+    pen += GetKerning(prev, cp);
+    prev = cp;
+    const int left = pen + glyph->offset;
+    if (glyph->src.w > 0 && left >= clip.x && left + glyph->src.w <= clip.x + clip.w) {
+      Quad quad;
+      quad.src = glyph->src;
+      quad.dst = {left, y, glyph->src.w, glyph->src.h};
+      batch_.push_back(quad);
+    }
+    pen += glyph->advance;
+  }
+}
+
+void GlyphAtlas::Flush(SDL_Renderer* render, SDL_Texture* texture, const SDL_Color& color) {
+  if (batch_.empty()) {
+    return;
+  }
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+  const float tex_w = static_cast<float>(atlas_width);
+  const float tex_h = static_cast<float>(atlas_height);
+  vertices_.clear();
+  indices_.clear();
+  for (const Quad& quad : batch_) {
+    const int base = static_cast<int>(vertices_.size());
+    const float x0 = static_cast<float>(quad.dst.x), y0 = static_cast<float>(quad.dst.y);
+    const float x1 = x0 + quad.dst.w, y1 = y0 + quad.dst.h;
+    const float u0 = quad.src.x / tex_w, v0 = quad.src.y / tex_h;
+    const float u1 = (quad.src.x + quad.src.w) / tex_w, v1 = (quad.src.y + quad.src.h) / tex_h;
+    vertices_.push_back({{x0, y0}, color, {u0, v0}});
+    vertices_.push_back({{x1, y0}, color, {u1, v0}});
+    vertices_.push_back({{x1, y1}, color, {u1, v1}});
+    vertices_.push_back({{x0, y1}, color, {u0, v1}});
+    const int quad_indices[] = {base, base + 1, base + 2, base, base + 2, base + 3};
+    indices_.insert(indices_.end(), quad_indices, quad_indices + 6);
+  }
+  SDL_RenderGeometry(render, texture, vertices_.data(), static_cast<int>(vertices_.size()), indices_.data(),
+                     static_cast<int>(indices_.size()));
+#else
+  SDL_SetTextureColorMod(texture, color.r, color.g, color.b);
+  SDL_SetTextureAlphaMod(texture, color.a);
+  for (const Quad& quad : batch_) {
+    SDL_RenderCopy(render, texture, &quad.src, &quad.dst);
+  }
+#endif
+}
+
+}  // namespace draw
+}  // namespace client
+}  // namespace fastotv
@@ -0,0 +1,104 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <player/gui/widgets/font_window.h>
+
+namespace fastotv {
+namespace client {
+namespace draw {
+
+// Glyphs are rasterised once into a single texture and text is drawn as batched quads from it,
+// instead of creating a surface and a texture per string every frame.
+class GlyphAtlas {
+ public:
+  typedef fastoplayer::gui::FontWindow::DrawType DrawType;
+  enum { atlas_width = 1024, atlas_height = 1024, glyph_padding = 1 };
+
+  explicit GlyphAtlas(TTF_Font* font);
+  ~GlyphAtlas();
+
+  TTF_Font* GetFont() const;
+  int GetLineHeight() const;
+
+  int CalcTextWidth(const std::string& line);
+  std::string DotText(const std::string& line, int max_width);
+
+  void DrawText(SDL_Renderer* render,
+                const std::string& text,
+                const SDL_Rect& rect,
+                const SDL_Color& color,
+                DrawType dt);
+
+ private:
+  struct Glyph {
+    SDL_Rect src;
+    int offset;  // of the rendered surface from the pen, a negative left bearing
+    int advance;
+  };
+
+  const Glyph* FindOrRasterize(uint32_t code_point);
+  bool Rasterize(uint32_t code_point, Glyph* glyph);
+  void Reset();
+  int GetKerning(uint32_t prev, uint32_t code_point) const;  // zero for the first glyph of a line
+
+  SDL_Texture* GetTexture(SDL_Renderer* render);
+  void ReleaseTexture();
+
+  std::vector<std::string> WrapLines(const std::string& text, int max_width);
+  void DrawLine(const std::string& line, int x, int y, const SDL_Rect& clip);
+  void Flush(SDL_Renderer* render, SDL_Texture* texture, const SDL_Color& color);
+
+  TTF_Font* const font_;
+  const int line_height_;
+  const bool kerning_;
+
+  SDL_Surface* surface_;
+  SDL_Texture* texture_;
+  SDL_Renderer* texture_render_;
+  bool texture_dirty_;
+
+  // shelf packing state
+  int pen_x_;
+  int pen_y_;
+  int shelf_height_;
+  bool restarted_;
+
+  std::unordered_map<uint32_t, Glyph> glyphs_;
+
+  struct Quad {
+    SDL_Rect src;
+    SDL_Rect dst;
+  };
+  std::vector<Quad> batch_;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+  std::vector<SDL_Vertex> vertices_;
+  std::vector<int> indices_;
+#endif
+};
+
+}  // namespace draw
+}  // namespace client
+}  // namespace fastotv
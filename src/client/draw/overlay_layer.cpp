@@ -0,0 +1,179 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "client/draw/overlay_layer.h"
+
+#include <common/logger.h>
+
+namespace fastotv {
+namespace client {
+namespace draw {
+
+namespace {
+
+bool IsSameRect(const SDL_Rect& lhs, const SDL_Rect& rhs) {
+  return lhs.x == rhs.x && lhs.y == rhs.y && lhs.w == rhs.w && lhs.h == rhs.h;
+}
+
+// layer texture holds premultiplied colors after rendering with SDL_BLENDMODE_BLEND on a transparent target
+SDL_BlendMode GetPremultipliedBlendMode() {
+  return SDL_ComposeCustomBlendMode(SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+                                    SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+}
+
+}  // namespace
+
+OverlayLayer::OverlayLayer()
+    : texture_(nullptr),
+      texture_render_(nullptr),
+      width_(0),
+      height_(0),
+      supported_(true),
+      rect_(),
+      cursor_visible_(false),
+      revisions_(),
+      valid_(false),
+      targets_lost_(false) {
+  SDL_AddEventWatch(&OverlayLayer::HandleRenderReset, this);
+}
+
+OverlayLayer::~OverlayLayer() {
+  SDL_DelEventWatch(&OverlayLayer::HandleRenderReset, this);
+  Reset();
+}
+
+void OverlayLayer::SetLayout(const SDL_Rect& rect, bool cursor_visible) {
+  if (!IsSameRect(rect, rect_) || cursor_visible != cursor_visible_) {
+    rect_ = rect;
+    cursor_visible_ = cursor_visible;
+    valid_ = false;
+  }
+}
+
+bool OverlayLayer::Draw(SDL_Renderer* render, const revisions_t& revisions, draw_callback_t draw_cb) {
+  if (!render || !Prepare(render)) {
+    return false;
+  }
+
+  if (targets_lost_.exchange(false)) {
+    valid_ = false;
+  }
+
+  if (!valid_ || revisions != revisions_) {
+    SDL_Texture* prev_target = SDL_GetRenderTarget(render);
+    if (SDL_SetRenderTarget(render, texture_) != 0) {
+      WARNING_LOG() << "Overlay layer disabled, can't set render target: " << SDL_GetError();
+      supported_ = false;
+      Reset();
+      return false;
+    }
+
+    SDL_BlendMode prev_blend;
+    SDL_GetRenderDrawBlendMode(render, &prev_blend);
+    SDL_SetRenderDrawBlendMode(render, SDL_BLENDMODE_NONE);
+    SDL_SetRenderDrawColor(render, 0, 0, 0, SDL_ALPHA_TRANSPARENT);
+    SDL_RenderClear(render);
+    SDL_SetRenderDrawBlendMode(render, prev_blend);
+    if (draw_cb) {
+      draw_cb(render);
+    }
+    SDL_SetRenderTarget(render, prev_target);
+    revisions_ = revisions;
+    valid_ = true;
+  }
+
+  SDL_RenderCopy(render, texture_, nullptr, nullptr);
+  return true;
+}
+
+int OverlayLayer::HandleRenderReset(void* user_data, SDL_Event* event) {
+  if (event->type == SDL_RENDER_TARGETS_RESET || event->type == SDL_RENDER_DEVICE_RESET) {
+    OverlayLayer* layer = static_cast<OverlayLayer*>(user_data);
+    layer->targets_lost_ = true;
+  }
+  return 1;
+}
+
+bool OverlayLayer::Prepare(SDL_Renderer* render) {
+  if (!supported_) {
+    return false;
+  }
+
+  int width = 0;
+  int height = 0;
+  SDL_RenderGetLogicalSize(render, &width, &height);
+  if (width == 0 || height == 0) {
+    if (SDL_GetRendererOutputSize(render, &width, &height) != 0) {
+      return false;
+    }
+  }
+
+  if (texture_ && texture_render_ == render && width == width_ && height == height_) {
+    return true;
+  }
+
+  if (texture_render_ != render) {
+    texture_ = nullptr;  // owned by previous renderer
+  }
+  Reset();
+  if (width <= 0 || height <= 0) {
+    return false;
+  }
+
+  if (!SDL_RenderTargetSupported(render)) {
+    WARNING_LOG() << "Overlay layer disabled, render targets not supported.";
+    supported_ = false;
+    return false;
+  }
+
+  SDL_Texture* texture =
+      SDL_CreateTexture(render, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, width, height);
+  if (!texture) {
+    WARNING_LOG() << "Overlay layer disabled, can't create texture: " << SDL_GetError();
+    supported_ = false;
+    return false;
+  }
+
+  if (SDL_SetTextureBlendMode(texture, GetPremultipliedBlendMode()) != 0) {
+    WARNING_LOG() << "Overlay layer disabled, premultiplied blending not supported: " << SDL_GetError();
+    SDL_DestroyTexture(texture);
+    supported_ = false;
+    return false;
+  }
+
+  texture_ = texture;
+  texture_render_ = render;
+  width_ = width;
+  height_ = height;
+  valid_ = false;
+  return true;
+}
+
+void OverlayLayer::Reset() {
+  if (texture_) {
+    SDL_DestroyTexture(texture_);
+    texture_ = nullptr;
+  }
+  texture_render_ = nullptr;
+  width_ = 0;
+  height_ = 0;
+}
+
+}  // namespace draw
+}  // namespace client
+}  // namespace fastotv
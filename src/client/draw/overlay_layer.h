@@ -0,0 +1,71 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <vector>
+
+#include <player/gui/widgets/font_window.h>
+
+namespace fastotv {
+namespace client {
+namespace draw {
+
+// Caches overlay widgets in a render target texture, the texture is re-rendered only when a revision of
+// some widget or the layout differs from the cached one, otherwise drawing the overlays costs a single blit.
+class OverlayLayer {
+ public:
+  typedef std::function<void(SDL_Renderer* render)> draw_callback_t;
+  typedef std::vector<uint64_t> revisions_t;
+
+  OverlayLayer();
+  ~OverlayLayer();
+
+  void SetLayout(const SDL_Rect& rect, bool cursor_visible);
+
+  // returns false if layer can't be cached on this renderer, in this case draw_cb should be called directly
+  bool Draw(SDL_Renderer* render, const revisions_t& revisions, draw_callback_t draw_cb);
+
+ private:
+  // targets content is lost on device reset, not an input
+  static int SDLCALL HandleRenderReset(void* user_data, SDL_Event* event);
+
+  bool Prepare(SDL_Renderer* render);
+  void Reset();
+
+  SDL_Texture* texture_;
+  SDL_Renderer* texture_render_;
+  int width_;
+  int height_;
+  bool supported_;
+
+  SDL_Rect rect_;
+  bool cursor_visible_;
+
+  revisions_t revisions_;
+  bool valid_;
+  std::atomic<bool> targets_lost_;
+};
+
+}  // namespace draw
+}  // namespace client
+}  // namespace fastotv
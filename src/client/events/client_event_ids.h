@@ -0,0 +1,55 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+namespace fastotv {
+namespace client {
+namespace events {
+
+// offsets from USER_EVENTS of every client event, one list so no two events share an id
+enum ClientEventOffset {
+  CLIENT_DISCONNECT_EVENT_OFFSET = 1,
+  CLIENT_CONNECT_EVENT_OFFSET,
+  CLIENT_AUTHORIZED_EVENT_OFFSET,
+  CLIENT_UNAUTHORIZED_EVENT_OFFSET,
+  CLIENT_SERVER_INFO_EVENT_OFFSET,
+  CLIENT_CONFIG_CHANGE_EVENT_OFFSET,
+  CLIENT_RECEIVE_CHANNELS_EVENT_OFFSET,
+  CLIENT_RECEIVE_RUNTIME_CHANNELS_EVENT_OFFSET,
+  CLIENT_CHAT_MESSAGE_SENT_EVENT_OFFSET,
+  CLIENT_CHAT_MESSAGE_RECEIVE_EVENT_OFFSET,
+  CLIENT_NOTIFICATION_TEXT_EVENT_OFFSET,
+  CLIENT_NOTIFICATION_SHUTDOWN_EVENT_OFFSET,
+  CLIENT_ICON_DECODED_EVENT_OFFSET,
+  CLIENT_CHANNEL_ICON_DOWNLOADED_EVENT_OFFSET,
+  CLIENT_HANDSHAKE_EVENT_OFFSET,
+  CLIENT_RECEIVE_RUNTIME_CHANNELS_BATCH_EVENT_OFFSET,
+  CLIENT_RUNTIME_CHANNELS_UPDATED_EVENT_OFFSET,
+  CLIENT_EVENTS_PENDING_EVENT_OFFSET,
+  CLIENT_BANDWIDTH_ESTIMATION_EVENT_OFFSET
+};
+
+static_assert(CLIENT_BANDWIDTH_ESTIMATION_EVENT_OFFSET == 19, "client event ids are fixed, append new ones");
+
+}  // namespace events
+}  // namespace client
+}  // namespace fastotv
+
+#define CLIENT_EVENT_ID(name) \
+  static_cast<EventsType>(USER_EVENTS + fastotv::client::events::name##_OFFSET)
@@ -0,0 +1,67 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "client/events/lock_free_ring.h"
+
+namespace fastotv {
+namespace client {
+namespace events {
+
+// Preallocated slots for events of one type. Acquire builds the event in a free slot, Release destroys it and
+// hands the slot back; free slots travel through a LockFreeRing, so producers on any thread never hit the heap.
+template <typename Event>
+class EventPool {
+ public:
+  explicit EventPool(size_t capacity) : slots_(new slot_t[capacity]), free_slots_(capacity) {
+    for (size_t i = 0; i < capacity; ++i) {
+      free_slots_.Push(&slots_[i]);
+    }
+  }
+
+  template <typename... Args>
+  Event* Acquire(Args&&... args) {  // nullptr when every slot is taken
+    slot_t* slot = nullptr;
+    if (!free_slots_.Pop(&slot)) {
+      return nullptr;
+    }
+    return new (slot) Event(std::forward<Args>(args)...);
+  }
+
+  void Release(Event* event) {
+    event->~Event();
+    free_slots_.Push(reinterpret_cast<slot_t*>(event));
+  }
+
+ private:
+  typedef typename std::aligned_storage<sizeof(Event), alignof(Event)>::type slot_t;
+
+  const std::unique_ptr<slot_t[]> slots_;
+  LockFreeRing<slot_t*> free_slots_;
+};
+
+}  // namespace events
+}  // namespace client
+}  // namespace fastotv
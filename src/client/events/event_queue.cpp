@@ -0,0 +1,147 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "client/events/event_queue.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace fastotv {
+namespace client {
+namespace events {
+
+namespace {
+
+common::time64_t steady_usectime() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+EventQueue::Stats::Stats()
+    : posted(0),
+      pooled(0),
+      overflowed(0),
+      drained(0),
+      drains(0),
+      max_depth(0),
+      avg_latency_usec(0),
+      max_latency_usec(0) {}
+
+EventQueue::EventQueue(size_t capacity, notify_callback_t notify_cb, overflow_callback_t overflow_cb)
+    : notify_cb_(notify_cb),
+      overflow_cb_(overflow_cb),
+      pools_(),
+      ring_(capacity),
+      wakeup_pending_(false),
+      posted_(0),
+      pooled_(0),
+      overflowed_(0),
+      max_depth_(0),
+      drained_(0),
+      drains_(0),
+      total_latency_usec_(0),
+      max_latency_usec_(0) {}
+
+EventQueue::~EventQueue() {
+  Entry entry;
+  while (ring_.Pop(&entry)) {
+    Release(entry);
+  }
+}
+
+size_t EventQueue::Drain(handler_t handler) {
+  // events posted from now on need a new wakeup, the ones already in the ring are handled below
+  wakeup_pending_ = false;
+
+  size_t handled = 0;
+  Entry entry;
+  while (ring_.Pop(&entry)) {
+    const common::time64_t latency = steady_usectime() - entry.posted_usec;
+    total_latency_usec_ += latency;
+    max_latency_usec_ = std::max(max_latency_usec_, latency);
+    if (handler) {
+      handler(entry.event);
+    }
+    Release(entry);
+    handled++;
+  }
+
+  drained_ += handled;
+  if (handled) {
+    drains_++;
+  }
+  return handled;
+}
+
+EventQueue::Stats EventQueue::GetStats() const {
+  Stats stats;
+  stats.posted = posted_;
+  stats.pooled = pooled_;
+  stats.overflowed = overflowed_;
+  stats.drained = drained_;
+  stats.drains = drains_;
+  stats.max_depth = max_depth_;
+  stats.avg_latency_usec = drained_ ? total_latency_usec_ / static_cast<common::time64_t>(drained_) : 0;
+  stats.max_latency_usec = max_latency_usec_;
+  return stats;
+}
+
+bool EventQueue::Push(event_t* event, const Pool* pool) {
+  const Entry entry = {event, pool, steady_usectime()};
+  if (!ring_.Push(entry)) {
+    return false;
+  }
+
+  posted_++;
+  if (pool) {
+    pooled_++;
+  }
+  const size_t depth = ring_.GetSize();
+  size_t max_depth = max_depth_.load(std::memory_order_relaxed);
+  while (depth > max_depth && !max_depth_.compare_exchange_weak(max_depth, depth, std::memory_order_relaxed)) {
+  }
+
+  if (!wakeup_pending_.exchange(true) && notify_cb_) {
+    notify_cb_();
+  }
+  return true;
+}
+
+void EventQueue::Overflow(event_t* event) {
+  posted_++;
+  overflowed_++;
+  if (overflow_cb_) {
+    overflow_cb_(event);
+    return;
+  }
+  delete event;
+}
+
+void EventQueue::Release(const Entry& entry) {
+  if (entry.pool) {
+    entry.pool->release(entry.pool->pool.get(), entry.event);
+    return;
+  }
+  delete entry.event;
+}
+
+}  // namespace events
+}  // namespace client
+}  // namespace fastotv
@@ -0,0 +1,136 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+
+#include <common/types.h>  // for time64_t
+
+#include <player/gui/events_base.h>  // for Event, EventsType
+
+#include "client/events/event_pool.h"
+#include "client/events/lock_free_ring.h"
+
+namespace fastotv {
+namespace client {
+namespace events {
+
+// Hands events from the network loop and the workers to the main thread without going through the SDL queue.
+// Producers post into a LockFreeRing, events of the types given a pool are built in preallocated slots.
+// The notify callback runs once per drain, for the first event posted after it, so a burst costs one wakeup.
+// A full ring falls back to the overflow callback with a heap event, nothing is ever dropped.
+class EventQueue {
+ public:
+  typedef fastoplayer::gui::events::Event event_t;
+  typedef std::function<void()> notify_callback_t;
+  typedef std::function<void(event_t* event)> overflow_callback_t;  // takes ownership
+  typedef std::function<void(event_t* event)> handler_t;
+
+  struct Stats {
+    Stats();
+
+    uint64_t posted;
+    uint64_t pooled;      // built in a pool slot
+    uint64_t overflowed;  // went through the overflow callback
+    uint64_t drained;
+    uint64_t drains;
+    size_t max_depth;
+    common::time64_t avg_latency_usec;  // posted until handled
+    common::time64_t max_latency_usec;
+  };
+
+  EventQueue(size_t capacity, notify_callback_t notify_cb, overflow_callback_t overflow_cb);
+  ~EventQueue();  // undrained events are destroyed
+
+  template <typename Event>
+  void AddPool(size_t capacity) {  // before any producer starts
+    pools_[Event::EventType] = {std::make_shared<EventPool<Event>>(capacity), &ReleaseToPool<Event>};
+  }
+
+  template <typename Event, typename Sender, typename Info>
+  void Post(Sender* sender, const Info& info) {  // any thread
+    const Pool* pool = nullptr;
+    Event* event = nullptr;
+    auto it = pools_.find(Event::EventType);
+    if (it != pools_.end()) {
+      event = static_cast<EventPool<Event>*>(it->second.pool.get())->Acquire(sender, info);
+      pool = event ? &it->second : nullptr;
+    }
+    if (!event) {
+      event = new Event(sender, info);
+    }
+
+    if (!Push(event, pool)) {
+      if (pool) {  // the overflow path deletes what it gets
+        pool->release(pool->pool.get(), event);
+        event = new Event(sender, info);
+      }
+      Overflow(event);
+    }
+  }
+
+  size_t Drain(handler_t handler);  // main thread, returns handled count
+  Stats GetStats() const;
+
+ private:
+  struct Pool {
+    std::shared_ptr<void> pool;
+    void (*release)(void* pool, event_t* event);
+  };
+
+  struct Entry {
+    event_t* event;
+    const Pool* pool;  // nullptr for heap events
+    common::time64_t posted_usec;
+  };
+
+  template <typename Event>
+  static void ReleaseToPool(void* pool, event_t* event) {
+    static_cast<EventPool<Event>*>(pool)->Release(static_cast<Event*>(event));
+  }
+
+  bool Push(event_t* event, const Pool* pool);
+  void Overflow(event_t* event);
+  static void Release(const Entry& entry);
+
+  const notify_callback_t notify_cb_;
+  const overflow_callback_t overflow_cb_;
+  std::map<EventsType, Pool> pools_;
+  LockFreeRing<Entry> ring_;
+  std::atomic<bool> wakeup_pending_;
+
+  std::atomic<uint64_t> posted_;
+  std::atomic<uint64_t> pooled_;
+  std::atomic<uint64_t> overflowed_;
+  std::atomic<size_t> max_depth_;
+  uint64_t drained_;  // consumer side
+  uint64_t drains_;
+  common::time64_t total_latency_usec_;
+  common::time64_t max_latency_usec_;
+};
+
+}  // namespace events
+}  // namespace client
+}  // namespace fastotv
@@ -0,0 +1,35 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "client/events/icon_events.h"
+
+namespace fastotv {
+namespace client {
+namespace events {
+
+IconInfo::IconInfo() : sid(), icon() {}
+
+IconInfo::IconInfo(const stream_id_t& sid, icon_surface_t icon) : sid(sid), icon(icon) {}
+
+IconDownloadInfo::IconDownloadInfo() : sid(), path() {}
+
+IconDownloadInfo::IconDownloadInfo(const stream_id_t& sid, const std::string& path) : sid(sid), path(path) {}
+
+}  // namespace events
+}  // namespace client
+}  // namespace fastotv
@@ -0,0 +1,61 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <player/gui/events_base.h>  // for EventBase, EventsType::C...
+
+#include <fastotv/types.h>
+
+#include "client/events/client_event_ids.h"
+
+#define CLIENT_ICON_DECODED_EVENT CLIENT_EVENT_ID(CLIENT_ICON_DECODED_EVENT)
+#define CLIENT_CHANNEL_ICON_DOWNLOADED_EVENT CLIENT_EVENT_ID(CLIENT_CHANNEL_ICON_DOWNLOADED_EVENT)
+
+namespace fastotv {
+namespace client {
+namespace events {
+
+typedef std::shared_ptr<SDL_Surface> icon_surface_t;
+
+struct IconInfo {
+  IconInfo();
+  IconInfo(const stream_id_t& sid, icon_surface_t icon);
+
+  stream_id_t sid;
+  icon_surface_t icon;  // nullptr if decoding failed
+};
+
+struct IconDownloadInfo {
+  IconDownloadInfo();
+  IconDownloadInfo(const stream_id_t& sid, const std::string& path);
+
+  stream_id_t sid;
+  std::string path;
+};
+
+typedef fastoplayer::gui::events::EventBase<CLIENT_ICON_DECODED_EVENT, IconInfo> IconDecodedEvent;
+typedef fastoplayer::gui::events::EventBase<CLIENT_CHANNEL_ICON_DOWNLOADED_EVENT, IconDownloadInfo>
+    ChannelIconDownloadedEvent;
+
+}  // namespace events
+}  // namespace client
+}  // namespace fastotv
@@ -26,6 +26,11 @@ ConnectInfo::ConnectInfo() {}
 
 ConnectInfo::ConnectInfo(const common::net::HostAndPort& host) : host(host) {}
 
+BandwidthEstimationInfo::BandwidthEstimationInfo() : sid(), bandwidth(0) {}
+
+BandwidthEstimationInfo::BandwidthEstimationInfo(const stream_id_t& sid, bandwidth_t bandwidth)
+    : sid(sid), bandwidth(bandwidth) {}
+
 }  // namespace events
 }  // namespace client
 }  // namespace fastotv
@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include <common/net/types.h>  // for HostAndPort
 
 #include <player/gui/events_base.h>  // for EventBase, EventsType::C...
@@ -29,25 +31,35 @@
 #include <fastotv/commands_info/server_info.h>
 #include <fastotv/commands_info/vods_info.h>
 #include <fastotv/commands_info/shutdown_info.h>
-
-#define CLIENT_DISCONNECT_EVENT static_cast<EventsType>(USER_EVENTS + 1)
-#define CLIENT_CONNECT_EVENT static_cast<EventsType>(USER_EVENTS + 2)
-#define CLIENT_AUTHORIZED_EVENT static_cast<EventsType>(USER_EVENTS + 3)
-#define CLIENT_UNAUTHORIZED_EVENT static_cast<EventsType>(USER_EVENTS + 4)
-#define CLIENT_SERVER_INFO_EVENT static_cast<EventsType>(USER_EVENTS + 5)
-#define CLIENT_CONFIG_CHANGE_EVENT static_cast<EventsType>(USER_EVENTS + 6)
-#define CLIENT_RECEIVE_CHANNELS_EVENT static_cast<EventsType>(USER_EVENTS + 7)
-#define CLIENT_RECEIVE_RUNTIME_CHANNELS_EVENT static_cast<EventsType>(USER_EVENTS + 8)
-#define CLIENT_CHAT_MESSAGE_SENT_EVENT static_cast<EventsType>(USER_EVENTS + 9)
-#define CLIENT_CHAT_MESSAGE_RECEIVE_EVENT static_cast<EventsType>(USER_EVENTS + 10)
-#define CLIENT_NOTIFICATION_TEXT_EVENT static_cast<EventsType>(USER_EVENTS + 11)
-#define CLIENT_NOTIFICATION_SHUTDOWN_EVENT static_cast<EventsType>(USER_EVENTS + 12)
+#include <fastotv/types.h>  // for bandwidth_t
+
+#include "client/events/client_event_ids.h"
+
+#define CLIENT_DISCONNECT_EVENT CLIENT_EVENT_ID(CLIENT_DISCONNECT_EVENT)
+#define CLIENT_CONNECT_EVENT CLIENT_EVENT_ID(CLIENT_CONNECT_EVENT)
+#define CLIENT_AUTHORIZED_EVENT CLIENT_EVENT_ID(CLIENT_AUTHORIZED_EVENT)
+#define CLIENT_UNAUTHORIZED_EVENT CLIENT_EVENT_ID(CLIENT_UNAUTHORIZED_EVENT)
+#define CLIENT_SERVER_INFO_EVENT CLIENT_EVENT_ID(CLIENT_SERVER_INFO_EVENT)
+#define CLIENT_CONFIG_CHANGE_EVENT CLIENT_EVENT_ID(CLIENT_CONFIG_CHANGE_EVENT)
+#define CLIENT_RECEIVE_CHANNELS_EVENT CLIENT_EVENT_ID(CLIENT_RECEIVE_CHANNELS_EVENT)
+#define CLIENT_RECEIVE_RUNTIME_CHANNELS_EVENT CLIENT_EVENT_ID(CLIENT_RECEIVE_RUNTIME_CHANNELS_EVENT)
+#define CLIENT_CHAT_MESSAGE_SENT_EVENT CLIENT_EVENT_ID(CLIENT_CHAT_MESSAGE_SENT_EVENT)
+#define CLIENT_CHAT_MESSAGE_RECEIVE_EVENT CLIENT_EVENT_ID(CLIENT_CHAT_MESSAGE_RECEIVE_EVENT)
+#define CLIENT_NOTIFICATION_TEXT_EVENT CLIENT_EVENT_ID(CLIENT_NOTIFICATION_TEXT_EVENT)
+#define CLIENT_NOTIFICATION_SHUTDOWN_EVENT CLIENT_EVENT_ID(CLIENT_NOTIFICATION_SHUTDOWN_EVENT)
+#define CLIENT_BANDWIDTH_ESTIMATION_EVENT CLIENT_EVENT_ID(CLIENT_BANDWIDTH_ESTIMATION_EVENT)
+#define CLIENT_HANDSHAKE_EVENT CLIENT_EVENT_ID(CLIENT_HANDSHAKE_EVENT)
+#define CLIENT_RECEIVE_RUNTIME_CHANNELS_BATCH_EVENT CLIENT_EVENT_ID(CLIENT_RECEIVE_RUNTIME_CHANNELS_BATCH_EVENT)
+#define CLIENT_RUNTIME_CHANNELS_UPDATED_EVENT CLIENT_EVENT_ID(CLIENT_RUNTIME_CHANNELS_UPDATED_EVENT)
+#define CLIENT_EVENTS_PENDING_EVENT CLIENT_EVENT_ID(CLIENT_EVENTS_PENDING_EVENT)
 
 namespace fastotv {
 namespace client {
 namespace events {
 
 class TvConfig {};
+class RuntimeChannelsUpdated {};  // pushed updates are waiting in RuntimeInfoCoalescer
+class EventsPending {};           // events are waiting in EventQueue
 
 struct ConnectInfo {
   ConnectInfo();
@@ -62,6 +74,22 @@ struct ChannelsMixInfo {
   commands_info::ChannelsInfo private_channels;
 };
 
+// throughput of the playing stream as measured on the client
+struct BandwidthEstimationInfo {
+  BandwidthEstimationInfo();
+  BandwidthEstimationInfo(const stream_id_t& sid, bandwidth_t bandwidth);
+
+  stream_id_t sid;
+  bandwidth_t bandwidth;  // bytes per second
+};
+
+// results of the pipelined Login, GetServerInfo and GetChannels requests
+struct HandshakeInfo {
+  commands_info::AuthInfo auth;
+  commands_info::ServerInfo server_info;
+  ChannelsMixInfo channels;
+};
+
 typedef fastoplayer::gui::events::EventBase<CLIENT_DISCONNECT_EVENT, ConnectInfo> ClientDisconnectedEvent;
 typedef fastoplayer::gui::events::EventBase<CLIENT_CONNECT_EVENT, ConnectInfo> ClientConnectedEvent;
 typedef fastoplayer::gui::events::EventBase<CLIENT_AUTHORIZED_EVENT, commands_info::AuthInfo> ClientAuthorizedEvent;
@@ -71,10 +99,19 @@ typedef fastoplayer::gui::events::EventBase<CLIENT_CONFIG_CHANGE_EVENT, TvConfig
 typedef fastoplayer::gui::events::EventBase<CLIENT_RECEIVE_CHANNELS_EVENT, ChannelsMixInfo> ReceiveChannelsEvent;
 typedef fastoplayer::gui::events::EventBase<CLIENT_RECEIVE_RUNTIME_CHANNELS_EVENT, commands_info::RuntimeChannelInfo>
     ReceiveRuntimeChannelEvent;
+typedef fastoplayer::gui::events::EventBase<CLIENT_RECEIVE_RUNTIME_CHANNELS_BATCH_EVENT,
+                                            std::vector<commands_info::RuntimeChannelInfo>>
+    ReceiveRuntimeChannelsEvent;
+typedef fastoplayer::gui::events::EventBase<CLIENT_RUNTIME_CHANNELS_UPDATED_EVENT, RuntimeChannelsUpdated>
+    RuntimeChannelsUpdatedEvent;
+typedef fastoplayer::gui::events::EventBase<CLIENT_EVENTS_PENDING_EVENT, EventsPending> EventsPendingEvent;
 typedef fastoplayer::gui::events::EventBase<CLIENT_NOTIFICATION_TEXT_EVENT, commands_info::NotificationTextInfo>
     NotificationTextEvent;
 typedef fastoplayer::gui::events::EventBase<CLIENT_NOTIFICATION_SHUTDOWN_EVENT, commands_info::ShutDownInfo>
     NotificationShutdownEvent;
+typedef fastoplayer::gui::events::EventBase<CLIENT_HANDSHAKE_EVENT, HandshakeInfo> ClientHandshakeEvent;
+typedef fastoplayer::gui::events::EventBase<CLIENT_BANDWIDTH_ESTIMATION_EVENT, BandwidthEstimationInfo>
+    BandwidthEstimationEvent;
 
 }  // namespace events
 }  // namespace client
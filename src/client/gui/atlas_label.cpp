@@ -0,0 +1,87 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "client/gui/atlas_label.h"
+
+#include <string>
+
+#include "client/draw/glyph_atlas.h"
+
+namespace fastotv {
+namespace client {
+namespace gui {
+
+AtlasLabel::AtlasLabel(const SDL_Color& back_ground_color)
+    : base_class(back_ground_color), atlas_(nullptr), icon_(nullptr), icon_src_(), icon_size_(), space_(0) {}
+
+AtlasLabel::~AtlasLabel() {}
+
+void AtlasLabel::SetTextAtlas(draw::GlyphAtlas* atlas) {
+  atlas_ = atlas;
+}
+
+void AtlasLabel::SetIconTexture(SDL_Texture* icon) {
+  icon_ = icon;
+  icon_src_ = {0, 0, 0, 0};
+}
+
+void AtlasLabel::SetIconTexture(SDL_Texture* icon, const SDL_Rect& src) {
+  icon_ = icon;
+  icon_src_ = src;
+}
+
+void AtlasLabel::SetIconSize(const common::draw::Size& icon_size) {
+  icon_size_ = icon_size;
+}
+
+void AtlasLabel::SetSpace(int space) {
+  space_ = space;
+}
+
+void AtlasLabel::Draw(SDL_Renderer* render) {
+  if (!IsCanDraw()) {
+    base_class::Draw(render);
+    return;
+  }
+
+  fastoplayer::gui::Window::Draw(render);
+
+  SDL_Rect text_rect = GetRect();
+  if (icon_) {
+    const int icon_width = icon_size_.width();
+    const int icon_height = icon_size_.height();
+    const SDL_Rect icon_rect = {text_rect.x + space_, text_rect.y + (text_rect.h - icon_height) / 2, icon_width,
+                                icon_height};
+    SDL_RenderCopy(render, icon_, icon_src_.w > 0 ? &icon_src_ : nullptr, &icon_rect);
+    const int shift = space_ + icon_width + space_;
+    text_rect.x += shift;
+    text_rect.w -= shift;
+  }
+
+  const std::string text = GetText();
+  if (atlas_) {
+    atlas_->DrawText(render, text, text_rect, GetTextColor(), GetDrawType());
+    return;
+  }
+
+  DrawText(render, text, text_rect, GetDrawType());
+}
+
+}  // namespace gui
+}  // namespace client
+}  // namespace fastotv
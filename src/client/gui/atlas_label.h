@@ -0,0 +1,57 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <player/gui/widgets/label.h>
+
+namespace fastotv {
+namespace client {
+namespace draw {
+class GlyphAtlas;
+}
+namespace gui {
+
+// Label which draws its text from the shared glyph atlas, optionally with an icon on the left side.
+class AtlasLabel : public fastoplayer::gui::Label {
+ public:
+  typedef fastoplayer::gui::Label base_class;
+  explicit AtlasLabel(const SDL_Color& back_ground_color);
+  ~AtlasLabel() override;
+
+  void SetTextAtlas(draw::GlyphAtlas* atlas);
+
+  void SetIconTexture(SDL_Texture* icon);
+  void SetIconTexture(SDL_Texture* icon, const SDL_Rect& src);  // part of atlas texture
+  void SetIconSize(const common::draw::Size& icon_size);
+  void SetSpace(int space);
+
+  void Draw(SDL_Renderer* render) override;
+
+ private:
+  draw::GlyphAtlas* atlas_;
+
+  SDL_Texture* icon_;
+  SDL_Rect icon_src_;
+  common::draw::Size icon_size_;
+  int space_;
+};
+
+}  // namespace gui
+}  // namespace client
+}  // namespace fastotv
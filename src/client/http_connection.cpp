@@ -0,0 +1,565 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "client/http_connection.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(OS_WIN)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#define poll WSAPoll
+#else
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#endif
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+#include <algorithm>
+
+#include <common/convert2string.h>
+
+#include "client/socket_utils.h"
+
+#define POLL_SLICE_MSEC 100  // how often quit callback is checked while waiting
+
+namespace fastotv {
+namespace client {
+
+namespace {
+
+std::string to_lower(std::string str) {
+  std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+  return str;
+}
+
+std::string trim(const std::string& str) {
+  const size_t begin = str.find_first_not_of(" \t");
+  if (begin == std::string::npos) {
+    return std::string();
+  }
+  const size_t end = str.find_last_not_of(" \t");
+  return str.substr(begin, end - begin + 1);
+}
+
+std::string tls_error_string() {
+  const unsigned long err = ERR_get_error();
+  if (err == 0) {
+    return "TLS error";
+  }
+  char buff[256];
+  ERR_error_string_n(err, buff, sizeof(buff));
+  ERR_clear_error();
+  return buff;
+}
+
+}  // namespace
+
+HttpResponse::HttpResponse() : status(0), headers(), keep_alive(false) {}
+
+std::string HttpResponse::GetHeader(const std::string& name) const {
+  auto it = headers.find(name);
+  if (it == headers.end()) {
+    return std::string();
+  }
+  return it->second;
+}
+
+HttpConnection::HttpConnection(SSL_CTX* tls_ctx, const std::string& host, uint16_t port)
+    : tls_ctx_(tls_ctx),
+      host_(host),
+      port_(port),
+      fd_(INVALID_DESCRIPTOR),
+      ssl_(nullptr),
+      input_(),
+      requests_count_(0) {}
+
+HttpConnection::~HttpConnection() {
+  Close();
+}
+
+common::ErrnoError HttpConnection::Connect(quit_callback_t quit) {
+  if (IsOpen()) {
+    return common::make_errno_error(EISCONN);
+  }
+
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+
+  struct addrinfo* result = nullptr;
+  const std::string port = common::ConvertToString(port_);
+  if (getaddrinfo(host_.c_str(), port.c_str(), &hints, &result) != 0) {
+    return common::make_errno_error(EHOSTUNREACH);
+  }
+
+  common::ErrnoError err = common::make_errno_error(ECONNREFUSED);
+  for (struct addrinfo* rp = result; rp; rp = rp->ai_next) {
+    fd_ = ::socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+    if (fd_ == INVALID_DESCRIPTOR) {
+      err = common::make_errno_error(GetLastSocketError());
+      continue;
+    }
+
+    if (!SetSocketBlocking(fd_, false)) {
+      err = common::make_errno_error(GetLastSocketError());
+      Close();
+      continue;
+    }
+
+    if (::connect(fd_, rp->ai_addr, rp->ai_addrlen) == 0) {
+      err = common::ErrnoError();
+      break;
+    }
+
+    if (!IsSocketConnectInProgress(GetLastSocketError())) {
+      err = common::make_errno_error(GetLastSocketError());
+      Close();
+      continue;
+    }
+
+    err = Wait(true, quit);
+    if (!err) {
+      int so_error = 0;
+      socklen_t len = sizeof(so_error);
+      if (getsockopt(fd_, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&so_error), &len) != 0) {
+        so_error = GetLastSocketError();
+      }
+      if (so_error == 0) {
+        break;
+      }
+      err = common::make_errno_error(so_error);
+    }
+    Close();
+    if (quit()) {
+      break;
+    }
+  }
+  freeaddrinfo(result);
+
+  if (err) {
+    return err;
+  }
+
+  if (tls_ctx_) {
+    err = Handshake(quit);
+    if (err) {
+      Close();
+      return err;
+    }
+  }
+  return common::ErrnoError();
+}
+
+bool HttpConnection::IsOpen() const {
+  return fd_ != INVALID_DESCRIPTOR;
+}
+
+void HttpConnection::Close() {
+  if (ssl_) {
+    SSL_shutdown(ssl_);  // best effort close_notify, the socket is non-blocking
+    SSL_free(ssl_);
+    ssl_ = nullptr;
+  }
+  if (fd_ != INVALID_DESCRIPTOR) {
+    CloseSocket(fd_);
+    fd_ = INVALID_DESCRIPTOR;
+  }
+  input_.clear();
+}
+
+common::ErrnoError HttpConnection::Get(const std::string& path,
+                                       const headers_t& headers,
+                                       quit_callback_t quit,
+                                       body_callback_t body,
+                                       HttpResponse* response) {
+  if (!response || !body || !quit) {
+    return common::make_errno_error_inval();
+  }
+
+  *response = HttpResponse();
+  if (!IsOpen()) {
+    return common::make_errno_error(ENOTCONN);
+  }
+
+  const bool default_port = (tls_ctx_ && port_ == 443) || (!tls_ctx_ && port_ == 80);
+  std::string request = "GET " + path + " HTTP/1.1\r\nHost: " + host_;
+  if (!default_port) {
+    request += ":" + common::ConvertToString(port_);
+  }
+  request += "\r\nConnection: keep-alive\r\nAccept-Encoding: identity\r\n";
+  for (auto it = headers.begin(); it != headers.end(); ++it) {
+    request += it->first + ": " + it->second + "\r\n";
+  }
+  request += "\r\n";
+
+  common::ErrnoError err = WriteAll(request, quit);
+  if (err) {
+    Close();
+    return err;
+  }
+
+  requests_count_++;
+  err = ReadResponse(quit, body, response);
+  if (err) {
+    Close();
+    return err;
+  }
+
+  if (!response->keep_alive) {
+    Close();
+  }
+  return common::ErrnoError();
+}
+
+size_t HttpConnection::GetRequestsCount() const {
+  return requests_count_;
+}
+
+common::ErrnoError HttpConnection::Handshake(quit_callback_t quit) {
+  ssl_ = SSL_new(tls_ctx_);
+  if (!ssl_) {
+    return common::make_errno_error(tls_error_string(), ENOMEM);
+  }
+
+  SSL_set_fd(ssl_, static_cast<int>(fd_));
+  SSL_set_tlsext_host_name(ssl_, host_.c_str());
+  X509_VERIFY_PARAM_set1_host(SSL_get0_param(ssl_), host_.c_str(), 0);
+  while (true) {
+    const int res = SSL_connect(ssl_);
+    if (res == 1) {
+      return common::ErrnoError();
+    }
+
+    const int ssl_err = SSL_get_error(ssl_, res);
+    if (ssl_err != SSL_ERROR_WANT_READ && ssl_err != SSL_ERROR_WANT_WRITE) {
+      return common::make_errno_error(tls_error_string(), EPROTO);
+    }
+
+    common::ErrnoError err = Wait(ssl_err == SSL_ERROR_WANT_WRITE, quit);
+    if (err) {
+      return err;
+    }
+  }
+}
+
+common::ErrnoError HttpConnection::Wait(bool write, quit_callback_t quit) {
+  const common::time64_t deadline = GetSteadyMsec() + io_timeout_msec;
+  while (true) {
+    if (quit()) {
+      return common::make_errno_error(ECANCELED);
+    }
+
+    struct pollfd pfd;
+    pfd.fd = fd_;
+    pfd.events = write ? POLLOUT : POLLIN;
+    pfd.revents = 0;
+    const int res = poll(&pfd, 1, POLL_SLICE_MSEC);
+    if (res > 0) {
+      return common::ErrnoError();
+    }
+
+    if (res < 0 && GetLastSocketError() != EINTR) {
+      return common::make_errno_error(GetLastSocketError());
+    }
+
+    if (GetSteadyMsec() >= deadline) {
+      return common::make_errno_error(ETIMEDOUT);
+    }
+  }
+}
+
+common::ErrnoError HttpConnection::WriteAll(const std::string& data, quit_callback_t quit) {
+  size_t written = 0;
+  while (written < data.size()) {
+    const char* ptr = data.data() + written;
+    const size_t size = data.size() - written;
+    bool want_write = true;
+    if (ssl_) {
+      const int res = SSL_write(ssl_, ptr, static_cast<int>(size));
+      if (res > 0) {
+        written += res;
+        continue;
+      }
+
+      const int ssl_err = SSL_get_error(ssl_, res);
+      if (ssl_err != SSL_ERROR_WANT_READ && ssl_err != SSL_ERROR_WANT_WRITE) {
+        return common::make_errno_error(tls_error_string(), EPIPE);
+      }
+      want_write = ssl_err == SSL_ERROR_WANT_WRITE;
+    } else {
+#if defined(MSG_NOSIGNAL)
+      const int flags = MSG_NOSIGNAL;
+#else
+      const int flags = 0;
+#endif
+      const auto res = ::send(fd_, ptr, size, flags);
+      if (res >= 0) {
+        written += res;
+        continue;
+      }
+
+      const int err = GetLastSocketError();
+      if (err == EINTR) {
+        continue;
+      }
+      if (!IsSocketWouldBlock(err)) {
+        return common::make_errno_error(err);
+      }
+    }
+
+    common::ErrnoError err = Wait(want_write, quit);
+    if (err) {
+      return err;
+    }
+  }
+  return common::ErrnoError();
+}
+
+common::ErrnoError HttpConnection::ReadMore(quit_callback_t quit, bool* eof) {
+  *eof = false;
+  char buff[16 * 1024];
+  while (true) {
+    bool want_write = false;
+    if (ssl_) {
+      const int res = SSL_read(ssl_, buff, sizeof(buff));
+      if (res > 0) {
+        input_.append(buff, res);
+        return common::ErrnoError();
+      }
+
+      const int ssl_err = SSL_get_error(ssl_, res);
+      if (ssl_err == SSL_ERROR_ZERO_RETURN || (ssl_err == SSL_ERROR_SYSCALL && res == 0)) {
+        *eof = true;
+        return common::ErrnoError();
+      }
+      if (ssl_err != SSL_ERROR_WANT_READ && ssl_err != SSL_ERROR_WANT_WRITE) {
+        return common::make_errno_error(tls_error_string(), ECONNRESET);
+      }
+      want_write = ssl_err == SSL_ERROR_WANT_WRITE;
+    } else {
+      const auto res = ::recv(fd_, buff, sizeof(buff), 0);
+      if (res > 0) {
+        input_.append(buff, res);
+        return common::ErrnoError();
+      }
+      if (res == 0) {
+        *eof = true;
+        return common::ErrnoError();
+      }
+
+      const int err = GetLastSocketError();
+      if (err == EINTR) {
+        continue;
+      }
+      if (!IsSocketWouldBlock(err)) {
+        return common::make_errno_error(err);
+      }
+    }
+
+    common::ErrnoError err = Wait(want_write, quit);
+    if (err) {
+      return err;
+    }
+  }
+}
+
+common::ErrnoError HttpConnection::ReadLine(quit_callback_t quit, std::string* line) {
+  size_t pos;
+  while ((pos = input_.find('\n')) == std::string::npos) {
+    if (input_.size() > max_header_size) {
+      return common::make_errno_error(EMSGSIZE);
+    }
+
+    bool eof;
+    common::ErrnoError err = ReadMore(quit, &eof);
+    if (err) {
+      return err;
+    }
+    if (eof) {
+      return common::make_errno_error(ECONNRESET);
+    }
+  }
+
+  const size_t len = pos > 0 && input_[pos - 1] == '\r' ? pos - 1 : pos;
+  *line = input_.substr(0, len);
+  input_.erase(0, pos + 1);
+  return common::ErrnoError();
+}
+
+common::ErrnoError HttpConnection::ReadResponse(quit_callback_t quit, body_callback_t body, HttpResponse* response) {
+  std::string line;
+  bool http11 = false;
+  int status = 0;
+  std::map<std::string, std::string> headers;
+  do {  // skips interim 1xx responses
+    common::ErrnoError err = ReadLine(quit, &line);
+    if (err) {
+      return err;
+    }
+
+    const size_t space = line.find(' ');
+    if (line.compare(0, 5, "HTTP/") != 0 || space == std::string::npos) {
+      return common::make_errno_error("Invalid status line: " + line, EPROTO);
+    }
+    http11 = line.compare(0, space, "HTTP/1.0") != 0;
+    status = atoi(line.c_str() + space + 1);
+    if (status < 100 || status > 999) {
+      return common::make_errno_error("Invalid status line: " + line, EPROTO);
+    }
+
+    headers.clear();
+    size_t headers_size = 0;
+    while (true) {
+      err = ReadLine(quit, &line);
+      if (err) {
+        return err;
+      }
+      if (line.empty()) {
+        break;
+      }
+
+      headers_size += line.size();
+      if (headers_size > max_header_size) {
+        return common::make_errno_error(EMSGSIZE);
+      }
+      const size_t colon = line.find(':');
+      if (colon == std::string::npos) {
+        continue;
+      }
+      headers[to_lower(trim(line.substr(0, colon)))] = trim(line.substr(colon + 1));
+    }
+  } while (status / 100 == 1);
+
+  response->status = status;
+  response->headers = headers;
+  const std::string connection = to_lower(response->GetHeader("connection"));
+  response->keep_alive = http11 ? connection != "close" : connection == "keep-alive";
+
+  if (status == 204 || status == 304) {
+    return common::ErrnoError();
+  }
+
+  if (to_lower(response->GetHeader("transfer-encoding")).find("chunked") != std::string::npos) {
+    return ReadChunkedBody(quit, body);
+  }
+
+  const std::string content_length = response->GetHeader("content-length");
+  if (!content_length.empty()) {
+    char* end = nullptr;
+    const unsigned long long size = strtoull(content_length.c_str(), &end, 10);
+    if (*end != '\0') {
+      return common::make_errno_error("Invalid content length: " + content_length, EPROTO);
+    }
+    return ReadBody(size, quit, body);
+  }
+
+  response->keep_alive = false;
+  return ReadBodyUntilClose(quit, body);
+}
+
+common::ErrnoError HttpConnection::ReadBody(size_t size, quit_callback_t quit, body_callback_t body) {
+  while (size > 0) {
+    if (input_.empty()) {
+      bool eof;
+      common::ErrnoError err = ReadMore(quit, &eof);
+      if (err) {
+        return err;
+      }
+      if (eof) {
+        return common::make_errno_error(ECONNRESET);
+      }
+    }
+
+    const size_t chunk = std::min(size, input_.size());
+    if (!body(input_.data(), chunk)) {
+      return common::make_errno_error(ECANCELED);
+    }
+    input_.erase(0, chunk);
+    size -= chunk;
+  }
+  return common::ErrnoError();
+}
+
+common::ErrnoError HttpConnection::ReadChunkedBody(quit_callback_t quit, body_callback_t body) {
+  std::string line;
+  while (true) {
+    common::ErrnoError err = ReadLine(quit, &line);
+    if (err) {
+      return err;
+    }
+
+    char* end = nullptr;
+    const unsigned long size = strtoul(line.c_str(), &end, 16);
+    if (end == line.c_str()) {
+      return common::make_errno_error("Invalid chunk size: " + line, EPROTO);
+    }
+
+    if (size == 0) {
+      break;
+    }
+
+    err = ReadBody(size, quit, body);
+    if (err) {
+      return err;
+    }
+
+    err = ReadLine(quit, &line);
+    if (err) {
+      return err;
+    }
+  }
+
+  do {  // trailers
+    common::ErrnoError err = ReadLine(quit, &line);
+    if (err) {
+      return err;
+    }
+  } while (!line.empty());
+  return common::ErrnoError();
+}
+
+common::ErrnoError HttpConnection::ReadBodyUntilClose(quit_callback_t quit, body_callback_t body) {
+  while (true) {
+    if (!input_.empty()) {
+      if (!body(input_.data(), input_.size())) {
+        return common::make_errno_error(ECANCELED);
+      }
+      input_.clear();
+    }
+
+    bool eof;
+    common::ErrnoError err = ReadMore(quit, &eof);
+    if (err) {
+      return err;
+    }
+    if (eof) {
+      return common::ErrnoError();
+    }
+  }
+}
+
+}  // namespace client
+}  // namespace fastotv
@@ -0,0 +1,96 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <map>
+#include <string>
+
+#include <common/error.h>
+#include <common/net/types.h>  // for socket_descr_t
+
+#include "client/utils.h"  // for quit_callback_t
+
+typedef struct ssl_st SSL;
+typedef struct ssl_ctx_st SSL_CTX;
+
+namespace fastotv {
+namespace client {
+
+struct HttpResponse {
+  HttpResponse();
+
+  std::string GetHeader(const std::string& name) const;  // name in lower case
+
+  int status;  // 0 until the status line is received
+  std::map<std::string, std::string> headers;  // keys in lower case
+  bool keep_alive;
+};
+
+// Blocking HTTP/1.1 client connection which can be reused for several requests to one host.
+// Plain http when tls_ctx is null, otherwise https with the server certificate checked against host.
+// I/O is non-blocking underneath so every wait can be interrupted by quit_callback_t.
+class HttpConnection {
+ public:
+  typedef std::map<std::string, std::string> headers_t;
+  typedef std::function<bool(const char* data, size_t size)> body_callback_t;  // false aborts the request
+
+  enum { io_timeout_msec = 10000, max_header_size = 64 * 1024 };
+
+  HttpConnection(SSL_CTX* tls_ctx, const std::string& host, uint16_t port);
+  ~HttpConnection();
+
+  common::ErrnoError Connect(quit_callback_t quit);
+  bool IsOpen() const;
+  void Close();
+
+  // the connection is closed on error or if the server doesn't keep it alive
+  common::ErrnoError Get(const std::string& path,
+                         const headers_t& headers,
+                         quit_callback_t quit,
+                         body_callback_t body,
+                         HttpResponse* response);
+  size_t GetRequestsCount() const;
+
+ private:
+  common::ErrnoError Handshake(quit_callback_t quit);
+  common::ErrnoError Wait(bool write, quit_callback_t quit);
+  common::ErrnoError WriteAll(const std::string& data, quit_callback_t quit);
+  common::ErrnoError ReadMore(quit_callback_t quit, bool* eof);
+  common::ErrnoError ReadResponse(quit_callback_t quit, body_callback_t body, HttpResponse* response);
+  common::ErrnoError ReadLine(quit_callback_t quit, std::string* line);
+  common::ErrnoError ReadBody(size_t size, quit_callback_t quit, body_callback_t body);
+  common::ErrnoError ReadChunkedBody(quit_callback_t quit, body_callback_t body);
+  common::ErrnoError ReadBodyUntilClose(quit_callback_t quit, body_callback_t body);
+
+  SSL_CTX* const tls_ctx_;
+  const std::string host_;
+  const uint16_t port_;
+
+  common::net::socket_descr_t fd_;
+  SSL* ssl_;
+  std::string input_;  // received, not yet consumed bytes
+  size_t requests_count_;
+};
+
+}  // namespace client
+}  // namespace fastotv
@@ -0,0 +1,45 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "client/inner/connection_options.h"
+
+namespace fastotv {
+namespace client {
+namespace inner {
+
+ConnectionOptions::ConnectionOptions()
+    : reconnect_min_delay_msec(default_reconnect_min_delay_msec),
+      reconnect_max_delay_msec(default_reconnect_max_delay_msec),
+      connect_timeout_msec(default_connect_timeout_msec),
+      request_timeout_msec(default_request_timeout_msec),
+      request_max_retries(default_request_max_retries),
+      keepalive_interval_msec(default_keepalive_interval_msec),
+      icon_fetch_parallelism(default_icon_fetch_parallelism),
+      tls(false),
+      tls_verify_peer(true),
+      tls_sessions_path() {}
+
+bool ConnectionOptions::IsValid() const {
+  return reconnect_min_delay_msec > 0 && reconnect_max_delay_msec >= reconnect_min_delay_msec &&
+         connect_timeout_msec > 0 && request_timeout_msec > 0 && request_max_retries >= 0 &&
+         keepalive_interval_msec > 0 && icon_fetch_parallelism > 0;
+}
+
+}  // namespace inner
+}  // namespace client
+}  // namespace fastotv
@@ -0,0 +1,56 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+
+namespace fastotv {
+namespace client {
+namespace inner {
+
+struct ConnectionOptions {
+  enum {
+    default_reconnect_min_delay_msec = 1000,
+    default_reconnect_max_delay_msec = 5 * 60 * 1000,
+    default_connect_timeout_msec = 10000,
+    default_request_timeout_msec = 15000,
+    default_request_max_retries = 2,
+    default_keepalive_interval_msec = 30000,
+    default_icon_fetch_parallelism = 4
+  };
+
+  ConnectionOptions();
+
+  bool IsValid() const;
+
+  int reconnect_min_delay_msec;   // first retry delay, doubled on every failed attempt
+  int reconnect_max_delay_msec;   // backoff cap
+  int connect_timeout_msec;       // how long a connect attempt may stay in progress
+  int request_timeout_msec;       // wait for an answer, doubled for every retry
+  int request_max_retries;        // resends of idempotent requests before giving up
+  int keepalive_interval_msec;    // idle time before the server is pinged
+  int icon_fetch_parallelism;     // channel icons downloaded at the same time
+  bool tls;                       // control channel over tls, a failed handshake fails the attempt
+  bool tls_verify_peer;           // server certificate checked against the host name
+  std::string tls_sessions_path;  // sessions for resumption survive restarts there, empty keeps them in memory
+};
+
+}  // namespace inner
+}  // namespace client
+}  // namespace fastotv
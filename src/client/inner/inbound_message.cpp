@@ -0,0 +1,187 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "client/inner/inbound_message.h"
+
+#include <json-c/json_object.h>
+#include <json-c/json_tokener.h>
+
+#define JSONRPC_ID_FIELD "id"
+#define JSONRPC_METHOD_FIELD "method"
+#define JSONRPC_PARAMS_FIELD "params"
+#define JSONRPC_RESULT_FIELD "result"
+#define JSONRPC_ERROR_FIELD "error"
+#define JSONRPC_ERROR_MESSAGE_FIELD "message"
+
+namespace fastotv {
+namespace client {
+namespace inner {
+
+InboundMessage::InboundMessage()
+    : tokener_(json_tokener_new()),
+      jmessage_(nullptr),
+      type_(INVALID_MESSAGE),
+      format_(JSON_WIRE_FORMAT),
+      id_(),
+      method_(),
+      jparams_(nullptr),
+      jresult_(nullptr),
+      jerror_(nullptr),
+      error_message_() {}
+
+InboundMessage::~InboundMessage() {
+  Clear();
+  json_tokener_free(tokener_);
+}
+
+common::Error InboundMessage::Parse(const char* data, size_t size, WireFormat format) {
+  Clear();
+  if (!data || !size) {
+    return common::make_error_inval();
+  }
+
+  json_object* jmessage = nullptr;
+  if (format == MSGPACK_WIRE_FORMAT) {
+    common::Error err = DecodeMsgPack(data, size, &jmessage);
+    if (err) {
+      return err;
+    }
+  } else {
+    json_tokener_reset(tokener_);
+    jmessage = json_tokener_parse_ex(tokener_, data, static_cast<int>(size));
+    if (!jmessage) {
+      const enum json_tokener_error jerr = json_tokener_get_error(tokener_);
+      return common::make_error(std::string("Invalid json message: ") + json_tokener_error_desc(jerr));
+    }
+  }
+
+  common::Error err = Assign(jmessage);
+  if (!err) {
+    format_ = format;
+  }
+  return err;
+}
+
+common::Error InboundMessage::Assign(json_object* jmessage) {
+  Clear();
+  if (!jmessage) {
+    return common::make_error_inval();
+  }
+
+  jmessage_ = jmessage;
+  if (!json_object_is_type(jmessage, json_type_object)) {
+    Clear();
+    return common::make_error("Invalid JSON-RPC message");
+  }
+
+  json_object* jid = nullptr;
+  if (json_object_object_get_ex(jmessage, JSONRPC_ID_FIELD, &jid) && jid) {
+    id_ = std::string(json_object_get_string(jid));
+  }
+
+  json_object* jmethod = nullptr;
+  if (json_object_object_get_ex(jmessage, JSONRPC_METHOD_FIELD, &jmethod) && jmethod) {
+    type_ = REQUEST_MESSAGE;
+    method_ = json_object_get_string(jmethod);
+    json_object_object_get_ex(jmessage, JSONRPC_PARAMS_FIELD, &jparams_);
+    return common::Error();
+  }
+
+  if (json_object_object_get_ex(jmessage, JSONRPC_ERROR_FIELD, &jerror_) && jerror_) {
+    type_ = RESPONSE_MESSAGE;
+    json_object* jerror_message = nullptr;
+    if (json_object_object_get_ex(jerror_, JSONRPC_ERROR_MESSAGE_FIELD, &jerror_message)) {
+      error_message_ = json_object_get_string(jerror_message);
+    }
+    return common::Error();
+  }
+
+  if (json_object_object_get_ex(jmessage, JSONRPC_RESULT_FIELD, &jresult_)) {  // null result is still a reply
+    type_ = RESPONSE_MESSAGE;
+    return common::Error();
+  }
+
+  Clear();
+  return common::make_error("Invalid JSON-RPC message");
+}
+
+void InboundMessage::AssignError(const protocol::sequance_id_t& id, const std::string& message) {
+  Clear();
+  jerror_ = json_object_new_object();
+  json_object_object_add(jerror_, JSONRPC_ERROR_MESSAGE_FIELD, json_object_new_string(message.c_str()));
+  jmessage_ = json_object_new_object();
+  json_object_object_add(jmessage_, JSONRPC_ERROR_FIELD, jerror_);
+  type_ = RESPONSE_MESSAGE;
+  id_ = id;
+  error_message_ = message;
+}
+
+void InboundMessage::Clear() {
+  if (jmessage_) {
+    json_object_put(jmessage_);
+    jmessage_ = nullptr;
+  }
+  type_ = INVALID_MESSAGE;
+  format_ = JSON_WIRE_FORMAT;
+  id_ = protocol::sequance_id_t();
+  method_.clear();  // keeps capacity for the next message
+  jparams_ = nullptr;
+  jresult_ = nullptr;
+  jerror_ = nullptr;
+  error_message_.clear();
+}
+
+bool InboundMessage::IsRequest() const {
+  return type_ == REQUEST_MESSAGE;
+}
+
+bool InboundMessage::IsResponse() const {
+  return type_ == RESPONSE_MESSAGE;
+}
+
+bool InboundMessage::IsError() const {
+  return type_ == RESPONSE_MESSAGE && jerror_;
+}
+
+const protocol::sequance_id_t& InboundMessage::GetID() const {
+  return id_;
+}
+
+const std::string& InboundMessage::GetMethod() const {
+  return method_;
+}
+
+json_object* InboundMessage::GetParams() const {
+  return jparams_;
+}
+
+json_object* InboundMessage::GetResult() const {
+  return jresult_;
+}
+
+const std::string& InboundMessage::GetErrorMessage() const {
+  return error_message_;
+}
+
+WireFormat InboundMessage::GetFormat() const {
+  return format_;
+}
+
+}  // namespace inner
+}  // namespace client
+}  // namespace fastotv
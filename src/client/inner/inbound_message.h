@@ -0,0 +1,82 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include <string>
+
+#include <common/error.h>
+
+#include <fastotv/protocol/types.h>
+
+#include "client/inner/wire_format.h"
+
+struct json_object;
+struct json_tokener;
+
+namespace fastotv {
+namespace client {
+namespace inner {
+
+// One inbound JSON-RPC message, parsed once into a DOM which every handler reads params and result from.
+// The instance is reused for the whole connection, so the tokener and the strings keep their allocations.
+class InboundMessage {
+ public:
+  InboundMessage();
+  ~InboundMessage();
+
+  // decoded as format, previous message parts become invalid
+  common::Error Parse(const char* data, size_t size, WireFormat format) WARN_UNUSED_RESULT;
+  // takes ownership of jmessage
+  common::Error Assign(json_object* jmessage) WARN_UNUSED_RESULT;
+  // error response made on this side, e.g. for a request which was never answered
+  void AssignError(const protocol::sequance_id_t& id, const std::string& message);
+  void Clear();
+
+  bool IsRequest() const;
+  bool IsResponse() const;
+  bool IsError() const;  // response with error member
+
+  const protocol::sequance_id_t& GetID() const;
+  const std::string& GetMethod() const;
+  json_object* GetParams() const;  // nullptr when absent
+  json_object* GetResult() const;  // nullptr for errors
+  const std::string& GetErrorMessage() const;
+  WireFormat GetFormat() const;  // the message was decoded from, json for the ones made on this side
+
+ private:
+  enum Type { INVALID_MESSAGE = 0, REQUEST_MESSAGE, RESPONSE_MESSAGE };
+
+  json_tokener* tokener_;
+  json_object* jmessage_;
+  Type type_;
+  WireFormat format_;
+
+  protocol::sequance_id_t id_;
+  std::string method_;
+  json_object* jparams_;
+  json_object* jresult_;
+  json_object* jerror_;
+  std::string error_message_;
+};
+
+}  // namespace inner
+}  // namespace client
+}  // namespace fastotv
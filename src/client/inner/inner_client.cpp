@@ -0,0 +1,324 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "client/inner/inner_client.h"
+
+#include <errno.h>
+
+#include <json-c/json_object.h>
+#include <json-c/json_tokener.h>
+
+#include <common/daemon/commands/ping_info.h>
+
+#include <fastotv/commands/commands.h>
+
+#include "client/inner/tls_transport.h"
+#include "client/socket_utils.h"
+
+#define RUNTIME_CHANNELS_IDS_FIELD "ids"
+#define RUNTIME_CHANNELS_CHANNELS_FIELD "channels"
+#define WIRE_FORMAT_FIELD "format"
+#define COMPRESSION_CODEC_FIELD "codec"
+#define COMPRESSION_DICTIONARY_ID_FIELD "dictionary_id"
+
+#define FRAME_STALL_TIMEOUT_MSEC 10000  // the rest of a started frame must move within that
+
+namespace fastotv {
+namespace client {
+namespace inner {
+
+namespace {
+
+bool is_would_block(common::ErrnoError err) {
+  return err->GetErrorCode() == EAGAIN || IsSocketWouldBlock(err->GetErrorCode());
+}
+
+common::Error parse_runtime_channels(json_object* jchannels, InnerClient::runtime_channels_t* channels) {
+  if (!json_object_is_type(jchannels, json_type_array)) {
+    return common::make_error_inval();
+  }
+
+  InnerClient::runtime_channels_t parsed;
+  const size_t len = json_object_array_length(jchannels);
+  for (size_t i = 0; i < len; ++i) {
+    commands_info::RuntimeChannelInfo chan;
+    common::Error err = chan.DeSerialize(json_object_array_get_idx(jchannels, i));
+    if (err) {
+      return err;
+    }
+    parsed.push_back(chan);
+  }
+
+  *channels = parsed;
+  return common::Error();
+}
+
+}  // namespace
+
+InnerClient::InnerClient(common::libev::IoLoop* server, const common::net::socket_info& info)
+    : base_class(server, info), request_sent_cb_(), tls_(nullptr) {}
+
+InnerClient::~InnerClient() {
+  delete tls_;
+}
+
+void InnerClient::SetTls(TlsTransport* tls) {
+  delete tls_;
+  tls_ = tls;
+}
+
+TlsTransport* InnerClient::GetTls() const {
+  return tls_;
+}
+
+bool InnerClient::IsReadable() const {
+  return !tls_ || tls_->HasApplicationData();
+}
+
+bool InnerClient::HasBufferedInput() const {
+  return tls_ && tls_->HasBufferedInput();
+}
+
+void InnerClient::SetRequestSentCallback(request_sent_callback_t cb) {
+  request_sent_cb_ = cb;
+}
+
+common::ErrnoError InnerClient::Login(const commands_info::AuthInfo& auth) {
+  std::string auth_str;
+  common::Error err_ser = auth.SerializeToString(&auth_str);
+  if (err_ser) {
+    const std::string err_str = err_ser->GetDescription();
+    return common::make_errno_error(err_str, EAGAIN);
+  }
+
+  return SendRequest(CLIENT_LOGIN, auth_str);
+}
+
+common::ErrnoError InnerClient::GetServerInfo() {
+  return SendRequest(CLIENT_GET_SERVER_INFO, std::string());
+}
+
+common::ErrnoError InnerClient::GetChannels() {
+  return SendRequest(CLIENT_GET_CHANNELS, std::string());
+}
+
+common::ErrnoError InnerClient::GetRuntimeChannelsInfo(const std::vector<stream_id_t>& sids) {
+  return WriteStreamsRequest(CLIENT_GET_RUNTIME_CHANNELS_INFO, sids);
+}
+
+common::ErrnoError InnerClient::SubscribeRuntimeChannelsInfo(const std::vector<stream_id_t>& sids) {
+  return WriteStreamsRequest(CLIENT_SUBSCRIBE_RUNTIME_CHANNELS_INFO, sids);
+}
+
+common::ErrnoError InnerClient::SetWireFormat(WireFormat format) {
+  json_object* jparams = json_object_new_object();
+  json_object_object_add(jparams, WIRE_FORMAT_FIELD, json_object_new_string(ConvertWireFormatToString(format)));
+  const std::string params = json_object_get_string(jparams);
+  json_object_put(jparams);
+  return SendRequest(CLIENT_SET_WIRE_FORMAT, params);
+}
+
+common::ErrnoError InnerClient::SetCompression(const std::string& codec, uint32_t dictionary_id) {
+  json_object* jparams = json_object_new_object();
+  json_object_object_add(jparams, COMPRESSION_CODEC_FIELD, json_object_new_string(codec.c_str()));
+  json_object_object_add(jparams, COMPRESSION_DICTIONARY_ID_FIELD, json_object_new_int64(dictionary_id));
+  const std::string params = json_object_get_string(jparams);
+  json_object_put(jparams);
+  return SendRequest(CLIENT_SET_COMPRESSION, params);
+}
+
+common::ErrnoError InnerClient::SendPing(protocol::sequance_id_t* id) {
+  if (!id) {
+    return common::make_errno_error_inval();
+  }
+
+  std::string ping_str;
+  common::Error err_ser = common::daemon::commands::ClientPingInfo().SerializeToString(&ping_str);
+  if (err_ser) {
+    const std::string err_str = err_ser->GetDescription();
+    return common::make_errno_error(err_str, EAGAIN);
+  }
+
+  protocol::request_t req;
+  req.id = NextRequestID();
+  req.method = CLIENT_PING;
+  req.params = ping_str;
+  common::ErrnoError err = WriteRequest(req);
+  if (err) {
+    return err;
+  }
+
+  *id = req.id;
+  return common::ErrnoError();
+}
+
+common::ErrnoError InnerClient::ResendRequest(const protocol::request_t& req, protocol::request_t* resent) {
+  if (!resent) {
+    return common::make_errno_error_inval();
+  }
+
+  protocol::request_t copy = req;
+  copy.id = NextRequestID();
+  common::ErrnoError err = WriteRequest(copy);
+  if (err) {
+    return err;
+  }
+
+  *resent = copy;
+  return common::ErrnoError();
+}
+
+// the protocol reads and writes a frame with a single call as on a blocking socket, but the socket stays
+// non-blocking for the loop and the tls readability check, so a frame split across segments or a full send buffer
+// waits for the socket here; the loop only calls in once the socket is ready, a frame never starts with a wait
+common::ErrnoError InnerClient::DoSingleWrite(const void* data, size_t size, size_t* nwrite_out) {
+  const char* ptr = static_cast<const char*>(data);
+  size_t total = 0;
+  while (total < size) {
+    size_t nwrite = 0;
+    common::ErrnoError err = tls_ ? tls_->Write(ptr + total, size - total, &nwrite)
+                                  : base_class::DoSingleWrite(ptr + total, size - total, &nwrite);
+    if (err) {
+      if (!is_would_block(err)) {
+        return err;
+      }
+      err = WaitSocket(GetInfo().fd(), !tls_ || tls_->WantsWrite(), FRAME_STALL_TIMEOUT_MSEC);
+      if (err) {
+        return err;
+      }
+      continue;
+    }
+
+    total += nwrite;
+  }
+
+  *nwrite_out = total;
+  return common::ErrnoError();
+}
+
+common::ErrnoError InnerClient::DoSingleRead(void* out, size_t max_size, size_t* nread) {
+  char* ptr = static_cast<char*>(out);
+  size_t total = 0;
+  while (total < max_size) {
+    size_t chunk = 0;
+    common::ErrnoError err = tls_ ? tls_->Read(ptr + total, max_size - total, &chunk)
+                                  : base_class::DoSingleRead(ptr + total, max_size - total, &chunk);
+    if (err) {
+      if (!is_would_block(err)) {
+        return err;
+      }
+      err = WaitSocket(GetInfo().fd(), tls_ && tls_->WantsWrite(), FRAME_STALL_TIMEOUT_MSEC);
+      if (err) {
+        return err;
+      }
+      continue;
+    }
+
+    if (chunk == 0) {  // closed by the peer, the protocol tells a short frame
+      break;
+    }
+    total += chunk;
+  }
+
+  *nread = total;
+  return common::ErrnoError();
+}
+
+common::ErrnoError InnerClient::SendRequest(const std::string& method, const std::string& params) {
+  protocol::request_t req;
+  req.id = NextRequestID();
+  req.method = method;
+  if (!params.empty()) {
+    req.params = params;
+  }
+  common::ErrnoError err = WriteRequest(req);
+  if (err) {
+    return err;
+  }
+
+  if (request_sent_cb_) {
+    request_sent_cb_(req);
+  }
+  return common::ErrnoError();
+}
+
+common::ErrnoError InnerClient::WriteStreamsRequest(const std::string& method, const std::vector<stream_id_t>& sids) {
+  json_object* jids = json_object_new_array();
+  for (const stream_id_t& sid : sids) {
+    json_object_array_add(jids, json_object_new_string(sid.c_str()));
+  }
+  json_object* jparams = json_object_new_object();
+  json_object_object_add(jparams, RUNTIME_CHANNELS_IDS_FIELD, jids);
+  const std::string params = json_object_get_string(jparams);
+  json_object_put(jparams);
+  return SendRequest(method, params);
+}
+
+common::Error InnerClient::ParseRuntimeChannelsRequest(const std::string& params, std::vector<stream_id_t>* sids) {
+  if (!sids) {
+    return common::make_error_inval();
+  }
+
+  json_object* jparams = json_tokener_parse(params.c_str());
+  if (!jparams) {
+    return common::make_error_inval();
+  }
+
+  json_object* jids = nullptr;
+  json_bool jids_exists = json_object_object_get_ex(jparams, RUNTIME_CHANNELS_IDS_FIELD, &jids);
+  if (!jids_exists || !json_object_is_type(jids, json_type_array)) {
+    json_object_put(jparams);
+    return common::make_error_inval();
+  }
+
+  std::vector<stream_id_t> result;
+  const size_t len = json_object_array_length(jids);
+  for (size_t i = 0; i < len; ++i) {
+    json_object* jid = json_object_array_get_idx(jids, i);
+    result.push_back(json_object_get_string(jid));
+  }
+  json_object_put(jparams);
+  *sids = result;
+  return common::Error();
+}
+
+common::Error InnerClient::ParseRuntimeChannelsResponce(json_object* jresult, runtime_channels_t* channels) {
+  if (!jresult || !channels) {
+    return common::make_error_inval();
+  }
+
+  return parse_runtime_channels(jresult, channels);
+}
+
+common::Error InnerClient::ParseRuntimeChannelsNotification(json_object* jparams, runtime_channels_t* channels) {
+  if (!jparams || !channels) {
+    return common::make_error_inval();
+  }
+
+  json_object* jchannels = nullptr;
+  json_bool jchannels_exists = json_object_object_get_ex(jparams, RUNTIME_CHANNELS_CHANNELS_FIELD, &jchannels);
+  if (!jchannels_exists) {
+    return common::make_error_inval();
+  }
+
+  return parse_runtime_channels(jchannels, channels);
+}
+
+}  // namespace inner
+}  // namespace client
+}  // namespace fastotv
@@ -0,0 +1,103 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <fastotv/client/client.h>
+#include <fastotv/commands_info/auth_info.h>
+#include <fastotv/commands_info/runtime_channel_info.h>
+
+#include "client/inner/wire_format.h"
+
+#define CLIENT_GET_RUNTIME_CHANNELS_INFO "get_runtime_channels_info"
+#define CLIENT_SUBSCRIBE_RUNTIME_CHANNELS_INFO "subscribe_runtime_channels_info"
+#define SERVER_RUNTIME_CHANNELS_INFO "runtime_channels_info"
+#define CLIENT_SET_WIRE_FORMAT "set_wire_format"
+#define CLIENT_SET_COMPRESSION "set_compression"
+
+namespace fastotv {
+namespace client {
+namespace inner {
+
+class TlsTransport;
+
+// Client with requests which are not part of the base protocol yet.
+class InnerClient : public Client {
+ public:
+  typedef Client base_class;
+  typedef std::vector<commands_info::RuntimeChannelInfo> runtime_channels_t;
+  typedef std::function<void(const protocol::request_t& req)> request_sent_callback_t;
+
+  InnerClient(common::libev::IoLoop* server, const common::net::socket_info& info);
+  ~InnerClient() override;
+
+  // from now on all I/O goes through tls, takes ownership
+  void SetTls(TlsTransport* tls);
+  TlsTransport* GetTls() const;
+  // a readable tls socket may carry no command yet, reading it would fail with EAGAIN
+  bool IsReadable() const;
+  // decrypted input left after a read, the loop won't report it as readable again
+  bool HasBufferedInput() const;
+
+  // every request written by the methods below is reported, so its answer can be awaited with a deadline
+  void SetRequestSentCallback(request_sent_callback_t cb);
+
+  // same requests as in the base class, sent through SendRequest
+  common::ErrnoError Login(const commands_info::AuthInfo& auth) WARN_UNUSED_RESULT;
+  common::ErrnoError GetServerInfo() WARN_UNUSED_RESULT;
+  common::ErrnoError GetChannels() WARN_UNUSED_RESULT;
+
+  // one request for many streams, answered with an array of runtime infos
+  common::ErrnoError GetRuntimeChannelsInfo(const std::vector<stream_id_t>& sids) WARN_UNUSED_RESULT;
+  // replaces the set of streams the server pushes runtime info changes for, empty list unsubscribes
+  common::ErrnoError SubscribeRuntimeChannelsInfo(const std::vector<stream_id_t>& sids) WARN_UNUSED_RESULT;
+  // asks the server to encode the following messages in format, servers which don't know it answer with error
+  common::ErrnoError SetWireFormat(WireFormat format) WARN_UNUSED_RESULT;
+  // lets the server compress large results with codec, dictionary_id zero means no dictionary
+  common::ErrnoError SetCompression(const std::string& codec, uint32_t dictionary_id) WARN_UNUSED_RESULT;
+  // keepalive probe, not reported to the callback: the keepalive monitor waits for the answer with its own rto
+  common::ErrnoError SendPing(protocol::sequance_id_t* id) WARN_UNUSED_RESULT;
+  // writes req again under a new id, not reported to the callback
+  common::ErrnoError ResendRequest(const protocol::request_t& req, protocol::request_t* resent) WARN_UNUSED_RESULT;
+
+  static common::Error ParseRuntimeChannelsRequest(const std::string& params,
+                                                   std::vector<stream_id_t>* sids) WARN_UNUSED_RESULT;
+  static common::Error ParseRuntimeChannelsResponce(json_object* jresult,
+                                                    runtime_channels_t* channels) WARN_UNUSED_RESULT;
+  static common::Error ParseRuntimeChannelsNotification(json_object* jparams,
+                                                        runtime_channels_t* channels) WARN_UNUSED_RESULT;
+
+ protected:
+  common::ErrnoError DoSingleWrite(const void* data, size_t size, size_t* nwrite_out) override;
+  common::ErrnoError DoSingleRead(void* out, size_t max_size, size_t* nread) override;
+
+ private:
+  common::ErrnoError SendRequest(const std::string& method, const std::string& params);
+  common::ErrnoError WriteStreamsRequest(const std::string& method, const std::vector<stream_id_t>& sids);
+
+  request_sent_callback_t request_sent_cb_;
+  TlsTransport* tls_;
+};
+
+}  // namespace inner
+}  // namespace client
+}  // namespace fastotv
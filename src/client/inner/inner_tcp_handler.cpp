@@ -18,14 +18,42 @@
 
 #include "client/inner/inner_tcp_handler.h"
 
+#include <errno.h>
+#include <string.h>
+
+#if defined(OS_WIN)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
 #include <algorithm>
+#include <limits>
 #include <string>
 
+#include <openssl/ssl.h>
+
 #include <common/application/application.h>  // for fApp
+#include <common/convert2string.h>
+#include <common/file_system/file_system.h>
+#include <common/file_system/string_path_utils.h>
+#include <common/libev/io_client.h>          // for IoClient
 #include <common/libev/io_loop.h>            // for IoLoop
-#include <common/net/net.h>                  // for connect
+#include <common/net/net.h>                  // for socket_info
+#include <common/time.h>
+#include <common/utils.h>  // for destroy
 
+#include "client/events/event_queue.h"
 #include "client/events/network_events.h"  // for BandwidtInfo, Con...
+#include "client/inner/inner_client.h"
+#include "client/inner/tls_session_cache.h"
+#include "client/inner/tls_transport.h"
+#include "client/live_stream/runtime_info_coalescer.h"
+#include "client/socket_utils.h"
 
 #include <fastotv/client/client.h>
 #include <fastotv/commands/commands.h>
@@ -37,23 +65,193 @@
 #define VODS_ARRAY_FIELD "vods"
 #define PRIVATE_CHANNELS_ARRAY_FIELD "private_channels"
 
+#define CHANNELS_DICTIONARY_PATH_RELATIVE "share/resources/channels.zdict"
+
+#define TCP_KEEPALIVE_IDLE_SEC 30
+#define TCP_KEEPALIVE_INTERVAL_SEC 10
+#define TCP_KEEPALIVE_PROBES 3
+#define TCP_USER_TIMEOUT_MSEC 30000
+
 namespace fastotv {
 namespace client {
 namespace inner {
 
-InnerTcpHandler::InnerTcpHandler(const common::net::HostAndPort& server_host, const commands_info::AuthInfo& auth_info)
+namespace {
+
+// the kernel gives up on unacknowledged data after TCP_USER_TIMEOUT_MSEC and probes idle connections,
+// so a half-open connection fails the socket even when nothing is written; best effort, errors are ignored
+void set_keepalive_options(common::net::socket_descr_t fd) {
+  int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, reinterpret_cast<const char*>(&on), sizeof(on));
+#if defined(TCP_KEEPIDLE) && defined(TCP_KEEPINTVL) && defined(TCP_KEEPCNT)
+  int idle = TCP_KEEPALIVE_IDLE_SEC;
+  int interval = TCP_KEEPALIVE_INTERVAL_SEC;
+  int probes = TCP_KEEPALIVE_PROBES;
+  setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, reinterpret_cast<const char*>(&idle), sizeof(idle));
+  setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, reinterpret_cast<const char*>(&interval), sizeof(interval));
+  setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, reinterpret_cast<const char*>(&probes), sizeof(probes));
+#endif
+#if defined(TCP_USER_TIMEOUT)
+  unsigned int user_timeout = TCP_USER_TIMEOUT_MSEC;
+  setsockopt(fd, IPPROTO_TCP, TCP_USER_TIMEOUT, reinterpret_cast<const char*>(&user_timeout), sizeof(user_timeout));
+#endif
+}
+
+// starts connect on a non-blocking socket, completion is reported by the loop when the socket becomes writable
+common::ErrnoError connect_nonblocking(const common::net::HostAndPort& host, common::net::socket_info* out_info) {
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+
+  struct addrinfo* result = nullptr;
+  const std::string port = common::ConvertToString(host.GetPort());
+  if (getaddrinfo(host.GetHost().c_str(), port.c_str(), &hints, &result) != 0) {
+    return common::make_errno_error(EHOSTUNREACH);
+  }
+
+  common::ErrnoError err = common::make_errno_error(ECONNREFUSED);
+  for (struct addrinfo* rp = result; rp; rp = rp->ai_next) {
+    common::net::socket_descr_t fd = ::socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+    if (fd == INVALID_DESCRIPTOR) {
+      err = common::make_errno_error(GetLastSocketError());
+      continue;
+    }
+
+    if (!SetSocketBlocking(fd, false)) {
+      err = common::make_errno_error(GetLastSocketError());
+      CloseSocket(fd);
+      continue;
+    }
+    set_keepalive_options(fd);
+
+    if (::connect(fd, rp->ai_addr, rp->ai_addrlen) == 0 || IsSocketConnectInProgress(GetLastSocketError())) {
+      *out_info = common::net::socket_info(fd, rp);
+      freeaddrinfo(result);
+      return common::ErrnoError();
+    }
+
+    err = common::make_errno_error(GetLastSocketError());
+    CloseSocket(fd);
+  }
+
+  freeaddrinfo(result);
+  return err;
+}
+
+common::ErrnoError get_connect_result(common::net::socket_descr_t fd) {
+  int so_error = 0;
+  socklen_t len = sizeof(so_error);
+  if (getsockopt(fd, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&so_error), &len) != 0) {
+    return common::make_errno_error(GetLastSocketError());
+  }
+
+  if (so_error != 0) {
+    return common::make_errno_error(so_error);
+  }
+  return common::ErrnoError();
+}
+
+}  // namespace
+
+InnerTcpHandler::HandshakeState::HandshakeState() : pending(0), login_error(), error(), info() {}
+
+InnerTcpHandler::InnerTcpHandler(const std::vector<common::net::HostAndPort>& servers,
+                                 const std::string& servers_history_path,
+                                 const commands_info::AuthInfo& auth_info,
+                                 const ConnectionOptions& options,
+                                 RuntimeInfoCoalescer* runtime_updates,
+                                 events::EventQueue* events)
     : common::libev::IoLoopObserver(),
       inner_connection_(nullptr),
+      runtime_channels_batch_supported_(true),
+      runtime_updates_(runtime_updates),
+      events_(events),
+      subscribed_streams_(),
+      runtime_subscription_supported_(true),
+      runtime_subscription_active_(false),
+      wire_format_(JSON_WIRE_FORMAT),
+      wire_format_switching_(false),
+      payload_decoder_(),
+      read_buffer_(),
+      inbound_(),
       ping_server_id_timer_(INVALID_TIMER_ID),
-      server_host_(server_host),
-      auth_info_(auth_info) {}
+      keepalive_(options.keepalive_interval_msec),
+      server_selector_(servers),
+      servers_history_path_(servers_history_path),
+      current_server_(0),
+      auth_info_(auth_info),
+      options_(options),
+      tls_ctx_(nullptr),
+      tls_sessions_(nullptr),
+      server_(nullptr),
+      handshake_(),
+      connect_timer_(INVALID_TIMER_ID),
+      stagger_timer_(INVALID_TIMER_ID),
+      attempts_(),
+      candidates_(),
+      round_error_(),
+      round_failed_server_(0),
+      deadlines_(),
+      deadline_timer_(INVALID_TIMER_ID),
+      deadline_timer_at_(0),
+      reconnect_timer_(INVALID_TIMER_ID),
+      reconnect_attempt_(0),
+      reconnect_enabled_(false),
+      reconnect_jitter_(std::random_device()()) {}
 
 InnerTcpHandler::~InnerTcpHandler() {
   CHECK(!inner_connection_);
 }
 
+template <typename Event, typename Info>
+void InnerTcpHandler::PostToMainThread(const Info& info) {
+  if (events_) {
+    events_->Post<Event>(this, info);
+    return;
+  }
+  PostEvent(new Event(this, info));
+}
+
+void InnerTcpHandler::PostEvent(event_t* event) {
+  fApp->PostEvent(event);
+}
+
+void InnerTcpHandler::PostExceptionEvent(event_t* event, common::Error err) {
+  fApp->PostEvent(common::make_exception_event(event, err));
+}
+
 void InnerTcpHandler::PreLooped(common::libev::IoLoop* server) {
-  ping_server_id_timer_ = server->CreateTimer(ping_timeout_server, true);
+  server_ = server;
+  ping_server_id_timer_ = server->CreateTimer(keepalive_tick_msec / 1000.0, true);
+  if (PayloadDecoder::IsSupported()) {
+    const std::string absolute_source_dir = common::file_system::absolute_path_from_relative(RELATIVE_SOURCE_DIR);
+    const std::string dictionary_path =
+        common::file_system::make_path(absolute_source_dir, CHANNELS_DICTIONARY_PATH_RELATIVE);
+    common::Error err = payload_decoder_.LoadDictionary(dictionary_path);
+    if (err) {  // frames are still accepted when compressed without dictionary
+      WARNING_LOG() << "Channels dictionary not loaded: " << err->GetDescription();
+    }
+  }
+
+  if (!servers_history_path_.empty()) {
+    common::Error err = server_selector_.Load(servers_history_path_);
+    if (err) {  // first start
+      DEBUG_LOG() << err->GetDescription();
+    }
+  }
+
+  if (options_.tls) {
+    tls_ctx_ = TlsTransport::CreateContext(options_.tls_verify_peer);
+    if (!tls_ctx_) {  // never falls back to plain tcp, every attempt fails instead
+      WARNING_LOG() << "Can't create tls context for the control channel";
+    }
+    tls_sessions_ = new TlsSessionCache(options_.tls_sessions_path);
+    common::Error err = tls_sessions_->Load();
+    if (err) {  // first start
+      DEBUG_LOG() << err->GetDescription();
+    }
+  }
 
   Connect(server);
 }
@@ -68,22 +266,48 @@ void InnerTcpHandler::Moved(common::libev::IoLoop* server, common::libev::IoClie
 }
 
 void InnerTcpHandler::Closed(common::libev::IoClient* client) {
+  const size_t attempt_pos = FindAttempt(client);
+  if (attempt_pos != attempts_.size()) {  // closed by the loop itself, the ones given up are removed before closing
+    attempts_.erase(attempts_.begin() + attempt_pos);
+    return;
+  }
+
   if (client == inner_connection_) {
-    Client* iclient = static_cast<Client*>(client);
-    common::net::socket_info info = iclient->GetInfo();
-    common::net::HostAndPort host(info.host(), info.port());
+    const common::net::HostAndPort host = server_selector_.GetServer(current_server_);
     events::ConnectInfo cinf(host);
-    fApp->PostEvent(new events::ClientDisconnectedEvent(this, cinf));
+    PostEvent(new events::ClientDisconnectedEvent(this, cinf));
     inner_connection_ = nullptr;
+    deadlines_.Clear();
+    StopDeadlineTimer();
+    ResetHandshake();
+    if (!reconnect_enabled_) {  // closed on purpose
+      return;
+    }
+
+    const common::time64_t now = common::time::current_utc_mstime();
+    server_selector_.ConnectFailed(current_server_, now);
+    SaveServersHistory();
+    if (server_selector_.HasHealthy(now)) {
+      WARNING_LOG() << "Lost connection to " << common::ConvertToString(host) << ", failing over";
+      ScheduleFailover();
+      return;
+    }
+    ScheduleReconnect();
     return;
   }
 }
 
 void InnerTcpHandler::DataReceived(common::libev::IoClient* client) {
-  if (client == inner_connection_) {
-    std::string buff;
-    Client* iclient = static_cast<Client*>(client);
-    common::ErrnoError err = iclient->ReadCommand(&buff);
+  const size_t attempt_pos = FindAttempt(client);
+  if (attempt_pos != attempts_.size()) {
+    ContinueAttempt(attempt_pos);
+  }
+
+  // over tls a readable socket may carry no command yet or several of them, the loop only reports the socket
+  bool readable = client == inner_connection_ && inner_connection_->IsReadable();
+  while (readable) {
+    InnerClient* iclient = inner_connection_;
+    common::ErrnoError err = iclient->ReadCommand(&read_buffer_);
     if (err) {
       DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
       ignore_result(client->Close());
@@ -91,12 +315,21 @@ void InnerTcpHandler::DataReceived(common::libev::IoClient* client) {
       return;
     }
 
-    HandleInnerDataReceived(iclient, buff);
+    keepalive_.DataReceived(GetSteadyMsec());  // any message proves the server is alive, even a slow reply
+
+    HandleInnerDataReceived(iclient, read_buffer_);
+    if (read_buffer_.capacity() > max_retained_read_buffer_size) {  // don't keep a channel list sized buffer around
+      std::string().swap(read_buffer_);
+    }
+    readable = client == inner_connection_ && iclient->HasBufferedInput();
   }
 }
 
 void InnerTcpHandler::DataReadyToWrite(common::libev::IoClient* client) {
-  UNUSED(client);
+  const size_t attempt_pos = FindAttempt(client);
+  if (attempt_pos != attempts_.size()) {
+    ContinueAttempt(attempt_pos);
+  }
 }
 
 void InnerTcpHandler::PostLooped(common::libev::IoLoop* server) {
@@ -106,19 +339,57 @@ void InnerTcpHandler::PostLooped(common::libev::IoLoop* server) {
     ping_server_id_timer_ = INVALID_TIMER_ID;
   }
 
+  StopConnectTimer();
+  StopStaggerTimer();
+  StopDeadlineTimer();
+  StopReconnect();
+  server_ = nullptr;
   CHECK(!inner_connection_);
+  CHECK(attempts_.empty());
+
+  if (tls_ctx_) {
+    SSL_CTX_free(tls_ctx_);
+    tls_ctx_ = nullptr;
+  }
+  destroy(&tls_sessions_);
 }
 
 void InnerTcpHandler::TimerEmited(common::libev::IoLoop* server, common::libev::timer_id_t id) {
-  UNUSED(server);
-  if (id == ping_server_id_timer_ && inner_connection_) {
-    Client* client = inner_connection_;
-    common::ErrnoError err = client->Ping();
-    if (err) {
-      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
-      ignore_result(client->Close());
-      delete client;
+  if (id == reconnect_timer_) {
+    server->RemoveTimer(reconnect_timer_);
+    reconnect_timer_ = INVALID_TIMER_ID;
+    Connect(server);
+    return;
+  }
+
+  if (id == connect_timer_) {
+    StopConnectTimer();
+    const common::time64_t now = common::time::current_utc_mstime();
+    for (const ConnectAttempt& attempt : attempts_) {
+      server_selector_.ConnectFailed(attempt.server, now);
+      round_failed_server_ = attempt.server;
     }
+    round_error_ = common::make_errno_error(ETIMEDOUT);
+    CancelAttempts();
+    RoundFailed();
+    return;
+  }
+
+  if (id == stagger_timer_) {
+    StopStaggerTimer();
+    StartNextAttempt();
+    return;
+  }
+
+  if (id == deadline_timer_) {
+    StopDeadlineTimer();
+    HandleExpiredRequests();
+    ArmDeadlineTimer();
+    return;
+  }
+
+  if (id == ping_server_id_timer_ && IsConnected()) {
+    CheckKeepAlive(inner_connection_);
   }
 }
 
@@ -138,11 +409,11 @@ void InnerTcpHandler::ChildStatusChanged(common::libev::IoChild* child, int stat
 }
 
 void InnerTcpHandler::ActivateRequest() {
-  if (!inner_connection_) {
+  if (!IsConnected()) {
     return;
   }
 
-  Client* client = inner_connection_;
+  InnerClient* client = inner_connection_;
   common::ErrnoError err = client->Login(auth_info_);
   if (err) {
     DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
@@ -152,11 +423,11 @@ void InnerTcpHandler::ActivateRequest() {
 }
 
 void InnerTcpHandler::RequestServerInfo() {
-  if (!inner_connection_) {
+  if (!IsConnected()) {
     return;
   }
 
-  Client* client = inner_connection_;
+  InnerClient* client = inner_connection_;
   common::ErrnoError err = client->GetServerInfo();
   if (err) {
     DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
@@ -166,11 +437,11 @@ void InnerTcpHandler::RequestServerInfo() {
 }
 
 void InnerTcpHandler::RequestChannels() {
-  if (!inner_connection_) {
+  if (!IsConnected()) {
     return;
   }
 
-  Client* client = inner_connection_;
+  InnerClient* client = inner_connection_;
   common::ErrnoError err = client->GetChannels();
   if (err) {
     DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
@@ -180,7 +451,7 @@ void InnerTcpHandler::RequestChannels() {
 }
 
 void InnerTcpHandler::RequesRuntimeChannelInfo(stream_id_t sid) {
-  if (!inner_connection_) {
+  if (!IsConnected()) {
     return;
   }
 
@@ -193,196 +464,666 @@ void InnerTcpHandler::RequesRuntimeChannelInfo(stream_id_t sid) {
   }
 }
 
+void InnerTcpHandler::RequestRuntimeChannelsInfo(const std::vector<stream_id_t>& sids) {
+  if (!IsConnected() || sids.empty() || runtime_subscription_active_) {
+    return;
+  }
+
+  InnerClient* client = inner_connection_;
+  common::ErrnoError err;
+  if (runtime_channels_batch_supported_) {
+    err = client->GetRuntimeChannelsInfo(sids);
+  } else {
+    for (size_t i = 0; i < sids.size() && !err; ++i) {
+      err = client->GetRuntimeChannelInfo(sids[i]);
+    }
+  }
+
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    ignore_result(client->Close());
+    delete client;
+  }
+}
+
+void InnerTcpHandler::SubscribeRuntimeChannelsInfo(const std::vector<stream_id_t>& sids) {
+  subscribed_streams_ = sids;
+  if (!IsConnected()) {  // sent again after connect
+    return;
+  }
+
+  SendRuntimeSubscription();
+}
+
+void InnerTcpHandler::SendRuntimeSubscription() {
+  if (!runtime_subscription_supported_) {
+    return;
+  }
+
+  InnerClient* client = inner_connection_;
+  common::ErrnoError err = client->SubscribeRuntimeChannelsInfo(subscribed_streams_);
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    ignore_result(client->Close());
+    delete client;
+  }
+}
+
 void InnerTcpHandler::Connect(common::libev::IoLoop* server) {
   if (!server) {
     return;
   }
 
   DisConnect(common::make_error("Reconnect"));
+  reconnect_enabled_ = true;
+
+  // happy eyeballs over servers: the best one gets a head start, the rest join one by one until a connect completes
+  candidates_ = server_selector_.Rank(common::time::current_utc_mstime());
+  round_error_ = common::make_errno_error(EDESTADDRREQ);  // reported if no server is configured
+  round_failed_server_ = 0;
+  connect_timer_ = server->CreateTimer(options_.connect_timeout_msec / 1000.0, false);
+  StartNextAttempt();
+}
+
+void InnerTcpHandler::StartNextAttempt() {
+  while (!candidates_.empty()) {
+    const size_t index = candidates_.front();
+    candidates_.erase(candidates_.begin());
+
+    common::net::socket_info client_info;
+    common::ErrnoError err = connect_nonblocking(server_selector_.GetServer(index), &client_info);
+    if (!err) {
+      InnerClient* connection = new InnerClient(server_, client_info);
+      connection->SetFlags(EV_READ | EV_WRITE);
+      connection->SetRequestSentCallback([this](const protocol::request_t& req) { TrackRequest(req, 0); });
+      if (server_->RegisterClient(connection)) {
+        attempts_.push_back({connection, index, GetSteadyMsec(), 0});
+        if (!candidates_.empty()) {
+          stagger_timer_ = server_->CreateTimer(connect_stagger_msec / 1000.0, false);
+        }
+        return;
+      }
+      delete connection;
+      err = common::make_errno_error(EIO);
+    }
 
-  common::net::socket_info client_info;
-  common::ErrnoError err = common::net::connect(server_host_, common::net::ST_SOCK_STREAM, nullptr, &client_info);
-  if (err) {
     DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
-    events::ConnectInfo cinf(server_host_);
-    auto ex_event =
-        common::make_exception_event(new events::ClientConnectedEvent(this, cinf), common::make_error_from_errno(err));
-    fApp->PostEvent(ex_event);
+    server_selector_.ConnectFailed(index, common::time::current_utc_mstime());
+    round_error_ = err;
+    round_failed_server_ = index;
+  }
+
+  if (attempts_.empty()) {
+    RoundFailed();
+  }
+}
+
+void InnerTcpHandler::ContinueAttempt(size_t pos) {
+  // an attempt is a state of the loop: tcp connect, then the tls handshake step by step as the socket gets ready,
+  // the other attempts keep racing meanwhile
+  ConnectAttempt* attempt = &attempts_[pos];
+  common::ErrnoError err;
+  if (!attempt->tls_started_msec) {
+    err = get_connect_result(attempt->client->GetInfo().fd());
+    if (!err && options_.tls) {
+      err = StartTls(attempt);
+    }
+  }
+
+  bool done = true;
+  if (!err && attempt->tls_started_msec) {
+    err = ContinueTls(attempt, &done);
+  }
+  if (!err && !done) {
     return;
   }
 
-  Client* connection = new Client(server, client_info);
-  inner_connection_ = connection;
-  if (server->RegisterClient(connection)) {
-    events::ConnectInfo cinf(server_host_);
-    fApp->PostEvent(new events::ClientConnectedEvent(this, cinf));
+  const ConnectAttempt finished = *attempt;
+  attempts_.erase(attempts_.begin() + pos);
+  if (err) {
+    AttemptFailed(finished, err);
+    return;
+  }
+  FinishAttempt(finished);
+}
+
+void InnerTcpHandler::FinishAttempt(const ConnectAttempt& attempt) {
+  server_selector_.ConnectSucceeded(attempt.server, GetSteadyMsec() - attempt.started_msec);
+  SaveServersHistory();
+  CancelAttempts();  // the rest lost the race
+  current_server_ = attempt.server;
+  inner_connection_ = attempt.client;
+  FinishConnect(attempt.client);
+}
+
+common::ErrnoError InnerTcpHandler::StartTls(ConnectAttempt* attempt) {
+  if (!tls_ctx_) {
+    return common::make_errno_error("No tls context", EPROTO);
+  }
+
+  const common::net::HostAndPort host = server_selector_.GetServer(attempt->server);
+  TlsTransport* tls = new TlsTransport(tls_ctx_, tls_sessions_, host);
+  common::ErrnoError err = tls->StartHandshake(attempt->client->GetInfo().fd());
+  if (err) {
+    delete tls;
+    return err;
+  }
+
+  attempt->client->SetTls(tls);
+  attempt->tls_started_msec = GetSteadyMsec();
+  return common::ErrnoError();
+}
+
+common::ErrnoError InnerTcpHandler::ContinueTls(ConnectAttempt* attempt, bool* done) {
+  TlsTransport* tls = attempt->client->GetTls();
+  common::ErrnoError err = tls->ContinueHandshake(done);
+  if (err) {
+    return err;
+  }
+
+  if (!*done) {  // bounded by the connect timer of the round like the tcp connect
+    attempt->client->SetFlags(tls->WantsWrite() ? EV_READ | EV_WRITE : EV_READ);
+    return common::ErrnoError();
+  }
+
+  DEBUG_LOG() << "Tls " << (tls->IsResumed() ? "session resumed" : "full handshake") << " with "
+              << common::ConvertToString(server_selector_.GetServer(attempt->server)) << " in "
+              << GetSteadyMsec() - attempt->tls_started_msec << " msec";
+  return common::ErrnoError();
+}
+
+void InnerTcpHandler::AttemptFailed(const ConnectAttempt& attempt, common::ErrnoError err) {
+  DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+  server_selector_.ConnectFailed(attempt.server, common::time::current_utc_mstime());
+  round_error_ = err;
+  round_failed_server_ = attempt.server;
+  ignore_result(attempt.client->Close());
+  delete attempt.client;
+
+  if (!candidates_.empty()) {  // no reason to wait out the stagger
+    StopStaggerTimer();
+    StartNextAttempt();
+    return;
+  }
+
+  if (attempts_.empty()) {
+    RoundFailed();
+  }
+}
+
+void InnerTcpHandler::CancelAttempts() {
+  StopConnectTimer();
+  StopStaggerTimer();
+  candidates_.clear();
+  std::vector<ConnectAttempt> attempts;
+  attempts.swap(attempts_);  // Closed must not see them
+  for (const ConnectAttempt& attempt : attempts) {
+    ignore_result(attempt.client->Close());
+    delete attempt.client;
+  }
+}
+
+size_t InnerTcpHandler::FindAttempt(common::libev::IoClient* client) const {
+  for (size_t i = 0; i < attempts_.size(); ++i) {
+    if (attempts_[i].client == client) {
+      return i;
+    }
+  }
+  return attempts_.size();
+}
+
+void InnerTcpHandler::RoundFailed() {
+  StopConnectTimer();
+  StopStaggerTimer();
+  candidates_.clear();
+  SaveServersHistory();
+  common::net::HostAndPort host;
+  if (round_failed_server_ < server_selector_.GetServersCount()) {
+    host = server_selector_.GetServer(round_failed_server_);
+  }
+  ConnectFailed(round_error_, host);
+}
+
+void InnerTcpHandler::SaveServersHistory() {
+  if (servers_history_path_.empty()) {
+    return;
+  }
+
+  common::Error err = server_selector_.Save(servers_history_path_);
+  if (err) {
+    WARNING_LOG() << err->GetDescription();
   }
 }
 
 void InnerTcpHandler::DisConnect(common::Error err) {
   UNUSED(err);
+  StopReconnect();
+  CancelAttempts();
   if (inner_connection_) {
-    Client* connection = inner_connection_;
+    InnerClient* connection = inner_connection_;
+    if (connection->GetTls()) {
+      connection->GetTls()->Shutdown();
+    }
     ignore_result(connection->Close());
     delete connection;
   }
 }
 
-common::ErrnoError InnerTcpHandler::HandleRequestServerPing(Client* client, const protocol::request_t* req) {
-  if (req->params) {
-    const char* params_ptr = req->params->c_str();
-    json_object* jstop = json_tokener_parse(params_ptr);
-    if (!jstop) {
-      return common::make_errno_error_inval();
+void InnerTcpHandler::FinishConnect(Client* client) {
+  client->SetFlags(EV_READ);
+  runtime_channels_batch_supported_ = true;
+  runtime_subscription_supported_ = true;
+  runtime_subscription_active_ = false;
+  wire_format_ = JSON_WIRE_FORMAT;
+  wire_format_switching_ = false;
+  keepalive_.Reset(GetSteadyMsec());
+  events::ConnectInfo cinf(server_selector_.GetServer(current_server_));
+  PostEvent(new events::ClientConnectedEvent(this, cinf));
+  StartHandshake(client);
+  if (IsConnected() && !subscribed_streams_.empty()) {
+    SendRuntimeSubscription();
+  }
+}
+
+void InnerTcpHandler::StartHandshake(Client* client) {
+  // requests are sent back to back, the server answers them in order on the same connection
+  ResetHandshake();
+  handshake_.pending = 3;
+  InnerClient* iclient = static_cast<InnerClient*>(client);
+  common::ErrnoError err = iclient->Login(auth_info_);
+  if (!err) {  // not part of the handshake result, on error the server keeps sending json
+    err = iclient->SetWireFormat(MSGPACK_WIRE_FORMAT);
+    wire_format_switching_ = !err;
+  }
+  if (!err && PayloadDecoder::IsSupported()) {  // not part of the handshake either, results stay plain on error
+    err = iclient->SetCompression(PAYLOAD_CODEC_ZSTD, payload_decoder_.GetDictionaryID());
+  }
+  if (!err) {
+    err = iclient->GetServerInfo();
+  }
+  if (!err) {
+    err = iclient->GetChannels();
+  }
+
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    ignore_result(client->Close());
+    delete client;
+  }
+}
+
+common::ErrnoError InnerTcpHandler::HandshakeStepDone(common::ErrnoError err, bool required) {
+  if (handshake_.pending == 0) {
+    return err;
+  }
+
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    if (required && !handshake_.error) {
+      handshake_.error = common::make_error_from_errno(err);
+    }
+  }
+
+  if (--handshake_.pending != 0) {
+    return common::ErrnoError();
+  }
+
+  if (handshake_.login_error) {
+    PostExceptionEvent(new events::ClientAuthorizedEvent(this, auth_info_), handshake_.login_error);
+  } else if (handshake_.error) {
+    PostExceptionEvent(new events::ClientHandshakeEvent(this, handshake_.info), handshake_.error);
+  } else {
+    PostEvent(new events::ClientHandshakeEvent(this, handshake_.info));
+  }
+  ResetHandshake();
+  return common::ErrnoError();
+}
+
+void InnerTcpHandler::ResetHandshake() {
+  handshake_ = HandshakeState();
+}
+
+void InnerTcpHandler::ConnectFailed(common::ErrnoError err, const common::net::HostAndPort& host) {
+  DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+  events::ConnectInfo cinf(host);
+  PostExceptionEvent(new events::ClientConnectedEvent(this, cinf), common::make_error_from_errno(err));
+  ScheduleReconnect();
+}
+
+void InnerTcpHandler::StopConnectTimer() {
+  if (server_ && connect_timer_ != INVALID_TIMER_ID) {
+    server_->RemoveTimer(connect_timer_);
+  }
+  connect_timer_ = INVALID_TIMER_ID;
+}
+
+void InnerTcpHandler::StopStaggerTimer() {
+  if (server_ && stagger_timer_ != INVALID_TIMER_ID) {
+    server_->RemoveTimer(stagger_timer_);
+  }
+  stagger_timer_ = INVALID_TIMER_ID;
+}
+
+bool InnerTcpHandler::IsConnected() const {
+  return inner_connection_ != nullptr;
+}
+
+void InnerTcpHandler::CheckKeepAlive(InnerClient* client) {
+  const common::time64_t now = GetSteadyMsec();
+  if (keepalive_.IsPeerDead(now)) {
+    WARNING_LOG() << "Server missed " << keepalive_.GetMissedCount(now) << " pings, rto: " << keepalive_.GetRto()
+                  << " msec, reconnecting";
+    ignore_result(client->Close());
+    delete client;
+    return;
+  }
+
+  if (!keepalive_.IsPingDue(now)) {
+    return;
+  }
+
+  protocol::sequance_id_t ping_id;
+  common::ErrnoError err = client->SendPing(&ping_id);
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    ignore_result(client->Close());
+    delete client;
+    return;
+  }
+  keepalive_.PingSent(ping_id, now);
+}
+
+void InnerTcpHandler::TrackRequest(const protocol::request_t& req, size_t attempt) {
+  const common::time64_t deadline = GetSteadyMsec() + GetRequestTimeoutMsec(req.method, attempt);
+  deadlines_.Add(req, attempt, deadline);
+  if (deadline_timer_ == INVALID_TIMER_ID || deadline < deadline_timer_at_) {
+    ArmDeadlineTimer();
+  }
+}
+
+void InnerTcpHandler::HandleExpiredRequests() {
+  const common::time64_t now = GetSteadyMsec();
+  RequestDeadlines::Pending expired;
+  while (IsConnected() && deadlines_.PopExpired(now, &expired)) {
+    InnerClient* client = inner_connection_;
+    const protocol::request_t& req = expired.request;
+    if (req.method == CLIENT_LOGIN || req.method == CLIENT_ACTIVATE_DEVICE) {
+      // no answer says nothing about the credentials, the connection is broken and made again
+      WARNING_LOG() << "Request " << req.method << " timed out, reconnecting";
+      ignore_result(client->Close());
+      delete client;
+      return;
     }
 
+    if (IsIdempotentRequest(req.method) && expired.attempt < static_cast<size_t>(options_.request_max_retries)) {
+      WARNING_LOG() << "Request " << req.method << " timed out, retry: " << expired.attempt + 1;
+      protocol::request_t stale;
+      ignore_result(client->PopRequestByID(req.id, &stale));  // a late answer to the old id is dropped as unknown
+      protocol::request_t resent;
+      common::ErrnoError err = client->ResendRequest(req, &resent);
+      if (err) {
+        DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+        ignore_result(client->Close());
+        delete client;
+        return;
+      }
+      TrackRequest(resent, expired.attempt + 1);
+      continue;
+    }
+
+    // answered like the server rejected it, so the usual exception events reach the player
+    WARNING_LOG() << "Request " << req.method << " timed out";
+    InboundMessage timeout;
+    timeout.AssignError(req.id, "Request timed out");
+    common::ErrnoError err = HandleResponceCommand(client, timeout);
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    }
+  }
+}
+
+void InnerTcpHandler::ArmDeadlineTimer() {
+  StopDeadlineTimer();
+  common::time64_t deadline;
+  if (!server_ || !deadlines_.GetNextDeadline(&deadline)) {
+    return;
+  }
+
+  const common::time64_t delay_msec = std::max<common::time64_t>(deadline - GetSteadyMsec(), 1);
+  deadline_timer_ = server_->CreateTimer(delay_msec / 1000.0, false);
+  deadline_timer_at_ = deadline;
+}
+
+void InnerTcpHandler::StopDeadlineTimer() {
+  if (server_ && deadline_timer_ != INVALID_TIMER_ID) {
+    server_->RemoveTimer(deadline_timer_);
+  }
+  deadline_timer_ = INVALID_TIMER_ID;
+}
+
+int InnerTcpHandler::GetRequestTimeoutMsec(const std::string& method, size_t attempt) const {
+  int timeout_msec = options_.request_timeout_msec;
+  if (method == CLIENT_GET_CHANNELS) {  // the largest reply by far
+    timeout_msec *= 2;
+  }
+  for (size_t i = 0; i < attempt && timeout_msec < std::numeric_limits<int>::max() / 2; ++i) {
+    timeout_msec *= 2;
+  }
+  return timeout_msec;
+}
+
+bool InnerTcpHandler::IsIdempotentRequest(const std::string& method) {
+  // only reads are sent again, the rest change server side state (session, wire format, compression,
+  // subscriptions) and the first one may still get through
+  return method == CLIENT_GET_SERVER_INFO || method == CLIENT_GET_CHANNELS ||
+         method == CLIENT_GET_RUNTIME_CHANNEL_INFO || method == CLIENT_GET_RUNTIME_CHANNELS_INFO;
+}
+
+void InnerTcpHandler::ScheduleReconnect() {
+  if (!server_ || !reconnect_enabled_ || reconnect_timer_ != INVALID_TIMER_ID) {
+    return;
+  }
+
+  const int delay_msec = CalcReconnectDelayMsec(reconnect_attempt_++);
+  WARNING_LOG() << "Reconnect in " << delay_msec << " msec, attempt " << reconnect_attempt_;
+  reconnect_timer_ = server_->CreateTimer(delay_msec / 1000.0, false);
+}
+
+void InnerTcpHandler::ScheduleFailover() {
+  if (!server_ || reconnect_timer_ != INVALID_TIMER_ID) {
+    return;
+  }
+
+  reconnect_timer_ = server_->CreateTimer(0, false);  // from the loop, not from inside Closed
+}
+
+void InnerTcpHandler::StopReconnect() {
+  reconnect_enabled_ = false;
+  if (server_ && reconnect_timer_ != INVALID_TIMER_ID) {
+    server_->RemoveTimer(reconnect_timer_);
+  }
+  reconnect_timer_ = INVALID_TIMER_ID;
+}
+
+int InnerTcpHandler::CalcReconnectDelayMsec(size_t attempt) {
+  // exponential backoff with equal jitter, so clients dropped at the same time don't come back at the same time
+  int64_t delay = options_.reconnect_min_delay_msec;
+  for (size_t i = 0; i < attempt && delay < options_.reconnect_max_delay_msec; ++i) {
+    delay *= 2;
+  }
+  if (delay > options_.reconnect_max_delay_msec) {
+    delay = options_.reconnect_max_delay_msec;
+  }
+
+  const int half = static_cast<int>(delay / 2);
+  std::uniform_int_distribution<int> jitter(0, static_cast<int>(delay) - half);
+  return half + jitter(reconnect_jitter_);
+}
+
+common::ErrnoError InnerTcpHandler::HandleRequestServerPing(Client* client, const InboundMessage& req) {
+  json_object* jstop = req.GetParams();
+  if (jstop) {
     common::daemon::commands::ServerPingInfo server_ping_info;
     common::Error err_des = server_ping_info.DeSerialize(jstop);
-    json_object_put(jstop);
     if (err_des) {
       const std::string err_str = err_des->GetDescription();
       return common::make_errno_error(err_str, EAGAIN);
     }
 
-    return client->Pong(req->id);
+    return client->Pong(req.GetID());
   }
 
   return common::make_errno_error_inval();
 }
 
-common::ErrnoError InnerTcpHandler::HandleRequestServerClientInfo(Client* client, const protocol::request_t* req) {
-  return client->SystemInfo(req->id, auth_info_.GetLogin(), auth_info_.GetDeviceID(),
+common::ErrnoError InnerTcpHandler::HandleRequestServerClientInfo(Client* client, const InboundMessage& req) {
+  return client->SystemInfo(req.GetID(), auth_info_.GetLogin(), auth_info_.GetDeviceID(),
                             commands_info::ProjectInfo(PROJECT_NAME_LOWERCASE, PROJECT_VERSION));
 }
 
-common::ErrnoError InnerTcpHandler::HandleRequestServerTextNotification(Client* client,
-                                                                        const protocol::request_t* req) {
-  if (req->params) {
-    const char* params_ptr = req->params->c_str();
-    json_object* jnotify_text = json_tokener_parse(params_ptr);
-    if (!jnotify_text) {
-      return common::make_errno_error_inval();
-    }
-
+common::ErrnoError InnerTcpHandler::HandleRequestServerTextNotification(Client* client, const InboundMessage& req) {
+  json_object* jnotify_text = req.GetParams();
+  if (jnotify_text) {
     commands_info::NotificationTextInfo notification_text_info;
     common::Error err_des = notification_text_info.DeSerialize(jnotify_text);
-    json_object_put(jnotify_text);
     if (err_des) {
       const std::string err_str = err_des->GetDescription();
       return common::make_errno_error(err_str, EAGAIN);
     }
 
-    fApp->PostEvent(new events::NotificationTextEvent(this, notification_text_info));
-    return client->NotificationTextOK(req->id);
+    PostToMainThread<events::NotificationTextEvent>(notification_text_info);
+    return client->NotificationTextOK(req.GetID());
   }
 
   return common::make_errno_error_inval();
 }
 
-common::ErrnoError InnerTcpHandler::HandleRequestServerShutdownNotification(Client* client, const protocol::request_t* req) {
-  if (req->params) {
-    const char* params_ptr = req->params->c_str();
-    json_object* jnotify_text = json_tokener_parse(params_ptr);
-    if (!jnotify_text) {
-      return common::make_errno_error_inval();
-    }
-
+common::ErrnoError InnerTcpHandler::HandleRequestServerShutdownNotification(Client* client, const InboundMessage& req) {
+  json_object* jnotify_text = req.GetParams();
+  if (jnotify_text) {
     commands_info::ShutDownInfo shutdown_info;
     common::Error err_des = shutdown_info.DeSerialize(jnotify_text);
-    json_object_put(jnotify_text);
     if (err_des) {
       const std::string err_str = err_des->GetDescription();
       return common::make_errno_error(err_str, EAGAIN);
     }
 
-    fApp->PostEvent(new events::NotificationShutdownEvent(this, shutdown_info));
-    return client->NotificationTextOK(req->id);
+    PostEvent(new events::NotificationShutdownEvent(this, shutdown_info));
+    return client->NotificationTextOK(req.GetID());
   }
 
   return common::make_errno_error_inval();
 }
 
+common::ErrnoError InnerTcpHandler::HandleRequestServerRuntimeChannelsInfo(Client* client, const InboundMessage& req) {
+  UNUSED(client);
+  InnerClient::runtime_channels_t channels;
+  common::Error err_parse = InnerClient::ParseRuntimeChannelsNotification(req.GetParams(), &channels);
+  if (err_parse) {
+    const std::string err_str = err_parse->GetDescription();
+    return common::make_errno_error(err_str, EAGAIN);
+  }
+
+  // notification, no reply; the player drains coalesced updates once per wakeup
+  if (runtime_updates_) {
+    runtime_updates_->Push(channels);
+  }
+  return common::ErrnoError();
+}
+
 common::ErrnoError InnerTcpHandler::HandleInnerDataReceived(Client* client, const std::string& input_command) {
-  protocol::request_t* req = nullptr;
-  protocol::response_t* resp = nullptr;
-  common::Error err_parse = common::protocols::json_rpc::ParseJsonRPC(input_command, &req, &resp);
+  const WireFormat format =
+      wire_format_switching_ ? DetectWireFormat(input_command.data(), input_command.size()) : wire_format_;
+  common::Error err_parse = inbound_.Parse(input_command.data(), input_command.size(), format);
   if (err_parse) {
     const std::string err_str = err_parse->GetDescription();
     return common::make_errno_error(err_str, EAGAIN);
   }
 
-  if (req) {
-    DEBUG_LOG() << "Received request: " << input_command;
-    common::ErrnoError err = HandleRequestCommand(client, req);
+  if (inbound_.IsRequest()) {
+    DEBUG_LOG() << "Received request: " << inbound_.GetMethod();
+    common::ErrnoError err = HandleRequestCommand(client, inbound_);
     if (err) {
       DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
     }
-    delete req;
-  } else if (resp) {
-    DEBUG_LOG() << "Received responce: " << input_command;
-    common::ErrnoError err = HandleResponceCommand(client, resp);
+  } else if (inbound_.IsResponse()) {
+    common::ErrnoError err = HandleResponceCommand(client, inbound_);
     if (err) {
       DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
     }
-    delete resp;
   } else {
     DNOTREACHED();
+    inbound_.Clear();
     return common::make_errno_error("Invalid command type.", EINVAL);
   }
 
+  inbound_.Clear();  // drop the document, the buffers stay for the next message
   return common::ErrnoError();
 }
 
-common::ErrnoError InnerTcpHandler::HandleRequestCommand(Client* client, const protocol::request_t* req) {
+common::ErrnoError InnerTcpHandler::HandleRequestCommand(Client* client, const InboundMessage& req) {
   Client* sclient = static_cast<Client*>(client);
-  if (req->method == SERVER_PING) {
+  if (req.GetMethod() == SERVER_PING) {
     return HandleRequestServerPing(sclient, req);
-  } else if (req->method == SERVER_GET_CLIENT_INFO) {
+  } else if (req.GetMethod() == SERVER_GET_CLIENT_INFO) {
     return HandleRequestServerClientInfo(sclient, req);
-  } else if (req->method == SERVER_TEXT_NOTIFICATION) {
+  } else if (req.GetMethod() == SERVER_TEXT_NOTIFICATION) {
     return HandleRequestServerTextNotification(sclient, req);
-  } else if (req->method == SERVER_SHUTDOWN_NOTIFICATION) {
+  } else if (req.GetMethod() == SERVER_SHUTDOWN_NOTIFICATION) {
     return HandleRequestServerShutdownNotification(sclient, req);
+  } else if (req.GetMethod() == SERVER_RUNTIME_CHANNELS_INFO) {
+    return HandleRequestServerRuntimeChannelsInfo(sclient, req);
   }
 
-  WARNING_LOG() << "Received unknown command: " << req->method;
+  WARNING_LOG() << "Received unknown command: " << req.GetMethod();
   return common::ErrnoError();
 }
 
-common::ErrnoError InnerTcpHandler::HandleResponceClientActivateDevice(Client* client,
-                                                                       const protocol::response_t* resp) {
+common::ErrnoError InnerTcpHandler::HandleResponceClientActivateDevice(Client* client, const InboundMessage& resp) {
   UNUSED(client);
-  if (resp->IsMessage()) {
+  if (!resp.IsError()) {
     return common::ErrnoError();
   }
   return common::ErrnoError();
 }
 
-common::ErrnoError InnerTcpHandler::HandleResponceClientLogin(Client* client, const protocol::response_t* resp) {
-  if (resp->IsMessage()) {
+common::ErrnoError InnerTcpHandler::HandleResponceClientLogin(Client* client, const InboundMessage& resp) {
+  if (!resp.IsError()) {
+    reconnect_attempt_ = 0;
     client->SetName(auth_info_.GetLogin());
-    fApp->PostEvent(new events::ClientAuthorizedEvent(this, auth_info_));
+    if (handshake_.pending) {
+      handshake_.info.auth = auth_info_;
+      return common::ErrnoError();
+    }
+    PostEvent(new events::ClientAuthorizedEvent(this, auth_info_));
     return common::ErrnoError();
   }
 
-  common::Error err = common::make_error(resp->error->message);
-  auto ex_event = common::make_exception_event(new events::ClientAuthorizedEvent(this, auth_info_), err);
-  fApp->PostEvent(ex_event);
+  common::Error err = common::make_error(resp.GetErrorMessage());
+  if (handshake_.pending) {
+    handshake_.login_error = err;
+    return common::ErrnoError();
+  }
+  PostExceptionEvent(new events::ClientAuthorizedEvent(this, auth_info_), err);
   return common::ErrnoError();
 }
 
-common::ErrnoError InnerTcpHandler::HandleResponceClientPing(Client* client, const protocol::response_t* resp) {
+common::ErrnoError InnerTcpHandler::HandleResponceClientPing(Client* client, const InboundMessage& resp) {
   UNUSED(client);
-  if (resp->IsMessage()) {
-    const char* params_ptr = resp->message->result.c_str();
-    json_object* jserver_ping = json_tokener_parse(params_ptr);
+  // even an error reply proves the peer is alive
+  if (keepalive_.PongReceived(resp.GetID(), GetSteadyMsec())) {
+    DEBUG_LOG() << "Server rtt: " << keepalive_.GetLastRtt() << " msec, srtt: " << keepalive_.GetSmoothedRtt()
+                << " msec, rttvar: " << keepalive_.GetRttVariance() << " msec, rto: " << keepalive_.GetRto() << " msec";
+  }
+
+  if (!resp.IsError()) {
+    json_object* jserver_ping = resp.GetResult();
     if (!jserver_ping) {
       return common::make_errno_error_inval();
     }
 
     common::daemon::commands::ServerPingInfo server_ping_info;
     common::Error err_des = server_ping_info.DeSerialize(jserver_ping);
-    json_object_put(jserver_ping);
     if (err_des) {
       const std::string err_str = err_des->GetDescription();
       return common::make_errno_error(err_str, EAGAIN);
@@ -392,43 +1133,46 @@ common::ErrnoError InnerTcpHandler::HandleResponceClientPing(Client* client, con
   return common::ErrnoError();
 }
 
-common::ErrnoError InnerTcpHandler::HandleResponceClientGetServerInfo(Client* client,
-                                                                      const protocol::response_t* resp) {
+common::ErrnoError InnerTcpHandler::HandleResponceClientGetServerInfo(Client* client, const InboundMessage& resp) {
   UNUSED(client);
 
-  if (resp->IsMessage()) {
-    const char* params_ptr = resp->message->result.c_str();
-    json_object* jserver_info = json_tokener_parse(params_ptr);
+  if (!resp.IsError()) {
+    json_object* jserver_info = resp.GetResult();
     if (!jserver_info) {
       return common::make_errno_error_inval();
     }
 
     commands_info::ServerInfo sinf;
     common::Error err_des = sinf.DeSerialize(jserver_info);
-    json_object_put(jserver_info);
     if (err_des) {
       const std::string err_str = err_des->GetDescription();
       return common::make_errno_error(err_str, EAGAIN);
     }
 
-    fApp->PostEvent(new events::ClientServerInfoEvent(this, sinf));
+    if (handshake_.pending) {
+      handshake_.info.server_info = sinf;
+      return common::ErrnoError();
+    }
+    PostEvent(new events::ClientServerInfoEvent(this, sinf));
     return common::ErrnoError();
   }
 
-  common::Error err = common::make_error(resp->error->message);
-  auto ex_event =
-      common::make_exception_event(new events::ClientServerInfoEvent(this, commands_info::ServerInfo()), err);
-  fApp->PostEvent(ex_event);
+  common::Error err = common::make_error(resp.GetErrorMessage());
+  if (handshake_.pending) {
+    return common::make_errno_error(err->GetDescription(), EAGAIN);
+  }
+  PostExceptionEvent(new events::ClientServerInfoEvent(this, commands_info::ServerInfo()), err);
   return common::ErrnoError();
 }
 
-common::ErrnoError InnerTcpHandler::HandleResponceClientGetChannels(Client* client, const protocol::response_t* resp) {
+common::ErrnoError InnerTcpHandler::HandleResponceClientGetChannels(Client* client, const InboundMessage& resp) {
   UNUSED(client);
-  if (resp->IsMessage()) {
-    const char* params_ptr = resp->message->result.c_str();
-    json_object* jchannels_info = json_tokener_parse(params_ptr);
-    if (!jchannels_info) {
-      return common::make_errno_error_inval();
+  if (!resp.IsError()) {
+    json_object* jchannels_info = nullptr;
+    common::Error err_parse = payload_decoder_.ParseResult(resp.GetResult(), resp.GetFormat(), &jchannels_info);
+    if (err_parse) {
+      const std::string err_str = err_parse->GetDescription();
+      return common::make_errno_error(err_str, EAGAIN);
     }
 
     json_object* jchannels_array = nullptr;
@@ -480,52 +1224,140 @@ common::ErrnoError InnerTcpHandler::HandleResponceClientGetChannels(Client* clie
 
     json_object_put(jchannels_info);
     events::ChannelsMixInfo ch = {channels, vods, private_channels};
-    fApp->PostEvent(new events::ReceiveChannelsEvent(this, ch));
+    if (handshake_.pending) {
+      handshake_.info.channels = ch;
+      return common::ErrnoError();
+    }
+    PostEvent(new events::ReceiveChannelsEvent(this, ch));
     return common::ErrnoError();
   }
+
+  if (handshake_.pending) {
+    return common::make_errno_error(resp.GetErrorMessage(), EAGAIN);
+  }
   return common::ErrnoError();
 }
 
 common::ErrnoError InnerTcpHandler::HandleResponceClientGetruntimeChannelInfo(Client* client,
-                                                                              const protocol::response_t* resp) {
+                                                                              const InboundMessage& resp) {
   UNUSED(client);
-  if (resp->IsMessage()) {
-    const char* params_ptr = resp->message->result.c_str();
-    json_object* jchannels_info = json_tokener_parse(params_ptr);
+  if (!resp.IsError()) {
+    json_object* jchannels_info = resp.GetResult();
     if (!jchannels_info) {
       return common::make_errno_error_inval();
     }
 
     commands_info::RuntimeChannelInfo chan;
     common::Error err_des = chan.DeSerialize(jchannels_info);
-    json_object_put(jchannels_info);
     if (err_des) {
       const std::string err_str = err_des->GetDescription();
       return common::make_errno_error(err_str, EAGAIN);
     }
 
-    fApp->PostEvent(new events::ReceiveRuntimeChannelEvent(this, chan));
+    PostToMainThread<events::ReceiveRuntimeChannelEvent>(chan);
+    return common::ErrnoError();
+  }
+  return common::ErrnoError();
+}
+
+common::ErrnoError InnerTcpHandler::HandleResponceClientGetRuntimeChannelsInfo(Client* client,
+                                                                              const protocol::request_t* req,
+                                                                              const InboundMessage& resp) {
+  UNUSED(client);
+  if (!resp.IsError()) {
+    InnerClient::runtime_channels_t channels;
+    common::Error err_des = InnerClient::ParseRuntimeChannelsResponce(resp.GetResult(), &channels);
+    if (err_des) {
+      const std::string err_str = err_des->GetDescription();
+      return common::make_errno_error(err_str, EAGAIN);
+    }
+
+    PostToMainThread<events::ReceiveRuntimeChannelsEvent>(channels);
+    return common::ErrnoError();
+  }
+
+  // older servers don't know the batched request, repeat it stream by stream
+  WARNING_LOG() << "Batched runtime channels info rejected: " << resp.GetErrorMessage();
+  runtime_channels_batch_supported_ = false;
+  std::vector<stream_id_t> sids;
+  if (req->params) {
+    common::Error err_parse = InnerClient::ParseRuntimeChannelsRequest(*req->params, &sids);
+    if (err_parse) {
+      const std::string err_str = err_parse->GetDescription();
+      return common::make_errno_error(err_str, EAGAIN);
+    }
+  }
+  RequestRuntimeChannelsInfo(sids);
+  return common::ErrnoError();
+}
+
+common::ErrnoError InnerTcpHandler::HandleResponceClientSubscribeRuntimeChannelsInfo(
+    Client* client,
+    const InboundMessage& resp) {
+  UNUSED(client);
+  if (!resp.IsError()) {
+    runtime_subscription_active_ = !subscribed_streams_.empty();
     return common::ErrnoError();
   }
+
+  // keep polling with batched requests
+  WARNING_LOG() << "Runtime channels subscription rejected: " << resp.GetErrorMessage();
+  runtime_subscription_supported_ = false;
+  runtime_subscription_active_ = false;
+  return common::ErrnoError();
+}
+
+common::ErrnoError InnerTcpHandler::HandleResponceClientSetWireFormat(Client* client, const InboundMessage& resp) {
+  UNUSED(client);
+  wire_format_switching_ = false;  // everything after the reply is in the agreed format
+  if (!resp.IsError()) {
+    wire_format_ = MSGPACK_WIRE_FORMAT;
+    DEBUG_LOG() << "Wire format: " << ConvertWireFormatToString(wire_format_);
+    return common::ErrnoError();
+  }
+
+  wire_format_ = JSON_WIRE_FORMAT;
+  return common::ErrnoError();
+}
+
+common::ErrnoError InnerTcpHandler::HandleResponceClientSetCompression(Client* client, const InboundMessage& resp) {
+  UNUSED(client);
+  if (!resp.IsError()) {
+    DEBUG_LOG() << "Payload compression: " << PAYLOAD_CODEC_ZSTD
+                << ", dictionary: " << payload_decoder_.GetDictionaryID();
+    return common::ErrnoError();
+  }
+
+  WARNING_LOG() << "Payload compression rejected: " << resp.GetErrorMessage();
   return common::ErrnoError();
 }
 
-common::ErrnoError InnerTcpHandler::HandleResponceCommand(Client* client, const protocol::response_t* resp) {
+common::ErrnoError InnerTcpHandler::HandleResponceCommand(Client* client, const InboundMessage& resp) {
+  deadlines_.Remove(resp.GetID());
   protocol::request_t req;
   Client* sclient = static_cast<Client*>(client);
-  if (sclient->PopRequestByID(resp->id, &req)) {
+  if (sclient->PopRequestByID(resp.GetID(), &req)) {
+    DEBUG_LOG() << "Received responce: " << req.method;
     if (req.method == CLIENT_ACTIVATE_DEVICE) {
       return HandleResponceClientActivateDevice(sclient, resp);
     } else if (req.method == CLIENT_LOGIN) {
-      return HandleResponceClientLogin(sclient, resp);
+      return HandshakeStepDone(HandleResponceClientLogin(sclient, resp), true);
     } else if (req.method == CLIENT_PING) {
       return HandleResponceClientPing(sclient, resp);
     } else if (req.method == CLIENT_GET_SERVER_INFO) {
-      return HandleResponceClientGetServerInfo(sclient, resp);
+      return HandshakeStepDone(HandleResponceClientGetServerInfo(sclient, resp), false);
     } else if (req.method == CLIENT_GET_CHANNELS) {
-      return HandleResponceClientGetChannels(sclient, resp);
+      return HandshakeStepDone(HandleResponceClientGetChannels(sclient, resp), true);
     } else if (req.method == CLIENT_GET_RUNTIME_CHANNEL_INFO) {
       return HandleResponceClientGetruntimeChannelInfo(sclient, resp);
+    } else if (req.method == CLIENT_GET_RUNTIME_CHANNELS_INFO) {
+      return HandleResponceClientGetRuntimeChannelsInfo(sclient, &req, resp);
+    } else if (req.method == CLIENT_SUBSCRIBE_RUNTIME_CHANNELS_INFO) {
+      return HandleResponceClientSubscribeRuntimeChannelsInfo(sclient, resp);
+    } else if (req.method == CLIENT_SET_WIRE_FORMAT) {
+      return HandleResponceClientSetWireFormat(sclient, resp);
+    } else if (req.method == CLIENT_SET_COMPRESSION) {
+      return HandleResponceClientSetCompression(sclient, resp);
     } else {
       WARNING_LOG() << "HandleResponceServiceCommand not handled command: " << req.method;
     }
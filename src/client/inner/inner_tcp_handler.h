@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <random>
 #include <string>
 #include <vector>
 
@@ -28,27 +29,53 @@
 #include <fastotv/protocol/types.h>
 #include <fastotv/types.h>  // for bandwidth_t
 
+#include "client/events/network_events.h"
+#include "client/inner/connection_options.h"
+#include "client/inner/inbound_message.h"
+#include "client/inner/keepalive_monitor.h"
+#include "client/inner/payload_compression.h"
+#include "client/inner/request_deadlines.h"
+#include "client/inner/server_selector.h"
+#include "client/inner/wire_format.h"
+
+typedef struct ssl_ctx_st SSL_CTX;
+
 namespace fastotv {
 namespace client {
 class Client;
+class RuntimeInfoCoalescer;
+namespace events {
+class EventQueue;
+}
 namespace bandwidth {
 class TcpBandwidthClient;
 }
 namespace inner {
+class InnerClient;
+class TlsSessionCache;
 
 class InnerTcpHandler : public common::libev::IoLoopObserver {
  public:
   enum {
-    ping_timeout_server = 30  // sec
+    keepalive_tick_msec = 500,                  // how often pings and missed replies are checked
+    connect_stagger_msec = 250,                 // head start of a connect attempt before the next server is raced
+    max_retained_read_buffer_size = 256 * 1024  // bytes
   };
 
-  explicit InnerTcpHandler(const common::net::HostAndPort& server_host, const commands_info::AuthInfo& auth_info);
+  InnerTcpHandler(const std::vector<common::net::HostAndPort>& servers,
+                  const std::string& servers_history_path,  // empty to keep the history in memory only
+                  const commands_info::AuthInfo& auth_info,
+                  const ConnectionOptions& options,
+                  RuntimeInfoCoalescer* runtime_updates,
+                  events::EventQueue* events);  // nullptr to post every event to the application
   ~InnerTcpHandler() override;
 
   void ActivateRequest();                          // should be execute in network thread
   void RequestServerInfo();                        // should be execute in network thread
   void RequestChannels();                          // should be execute in network thread
   void RequesRuntimeChannelInfo(stream_id_t sid);  // should be execute in network thread
+  void RequestRuntimeChannelsInfo(const std::vector<stream_id_t>& sids);  // should be execute in network thread
+  void SubscribeRuntimeChannelsInfo(const std::vector<stream_id_t>& sids);  // should be execute in network thread
   void Connect(common::libev::IoLoop* server);     // should be execute in network thread
   void DisConnect(common::Error err);              // should be execute in network thread
 
@@ -65,28 +92,129 @@ class InnerTcpHandler : public common::libev::IoLoopObserver {
   void ChildStatusChanged(common::libev::IoChild* child, int status, int signal) override;
 
  protected:
+  typedef fastoplayer::gui::events::Event event_t;
+
+  // everything for the application goes through these, take ownership of the event
+  virtual void PostEvent(event_t* event);
+  virtual void PostExceptionEvent(event_t* event, common::Error err);
+
   common::ErrnoError HandleInnerDataReceived(Client* client, const std::string& input_command);
-  common::ErrnoError HandleRequestCommand(Client* client, const protocol::request_t* req);
-  common::ErrnoError HandleResponceCommand(Client* client, const protocol::response_t* resp);
+  common::ErrnoError HandleRequestCommand(Client* client, const InboundMessage& req);
+  common::ErrnoError HandleResponceCommand(Client* client, const InboundMessage& resp);
 
  private:
-  common::ErrnoError HandleRequestServerPing(Client* client, const protocol::request_t* req);
-  common::ErrnoError HandleRequestServerClientInfo(Client* client, const protocol::request_t* req);
-  common::ErrnoError HandleRequestServerTextNotification(Client* client, const protocol::request_t* req);
-  common::ErrnoError HandleRequestServerShutdownNotification(Client* client, const protocol::request_t* req);
-
-  common::ErrnoError HandleResponceClientActivateDevice(Client* client, const protocol::response_t* resp);
-  common::ErrnoError HandleResponceClientLogin(Client* client, const protocol::response_t* resp);
-  common::ErrnoError HandleResponceClientPing(Client* client, const protocol::response_t* resp);
-  common::ErrnoError HandleResponceClientGetServerInfo(Client* client, const protocol::response_t* resp);
-  common::ErrnoError HandleResponceClientGetChannels(Client* client, const protocol::response_t* resp);
-  common::ErrnoError HandleResponceClientGetruntimeChannelInfo(Client* client, const protocol::response_t* resp);
-
-  Client* inner_connection_;
+  void StartHandshake(Client* client);
+  common::ErrnoError HandshakeStepDone(common::ErrnoError err, bool required);
+  void ResetHandshake();
+
+  struct ConnectAttempt {
+    InnerClient* client;
+    size_t server;  // index in server_selector_
+    common::time64_t started_msec;
+    common::time64_t tls_started_msec;  // zero until the tcp connect completed, the tls handshake runs after
+  };
+
+  void StartNextAttempt();
+  void ContinueAttempt(size_t pos);
+  void FinishAttempt(const ConnectAttempt& attempt);
+  common::ErrnoError StartTls(ConnectAttempt* attempt);
+  common::ErrnoError ContinueTls(ConnectAttempt* attempt, bool* done);
+  void AttemptFailed(const ConnectAttempt& attempt, common::ErrnoError err);
+  void CancelAttempts();
+  size_t FindAttempt(common::libev::IoClient* client) const;
+  void RoundFailed();
+  void SaveServersHistory();
+
+  void FinishConnect(Client* client);
+  void ConnectFailed(common::ErrnoError err, const common::net::HostAndPort& host);
+  void StopConnectTimer();
+  void StopStaggerTimer();
+  bool IsConnected() const;
+
+  void CheckKeepAlive(InnerClient* client);
+
+  void TrackRequest(const protocol::request_t& req, size_t attempt);
+  void HandleExpiredRequests();
+  void ArmDeadlineTimer();
+  void StopDeadlineTimer();
+  int GetRequestTimeoutMsec(const std::string& method, size_t attempt) const;
+  static bool IsIdempotentRequest(const std::string& method);
+
+  void ScheduleReconnect();
+  void ScheduleFailover();
+  void StopReconnect();
+  int CalcReconnectDelayMsec(size_t attempt);
+
+  common::ErrnoError HandleRequestServerPing(Client* client, const InboundMessage& req);
+  common::ErrnoError HandleRequestServerClientInfo(Client* client, const InboundMessage& req);
+  common::ErrnoError HandleRequestServerTextNotification(Client* client, const InboundMessage& req);
+  common::ErrnoError HandleRequestServerShutdownNotification(Client* client, const InboundMessage& req);
+  common::ErrnoError HandleRequestServerRuntimeChannelsInfo(Client* client, const InboundMessage& req);
+
+  common::ErrnoError HandleResponceClientActivateDevice(Client* client, const InboundMessage& resp);
+  common::ErrnoError HandleResponceClientLogin(Client* client, const InboundMessage& resp);
+  common::ErrnoError HandleResponceClientPing(Client* client, const InboundMessage& resp);
+  common::ErrnoError HandleResponceClientGetServerInfo(Client* client, const InboundMessage& resp);
+  common::ErrnoError HandleResponceClientGetChannels(Client* client, const InboundMessage& resp);
+  common::ErrnoError HandleResponceClientGetruntimeChannelInfo(Client* client, const InboundMessage& resp);
+  common::ErrnoError HandleResponceClientGetRuntimeChannelsInfo(Client* client,
+                                                                const protocol::request_t* req,
+                                                                const InboundMessage& resp);
+  common::ErrnoError HandleResponceClientSubscribeRuntimeChannelsInfo(Client* client, const InboundMessage& resp);
+  common::ErrnoError HandleResponceClientSetWireFormat(Client* client, const InboundMessage& resp);
+  common::ErrnoError HandleResponceClientSetCompression(Client* client, const InboundMessage& resp);
+  void SendRuntimeSubscription();
+  template <typename Event, typename Info>
+  void PostToMainThread(const Info& info);
+
+  InnerClient* inner_connection_;
+  bool runtime_channels_batch_supported_;  // cleared when the server rejects batched requests
+
+  RuntimeInfoCoalescer* const runtime_updates_;
+  events::EventQueue* const events_;
+  std::vector<stream_id_t> subscribed_streams_;
+  bool runtime_subscription_supported_;
+  bool runtime_subscription_active_;  // server pushes changes, polling is not needed
+  WireFormat wire_format_;            // inbound format agreed with the server
+  bool wire_format_switching_;        // set_wire_format not answered yet, messages can come in either format
+  PayloadDecoder payload_decoder_;
+  std::string read_buffer_;  // reused for every command of the connection
+  InboundMessage inbound_;
   common::libev::timer_id_t ping_server_id_timer_;
+  KeepAliveMonitor keepalive_;
 
-  const common::net::HostAndPort server_host_;
+  ServerSelector server_selector_;
+  const std::string servers_history_path_;
+  size_t current_server_;
   const commands_info::AuthInfo auth_info_;
+  const ConnectionOptions options_;
+  SSL_CTX* tls_ctx_;  // null when the control channel is plain tcp
+  TlsSessionCache* tls_sessions_;
+
+  common::libev::IoLoop* server_;
+  struct HandshakeState {
+    HandshakeState();
+
+    size_t pending;  // responses still expected, zero when no handshake in progress
+    common::Error login_error;
+    common::Error error;
+    events::HandshakeInfo info;
+  };
+  HandshakeState handshake_;
+
+  common::libev::timer_id_t connect_timer_;  // bounds a whole round of attempts
+  common::libev::timer_id_t stagger_timer_;
+  std::vector<ConnectAttempt> attempts_;  // racing connects, the first to complete wins
+  std::vector<size_t> candidates_;       // servers of the round not tried yet, best first
+  common::ErrnoError round_error_;
+  size_t round_failed_server_;
+  RequestDeadlines deadlines_;
+  common::libev::timer_id_t deadline_timer_;  // armed for the earliest deadline only
+  common::time64_t deadline_timer_at_;
+  common::libev::timer_id_t reconnect_timer_;
+  size_t reconnect_attempt_;
+  bool reconnect_enabled_;
+  std::mt19937 reconnect_jitter_;
 };
 
 }  // namespace inner
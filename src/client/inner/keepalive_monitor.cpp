@@ -0,0 +1,148 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "client/inner/keepalive_monitor.h"
+
+#include <algorithm>
+
+namespace fastotv {
+namespace client {
+namespace inner {
+
+KeepAliveMonitor::KeepAliveMonitor(common::time64_t interval_msec)
+    : interval_msec_(interval_msec),
+      outstanding_(),
+      last_ping_sent_(0),
+      last_data_received_(0),
+      has_rtt_(false),
+      last_rtt_(0),
+      srtt_(0),
+      rttvar_(0),
+      rto_(initial_rto_msec),
+      backoff_(0) {}
+
+void KeepAliveMonitor::Reset(common::time64_t now) {
+  outstanding_.clear();
+  last_ping_sent_ = now;
+  last_data_received_ = now;
+  has_rtt_ = false;
+  last_rtt_ = 0;
+  srtt_ = 0;
+  rttvar_ = 0;
+  rto_ = initial_rto_msec;
+  backoff_ = 0;
+}
+
+void KeepAliveMonitor::PingSent(const protocol::sequance_id_t& id, common::time64_t now) {
+  if (IsProbing()) {
+    backoff_++;
+  }
+
+  // pings followed by other data only wait for a late rtt sample, until they would be missed
+  const common::time64_t data_received = last_data_received_;
+  outstanding_.erase(std::remove_if(outstanding_.begin(), outstanding_.end(),
+                                    [now, data_received](const Ping& ping) {
+                                      return ping.sent < data_received && now >= ping.deadline;
+                                    }),
+                     outstanding_.end());
+  outstanding_.push_back({id, now, now + GetRto()});
+  last_ping_sent_ = now;
+}
+
+bool KeepAliveMonitor::PongReceived(const protocol::sequance_id_t& id, common::time64_t now) {
+  auto it = std::find_if(outstanding_.begin(), outstanding_.end(), [&id](const Ping& ping) { return ping.id == id; });
+  if (it == outstanding_.end()) {
+    return false;
+  }
+
+  const common::time64_t rtt = std::max<common::time64_t>(now - it->sent, 0);
+  outstanding_.erase(it);
+  last_data_received_ = std::max(last_data_received_, now);
+  backoff_ = 0;
+  last_rtt_ = rtt;
+  if (!has_rtt_) {
+    srtt_ = rtt;
+    rttvar_ = rtt / 2;
+    has_rtt_ = true;
+  } else {  // alpha = 1/8, beta = 1/4
+    const common::time64_t delta = srtt_ > rtt ? srtt_ - rtt : rtt - srtt_;
+    rttvar_ = (3 * rttvar_ + delta) / 4;
+    srtt_ = (7 * srtt_ + rtt) / 8;
+  }
+  rto_ = std::min<common::time64_t>(std::max<common::time64_t>(srtt_ + 4 * rttvar_, min_rto_msec), max_rto_msec);
+  return true;
+}
+
+void KeepAliveMonitor::DataReceived(common::time64_t now) {
+  last_data_received_ = std::max(last_data_received_, now);
+  backoff_ = 0;
+}
+
+bool KeepAliveMonitor::IsPingDue(common::time64_t now) const {
+  if (!IsProbing()) {  // idle since the last ping or data
+    return now - std::max(last_ping_sent_, last_data_received_) >= interval_msec_;
+  }
+  return now - last_ping_sent_ >= GetRto();  // the last probe is late, probe again
+}
+
+bool KeepAliveMonitor::IsPeerDead(common::time64_t now) const {
+  return GetMissedCount(now) >= max_missed_pings;
+}
+
+size_t KeepAliveMonitor::GetMissedCount(common::time64_t now) const {
+  size_t missed = 0;
+  for (const Ping& ping : outstanding_) {
+    if (ping.sent >= last_data_received_ && now >= ping.deadline) {
+      missed++;
+    }
+  }
+  return missed;
+}
+
+bool KeepAliveMonitor::IsProbing() const {
+  for (const Ping& ping : outstanding_) {
+    if (ping.sent >= last_data_received_) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool KeepAliveMonitor::HasRtt() const {
+  return has_rtt_;
+}
+
+common::time64_t KeepAliveMonitor::GetLastRtt() const {
+  return last_rtt_;
+}
+
+common::time64_t KeepAliveMonitor::GetSmoothedRtt() const {
+  return srtt_;
+}
+
+common::time64_t KeepAliveMonitor::GetRttVariance() const {
+  return rttvar_;
+}
+
+common::time64_t KeepAliveMonitor::GetRto() const {
+  return std::min<common::time64_t>(rto_ << std::min<size_t>(backoff_, 6), max_rto_msec);
+}
+
+}  // namespace inner
+}  // namespace client
+}  // namespace fastotv
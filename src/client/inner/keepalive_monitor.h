@@ -0,0 +1,88 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include <vector>
+
+#include <common/types.h>  // for time64_t
+
+#include <fastotv/protocol/types.h>
+
+namespace fastotv {
+namespace client {
+namespace inner {
+
+// Round trip time of pings smoothed as in RFC 6298, and the retransmission timeout derived from it.
+// A reply is counted as missed once it is RTO late; a missed reply is probed again after one RTO
+// instead of the idle interval, and the RTO doubles for every probe in a row, so a dead peer is
+// declared after a few RTOs instead of minutes. Any inbound data proves the peer is alive.
+class KeepAliveMonitor {
+ public:
+  enum {
+    initial_rto_msec = 3000,
+    min_rto_msec = 1000,
+    max_rto_msec = 60000,
+    max_missed_pings = 3
+  };
+
+  explicit KeepAliveMonitor(common::time64_t interval_msec);
+
+  void Reset(common::time64_t now);  // new connection, the first ping is due after the interval
+
+  void PingSent(const protocol::sequance_id_t& id, common::time64_t now);
+  bool PongReceived(const protocol::sequance_id_t& id, common::time64_t now);  // false if id is not a ping
+  void DataReceived(common::time64_t now);
+
+  bool IsPingDue(common::time64_t now) const;
+  bool IsPeerDead(common::time64_t now) const;
+  size_t GetMissedCount(common::time64_t now) const;
+
+  bool HasRtt() const;
+  common::time64_t GetLastRtt() const;
+  common::time64_t GetSmoothedRtt() const;
+  common::time64_t GetRttVariance() const;
+  common::time64_t GetRto() const;  // with the backoff of unanswered probes
+
+ private:
+  struct Ping {
+    protocol::sequance_id_t id;
+    common::time64_t sent;
+    common::time64_t deadline;  // missed after it
+  };
+
+  bool IsProbing() const;  // a ping sent after the last inbound data is unanswered
+
+  const common::time64_t interval_msec_;
+
+  std::vector<Ping> outstanding_;
+  common::time64_t last_ping_sent_;
+  common::time64_t last_data_received_;
+  bool has_rtt_;
+  common::time64_t last_rtt_;
+  common::time64_t srtt_;
+  common::time64_t rttvar_;
+  common::time64_t rto_;
+  size_t backoff_;  // probes sent in a row without an answer
+};
+
+}  // namespace inner
+}  // namespace client
+}  // namespace fastotv
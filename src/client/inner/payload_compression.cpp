@@ -0,0 +1,233 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "client/inner/payload_compression.h"
+
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include <common/macros.h>
+
+#include <json-c/json_object.h>
+#include <json-c/json_tokener.h>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#define PAYLOAD_ENCODING_FIELD "encoding"
+#define PAYLOAD_DATA_FIELD "data"
+
+namespace fastotv {
+namespace client {
+namespace inner {
+
+namespace {
+
+int base64_value(char c) {
+  if (c >= 'A' && c <= 'Z') {
+    return c - 'A';
+  } else if (c >= 'a' && c <= 'z') {
+    return c - 'a' + 26;
+  } else if (c >= '0' && c <= '9') {
+    return c - '0' + 52;
+  } else if (c == '+') {
+    return 62;
+  } else if (c == '/') {
+    return 63;
+  }
+  return -1;
+}
+
+bool base64_decode(const char* data, size_t size, std::string* out) {
+  std::string decoded;
+  decoded.reserve(size / 4 * 3);
+  uint32_t acc = 0;
+  int bits = 0;
+  for (size_t i = 0; i < size; ++i) {
+    if (data[i] == '=') {
+      break;
+    }
+    const int value = base64_value(data[i]);
+    if (value < 0) {
+      return false;
+    }
+    acc = (acc << 6) | value;
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      decoded.push_back(static_cast<char>((acc >> bits) & 0xff));
+    }
+  }
+
+  *out = decoded;
+  return true;
+}
+
+}  // namespace
+
+PayloadDecoder::PayloadDecoder() : dctx_(nullptr), ddict_(nullptr), dictionary_id_(0) {
+#ifdef HAVE_ZSTD
+  dctx_ = ZSTD_createDCtx();
+#endif
+}
+
+PayloadDecoder::~PayloadDecoder() {
+#ifdef HAVE_ZSTD
+  ZSTD_freeDDict(ddict_);
+  ZSTD_freeDCtx(dctx_);
+#endif
+}
+
+bool PayloadDecoder::IsSupported() {
+#ifdef HAVE_ZSTD
+  return true;
+#else
+  return false;
+#endif
+}
+
+common::Error PayloadDecoder::LoadDictionary(const std::string& path) {
+#ifdef HAVE_ZSTD
+  std::ifstream file(path, std::ios::in | std::ios::binary);
+  if (!file) {
+    return common::make_error("Can't open dictionary: " + path);
+  }
+
+  const std::vector<char> content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  ZSTD_DDict* ddict = ZSTD_createDDict(content.data(), content.size());
+  if (!ddict) {
+    return common::make_error("Invalid dictionary: " + path);
+  }
+
+  ZSTD_freeDDict(ddict_);
+  ddict_ = ddict;
+  dictionary_id_ = ZSTD_getDictID_fromDDict(ddict);
+  return common::Error();
+#else
+  UNUSED(path);
+  return common::make_error("Built without zstd support");
+#endif
+}
+
+uint32_t PayloadDecoder::GetDictionaryID() const {
+  return dictionary_id_;
+}
+
+common::Error PayloadDecoder::ParseResult(json_object* jresult, WireFormat format, json_object** out) {
+  if (!jresult || !out) {
+    return common::make_error_inval();
+  }
+
+  json_object* jencoding = nullptr;
+  if (!json_object_is_type(jresult, json_type_object) ||
+      !json_object_object_get_ex(jresult, PAYLOAD_ENCODING_FIELD, &jencoding)) {
+    *out = json_object_get(jresult);
+    return common::Error();
+  }
+
+  const std::string encoding = json_object_get_string(jencoding);
+  json_object* jdata = nullptr;
+  if (encoding != PAYLOAD_CODEC_ZSTD || !json_object_object_get_ex(jresult, PAYLOAD_DATA_FIELD, &jdata)) {
+    return common::make_error("Unsupported payload encoding: " + encoding);
+  }
+
+  const char* data = json_object_get_string(jdata);
+  const size_t size = json_object_get_string_len(jdata);
+  if (format == MSGPACK_WIRE_FORMAT) {  // bin, taken as is
+    return Decompress(data, size, out);
+  }
+
+  std::string frame;
+  if (!base64_decode(data, size, &frame)) {
+    return common::make_error("Invalid compressed payload");
+  }
+  return Decompress(frame.data(), frame.size(), out);
+}
+
+common::Error PayloadDecoder::Decompress(const char* frame, size_t size, json_object** out) {
+#ifdef HAVE_ZSTD
+  if (!dctx_) {
+    return common::make_error("Decompression context not created");
+  }
+
+  const unsigned long long content_size = ZSTD_getFrameContentSize(frame, size);
+  if (content_size != ZSTD_CONTENTSIZE_UNKNOWN && content_size != ZSTD_CONTENTSIZE_ERROR &&
+      content_size > max_decompressed_size) {
+    return common::make_error("Compressed payload is too large");
+  }
+
+  ZSTD_DCtx_reset(dctx_, ZSTD_reset_session_only);
+  ZSTD_DCtx_refDDict(dctx_, ddict_);  // nullptr returns to frames without dictionary
+
+  json_tokener* tok = json_tokener_new();
+  std::vector<char> chunk(ZSTD_DStreamOutSize());
+  ZSTD_inBuffer input = {frame, size, 0};
+  json_object* obj = nullptr;
+  enum json_tokener_error jerr = json_tokener_continue;
+  size_t remaining = 1;
+  size_t decompressed = 0;
+  while (remaining != 0) {
+    ZSTD_outBuffer output = {chunk.data(), chunk.size(), 0};
+    remaining = ZSTD_decompressStream(dctx_, &output, &input);
+    if (ZSTD_isError(remaining)) {
+      json_tokener_free(tok);
+      return common::make_error(std::string("Decompression failed: ") + ZSTD_getErrorName(remaining));
+    }
+
+    decompressed += output.pos;
+    if (decompressed > max_decompressed_size) {  // the frame header may not tell the size, or lie about it
+      json_tokener_free(tok);
+      return common::make_error("Compressed payload is too large");
+    }
+
+    if (output.pos) {
+      obj = json_tokener_parse_ex(tok, chunk.data(), static_cast<int>(output.pos));
+      jerr = json_tokener_get_error(tok);
+      if (jerr != json_tokener_continue) {
+        break;
+      }
+    }
+
+    if (input.pos == input.size && output.pos < output.size) {
+      break;  // no more input and nothing buffered in the decoder
+    }
+  }
+  json_tokener_free(tok);
+
+  if (jerr == json_tokener_continue) {
+    return common::make_error("Truncated compressed payload");
+  }
+  if (!obj) {
+    return common::make_error(std::string("Invalid compressed payload: ") + json_tokener_error_desc(jerr));
+  }
+
+  *out = obj;
+  return common::Error();
+#else
+  UNUSED(frame);
+  UNUSED(size);
+  UNUSED(out);
+  return common::make_error("Built without zstd support");
+#endif
+}
+
+}  // namespace inner
+}  // namespace client
+}  // namespace fastotv
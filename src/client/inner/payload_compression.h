@@ -0,0 +1,69 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+
+#include <common/error.h>
+
+#include "client/inner/wire_format.h"
+
+#define PAYLOAD_CODEC_ZSTD "zstd"
+
+struct json_object;
+struct ZSTD_DCtx_s;
+struct ZSTD_DDict_s;
+
+namespace fastotv {
+namespace client {
+namespace inner {
+
+// Large results may arrive as {"encoding": "zstd", "data": <zstd frame>} once the codec was negotiated.
+// The frame is MessagePack bin in msgpack messages and base64 text in json ones. It is decompressed chunk
+// by chunk straight into the json tokener, so the uncompressed document never exists as one text buffer.
+class PayloadDecoder {
+ public:
+  enum { max_decompressed_size = 64 * 1024 * 1024 };  // larger documents are rejected, not a memory bomb
+
+  PayloadDecoder();
+  ~PayloadDecoder();
+
+  static bool IsSupported();  // built with zstd
+
+  // dictionary trained offline on channel lists, frames compressed with it need the same dictionary
+  common::Error LoadDictionary(const std::string& path) WARN_UNUSED_RESULT;
+  uint32_t GetDictionaryID() const;  // zero when no dictionary loaded
+
+  // plain results are returned with an extra reference, encoded ones are decompressed first;
+  // format is the one of the message the result came in
+  common::Error ParseResult(json_object* jresult, WireFormat format, json_object** out) WARN_UNUSED_RESULT;
+
+ private:
+  common::Error Decompress(const char* frame, size_t size, json_object** out);
+
+  ZSTD_DCtx_s* dctx_;
+  ZSTD_DDict_s* ddict_;
+  uint32_t dictionary_id_;
+};
+
+}  // namespace inner
+}  // namespace client
+}  // namespace fastotv
@@ -0,0 +1,104 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "client/inner/request_deadlines.h"
+
+#include <algorithm>
+
+namespace fastotv {
+namespace client {
+namespace inner {
+
+RequestDeadlines::RequestDeadlines() : heap_(), pending_(), next_seq_(0) {}
+
+void RequestDeadlines::Add(const protocol::request_t& request, size_t attempt, common::time64_t deadline) {
+  const uint64_t seq = next_seq_++;
+  Entry entry = {seq, {request, attempt}};
+  pending_.push_back(entry);
+  Deadline dl = {deadline, seq};
+  heap_.push_back(dl);
+  std::push_heap(heap_.begin(), heap_.end(), &RequestDeadlines::IsLater);
+}
+
+bool RequestDeadlines::Remove(const protocol::sequance_id_t& id) {
+  for (auto it = pending_.begin(); it != pending_.end(); ++it) {
+    if (it->pending.request.id == id) {
+      pending_.erase(it);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool RequestDeadlines::GetNextDeadline(common::time64_t* deadline) {
+  DropAnswered();
+  if (heap_.empty()) {
+    return false;
+  }
+
+  *deadline = heap_.front().at;
+  return true;
+}
+
+bool RequestDeadlines::PopExpired(common::time64_t now, Pending* expired) {
+  DropAnswered();
+  if (heap_.empty() || heap_.front().at > now) {
+    return false;
+  }
+
+  std::pop_heap(heap_.begin(), heap_.end(), &RequestDeadlines::IsLater);
+  const uint64_t seq = heap_.back().seq;
+  heap_.pop_back();
+  auto it = FindEntry(seq);
+  *expired = it->pending;
+  pending_.erase(it);
+  return true;
+}
+
+void RequestDeadlines::Clear() {
+  heap_.clear();
+  pending_.clear();
+}
+
+size_t RequestDeadlines::GetPendingCount() const {
+  return pending_.size();
+}
+
+bool RequestDeadlines::IsLater(const Deadline& left, const Deadline& right) {
+  return left.at > right.at;
+}
+
+std::vector<RequestDeadlines::Entry>::iterator RequestDeadlines::FindEntry(uint64_t seq) {
+  for (auto it = pending_.begin(); it != pending_.end(); ++it) {
+    if (it->seq == seq) {
+      return it;
+    }
+  }
+  return pending_.end();
+}
+
+void RequestDeadlines::DropAnswered() {
+  while (!heap_.empty() && FindEntry(heap_.front().seq) == pending_.end()) {
+    std::pop_heap(heap_.begin(), heap_.end(), &RequestDeadlines::IsLater);
+    heap_.pop_back();
+  }
+}
+
+}  // namespace inner
+}  // namespace client
+}  // namespace fastotv
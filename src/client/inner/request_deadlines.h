@@ -0,0 +1,74 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <common/types.h>  // for time64_t
+
+#include <fastotv/protocol/types.h>
+
+namespace fastotv {
+namespace client {
+namespace inner {
+
+// Outstanding requests in a min-heap ordered by deadline, so one loop timer armed for the
+// earliest deadline covers all of them. Answered requests leave the pending list at once,
+// their heap entries are skipped when they reach the top.
+class RequestDeadlines {
+ public:
+  struct Pending {
+    protocol::request_t request;
+    size_t attempt;  // zero for the first send
+  };
+
+  RequestDeadlines();
+
+  void Add(const protocol::request_t& request, size_t attempt, common::time64_t deadline);
+  bool Remove(const protocol::sequance_id_t& id);  // false if not tracked
+  bool GetNextDeadline(common::time64_t* deadline);
+  bool PopExpired(common::time64_t now, Pending* expired);
+  void Clear();
+
+  size_t GetPendingCount() const;
+
+ private:
+  struct Deadline {
+    common::time64_t at;
+    uint64_t seq;
+  };
+  struct Entry {
+    uint64_t seq;
+    Pending pending;
+  };
+
+  static bool IsLater(const Deadline& left, const Deadline& right);
+  std::vector<Entry>::iterator FindEntry(uint64_t seq);
+  void DropAnswered();
+
+  std::vector<Deadline> heap_;
+  std::vector<Entry> pending_;  // a handful of requests, linear search is fine
+  uint64_t next_seq_;
+};
+
+}  // namespace inner
+}  // namespace client
+}  // namespace fastotv
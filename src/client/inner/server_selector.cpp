@@ -0,0 +1,164 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "client/inner/server_selector.h"
+
+#include <stdio.h>  // for rename
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include <common/convert2string.h>
+
+namespace fastotv {
+namespace client {
+namespace inner {
+
+ServerSelector::ServerStats::ServerStats() : connect_latency_msec(0), consecutive_failures(0), last_failure_msec(0) {}
+
+ServerSelector::ServerSelector(const std::vector<common::net::HostAndPort>& servers)
+    : servers_(servers), stats_(servers.size()) {}
+
+size_t ServerSelector::GetServersCount() const {
+  return servers_.size();
+}
+
+common::net::HostAndPort ServerSelector::GetServer(size_t index) const {
+  return servers_[index];
+}
+
+ServerSelector::ServerStats ServerSelector::GetStats(size_t index) const {
+  return stats_[index];
+}
+
+bool ServerSelector::IsHealthy(size_t index, common::time64_t now) const {
+  return stats_[index].consecutive_failures == 0 || now >= GetRetryTime(index);
+}
+
+bool ServerSelector::HasHealthy(common::time64_t now) const {
+  for (size_t i = 0; i < servers_.size(); ++i) {
+    if (IsHealthy(i, now)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::vector<size_t> ServerSelector::Rank(common::time64_t now) const {
+  std::vector<size_t> healthy;
+  std::vector<size_t> cooling;
+  for (size_t i = 0; i < servers_.size(); ++i) {
+    if (IsHealthy(i, now)) {
+      healthy.push_back(i);
+    } else {
+      cooling.push_back(i);
+    }
+  }
+
+  // servers never connected to come first, so a new server gets measured; config order breaks ties
+  std::stable_sort(healthy.begin(), healthy.end(), [this](size_t left, size_t right) {
+    return stats_[left].connect_latency_msec < stats_[right].connect_latency_msec;
+  });
+  std::stable_sort(cooling.begin(), cooling.end(),
+                   [this](size_t left, size_t right) { return GetRetryTime(left) < GetRetryTime(right); });
+  healthy.insert(healthy.end(), cooling.begin(), cooling.end());
+  return healthy;
+}
+
+void ServerSelector::ConnectSucceeded(size_t index, common::time64_t latency_msec) {
+  ServerStats* stats = &stats_[index];
+  latency_msec = std::max<common::time64_t>(latency_msec, 1);
+  if (stats->connect_latency_msec == 0) {
+    stats->connect_latency_msec = latency_msec;
+  } else {
+    stats->connect_latency_msec = (3 * stats->connect_latency_msec + latency_msec) / 4;
+  }
+  stats->consecutive_failures = 0;
+}
+
+void ServerSelector::ConnectFailed(size_t index, common::time64_t now) {
+  stats_[index].consecutive_failures++;
+  stats_[index].last_failure_msec = now;
+}
+
+common::Error ServerSelector::Load(const std::string& path) {
+  std::ifstream file(path);
+  if (!file) {
+    return common::make_error("Can't open servers history: " + path);
+  }
+
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    std::string host;
+    ServerStats stats;
+    if (!(fields >> host >> stats.connect_latency_msec >> stats.consecutive_failures >> stats.last_failure_msec)) {
+      continue;
+    }
+
+    for (size_t i = 0; i < servers_.size(); ++i) {
+      if (common::ConvertToString(servers_[i]) == host) {
+        stats_[i] = stats;
+      }
+    }
+  }
+  return common::Error();
+}
+
+common::Error ServerSelector::Save(const std::string& path) const {
+  // written aside and renamed, a crash never leaves a truncated history
+  const std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream file(tmp_path, std::ios::out | std::ios::trunc);
+    if (!file) {
+      return common::make_error("Can't write servers history: " + tmp_path);
+    }
+
+    for (size_t i = 0; i < servers_.size(); ++i) {
+      file << common::ConvertToString(servers_[i]) << ' ' << stats_[i].connect_latency_msec << ' '
+           << stats_[i].consecutive_failures << ' ' << stats_[i].last_failure_msec << '\n';
+    }
+    if (!file.flush()) {
+      return common::make_error("Can't write servers history: " + tmp_path);
+    }
+  }
+
+  if (rename(tmp_path.c_str(), path.c_str()) == 0) {
+    return common::Error();
+  }
+
+  // windows doesn't rename over an existing file
+  if (remove(path.c_str()) != 0 || rename(tmp_path.c_str(), path.c_str()) != 0) {
+    return common::make_error("Can't replace servers history: " + path);
+  }
+  return common::Error();
+}
+
+common::time64_t ServerSelector::GetRetryTime(size_t index) const {
+  const ServerStats& stats = stats_[index];
+  common::time64_t cooldown = failure_cooldown_msec;
+  for (size_t i = 1; i < stats.consecutive_failures && cooldown < max_failure_cooldown_msec; ++i) {
+    cooldown *= 2;
+  }
+  return stats.last_failure_msec + std::min<common::time64_t>(cooldown, max_failure_cooldown_msec);
+}
+
+}  // namespace inner
+}  // namespace client
+}  // namespace fastotv
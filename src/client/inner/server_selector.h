@@ -0,0 +1,77 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include <common/error.h>
+#include <common/net/types.h>  // for HostAndPort
+#include <common/types.h>      // for time64_t
+
+namespace fastotv {
+namespace client {
+namespace inner {
+
+// Connect history of the configured servers. Healthy servers are ranked by smoothed connect latency,
+// a failed server is kept back for a cooldown doubled on every consecutive failure.
+// The history survives restarts in a small text file, one server per line.
+class ServerSelector {
+ public:
+  enum {
+    failure_cooldown_msec = 30 * 1000,
+    max_failure_cooldown_msec = 60 * 60 * 1000
+  };
+
+  struct ServerStats {
+    ServerStats();
+
+    common::time64_t connect_latency_msec;  // zero if never connected
+    size_t consecutive_failures;
+    common::time64_t last_failure_msec;  // utc
+  };
+
+  explicit ServerSelector(const std::vector<common::net::HostAndPort>& servers);
+
+  size_t GetServersCount() const;
+  common::net::HostAndPort GetServer(size_t index) const;
+  ServerStats GetStats(size_t index) const;
+
+  bool IsHealthy(size_t index, common::time64_t now) const;
+  bool HasHealthy(common::time64_t now) const;
+  std::vector<size_t> Rank(common::time64_t now) const;  // every server, best first
+
+  void ConnectSucceeded(size_t index, common::time64_t latency_msec);
+  void ConnectFailed(size_t index, common::time64_t now);
+
+  common::Error Load(const std::string& path);  // entries of unknown servers are skipped
+  common::Error Save(const std::string& path) const;
+
+ private:
+  common::time64_t GetRetryTime(size_t index) const;
+
+  const std::vector<common::net::HostAndPort> servers_;
+  std::vector<ServerStats> stats_;
+};
+
+}  // namespace inner
+}  // namespace client
+}  // namespace fastotv
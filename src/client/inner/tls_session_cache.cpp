@@ -0,0 +1,218 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "client/inner/tls_session_cache.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#if defined(OS_WIN)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <fstream>
+#include <sstream>
+
+#include <common/logger.h>
+
+namespace fastotv {
+namespace client {
+namespace inner {
+
+namespace {
+
+// the sessions hold resumption secrets, the file is readable by the owner only from the moment it exists
+FILE* open_private_file(const std::string& path) {
+#if defined(OS_WIN)
+  const int fd = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+  const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+#endif
+  if (fd < 0) {
+    return nullptr;
+  }
+
+#if !defined(OS_WIN)
+  if (fchmod(fd, S_IRUSR | S_IWUSR) != 0) {  // left over by an older version with the default umask
+    close(fd);
+    return nullptr;
+  }
+#endif
+  FILE* file = fdopen(fd, "wb");
+  if (!file) {
+#if defined(OS_WIN)
+    _close(fd);
+#else
+    close(fd);
+#endif
+  }
+  return file;
+}
+
+std::string to_hex(const std::string& data) {
+  static const char digits[] = "0123456789abcdef";
+  std::string result;
+  result.reserve(data.size() * 2);
+  for (unsigned char c : data) {
+    result += digits[c >> 4];
+    result += digits[c & 0x0F];
+  }
+  return result;
+}
+
+int hex_value(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+
+bool from_hex(const std::string& hex, std::string* data) {
+  if (hex.size() % 2) {
+    return false;
+  }
+
+  std::string result;
+  result.reserve(hex.size() / 2);
+  for (size_t i = 0; i < hex.size(); i += 2) {
+    const int high = hex_value(hex[i]);
+    const int low = hex_value(hex[i + 1]);
+    if (high < 0 || low < 0) {
+      return false;
+    }
+    result += static_cast<char>(high << 4 | low);
+  }
+  *data = result;
+  return true;
+}
+
+}  // namespace
+
+TlsSessionCache::TlsSessionCache(const std::string& path) : path_(path), sessions_() {}
+
+common::Error TlsSessionCache::Load() {
+  if (path_.empty()) {
+    return common::Error();
+  }
+
+  std::ifstream file(path_);
+  if (!file) {
+    return common::make_error("Can't open tls sessions: " + path_);
+  }
+
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    std::string server;
+    std::string hex;
+    std::string der;
+    if (!(fields >> server >> hex) || !from_hex(hex, &der)) {
+      continue;
+    }
+    sessions_[server] = der;
+  }
+  return common::Error();
+}
+
+SSL_SESSION* TlsSessionCache::Get(const std::string& server) const {
+  auto it = sessions_.find(server);
+  if (it == sessions_.end()) {
+    return nullptr;
+  }
+
+  const unsigned char* der = reinterpret_cast<const unsigned char*>(it->second.data());
+  SSL_SESSION* session = d2i_SSL_SESSION(nullptr, &der, static_cast<long>(it->second.size()));
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+  if (session && !SSL_SESSION_is_resumable(session)) {
+    SSL_SESSION_free(session);
+    return nullptr;
+  }
+#endif
+  return session;
+}
+
+void TlsSessionCache::Put(const std::string& server, SSL_SESSION* session) {
+  const int size = i2d_SSL_SESSION(session, nullptr);
+  if (size <= 0) {
+    return;
+  }
+
+  std::string der(size, 0);
+  unsigned char* out = reinterpret_cast<unsigned char*>(&der[0]);
+  if (i2d_SSL_SESSION(session, &out) != size) {
+    return;
+  }
+
+  sessions_[server] = der;
+  common::Error err = Save();
+  if (err) {
+    WARNING_LOG() << err->GetDescription();
+  }
+}
+
+void TlsSessionCache::Remove(const std::string& server) {
+  if (sessions_.erase(server)) {
+    ignore_result(Save());
+  }
+}
+
+size_t TlsSessionCache::GetCount() const {
+  return sessions_.size();
+}
+
+common::Error TlsSessionCache::Save() const {
+  if (path_.empty()) {
+    return common::Error();
+  }
+
+  // written aside and renamed, a crash never leaves a truncated file
+  const std::string tmp_path = path_ + ".tmp";
+  FILE* file = open_private_file(tmp_path);
+  if (!file) {
+    return common::make_error("Can't write tls sessions: " + tmp_path);
+  }
+
+  bool written = true;
+  for (auto it = sessions_.begin(); it != sessions_.end() && written; ++it) {
+    const std::string line = it->first + ' ' + to_hex(it->second) + '\n';
+    written = fwrite(line.data(), 1, line.size(), file) == line.size();
+  }
+  if (fclose(file) != 0 || !written) {
+    remove(tmp_path.c_str());
+    return common::make_error("Can't write tls sessions: " + tmp_path);
+  }
+
+  if (rename(tmp_path.c_str(), path_.c_str()) == 0) {
+    return common::Error();
+  }
+
+  // windows doesn't rename over an existing file
+  if (remove(path_.c_str()) != 0 || rename(tmp_path.c_str(), path_.c_str()) != 0) {
+    return common::make_error("Can't replace tls sessions: " + path_);
+  }
+  return common::Error();
+}
+
+}  // namespace inner
+}  // namespace client
+}  // namespace fastotv
@@ -0,0 +1,55 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <map>
+#include <string>
+
+#include <openssl/ssl.h>
+
+#include <common/error.h>
+
+namespace fastotv {
+namespace client {
+namespace inner {
+
+// TLS sessions the servers handed out, by "host:port", so a reconnect resumes instead of running the full handshake.
+// Kept as DER in memory and, when a path is given, in a file with one "host:port hex" line per server which is
+// written aside and renamed like the servers history.
+class TlsSessionCache {
+ public:
+  explicit TlsSessionCache(const std::string& path);  // empty path keeps sessions in memory only
+
+  common::Error Load() WARN_UNUSED_RESULT;
+
+  SSL_SESSION* Get(const std::string& server) const;  // nullptr if none, the caller frees the result
+  void Put(const std::string& server, SSL_SESSION* session);
+  void Remove(const std::string& server);
+  size_t GetCount() const;
+
+ private:
+  common::Error Save() const;
+
+  const std::string path_;
+  std::map<std::string, std::string> sessions_;
+};
+
+}  // namespace inner
+}  // namespace client
+}  // namespace fastotv
@@ -0,0 +1,214 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "client/inner/tls_transport.h"
+
+#include <errno.h>
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+#include <common/convert2string.h>
+
+#include "client/inner/tls_session_cache.h"
+
+namespace fastotv {
+namespace client {
+namespace inner {
+
+namespace {
+
+std::string tls_error_string() {
+  const unsigned long err = ERR_get_error();
+  if (err == 0) {
+    return "TLS error";
+  }
+  char buff[256];
+  ERR_error_string_n(err, buff, sizeof(buff));
+  ERR_clear_error();
+  return buff;
+}
+
+}  // namespace
+
+TlsTransport::TlsTransport(SSL_CTX* tls_ctx, TlsSessionCache* sessions, const common::net::HostAndPort& server)
+    : tls_ctx_(tls_ctx), sessions_(sessions), server_(common::ConvertToString(server)), host_(server.GetHost()),
+      ssl_(nullptr), want_write_(false) {}
+
+TlsTransport::~TlsTransport() {
+  if (ssl_) {
+    SSL_free(ssl_);
+  }
+}
+
+SSL_CTX* TlsTransport::CreateContext(bool verify_peer) {
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+  SSL_library_init();
+  SSL_load_error_strings();
+  SSL_CTX* ctx = SSL_CTX_new(SSLv23_client_method());
+#else
+  SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+#endif
+  if (!ctx) {
+    return nullptr;
+  }
+
+  SSL_CTX_set_options(ctx, SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3);
+  if (verify_peer) {
+    SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, nullptr);
+    SSL_CTX_set_default_verify_paths(ctx);
+  }
+  SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+  SSL_CTX_sess_set_new_cb(ctx, NewSessionCallback);
+  return ctx;
+}
+
+common::ErrnoError TlsTransport::StartHandshake(common::net::socket_descr_t fd) {
+  if (ssl_) {
+    return common::make_errno_error_inval();
+  }
+
+  ssl_ = SSL_new(tls_ctx_);
+  if (!ssl_) {
+    return common::make_errno_error(tls_error_string(), ENOMEM);
+  }
+
+  SSL_set_app_data(ssl_, this);
+  SSL_set_fd(ssl_, static_cast<int>(fd));
+  SSL_set_tlsext_host_name(ssl_, host_.c_str());
+  X509_VERIFY_PARAM_set1_host(SSL_get0_param(ssl_), host_.c_str(), 0);
+  if (sessions_) {
+    SSL_SESSION* session = sessions_->Get(server_);
+    if (session) {
+      SSL_set_session(ssl_, session);
+      SSL_SESSION_free(session);
+    }
+  }
+  return common::ErrnoError();
+}
+
+common::ErrnoError TlsTransport::ContinueHandshake(bool* done) {
+  if (!ssl_ || !done) {
+    return common::make_errno_error_inval();
+  }
+
+  const int res = SSL_connect(ssl_);
+  if (res == 1) {
+    want_write_ = false;
+    *done = true;
+    return common::ErrnoError();
+  }
+
+  const int ssl_err = SSL_get_error(ssl_, res);
+  if (ssl_err == SSL_ERROR_WANT_READ || ssl_err == SSL_ERROR_WANT_WRITE) {
+    want_write_ = ssl_err == SSL_ERROR_WANT_WRITE;
+    *done = false;
+    return common::ErrnoError();
+  }
+
+  if (sessions_) {
+    sessions_->Remove(server_);  // a stale session must not fail the next attempt too
+  }
+  return common::make_errno_error(tls_error_string(), EPROTO);
+}
+
+bool TlsTransport::WantsWrite() const {
+  return want_write_;
+}
+
+bool TlsTransport::IsResumed() const {
+  return ssl_ && SSL_session_reused(ssl_);
+}
+
+common::ErrnoError TlsTransport::Write(const void* data, size_t size, size_t* nwrite) {
+  if (!ssl_ || !nwrite) {
+    return common::make_errno_error_inval();
+  }
+
+  const int res = SSL_write(ssl_, data, static_cast<int>(size));
+  if (res > 0) {
+    *nwrite = res;
+    return common::ErrnoError();
+  }
+
+  const int ssl_err = SSL_get_error(ssl_, res);
+  if (ssl_err == SSL_ERROR_WANT_READ || ssl_err == SSL_ERROR_WANT_WRITE) {
+    want_write_ = ssl_err == SSL_ERROR_WANT_WRITE;
+    return common::make_errno_error(EAGAIN);
+  }
+  return common::make_errno_error(tls_error_string(), EPIPE);
+}
+
+common::ErrnoError TlsTransport::Read(void* out, size_t max_size, size_t* nread) {
+  if (!ssl_ || !nread) {
+    return common::make_errno_error_inval();
+  }
+
+  const int res = SSL_read(ssl_, out, static_cast<int>(max_size));
+  if (res > 0) {
+    *nread = res;
+    return common::ErrnoError();
+  }
+
+  const int ssl_err = SSL_get_error(ssl_, res);
+  if (ssl_err == SSL_ERROR_WANT_READ || ssl_err == SSL_ERROR_WANT_WRITE) {
+    want_write_ = ssl_err == SSL_ERROR_WANT_WRITE;
+    return common::make_errno_error(EAGAIN);
+  }
+  if (ssl_err == SSL_ERROR_ZERO_RETURN || (ssl_err == SSL_ERROR_SYSCALL && res == 0)) {
+    return common::make_errno_error(ECONNRESET);
+  }
+  return common::make_errno_error(tls_error_string(), EPROTO);
+}
+
+bool TlsTransport::HasApplicationData() {
+  if (!ssl_) {
+    return false;
+  }
+
+  char byte;
+  const int res = SSL_peek(ssl_, &byte, 1);
+  if (res > 0) {
+    return true;
+  }
+  const int ssl_err = SSL_get_error(ssl_, res);
+  return ssl_err != SSL_ERROR_WANT_READ && ssl_err != SSL_ERROR_WANT_WRITE;  // errors are reported by Read
+}
+
+bool TlsTransport::HasBufferedInput() const {
+  return ssl_ && SSL_pending(ssl_) > 0;
+}
+
+void TlsTransport::Shutdown() {
+  if (ssl_) {
+    SSL_shutdown(ssl_);  // best effort close_notify, the socket is non-blocking
+  }
+}
+
+int TlsTransport::NewSessionCallback(SSL* ssl, SSL_SESSION* session) {
+  TlsTransport* self = static_cast<TlsTransport*>(SSL_get_app_data(ssl));
+  if (self && self->sessions_) {
+    self->sessions_->Put(self->server_, session);
+  }
+  return 0;  // the reference stays with openssl
+}
+
+}  // namespace inner
+}  // namespace client
+}  // namespace fastotv
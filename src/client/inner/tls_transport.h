@@ -0,0 +1,79 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include <string>
+
+#include <common/error.h>
+#include <common/net/types.h>  // for socket_descr_t, HostAndPort
+
+typedef struct ssl_st SSL;
+typedef struct ssl_ctx_st SSL_CTX;
+typedef struct ssl_session_st SSL_SESSION;
+
+namespace fastotv {
+namespace client {
+namespace inner {
+
+class TlsSessionCache;
+
+// TLS on top of an already connected control channel socket. The handshake offers the session cached for the server
+// and every new session (tls 1.3 tickets arrive after the handshake) is stored back, so reconnects skip the full
+// handshake. The handshake, Read and Write are non-blocking and report EAGAIN the way plain socket I/O does.
+class TlsTransport {
+ public:
+  TlsTransport(SSL_CTX* tls_ctx, TlsSessionCache* sessions, const common::net::HostAndPort& server);
+  ~TlsTransport();
+
+  // client context for the control channel, sessions are kept only by TlsSessionCache
+  static SSL_CTX* CreateContext(bool verify_peer);
+
+  common::ErrnoError StartHandshake(common::net::socket_descr_t fd) WARN_UNUSED_RESULT;
+  // called whenever the socket gets ready, done is set once the handshake completed,
+  // until then WantsWrite tells whether to wait for the socket to become writable or readable
+  common::ErrnoError ContinueHandshake(bool* done) WARN_UNUSED_RESULT;
+  bool WantsWrite() const;
+  bool IsResumed() const;
+
+  // EAGAIN when the socket isn't ready, WantsWrite tells for what to wait then
+  common::ErrnoError Write(const void* data, size_t size, size_t* nwrite) WARN_UNUSED_RESULT;
+  common::ErrnoError Read(void* out, size_t max_size, size_t* nread) WARN_UNUSED_RESULT;
+  // false while the socket carried only handshake messages (tls 1.3 tickets) or part of a record
+  bool HasApplicationData();
+  // decrypted bytes which won't wake the loop up again as the socket has nothing left
+  bool HasBufferedInput() const;
+
+  void Shutdown();
+
+ private:
+  static int NewSessionCallback(SSL* ssl, SSL_SESSION* session);
+
+  SSL_CTX* const tls_ctx_;
+  TlsSessionCache* const sessions_;
+  const std::string server_;
+  const std::string host_;
+  SSL* ssl_;
+  bool want_write_;
+};
+
+}  // namespace inner
+}  // namespace client
+}  // namespace fastotv
@@ -0,0 +1,389 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "client/inner/wire_format.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <json-c/json_object.h>
+
+#define MSGPACK_MAX_DEPTH 64
+
+namespace fastotv {
+namespace client {
+namespace inner {
+
+namespace {
+
+void put_be(uint64_t value, size_t bytes, std::string* out) {
+  for (size_t i = bytes; i > 0; --i) {
+    out->push_back(static_cast<char>((value >> ((i - 1) * 8)) & 0xff));
+  }
+}
+
+void put_header(uint8_t fix_mask, size_t fix_max, uint8_t base8, uint8_t base16, uint8_t base32, size_t len,
+                std::string* out) {
+  if (len <= fix_max) {
+    out->push_back(static_cast<char>(fix_mask | len));
+  } else if (base8 && len <= UINT8_MAX) {
+    out->push_back(static_cast<char>(base8));
+    put_be(len, 1, out);
+  } else if (len <= UINT16_MAX) {
+    out->push_back(static_cast<char>(base16));
+    put_be(len, 2, out);
+  } else {
+    out->push_back(static_cast<char>(base32));
+    put_be(len, 4, out);
+  }
+}
+
+void encode_int(int64_t value, std::string* out) {
+  if (value >= 0) {
+    if (value <= 0x7f) {
+      out->push_back(static_cast<char>(value));
+    } else if (value <= UINT8_MAX) {
+      out->push_back(static_cast<char>(0xcc));
+      put_be(value, 1, out);
+    } else if (value <= UINT16_MAX) {
+      out->push_back(static_cast<char>(0xcd));
+      put_be(value, 2, out);
+    } else if (value <= UINT32_MAX) {
+      out->push_back(static_cast<char>(0xce));
+      put_be(value, 4, out);
+    } else {
+      out->push_back(static_cast<char>(0xcf));
+      put_be(value, 8, out);
+    }
+    return;
+  }
+
+  if (value >= -32) {
+    out->push_back(static_cast<char>(value));
+  } else if (value >= INT8_MIN) {
+    out->push_back(static_cast<char>(0xd0));
+    put_be(static_cast<uint64_t>(value), 1, out);
+  } else if (value >= INT16_MIN) {
+    out->push_back(static_cast<char>(0xd1));
+    put_be(static_cast<uint64_t>(value), 2, out);
+  } else if (value >= INT32_MIN) {
+    out->push_back(static_cast<char>(0xd2));
+    put_be(static_cast<uint64_t>(value), 4, out);
+  } else {
+    out->push_back(static_cast<char>(0xd3));
+    put_be(static_cast<uint64_t>(value), 8, out);
+  }
+}
+
+void encode_string(const char* str, size_t len, std::string* out) {
+  put_header(0xa0, 31, 0xd9, 0xda, 0xdb, len, out);
+  out->append(str, len);
+}
+
+common::Error encode(json_object* obj, size_t depth, std::string* out) {
+  if (depth > MSGPACK_MAX_DEPTH) {
+    return common::make_error("Too deep document");
+  }
+
+  switch (json_object_get_type(obj)) {
+    case json_type_null:
+      out->push_back(static_cast<char>(0xc0));
+      return common::Error();
+    case json_type_boolean:
+      out->push_back(static_cast<char>(json_object_get_boolean(obj) ? 0xc3 : 0xc2));
+      return common::Error();
+    case json_type_int:
+      encode_int(json_object_get_int64(obj), out);
+      return common::Error();
+    case json_type_double: {
+      const double value = json_object_get_double(obj);
+      uint64_t bits;
+      memcpy(&bits, &value, sizeof(bits));
+      out->push_back(static_cast<char>(0xcb));
+      put_be(bits, 8, out);
+      return common::Error();
+    }
+    case json_type_string:
+      encode_string(json_object_get_string(obj), json_object_get_string_len(obj), out);
+      return common::Error();
+    case json_type_array: {
+      const size_t len = json_object_array_length(obj);
+      put_header(0x90, 15, 0, 0xdc, 0xdd, len, out);
+      for (size_t i = 0; i < len; ++i) {
+        common::Error err = encode(json_object_array_get_idx(obj, i), depth + 1, out);
+        if (err) {
+          return err;
+        }
+      }
+      return common::Error();
+    }
+    case json_type_object: {
+      put_header(0x80, 15, 0, 0xde, 0xdf, json_object_object_length(obj), out);
+      json_object_object_foreach(obj, key, val) {
+        encode_string(key, strlen(key), out);
+        common::Error err = encode(val, depth + 1, out);
+        if (err) {
+          return err;
+        }
+      }
+      return common::Error();
+    }
+  }
+
+  return common::make_error("Unknown json type");
+}
+
+class Decoder {
+ public:
+  Decoder(const char* data, size_t size)
+      : data_(reinterpret_cast<const uint8_t*>(data)), size_(size), pos_(0) {}
+
+  bool IsEnd() const { return pos_ == size_; }
+
+  common::Error Decode(size_t depth, json_object** out) {
+    if (depth > MSGPACK_MAX_DEPTH) {
+      return common::make_error("Too deep document");
+    }
+
+    uint64_t tag;
+    if (!Read(1, &tag)) {
+      return common::make_error("Unexpected end of data");
+    }
+
+    if (tag <= 0x7f) {
+      *out = json_object_new_int64(tag);
+      return common::Error();
+    } else if (tag >= 0xe0) {
+      *out = json_object_new_int64(static_cast<int8_t>(tag));
+      return common::Error();
+    } else if ((tag & 0xf0) == 0x80) {
+      return DecodeMap(tag & 0x0f, depth, out);
+    } else if ((tag & 0xf0) == 0x90) {
+      return DecodeArray(tag & 0x0f, depth, out);
+    } else if ((tag & 0xe0) == 0xa0) {
+      return DecodeString(tag & 0x1f, out);
+    }
+
+    uint64_t value;
+    switch (tag) {
+      case 0xc0:
+        *out = nullptr;
+        return common::Error();
+      case 0xc2:
+      case 0xc3:
+        *out = json_object_new_boolean(tag == 0xc3);
+        return common::Error();
+      case 0xc4:
+      case 0xd9:
+        return ReadLength(1, &value) ? DecodeString(value, out) : Truncated();
+      case 0xc5:
+      case 0xda:
+        return ReadLength(2, &value) ? DecodeString(value, out) : Truncated();
+      case 0xc6:
+      case 0xdb:
+        return ReadLength(4, &value) ? DecodeString(value, out) : Truncated();
+      case 0xca: {
+        if (!Read(4, &value)) {
+          return Truncated();
+        }
+        const uint32_t bits = static_cast<uint32_t>(value);
+        float result;
+        memcpy(&result, &bits, sizeof(result));
+        *out = json_object_new_double(result);
+        return common::Error();
+      }
+      case 0xcb: {
+        if (!Read(8, &value)) {
+          return Truncated();
+        }
+        double result;
+        memcpy(&result, &value, sizeof(result));
+        *out = json_object_new_double(result);
+        return common::Error();
+      }
+      case 0xcc:
+      case 0xcd:
+      case 0xce:
+      case 0xcf: {
+        if (!Read(size_t(1) << (tag - 0xcc), &value)) {
+          return Truncated();
+        }
+        *out = json_object_new_int64(static_cast<int64_t>(value));
+        return common::Error();
+      }
+      case 0xd0:
+        return Read(1, &value) ? NewInt(static_cast<int8_t>(value), out) : Truncated();
+      case 0xd1:
+        return Read(2, &value) ? NewInt(static_cast<int16_t>(value), out) : Truncated();
+      case 0xd2:
+        return Read(4, &value) ? NewInt(static_cast<int32_t>(value), out) : Truncated();
+      case 0xd3:
+        return Read(8, &value) ? NewInt(static_cast<int64_t>(value), out) : Truncated();
+      case 0xdc:
+        return ReadLength(2, &value) ? DecodeArray(value, depth, out) : Truncated();
+      case 0xdd:
+        return ReadLength(4, &value) ? DecodeArray(value, depth, out) : Truncated();
+      case 0xde:
+        return ReadLength(2, &value) ? DecodeMap(value, depth, out) : Truncated();
+      case 0xdf:
+        return ReadLength(4, &value) ? DecodeMap(value, depth, out) : Truncated();
+    }
+
+    return common::make_error("Unsupported msgpack type");
+  }
+
+ private:
+  static common::Error Truncated() { return common::make_error("Unexpected end of data"); }
+
+  static common::Error NewInt(int64_t value, json_object** out) {
+    *out = json_object_new_int64(value);
+    return common::Error();
+  }
+
+  bool Read(size_t bytes, uint64_t* value) {
+    if (size_ - pos_ < bytes) {
+      return false;
+    }
+
+    uint64_t result = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+      result = (result << 8) | data_[pos_++];
+    }
+    *value = result;
+    return true;
+  }
+
+  // lengths can't exceed what is left in the buffer, protects against huge allocations
+  bool ReadLength(size_t bytes, uint64_t* len) { return Read(bytes, len) && *len <= size_ - pos_; }
+
+  common::Error DecodeString(uint64_t len, json_object** out) {
+    if (size_ - pos_ < len) {
+      return Truncated();
+    }
+
+    *out = json_object_new_string_len(reinterpret_cast<const char*>(data_ + pos_), static_cast<int>(len));
+    pos_ += len;
+    return common::Error();
+  }
+
+  common::Error DecodeArray(uint64_t len, size_t depth, json_object** out) {
+    json_object* jarray = json_object_new_array();
+    for (uint64_t i = 0; i < len; ++i) {
+      json_object* jitem = nullptr;
+      common::Error err = Decode(depth + 1, &jitem);
+      if (err) {
+        json_object_put(jarray);
+        return err;
+      }
+      json_object_array_add(jarray, jitem);
+    }
+    *out = jarray;
+    return common::Error();
+  }
+
+  common::Error DecodeMap(uint64_t len, size_t depth, json_object** out) {
+    json_object* jobject = json_object_new_object();
+    for (uint64_t i = 0; i < len; ++i) {
+      json_object* jkey = nullptr;
+      common::Error err = Decode(depth + 1, &jkey);
+      if (!err && !json_object_is_type(jkey, json_type_string)) {
+        err = common::make_error("Map key is not a string");
+      }
+      json_object* jvalue = nullptr;
+      if (!err) {
+        err = Decode(depth + 1, &jvalue);
+      }
+      if (err) {
+        json_object_put(jkey);
+        json_object_put(jobject);
+        return err;
+      }
+
+      json_object_object_add(jobject, json_object_get_string(jkey), jvalue);
+      json_object_put(jkey);
+    }
+    *out = jobject;
+    return common::Error();
+  }
+
+  const uint8_t* const data_;
+  const size_t size_;
+  size_t pos_;
+};
+
+}  // namespace
+
+const char* ConvertWireFormatToString(WireFormat format) {
+  if (format == MSGPACK_WIRE_FORMAT) {
+    return "msgpack";
+  }
+  return "json";
+}
+
+WireFormat DetectWireFormat(const char* data, size_t size) {
+  if (!data || size == 0) {
+    return JSON_WIRE_FORMAT;
+  }
+
+  // a JSON-RPC message is an object, encoded it starts with a map tag
+  const uint8_t first = static_cast<uint8_t>(data[0]);
+  if ((first & 0xf0) == 0x80 || first == 0xde || first == 0xdf) {
+    return MSGPACK_WIRE_FORMAT;
+  }
+  return JSON_WIRE_FORMAT;
+}
+
+common::Error EncodeMsgPack(json_object* obj, std::string* out) {
+  if (!out) {
+    return common::make_error_inval();
+  }
+
+  std::string result;
+  common::Error err = encode(obj, 0, &result);
+  if (err) {
+    return err;
+  }
+
+  *out = result;
+  return common::Error();
+}
+
+common::Error DecodeMsgPack(const char* data, size_t size, json_object** out) {
+  if (!data || !out) {
+    return common::make_error_inval();
+  }
+
+  Decoder decoder(data, size);
+  json_object* result = nullptr;
+  common::Error err = decoder.Decode(0, &result);
+  if (err) {
+    return err;
+  }
+
+  if (!decoder.IsEnd()) {
+    json_object_put(result);
+    return common::make_error("Trailing data after msgpack document");
+  }
+
+  *out = result;
+  return common::Error();
+}
+
+}  // namespace inner
+}  // namespace client
+}  // namespace fastotv
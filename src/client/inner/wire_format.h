@@ -0,0 +1,46 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include <string>
+
+#include <common/error.h>
+
+struct json_object;
+
+namespace fastotv {
+namespace client {
+namespace inner {
+
+// Inbound messages are either JSON-RPC text or the same document encoded as MessagePack.
+// Messages are decoded by the format negotiated with the server, only while the switch
+// is in flight the format is detected per message.
+enum WireFormat { JSON_WIRE_FORMAT = 0, MSGPACK_WIRE_FORMAT };
+
+const char* ConvertWireFormatToString(WireFormat format);
+WireFormat DetectWireFormat(const char* data, size_t size);  // by the first byte
+
+common::Error EncodeMsgPack(json_object* obj, std::string* out) WARN_UNUSED_RESULT;
+common::Error DecodeMsgPack(const char* data, size_t size, json_object** out) WARN_UNUSED_RESULT;
+
+}  // namespace inner
+}  // namespace client
+}  // namespace fastotv
@@ -46,8 +46,13 @@ namespace {
 class PrivateHandler : public inner::InnerTcpHandler {
  public:
   typedef inner::InnerTcpHandler base_class;
-  explicit PrivateHandler(const common::net::HostAndPort& server_host, const commands_info::AuthInfo& auth_info)
-      : base_class(server_host, auth_info)
+  PrivateHandler(const std::vector<common::net::HostAndPort>& servers,
+                 const std::string& servers_history_path,
+                 const commands_info::AuthInfo& auth_info,
+                 const inner::ConnectionOptions& options,
+                 RuntimeInfoCoalescer* runtime_updates,
+                 events::EventQueue* events)
+      : base_class(servers, servers_history_path, auth_info, options, runtime_updates, events)
 #ifdef HAVE_LIRC
         ,
         client_(nullptr)
@@ -123,10 +128,19 @@ class PrivateHandler : public inner::InnerTcpHandler {
 };
 }  // namespace
 
-IoService::IoService(const commands_info::AuthInfo& ainf, const common::net::HostAndPort& server_host)
+IoService::IoService(const commands_info::AuthInfo& ainf,
+                     const std::vector<common::net::HostAndPort>& servers,
+                     const std::string& servers_history_path,
+                     const inner::ConnectionOptions& options,
+                     RuntimeInfoCoalescer* runtime_updates,
+                     events::EventQueue* events)
     : ILoopController(),
       ainf_(ainf),
-      server_host_(server_host),
+      servers_(servers),
+      servers_history_path_(servers_history_path),
+      options_(options),
+      runtime_updates_(runtime_updates),
+      events_(events),
       loop_thread_(THREAD_MANAGER()->CreateThread(&IoService::Exec, this)) {}
 
 bool IoService::IsRunning() const {
@@ -192,8 +206,24 @@ void IoService::RequesRuntimeChannelInfo(stream_id_t sid) const {
   }
 }
 
+void IoService::RequestRuntimeChannelsInfo(const std::vector<stream_id_t>& sids) const {
+  PrivateHandler* handler = static_cast<PrivateHandler*>(handler_);
+  if (handler) {
+    auto cb = [handler, sids]() { handler->RequestRuntimeChannelsInfo(sids); };
+    ExecInLoopThread(cb);
+  }
+}
+
+void IoService::SubscribeRuntimeChannelsInfo(const std::vector<stream_id_t>& sids) const {
+  PrivateHandler* handler = static_cast<PrivateHandler*>(handler_);
+  if (handler) {
+    auto cb = [handler, sids]() { handler->SubscribeRuntimeChannelsInfo(sids); };
+    ExecInLoopThread(cb);
+  }
+}
+
 common::libev::IoLoopObserver* IoService::CreateHandler() {
-  return new PrivateHandler(server_host_, ainf_);
+  return new PrivateHandler(servers_, servers_history_path_, ainf_, options_, runtime_updates_, events_);
 }
 
 common::libev::IoLoop* IoService::CreateServer(common::libev::IoLoopObserver* handler) {
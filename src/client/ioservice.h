@@ -19,6 +19,8 @@
 #pragma once
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include <common/libev/io_loop.h>           // for IoLoop
 #include <common/libev/io_loop_observer.h>  // for IoLoopObserver
@@ -28,6 +30,8 @@
 #include <fastotv/commands_info/auth_info.h>
 #include <fastotv/types.h>
 
+#include "client/inner/connection_options.h"
+
 namespace common {
 namespace threads {
 template <typename RT>
@@ -37,10 +41,19 @@ class Thread;
 
 namespace fastotv {
 namespace client {
+class RuntimeInfoCoalescer;
+namespace events {
+class EventQueue;
+}
 
 class IoService : public common::libev::ILoopController {
  public:
-  IoService(const commands_info::AuthInfo& ainf, const common::net::HostAndPort& server_host);
+  IoService(const commands_info::AuthInfo& ainf,
+            const std::vector<common::net::HostAndPort>& servers,
+            const std::string& servers_history_path,
+            const inner::ConnectionOptions& options,
+            RuntimeInfoCoalescer* runtime_updates,
+            events::EventQueue* events);
   ~IoService() override;
 
   bool IsRunning() const;
@@ -53,6 +66,8 @@ class IoService : public common::libev::ILoopController {
   void RequestServerInfo() const;
   void RequestChannels() const;
   void RequesRuntimeChannelInfo(stream_id_t sid) const;
+  void RequestRuntimeChannelsInfo(const std::vector<stream_id_t>& sids) const;
+  void SubscribeRuntimeChannelsInfo(const std::vector<stream_id_t>& sids) const;
 
  private:
   using ILoopController::Exec;
@@ -64,7 +79,11 @@ class IoService : public common::libev::ILoopController {
   void HandleStopped() override;
 
   const commands_info::AuthInfo ainf_;
-  const common::net::HostAndPort server_host_;
+  const std::vector<common::net::HostAndPort> servers_;
+  const std::string servers_history_path_;
+  const inner::ConnectionOptions options_;
+  RuntimeInfoCoalescer* const runtime_updates_;
+  events::EventQueue* const events_;
   std::shared_ptr<common::threads::Thread<int>> loop_thread_;
 };
 
@@ -0,0 +1,370 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "client/live_stream/icon_atlas.h"
+
+#include <algorithm>
+
+#include <common/logger.h>
+
+#include "client/live_stream/icon_loader.h"
+
+// pinned, never evicted
+#define PLACEHOLDER_ICON_ID ""
+
+namespace fastotv {
+namespace client {
+
+IconAtlas::IconAtlas()
+    : cell_size_(0),
+      pages_(),
+      free_slots_(),
+      next_slot_(0),
+      placeholder_path_(),
+      sources_(),
+      slots_(),
+      lru_(),
+      requested_(),
+      request_icon_cb_(),
+      batch_(),
+      revision_(0) {}
+
+IconAtlas::~IconAtlas() {
+  ResetPages();
+}
+
+int IconAtlas::GetCellSize() const {
+  return cell_size_;
+}
+
+void IconAtlas::SetCellSize(int cell_size) {
+  if (cell_size > page_size) {
+    cell_size = page_size;
+  }
+  if (cell_size == cell_size_) {
+    return;
+  }
+
+  cell_size_ = cell_size;
+  ResetPages();
+  if (!placeholder_path_.empty()) {
+    SetPlaceholder(placeholder_path_);
+  }
+}
+
+void IconAtlas::SetRequestIconCallback(request_icon_callback_t cb) {
+  request_icon_cb_ = cb;
+}
+
+bool IconAtlas::SetPlaceholder(const std::string& path) {
+  placeholder_path_ = path;
+  if (cell_size_ <= 0) {  // will be loaded after SetCellSize
+    return true;
+  }
+
+  events::icon_surface_t icon = IconLoader::Decode(path, cell_size_);
+  if (!icon) {
+    WARNING_LOG() << "Can't load placeholder icon: " << path;
+    return false;
+  }
+
+  return CopyIcon(PLACEHOLDER_ICON_ID, icon.get(), true);
+}
+
+void IconAtlas::SetIconPath(const stream_id_t& sid, const std::string& path) {
+  sources_[sid] = path;
+}
+
+bool IconAtlas::AddIcon(const stream_id_t& sid, SDL_Surface* icon) {
+  if (!icon) {  // not retried, stays requested
+    return false;
+  }
+
+  requested_.erase(sid);
+  if (icon->w != cell_size_ || icon->h != cell_size_) {  // decoded for previous cell size
+    return false;
+  }
+
+  return CopyIcon(sid, icon, false);
+}
+
+void IconAtlas::RemoveIcon(const stream_id_t& sid) {
+  sources_.erase(sid);
+  requested_.erase(sid);
+  auto it = slots_.find(sid);
+  if (it == slots_.end()) {
+    return;
+  }
+
+  if (it->second.lru_pos != lru_.end()) {
+    lru_.erase(it->second.lru_pos);
+  }
+  free_slots_.push_back(it->second.index);
+  slots_.erase(it);
+  revision_++;
+}
+
+bool IconAtlas::HasIcon(const stream_id_t& sid) const {
+  return slots_.find(sid) != slots_.end();
+}
+
+void IconAtlas::Clear() {
+  sources_.clear();
+  ResetPages();
+}
+
+uint64_t IconAtlas::GetRevision() const {
+  return revision_;
+}
+
+bool IconAtlas::GetIcon(SDL_Renderer* render, const stream_id_t& sid, SDL_Texture** texture, SDL_Rect* src) {
+  if (!render || !texture || !src) {
+    return false;
+  }
+
+  size_t slot;
+  if (!FindSlot(sid, &slot)) {
+    return false;
+  }
+
+  SDL_Texture* page_texture = GetPageTexture(render, slot / GetCellsPerPage());
+  if (!page_texture) {
+    return false;
+  }
+
+  *texture = page_texture;
+  *src = GetSlotRect(slot);
+  return true;
+}
+
+bool IconAtlas::QueueIcon(const stream_id_t& sid, const SDL_Rect& dst) {
+  size_t slot;
+  if (!FindSlot(sid, &slot)) {
+    return false;
+  }
+
+  batch_.push_back({slot, dst});
+  return true;
+}
+
+void IconAtlas::Flush(SDL_Renderer* render) {
+  if (batch_.empty()) {
+    return;
+  }
+
+  if (render) {
+    // consecutive copies from the same texture are merged into one draw call by the SDL render batching
+    const size_t cells_per_page = GetCellsPerPage();
+    std::stable_sort(batch_.begin(), batch_.end(), [cells_per_page](const Quad& lhs, const Quad& rhs) {
+      return lhs.slot / cells_per_page < rhs.slot / cells_per_page;
+    });
+
+    size_t current_page = pages_.size();
+    SDL_Texture* texture = nullptr;
+    for (const Quad& quad : batch_) {
+      const size_t page = quad.slot / cells_per_page;
+      if (page != current_page) {
+        current_page = page;
+        texture = GetPageTexture(render, page);
+      }
+      if (!texture) {
+        continue;
+      }
+
+      const SDL_Rect src = GetSlotRect(quad.slot);
+      SDL_RenderCopy(render, texture, &src, &quad.dst);
+    }
+  }
+
+  batch_.clear();
+}
+
+int IconAtlas::GetCellsPerLine() const {
+  return page_size / cell_size_;
+}
+
+int IconAtlas::GetCellsPerPage() const {
+  const int per_line = GetCellsPerLine();
+  return per_line * per_line;
+}
+
+SDL_Rect IconAtlas::GetSlotRect(size_t slot) const {
+  const size_t cell = slot % GetCellsPerPage();
+  const int per_line = GetCellsPerLine();
+  const int x = static_cast<int>(cell % per_line) * cell_size_;
+  const int y = static_cast<int>(cell / per_line) * cell_size_;
+  return {x, y, cell_size_, cell_size_};
+}
+
+bool IconAtlas::FindSlot(const stream_id_t& sid, size_t* slot) {
+  if (cell_size_ <= 0) {
+    return false;
+  }
+
+  auto it = slots_.find(sid);
+  if (it != slots_.end()) {
+    if (it->second.lru_pos != lru_.end()) {
+      lru_.splice(lru_.begin(), lru_, it->second.lru_pos);
+    }
+    *slot = it->second.index;
+    return true;
+  }
+
+  RequestIcon(sid);
+  auto placeholder = slots_.find(PLACEHOLDER_ICON_ID);
+  if (placeholder == slots_.end()) {
+    return false;
+  }
+
+  *slot = placeholder->second.index;
+  return true;
+}
+
+bool IconAtlas::CopyIcon(const stream_id_t& sid, SDL_Surface* icon, bool pinned) {
+  size_t slot;
+  auto it = slots_.find(sid);
+  if (it != slots_.end()) {
+    slot = it->second.index;
+  } else if (!AllocateSlot(&slot)) {
+    return false;
+  }
+
+  Page* page = &pages_[slot / GetCellsPerPage()];
+  SDL_Rect dst = GetSlotRect(slot);
+  SDL_SetSurfaceBlendMode(icon, SDL_BLENDMODE_NONE);
+  if (SDL_BlitSurface(icon, nullptr, page->surface, &dst) != 0) {
+    WARNING_LOG() << "Can't pack channel icon, error: " << SDL_GetError();
+    if (it != slots_.end()) {
+      RemoveIcon(sid);
+    } else {
+      free_slots_.push_back(slot);
+    }
+    return false;
+  }
+
+  page->dirty = true;
+  revision_++;
+  if (it == slots_.end()) {
+    if (pinned) {
+      slots_[sid] = {slot, lru_.end()};
+    } else {
+      lru_.push_front(sid);
+      slots_[sid] = {slot, lru_.begin()};
+    }
+  }
+  return true;
+}
+
+bool IconAtlas::AllocateSlot(size_t* slot) {
+  if (!free_slots_.empty()) {
+    *slot = free_slots_.back();
+    free_slots_.pop_back();
+    return true;
+  }
+
+  const size_t cells_per_page = GetCellsPerPage();
+  const size_t page = next_slot_ / cells_per_page;
+  if (page == max_pages) {  // evict least recently used
+    if (lru_.empty()) {
+      return false;
+    }
+
+    const stream_id_t sid = lru_.back();
+    auto it = slots_.find(sid);
+    *slot = it->second.index;
+    lru_.pop_back();
+    slots_.erase(it);
+    return true;
+  }
+
+  if (page == pages_.size()) {
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, page_size, page_size, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (!surface) {
+      WARNING_LOG() << "Can't allocate icons page: " << SDL_GetError();
+      return false;
+    }
+    SDL_FillRect(surface, nullptr, SDL_MapRGBA(surface->format, 0, 0, 0, SDL_ALPHA_TRANSPARENT));
+    pages_.push_back({surface, nullptr, nullptr, true});
+  }
+
+  *slot = next_slot_++;
+  return true;
+}
+
+void IconAtlas::RequestIcon(const stream_id_t& sid) {
+  if (!request_icon_cb_ || requested_.find(sid) != requested_.end()) {
+    return;
+  }
+
+  auto it = sources_.find(sid);
+  if (it == sources_.end()) {
+    return;
+  }
+
+  requested_.insert(sid);
+  request_icon_cb_(sid, it->second, cell_size_);
+}
+
+SDL_Texture* IconAtlas::GetPageTexture(SDL_Renderer* render, size_t page_index) {
+  if (page_index >= pages_.size()) {
+    return nullptr;
+  }
+
+  Page* page = &pages_[page_index];
+  if (page->texture && page->texture_render != render) {
+    page->texture = nullptr;  // owned by previous renderer
+  }
+
+  if (!page->texture) {
+    page->texture =
+        SDL_CreateTexture(render, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, page_size, page_size);
+    if (!page->texture) {
+      WARNING_LOG() << "Can't create icons texture: " << SDL_GetError();
+      return nullptr;
+    }
+    SDL_SetTextureBlendMode(page->texture, SDL_BLENDMODE_BLEND);
+    page->texture_render = render;
+    page->dirty = true;
+  }
+
+  if (page->dirty) {
+    SDL_UpdateTexture(page->texture, nullptr, page->surface->pixels, page->surface->pitch);
+    page->dirty = false;
+  }
+  return page->texture;
+}
+
+void IconAtlas::ResetPages() {
+  for (Page& page : pages_) {
+    if (page.texture) {
+      SDL_DestroyTexture(page.texture);
+    }
+    SDL_FreeSurface(page.surface);
+  }
+  pages_.clear();
+  free_slots_.clear();
+  next_slot_ = 0;
+  slots_.clear();
+  lru_.clear();
+  requested_.clear();
+  batch_.clear();
+  revision_++;
+}
+
+}  // namespace client
+}  // namespace fastotv
@@ -0,0 +1,116 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <functional>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <player/gui/widgets/font_window.h>
+
+#include <fastotv/types.h>
+
+namespace fastotv {
+namespace client {
+
+// Channel icons downscaled to the playlist row height and packed into a few shared pages,
+// rows queue their icons and all of them are drawn in one pass per page.
+// Works as LRU cache: icons are requested when drawn for the first time, the placeholder is drawn until
+// the decoded icon is added, least recently drawn icons are dropped when pages are full.
+class IconAtlas {
+ public:
+  typedef std::function<void(const stream_id_t& sid, const std::string& path, int size)> request_icon_callback_t;
+  enum { page_size = 1024, max_pages = 2 };
+
+  IconAtlas();
+  ~IconAtlas();
+
+  int GetCellSize() const;
+  void SetCellSize(int cell_size);  // drops all icons
+
+  void SetRequestIconCallback(request_icon_callback_t cb);
+  bool SetPlaceholder(const std::string& path);
+
+  void SetIconPath(const stream_id_t& sid, const std::string& path);
+  bool AddIcon(const stream_id_t& sid, SDL_Surface* icon);  // icon should be cell size
+  void RemoveIcon(const stream_id_t& sid);
+  bool HasIcon(const stream_id_t& sid) const;
+  void Clear();
+
+  // changes when a drawn icon can look different
+  uint64_t GetRevision() const;
+
+  // placeholder returned if icon not ready
+  bool GetIcon(SDL_Renderer* render, const stream_id_t& sid, SDL_Texture** texture, SDL_Rect* src);
+
+  bool QueueIcon(const stream_id_t& sid, const SDL_Rect& dst);
+  void Flush(SDL_Renderer* render);
+
+ private:
+  struct Page {
+    SDL_Surface* surface;
+    SDL_Texture* texture;
+    SDL_Renderer* texture_render;
+    bool dirty;
+  };
+
+  struct Slot {
+    size_t index;
+    std::list<stream_id_t>::iterator lru_pos;  // lru_.end() for pinned
+  };
+
+  struct Quad {
+    size_t slot;
+    SDL_Rect dst;
+  };
+
+  int GetCellsPerLine() const;
+  int GetCellsPerPage() const;
+  SDL_Rect GetSlotRect(size_t slot) const;
+
+  bool FindSlot(const stream_id_t& sid, size_t* slot);
+  bool CopyIcon(const stream_id_t& sid, SDL_Surface* icon, bool pinned);
+  bool AllocateSlot(size_t* slot);
+  void RequestIcon(const stream_id_t& sid);
+  SDL_Texture* GetPageTexture(SDL_Renderer* render, size_t page);
+  void ResetPages();
+
+  int cell_size_;
+  std::vector<Page> pages_;
+  std::vector<size_t> free_slots_;
+  size_t next_slot_;
+
+  std::string placeholder_path_;
+  std::map<stream_id_t, std::string> sources_;
+  std::map<stream_id_t, Slot> slots_;
+  std::list<stream_id_t> lru_;  // most recently used first
+  std::set<stream_id_t> requested_;
+  request_icon_callback_t request_icon_cb_;
+
+  std::vector<Quad> batch_;
+  uint64_t revision_;
+};
+
+}  // namespace client
+}  // namespace fastotv
@@ -0,0 +1,434 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "client/live_stream/icon_fetcher.h"
+
+#include <errno.h>
+#include <stdio.h>  // for rename
+
+#include <algorithm>
+#include <fstream>
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+#include <common/convert2string.h>
+
+#include "client/http_connection.h"
+#include "client/worker_pool.h"
+
+#define META_FILE_EXTENSION ".meta"
+#define PART_FILE_EXTENSION ".part"
+
+#define META_URL_FIELD "url"
+#define META_ETAG_FIELD "etag"
+#define META_LAST_MODIFIED_FIELD "last_modified"
+
+namespace fastotv {
+namespace client {
+
+namespace {
+
+struct IconValidators {
+  std::string url;
+  std::string etag;
+  std::string last_modified;
+};
+
+bool is_file_exist(const std::string& path) {
+  std::ifstream file(path);
+  return file.good();
+}
+
+bool replace_file(const std::string& from, const std::string& to) {
+  if (rename(from.c_str(), to.c_str()) == 0) {
+    return true;
+  }
+
+  // windows doesn't rename over an existing file
+  return remove(to.c_str()) == 0 && rename(from.c_str(), to.c_str()) == 0;
+}
+
+// one "field value" per line
+bool read_validators(const std::string& path, IconValidators* validators) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  IconValidators result;
+  std::string line;
+  while (std::getline(file, line)) {
+    const size_t space = line.find(' ');
+    if (space == std::string::npos) {
+      continue;
+    }
+
+    const std::string field = line.substr(0, space);
+    const std::string value = line.substr(space + 1);
+    if (field == META_URL_FIELD) {
+      result.url = value;
+    } else if (field == META_ETAG_FIELD) {
+      result.etag = value;
+    } else if (field == META_LAST_MODIFIED_FIELD) {
+      result.last_modified = value;
+    }
+  }
+
+  *validators = result;
+  return true;
+}
+
+bool write_validators(const std::string& path, const IconValidators& validators) {
+  const std::string tmp_path = path + PART_FILE_EXTENSION;
+  {
+    std::ofstream file(tmp_path, std::ios::out | std::ios::trunc);
+    if (!file.is_open()) {
+      return false;
+    }
+    file << META_URL_FIELD " " << validators.url << "\n";
+    if (!validators.etag.empty()) {
+      file << META_ETAG_FIELD " " << validators.etag << "\n";
+    }
+    if (!validators.last_modified.empty()) {
+      file << META_LAST_MODIFIED_FIELD " " << validators.last_modified << "\n";
+    }
+    if (!file.good()) {
+      return false;
+    }
+  }
+  return replace_file(tmp_path, path);
+}
+
+bool is_redirect(int status) {
+  return status == 301 || status == 302 || status == 303 || status == 307 || status == 308;
+}
+
+std::string connection_key(const common::uri::GURL& url) {
+  return url.scheme() + "://" + url.host() + ":" + common::ConvertToString(url.EffectiveIntPort());
+}
+
+}  // namespace
+
+IconFetcher::Stats::Stats()
+    : requests(0), redirects(0), connections_opened(0), downloaded(0), not_modified(0), failed(0), max_active(0) {}
+
+IconFetcher::IconFetcher(WorkerPool* workers, size_t max_parallel, fetched_callback_t fetched_cb)
+    : workers_(workers),
+      max_parallel_(max_parallel ? max_parallel : 1),
+      fetched_cb_(fetched_cb),
+      tls_ctx_(nullptr),
+      mutex_(),
+      tasks_(),
+      queued_(),
+      active_(0),
+      fetching_(0),
+      stop_(true),
+      idle_connections_(),
+      stats_() {
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+  SSL_library_init();
+  SSL_load_error_strings();
+  tls_ctx_ = SSL_CTX_new(SSLv23_client_method());
+#else
+  tls_ctx_ = SSL_CTX_new(TLS_client_method());
+#endif
+  if (tls_ctx_) {
+    SSL_CTX_set_options(tls_ctx_, SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3);
+    SSL_CTX_set_verify(tls_ctx_, SSL_VERIFY_PEER, nullptr);
+    SSL_CTX_set_default_verify_paths(tls_ctx_);
+  }
+}
+
+IconFetcher::~IconFetcher() {
+  Stop();
+  if (tls_ctx_) {
+    SSL_CTX_free(tls_ctx_);
+    tls_ctx_ = nullptr;
+  }
+}
+
+bool IconFetcher::IsSupported(const common::uri::GURL& url) {
+  return url.is_valid() && (url.SchemeIs("http") || url.SchemeIs("https"));
+}
+
+void IconFetcher::Start() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  stop_ = false;
+}
+
+void IconFetcher::Stop() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stop_ = true;
+    tasks_.clear();
+    queued_.clear();
+  }
+  CloseIdleConnections();
+}
+
+void IconFetcher::Fetch(const stream_id_t& sid, const common::uri::GURL& url, const std::string& path) {
+  if (!IsSupported(url)) {
+    return;
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (stop_ || !queued_.insert(sid).second) {
+      return;
+    }
+    tasks_.push_back({sid, url, path});
+    if (active_ >= max_parallel_) {  // a running job picks it up
+      return;
+    }
+    active_++;
+  }
+
+  if (!workers_->Post([this]() { FetchQueued(); })) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    active_--;
+  }
+}
+
+IconFetcher::Stats IconFetcher::GetStats() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void IconFetcher::FetchQueued() {
+  while (true) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (stop_ || tasks_.empty()) {
+        active_--;
+        return;
+      }
+
+      task = tasks_.front();
+      tasks_.pop_front();
+      queued_.erase(task.sid);
+      fetching_++;
+      stats_.max_active = std::max(stats_.max_active, fetching_);
+    }
+
+    const FetchResult result = FetchOne(task);
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      fetching_--;
+      if (result == FETCH_DOWNLOADED) {
+        stats_.downloaded++;
+      } else if (result == FETCH_NOT_MODIFIED) {
+        stats_.not_modified++;
+      } else {
+        stats_.failed++;
+      }
+    }
+
+    if (result == FETCH_DOWNLOADED && fetched_cb_) {
+      fetched_cb_(task.sid, task.path);
+    }
+  }
+}
+
+IconFetcher::FetchResult IconFetcher::FetchOne(const Task& task) {
+  const std::string meta_path = task.path + META_FILE_EXTENSION;
+  const std::string part_path = task.path + PART_FILE_EXTENSION;
+  const std::string url = task.url.spec();
+
+  HttpConnection::headers_t headers;
+  IconValidators cached;
+  if (is_file_exist(task.path) && read_validators(meta_path, &cached) && cached.url == url) {
+    if (!cached.etag.empty()) {
+      headers["If-None-Match"] = cached.etag;
+    }
+    if (!cached.last_modified.empty()) {
+      headers["If-Modified-Since"] = cached.last_modified;
+    }
+  }
+
+  HttpResponse response;
+  std::ofstream part_file;
+  size_t received = 0;
+  auto body_cb = [&response, &part_file, &part_path, &received](const char* data, size_t size) {
+    received += size;
+    if (received > max_icon_size) {
+      return false;
+    }
+    if (response.status != 200) {  // body of a redirect or an error page
+      return true;
+    }
+    if (!part_file.is_open()) {
+      part_file.open(part_path, std::ios::out | std::ios::binary | std::ios::trunc);
+    }
+    part_file.write(data, size);
+    return part_file.good();
+  };
+
+  common::uri::GURL request_url = task.url;
+  common::ErrnoError err;
+  for (size_t redirects = 0;; ++redirects) {
+    received = 0;
+    err = Get(request_url, headers, body_cb, &response);
+    if (err || !is_redirect(response.status)) {
+      break;
+    }
+
+    const common::uri::GURL location = request_url.Resolve(response.GetHeader("location"));
+    if (redirects == max_redirects || !IsSupported(location)) {
+      err = common::make_errno_error("Too many or invalid redirects", EPROTO);
+      break;
+    }
+    request_url = location;  // the connection for it comes from the pool of its own host
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      stats_.redirects++;
+    }
+  }
+
+  if (part_file.is_open()) {
+    part_file.close();
+  }
+
+  if (err) {
+    remove(part_path.c_str());
+    return FETCH_FAILED;
+  }
+
+  if (response.status == 304) {
+    return FETCH_NOT_MODIFIED;
+  }
+
+  if (response.status != 200 || received == 0) {
+    remove(part_path.c_str());
+    return FETCH_FAILED;
+  }
+
+  if (!replace_file(part_path, task.path)) {
+    remove(part_path.c_str());
+    return FETCH_FAILED;
+  }
+
+  IconValidators validators;
+  validators.url = url;
+  validators.etag = response.GetHeader("etag");
+  validators.last_modified = response.GetHeader("last-modified");
+  if (!write_validators(meta_path, validators)) {
+    remove(meta_path.c_str());  // next time downloaded unconditionally
+  }
+  return FETCH_DOWNLOADED;
+}
+
+common::ErrnoError IconFetcher::Get(const common::uri::GURL& url,
+                                    const HttpConnection::headers_t& headers,
+                                    HttpConnection::body_callback_t body,
+                                    HttpResponse* response) {
+  auto quit_cb = [this]() { return IsStopped(); };
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    bool reused = false;
+    HttpConnection* connection = AcquireConnection(url, &reused);
+    if (!connection) {
+      return common::make_errno_error(ECONNREFUSED);
+    }
+
+    *response = HttpResponse();
+    common::ErrnoError err = connection->Get(url.PathForRequest(), headers, quit_cb, body, response);
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      stats_.requests++;
+    }
+    // the server may have closed an idle connection while it waited in the pool, retried on a fresh one
+    if (err && reused && response->status == 0 && !IsStopped()) {
+      delete connection;
+      continue;
+    }
+
+    ReleaseConnection(url, connection);
+    return err;
+  }
+
+  return common::make_errno_error(ECONNRESET);
+}
+
+HttpConnection* IconFetcher::AcquireConnection(const common::uri::GURL& url, bool* reused) {
+  const std::string key = connection_key(url);
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = idle_connections_.find(key);
+    if (it != idle_connections_.end() && !it->second.empty()) {
+      HttpConnection* connection = it->second.back();
+      it->second.pop_back();
+      *reused = true;
+      return connection;
+    }
+  }
+
+  const bool tls = url.SchemeIs("https");
+  if (tls && !tls_ctx_) {
+    return nullptr;
+  }
+
+  HttpConnection* connection =
+      new HttpConnection(tls ? tls_ctx_ : nullptr, url.host(), static_cast<uint16_t>(url.EffectiveIntPort()));
+  common::ErrnoError err = connection->Connect([this]() { return IsStopped(); });
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stats_.connections_opened++;
+  }
+  if (err) {
+    delete connection;
+    return nullptr;
+  }
+
+  *reused = false;
+  return connection;
+}
+
+void IconFetcher::ReleaseConnection(const common::uri::GURL& url, HttpConnection* connection) {
+  if (connection->IsOpen()) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::vector<HttpConnection*>& idle = idle_connections_[connection_key(url)];
+    if (!stop_ && idle.size() < max_idle_connections_per_host) {
+      idle.push_back(connection);
+      return;
+    }
+  }
+  delete connection;
+}
+
+void IconFetcher::CloseIdleConnections() {
+  std::map<std::string, std::vector<HttpConnection*>> idle;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle.swap(idle_connections_);
+  }
+
+  for (auto it = idle.begin(); it != idle.end(); ++it) {
+    for (HttpConnection* connection : it->second) {
+      delete connection;
+    }
+  }
+}
+
+bool IconFetcher::IsStopped() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return stop_;
+}
+
+}  // namespace client
+}  // namespace fastotv
@@ -0,0 +1,114 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <common/uri/gurl.h>
+
+#include "client/http_connection.h"
+
+#include <fastotv/types.h>
+
+typedef struct ssl_ctx_st SSL_CTX;
+
+namespace fastotv {
+namespace client {
+class WorkerPool;
+
+// Downloads channel icons over http(s) on the worker pool, at most max_parallel at once.
+// Connections are kept alive and reused per host. Validators of every downloaded icon are stored next to it
+// (<icon>.meta), so a cached icon is revalidated with a conditional GET and only fetched again when it changed
+// or its url did. Redirects are followed up to max_redirects, each hop on a connection of its own host.
+// fetched_callback_t is called from a worker when a new icon file is in place.
+class IconFetcher {
+ public:
+  typedef std::function<void(const stream_id_t& sid, const std::string& path)> fetched_callback_t;
+
+  enum { max_icon_size = 1024 * 1024, max_idle_connections_per_host = 4, max_redirects = 5 };
+
+  struct Stats {
+    Stats();
+
+    size_t requests;
+    size_t redirects;  // followed, every one is a request too
+    size_t connections_opened;
+    size_t downloaded;
+    size_t not_modified;
+    size_t failed;
+    size_t max_active;  // icons fetched at the same time
+  };
+
+  IconFetcher(WorkerPool* workers, size_t max_parallel, fetched_callback_t fetched_cb);
+  ~IconFetcher();
+
+  static bool IsSupported(const common::uri::GURL& url);
+
+  void Start();
+  void Stop();  // closes idle connections, jobs still in the pool give up
+
+  void Fetch(const stream_id_t& sid, const common::uri::GURL& url, const std::string& path);
+  Stats GetStats() const;
+
+ private:
+  struct Task {
+    stream_id_t sid;
+    common::uri::GURL url;
+    std::string path;
+  };
+
+  enum FetchResult { FETCH_DOWNLOADED, FETCH_NOT_MODIFIED, FETCH_FAILED };
+
+  void FetchQueued();
+  FetchResult FetchOne(const Task& task);
+  // one request on a pooled connection to the host of url
+  common::ErrnoError Get(const common::uri::GURL& url,
+                         const HttpConnection::headers_t& headers,
+                         HttpConnection::body_callback_t body,
+                         HttpResponse* response);
+  HttpConnection* AcquireConnection(const common::uri::GURL& url, bool* reused);
+  void ReleaseConnection(const common::uri::GURL& url, HttpConnection* connection);
+  void CloseIdleConnections();
+  bool IsStopped() const;
+
+  WorkerPool* const workers_;
+  const size_t max_parallel_;
+  const fetched_callback_t fetched_cb_;
+  SSL_CTX* tls_ctx_;
+
+  mutable std::mutex mutex_;
+  std::deque<Task> tasks_;
+  std::set<stream_id_t> queued_;
+  size_t active_;  // FetchQueued jobs posted to the pool
+  size_t fetching_;
+  bool stop_;
+  std::map<std::string, std::vector<HttpConnection*>> idle_connections_;  // by scheme://host:port
+  Stats stats_;
+};
+
+}  // namespace client
+}  // namespace fastotv
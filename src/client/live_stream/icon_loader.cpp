@@ -0,0 +1,113 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "client/live_stream/icon_loader.h"
+
+#include <common/application/application.h>  // for fApp
+
+#include <player/sdl_utils.h>  // for IMG_LoadPNG
+
+#include "client/worker_pool.h"
+
+namespace fastotv {
+namespace client {
+
+IconLoader::IconLoader(WorkerPool* workers)
+    : workers_(workers), tasks_mutex_(), tasks_(), queued_(), active_(0), stop_(true) {}
+
+IconLoader::~IconLoader() {
+  Stop();
+}
+
+void IconLoader::Start() {
+  std::unique_lock<std::mutex> lock(tasks_mutex_);
+  stop_ = false;
+}
+
+void IconLoader::Stop() {  // jobs still in the pool find nothing to do
+  std::unique_lock<std::mutex> lock(tasks_mutex_);
+  stop_ = true;
+  tasks_.clear();
+  queued_.clear();
+}
+
+void IconLoader::Load(const stream_id_t& sid, const std::string& path, int size) {
+  {
+    std::unique_lock<std::mutex> lock(tasks_mutex_);
+    if (stop_ || !queued_.insert(sid).second) {
+      return;
+    }
+    tasks_.push_back({sid, path, size});
+    if (active_ >= max_parallel_decodes) {  // a running job picks it up
+      return;
+    }
+    active_++;
+  }
+
+  if (!workers_->Post([this]() { DecodeQueued(); })) {
+    std::unique_lock<std::mutex> lock(tasks_mutex_);
+    active_--;
+  }
+}
+
+events::icon_surface_t IconLoader::Decode(const std::string& path, int size) {
+  SDL_Surface* img = IMG_LoadPNG(path.c_str());
+  if (!img) {
+    return events::icon_surface_t();
+  }
+
+  SDL_Surface* icon = SDL_CreateRGBSurfaceWithFormat(0, size, size, 32, SDL_PIXELFORMAT_ARGB8888);
+  if (!icon) {
+    SDL_FreeSurface(img);
+    return events::icon_surface_t();
+  }
+
+  SDL_FillRect(icon, nullptr, SDL_MapRGBA(icon->format, 0, 0, 0, SDL_ALPHA_TRANSPARENT));
+  SDL_SetSurfaceBlendMode(img, SDL_BLENDMODE_NONE);
+  int res = SDL_BlitScaled(img, nullptr, icon, nullptr);
+  SDL_FreeSurface(img);
+  if (res != 0) {
+    SDL_FreeSurface(icon);
+    return events::icon_surface_t();
+  }
+
+  return events::icon_surface_t(icon, SDL_FreeSurface);
+}
+
+void IconLoader::DecodeQueued() {
+  while (true) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(tasks_mutex_);
+      if (stop_ || tasks_.empty()) {
+        active_--;
+        return;
+      }
+
+      task = tasks_.back();
+      tasks_.pop_back();
+      queued_.erase(task.sid);
+    }
+
+    events::IconInfo inf(task.sid, Decode(task.path, task.size));
+    fApp->PostEvent(new events::IconDecodedEvent(this, inf));
+  }
+}
+
+}  // namespace client
+}  // namespace fastotv
@@ -0,0 +1,69 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <fastotv/types.h>
+
+#include "client/events/icon_events.h"
+
+namespace fastotv {
+namespace client {
+class WorkerPool;
+
+// Decodes and downscales channel icons on the worker pool, results are posted as IconDecodedEvent.
+class IconLoader {
+ public:
+  enum { max_parallel_decodes = 2 };  // leaves the rest of the pool to downloads
+
+  explicit IconLoader(WorkerPool* workers);
+  ~IconLoader();
+
+  void Start();
+  void Stop();
+
+  // last requested icons are decoded first, they belong to the rows which are visible now
+  void Load(const stream_id_t& sid, const std::string& path, int size);
+
+  static events::icon_surface_t Decode(const std::string& path, int size);
+
+ private:
+  struct Task {
+    stream_id_t sid;
+    std::string path;
+    int size;
+  };
+
+  void DecodeQueued();
+
+  WorkerPool* const workers_;
+
+  std::mutex tasks_mutex_;
+  std::vector<Task> tasks_;
+  std::set<stream_id_t> queued_;
+  size_t active_;  // DecodeQueued jobs posted to the pool
+  bool stop_;
+};
+
+}  // namespace client
+}  // namespace fastotv
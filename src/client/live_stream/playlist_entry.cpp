@@ -30,10 +30,10 @@
 namespace fastotv {
 namespace client {
 
-PlaylistEntry::PlaylistEntry() : info_(), icon_(), cache_dir_() {}
+PlaylistEntry::PlaylistEntry() : info_(), cache_dir_() {}
 
 PlaylistEntry::PlaylistEntry(const std::string& cache_root_dir, const commands_info::ChannelInfo& info)
-    : info_(info), rinfo_(), icon_(), cache_dir_() {
+    : info_(info), rinfo_(), cache_dir_() {
   stream_id_t id = info_.GetStreamID();
   cache_dir_ = common::file_system::make_path(cache_root_dir, id);
 }
@@ -64,15 +64,7 @@ ChannelDescription PlaylistEntry::GetChannelDescription() const {
     decr = prog.GetTitle();
   }
 
-  return {epg.GetDisplayName(), decr, GetIcon()};
-}
-
-void PlaylistEntry::SetIcon(channel_icon_t icon) {
-  icon_ = icon;
-}
-
-channel_icon_t PlaylistEntry::GetIcon() const {
-  return icon_;
+  return {epg.GetDisplayName(), decr};
 }
 
 commands_info::ChannelInfo PlaylistEntry::GetChannelInfo() const {
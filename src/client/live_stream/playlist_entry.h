@@ -18,27 +18,17 @@
 
 #pragma once
 
-#include <memory>
 #include <string>
 
 #include <fastotv/commands_info/channels_info.h>
 #include <fastotv/commands_info/runtime_channel_info.h>
 
-namespace fastoplayer {
-namespace draw {
-class SurfaceSaver;
-}
-}  // namespace fastoplayer
-
 namespace fastotv {
 namespace client {
 
-typedef std::shared_ptr<fastoplayer::draw::SurfaceSaver> channel_icon_t;
-
 struct ChannelDescription {
   std::string title;
   std::string description;
-  channel_icon_t icon;
 };
 
 class PlaylistEntry {
@@ -51,9 +41,6 @@ class PlaylistEntry {
   void SetRuntimeChannelInfo(const commands_info::RuntimeChannelInfo& rinfo);
   commands_info::RuntimeChannelInfo GetRuntimeChannelInfo() const;
 
-  void SetIcon(channel_icon_t icon);
-  channel_icon_t GetIcon() const;
-
   std::string GetCacheDir() const;
   std::string GetIconPath() const;
 
@@ -63,7 +50,6 @@ class PlaylistEntry {
   commands_info::ChannelInfo info_;
   commands_info::RuntimeChannelInfo rinfo_;
 
-  channel_icon_t icon_;
   std::string cache_dir_;
 };
 
@@ -26,13 +26,15 @@
 #include <common/sprintf.h>
 
 #include <player/draw/draw.h>
-#include <player/draw/surface_saver.h>
+
+#include "client/draw/glyph_atlas.h"
+#include "client/live_stream/icon_atlas.h"
 
 namespace fastotv {
 namespace client {
 
 PlaylistWindow::PlaylistWindow(const SDL_Color& back_ground_color, Window* parent)
-    : base_class(back_ground_color, parent), play_list_(nullptr) {}
+    : base_class(back_ground_color, parent), play_list_(nullptr), atlas_(nullptr), icons_(nullptr) {}
 
 PlaylistWindow::~PlaylistWindow() {}
 
@@ -44,6 +46,14 @@ const PlaylistWindow::playlist_t* PlaylistWindow::GetPlaylist() const {
   return play_list_;
 }
 
+void PlaylistWindow::SetTextAtlas(draw::GlyphAtlas* atlas) {
+  atlas_ = atlas;
+}
+
+void PlaylistWindow::SetIconAtlas(IconAtlas* icons) {
+  icons_ = icons;
+}
+
 size_t PlaylistWindow::GetRowCount() const {
   if (!play_list_) {
     return 0;
@@ -51,6 +61,18 @@ size_t PlaylistWindow::GetRowCount() const {
   return play_list_->size();
 }
 
+const std::vector<stream_id_t>& PlaylistWindow::GetVisibleStreams() const {
+  return visible_streams_;
+}
+
+void PlaylistWindow::Draw(SDL_Renderer* render) {
+  visible_streams_.clear();
+  base_class::Draw(render);
+  if (icons_) {  // icons queued by rows
+    icons_->Flush(render);
+  }
+}
+
 void PlaylistWindow::DrawRow(SDL_Renderer* render, size_t pos, bool active, bool hover, const SDL_Rect& row_rect) {
   UNUSED(active);
   UNUSED(hover);
@@ -61,32 +83,45 @@ void PlaylistWindow::DrawRow(SDL_Renderer* render, size_t pos, bool active, bool
 
   SDL_Rect number_rect = {row_rect.x, row_rect.y, channel_number_width, row_rect.h};
   std::string number_str = common::ConvertToString(pos + 1);
-  DrawText(render, number_str, number_rect, PlaylistWindow::CENTER_TEXT);
+  DrawRowText(render, number_str, number_rect, PlaylistWindow::CENTER_TEXT);
 
-  ChannelDescription descr = play_list_->operator[](pos).GetChannelDescription();
-  channel_icon_t icon = descr.icon;
+  const PlaylistEntry& entry = play_list_->operator[](pos);
+  visible_streams_.push_back(entry.GetChannelInfo().GetStreamID());
+  ChannelDescription descr = entry.GetChannelDescription();
   int shift = channel_number_width;
-  if (icon) {
-    SDL_Texture* img = icon->GetTexture(render);
-    if (img) {
-      SDL_Rect icon_rect = {row_rect.x + shift, row_rect.y, row_rect.h, row_rect.h};
-      SDL_RenderCopy(render, img, nullptr, &icon_rect);
-    }
+  if (icons_) {
+    SDL_Rect icon_rect = {row_rect.x + shift, row_rect.y, row_rect.h, row_rect.h};
+    icons_->QueueIcon(entry.GetChannelInfo().GetStreamID(), icon_rect);
   }
   shift += row_rect.h + space_width;  // in any case shift should be
 
   int text_width = row_rect.w - shift;
-  std::string title_line =
-      fastoplayer::draw::DotText(common::MemSPrintf("Title: %s", descr.title), GetFont(), text_width);
-  std::string description_line =
-      fastoplayer::draw::DotText(common::MemSPrintf("Description: %s", descr.description), GetFont(), text_width);
+  std::string title_line = DotRowText(common::MemSPrintf("Title: %s", descr.title), text_width);
+  std::string description_line = DotRowText(common::MemSPrintf("Description: %s", descr.description), text_width);
 
   std::string line_text = common::MemSPrintf(
       "%s\n"
       "%s",
       title_line, description_line);
   SDL_Rect text_rect = {row_rect.x + shift, row_rect.y, text_width, row_rect.h};
-  DrawText(render, line_text, text_rect, GetDrawType());
+  DrawRowText(render, line_text, text_rect, GetDrawType());
+}
+
+void PlaylistWindow::DrawRowText(SDL_Renderer* render, const std::string& text, const SDL_Rect& rect, DrawType dt) {
+  if (atlas_) {
+    atlas_->DrawText(render, text, rect, GetTextColor(), dt);
+    return;
+  }
+
+  DrawText(render, text, rect, dt);
+}
+
+std::string PlaylistWindow::DotRowText(const std::string& text, int width) {
+  if (atlas_) {
+    return atlas_->DotText(text, width);
+  }
+
+  return fastoplayer::draw::DotText(text, GetFont(), width);
 }
 
 }  // namespace client
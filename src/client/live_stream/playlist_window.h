@@ -27,6 +27,10 @@
 
 namespace fastotv {
 namespace client {
+namespace draw {
+class GlyphAtlas;
+}
+class IconAtlas;
 
 class PlaylistWindow : public fastoplayer::gui::IListBox {
  public:
@@ -39,13 +43,27 @@ class PlaylistWindow : public fastoplayer::gui::IListBox {
   void SetPlaylist(const playlist_t* pl);
   const playlist_t* GetPlaylist() const;
 
+  void SetTextAtlas(draw::GlyphAtlas* atlas);
+  void SetIconAtlas(IconAtlas* icons);
+
   size_t GetRowCount() const override;
 
+  // streams of the rows drawn last time
+  const std::vector<stream_id_t>& GetVisibleStreams() const;
+
+  void Draw(SDL_Renderer* render) override;
+
  protected:
   void DrawRow(SDL_Renderer* render, size_t pos, bool active, bool hover, const SDL_Rect& row_rect) override;
 
  private:
+  void DrawRowText(SDL_Renderer* render, const std::string& text, const SDL_Rect& rect, DrawType dt);
+  std::string DotRowText(const std::string& text, int width);
+
   const playlist_t* play_list_;  // pointer
+  draw::GlyphAtlas* atlas_;
+  IconAtlas* icons_;
+  std::vector<stream_id_t> visible_streams_;
 };
 
 }  // namespace client
@@ -0,0 +1,59 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "client/live_stream/runtime_info_coalescer.h"
+
+namespace fastotv {
+namespace client {
+
+RuntimeInfoCoalescer::RuntimeInfoCoalescer(notify_callback_t notify_cb)
+    : notify_cb_(notify_cb), pending_mutex_(), pending_() {}
+
+void RuntimeInfoCoalescer::Push(const runtime_channels_t& channels) {
+  bool need_notify = false;
+  {
+    std::unique_lock<std::mutex> lock(pending_mutex_);
+    const bool was_empty = pending_.empty();
+    for (const commands_info::RuntimeChannelInfo& chan : channels) {
+      pending_[chan.GetStreamID()] = chan;
+    }
+    need_notify = was_empty && !pending_.empty();
+  }
+
+  if (need_notify && notify_cb_) {
+    notify_cb_();
+  }
+}
+
+RuntimeInfoCoalescer::runtime_channels_t RuntimeInfoCoalescer::Take() {
+  std::map<stream_id_t, commands_info::RuntimeChannelInfo> pending;
+  {
+    std::unique_lock<std::mutex> lock(pending_mutex_);
+    pending.swap(pending_);
+  }
+
+  runtime_channels_t result;
+  result.reserve(pending.size());
+  for (const auto& it : pending) {
+    result.push_back(it.second);
+  }
+  return result;
+}
+
+}  // namespace client
+}  // namespace fastotv
@@ -0,0 +1,52 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <fastotv/commands_info/runtime_channel_info.h>
+
+namespace fastotv {
+namespace client {
+
+// Folds runtime info updates pushed by the server into the latest value per stream.
+// The notify callback runs only when the first update lands in an empty buffer,
+// so the consumer gets one wakeup per drain however fast the producer pushes.
+class RuntimeInfoCoalescer {
+ public:
+  typedef std::function<void()> notify_callback_t;
+  typedef std::vector<commands_info::RuntimeChannelInfo> runtime_channels_t;
+
+  explicit RuntimeInfoCoalescer(notify_callback_t notify_cb);
+
+  void Push(const runtime_channels_t& channels);  // any thread
+  runtime_channels_t Take();                      // drains the buffer
+
+ private:
+  const notify_callback_t notify_cb_;
+
+  std::mutex pending_mutex_;
+  std::map<stream_id_t, commands_info::RuntimeChannelInfo> pending_;
+};
+
+}  // namespace client
+}  // namespace fastotv
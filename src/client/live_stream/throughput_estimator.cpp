@@ -0,0 +1,123 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "client/live_stream/throughput_estimator.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+namespace fastotv {
+namespace client {
+
+ThroughputEstimator::Ewma::Ewma(common::time64_t half_life_msec)
+    : alpha_(exp(log(0.5) * 1000 / half_life_msec)), estimate_(0), total_weight_(0) {}
+
+void ThroughputEstimator::Ewma::Reset() {
+  estimate_ = 0;
+  total_weight_ = 0;
+}
+
+void ThroughputEstimator::Ewma::Add(common::time64_t duration_msec, double value) {
+  const double weight = duration_msec / 1000.0;
+  const double alpha = pow(alpha_, weight);
+  estimate_ = value * (1 - alpha) + estimate_ * alpha;
+  total_weight_ += weight;
+}
+
+double ThroughputEstimator::Ewma::Get() const {
+  const double zero_factor = 1 - pow(alpha_, total_weight_);
+  if (zero_factor <= 0) {
+    return 0;
+  }
+  return estimate_ / zero_factor;
+}
+
+ThroughputEstimator::ThroughputEstimator(common::time64_t window_msec)
+    : window_msec_(window_msec),
+      fast_(fast_half_life_msec),
+      slow_(slow_half_life_msec),
+      started_(false),
+      last_total_bytes_(0),
+      window_start_(0),
+      window_bytes_(0),
+      windows_count_(0) {}
+
+void ThroughputEstimator::Reset() {
+  fast_.Reset();
+  slow_.Reset();
+  started_ = false;
+  last_total_bytes_ = 0;
+  window_start_ = 0;
+  window_bytes_ = 0;
+  windows_count_ = 0;
+}
+
+void ThroughputEstimator::AddSample(common::time64_t now, uint64_t total_bytes) {
+  if (started_ && total_bytes < last_total_bytes_) {
+    Reset();
+  }
+
+  if (!started_) {  // the first sample only sets the base
+    started_ = true;
+    last_total_bytes_ = total_bytes;
+    window_start_ = now;
+    return;
+  }
+
+  window_bytes_ += total_bytes - last_total_bytes_;
+  last_total_bytes_ = total_bytes;
+  if (now - window_start_ >= window_msec_) {
+    CloseWindow(now);
+  }
+}
+
+bool ThroughputEstimator::HasEstimate() const {
+  return windows_count_ != 0;
+}
+
+uint64_t ThroughputEstimator::GetEstimate() const {
+  return std::min(GetFastEstimate(), GetSlowEstimate());
+}
+
+uint64_t ThroughputEstimator::GetFastEstimate() const {
+  return HasEstimate() ? static_cast<uint64_t>(fast_.Get()) : 0;
+}
+
+uint64_t ThroughputEstimator::GetSlowEstimate() const {
+  return HasEstimate() ? static_cast<uint64_t>(slow_.Get()) : 0;
+}
+
+size_t ThroughputEstimator::GetWindowsCount() const {
+  return windows_count_;
+}
+
+void ThroughputEstimator::CloseWindow(common::time64_t now) {
+  const common::time64_t duration_msec = now - window_start_;
+  if (window_bytes_ >= min_window_bytes) {
+    const double rate = window_bytes_ * 1000.0 / duration_msec;
+    fast_.Add(duration_msec, rate);
+    slow_.Add(duration_msec, rate);
+    windows_count_++;
+  }
+  window_start_ = now;
+  window_bytes_ = 0;
+}
+
+}  // namespace client
+}  // namespace fastotv
@@ -0,0 +1,82 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <common/types.h>  // for time64_t
+
+namespace fastotv {
+namespace client {
+
+// Passive throughput estimate from the bytes the demuxer of the playing stream has read. Bytes are summed into
+// windows of window_msec, every window's rate feeds two exponentially weighted averages weighted by its duration,
+// and the lower of the fast and the slow one is the estimate: drops show up at once, peaks have to last.
+// Windows with few bytes are skipped, they mostly measure a demuxer paused on full queues, not the link.
+class ThroughputEstimator {
+ public:
+  enum {
+    default_window_msec = 500,
+    fast_half_life_msec = 2000,
+    slow_half_life_msec = 10000,
+    min_window_bytes = 16 * 1024
+  };
+
+  explicit ThroughputEstimator(common::time64_t window_msec = default_window_msec);
+
+  void Reset();  // another stream, nothing measured so far applies
+  // total bytes read by the demuxer, a value lower than the last one starts over as well
+  void AddSample(common::time64_t now, uint64_t total_bytes);
+
+  bool HasEstimate() const;
+  uint64_t GetEstimate() const;  // bytes per second, zero without estimate
+  uint64_t GetFastEstimate() const;
+  uint64_t GetSlowEstimate() const;
+  size_t GetWindowsCount() const;  // windows which made it into the averages
+
+ private:
+  class Ewma {
+   public:
+    explicit Ewma(common::time64_t half_life_msec);
+
+    void Reset();
+    void Add(common::time64_t duration_msec, double value);
+    double Get() const;  // corrected for the zero start
+
+   private:
+    const double alpha_;  // weight of the old estimate after one second
+    double estimate_;
+    double total_weight_;
+  };
+
+  void CloseWindow(common::time64_t now);
+
+  const common::time64_t window_msec_;
+  Ewma fast_;
+  Ewma slow_;
+  bool started_;
+  uint64_t last_total_bytes_;
+  common::time64_t window_start_;
+  uint64_t window_bytes_;
+  size_t windows_count_;
+};
+
+}  // namespace client
+}  // namespace fastotv
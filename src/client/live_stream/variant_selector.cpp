@@ -0,0 +1,212 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "client/live_stream/variant_selector.h"
+
+#include <algorithm>
+
+namespace fastotv {
+namespace client {
+
+VariantSelector::Conditions::Conditions()
+    : now(0), throughput(0), demuxed_bytes(0), queued_bytes(0), dropped_frames(0) {}
+
+VariantSelector::VariantSelector(size_t variants_count)
+    : bitrates_(std::max<size_t>(variants_count, 1), 0),
+      up_switch_hold_(bitrates_.size(), up_switch_hold_msec),
+      current_(0),
+      last_switched_(0),
+      has_base_(false),
+      base_time_(0),
+      base_demuxed_bytes_(0),
+      base_queued_bytes_(0),
+      last_updated_(0),
+      last_dropped_frames_(0),
+      buffer_msec_(-1),
+      up_since_(0),
+      probing_(false),
+      drops_limit_(0),
+      drops_limit_until_(0),
+      drops_penalty_(drops_penalty_msec) {}
+
+size_t VariantSelector::GetVariantsCount() const {
+  return bitrates_.size();
+}
+
+void VariantSelector::SetVariantBitrate(size_t variant, uint64_t bitrate) {
+  if (variant < bitrates_.size()) {
+    bitrates_[variant] = bitrate;
+  }
+}
+
+bool VariantSelector::IsVariantBitrateKnown(size_t variant) const {
+  return variant < bitrates_.size() && bitrates_[variant] != 0;
+}
+
+uint64_t VariantSelector::GetVariantBitrate(size_t variant) const {
+  if (variant >= bitrates_.size()) {
+    return 0;
+  }
+
+  for (size_t i = variant + 1; i-- > 0;) {
+    if (bitrates_[i]) {
+      return bitrates_[i] >> (variant - i);
+    }
+  }
+  for (size_t i = variant + 1; i < bitrates_.size(); ++i) {
+    if (bitrates_[i]) {
+      return bitrates_[i] << (i - variant);
+    }
+  }
+  return 0;
+}
+
+size_t VariantSelector::SelectInitial(uint64_t throughput) const {
+  if (!throughput || !GetVariantBitrate(0)) {  // nothing to compare, the variant played last time
+    return current_;
+  }
+  return SelectSustainable(throughput);
+}
+
+void VariantSelector::Start(size_t variant, common::time64_t now) {
+  SwitchTo(std::min(variant, bitrates_.size() - 1), now);
+  probing_ = false;
+}
+
+size_t VariantSelector::Update(const Conditions& conditions) {
+  const common::time64_t now = conditions.now;
+  const common::time64_t elapsed = now - last_updated_;
+  last_updated_ = now;
+  if (!has_base_) {
+    has_base_ = true;
+    base_time_ = now;
+    base_demuxed_bytes_ = conditions.demuxed_bytes;
+    base_queued_bytes_ = conditions.queued_bytes;
+    last_dropped_frames_ = conditions.dropped_frames;
+    return current_;
+  }
+
+  const common::time64_t played = now - base_time_;
+  const uint64_t read = conditions.demuxed_bytes - base_demuxed_bytes_ + base_queued_bytes_;
+  if (played >= learn_bitrate_msec && read > conditions.queued_bytes) {
+    bitrates_[current_] = (read - conditions.queued_bytes) * 1000 / played;
+  }
+  buffer_msec_ = bitrates_[current_] ? conditions.queued_bytes * 1000 / bitrates_[current_] : -1;
+
+  const size_t dropped = conditions.dropped_frames >= last_dropped_frames_
+                             ? conditions.dropped_frames - last_dropped_frames_
+                             : conditions.dropped_frames;
+  last_dropped_frames_ = conditions.dropped_frames;
+
+  if (probing_ && buffer_msec_ >= high_buffer_msec) {
+    probing_ = false;
+    up_switch_hold_[current_] = up_switch_hold_msec;
+  }
+
+  const size_t worst = bitrates_.size() - 1;
+  if (now - last_switched_ < min_switch_interval_msec) {  // a new stream fills its buffer first
+    return current_;
+  }
+
+  if (elapsed > 0 && dropped * 1000 > static_cast<uint64_t>(max_dropped_frames_per_sec * elapsed)) {
+    if (current_ != worst) {  // the decoder or the renderer can't keep up, whatever the link does
+      if (drops_limit_until_ && drops_limit_ == current_ + 1) {
+        drops_penalty_ = std::min<common::time64_t>(drops_penalty_ * 2, max_drops_penalty_msec);
+      } else {
+        drops_penalty_ = drops_penalty_msec;
+      }
+      drops_limit_ = current_ + 1;
+      drops_limit_until_ = now + drops_penalty_;
+      SwitchTo(current_ + 1, now);
+    }
+    return current_;
+  }
+
+  if (buffer_msec_ < 0 || !conditions.throughput) {
+    up_since_ = 0;
+    return current_;
+  }
+
+  const uint64_t bitrate = bitrates_[current_];
+  if (buffer_msec_ < low_buffer_msec && conditions.throughput < bitrate) {
+    if (current_ != worst) {
+      if (probing_) {
+        up_switch_hold_[current_] = std::min<common::time64_t>(up_switch_hold_[current_] * 2, max_up_switch_hold_msec);
+      }
+      SwitchTo(std::max(SelectSustainable(conditions.throughput), current_ + 1), now);
+    }
+    return current_;
+  }
+
+  const bool keeps_up = conditions.throughput * 100 >= bitrate * safety_percent;
+  if (current_ == 0 || !CanUseVariant(current_ - 1, now) || buffer_msec_ < high_buffer_msec || dropped || !keeps_up) {
+    up_since_ = 0;
+    return current_;
+  }
+
+  const size_t better = current_ - 1;
+  if (conditions.throughput * safety_percent / 100 >= GetVariantBitrate(better)) {
+    SwitchTo(better, now);
+    probing_ = false;
+    return current_;
+  }
+
+  if (!up_since_) {
+    up_since_ = now;
+  }
+  if (now - up_since_ >= up_switch_hold_[better]) {
+    SwitchTo(better, now);
+    probing_ = true;
+  }
+  return current_;
+}
+
+size_t VariantSelector::GetCurrent() const {
+  return current_;
+}
+
+common::time64_t VariantSelector::GetBufferMsec() const {
+  return buffer_msec_;
+}
+
+size_t VariantSelector::SelectSustainable(uint64_t throughput) const {
+  const uint64_t budget = throughput * safety_percent / 100;
+  for (size_t i = 0; i < bitrates_.size(); ++i) {
+    const uint64_t bitrate = GetVariantBitrate(i);
+    if (bitrate && bitrate <= budget && CanUseVariant(i, last_updated_)) {
+      return i;
+    }
+  }
+  return bitrates_.size() - 1;
+}
+
+bool VariantSelector::CanUseVariant(size_t variant, common::time64_t now) const {
+  return variant >= drops_limit_ || now >= drops_limit_until_;
+}
+
+void VariantSelector::SwitchTo(size_t variant, common::time64_t now) {
+  current_ = variant;
+  last_switched_ = now;
+  last_updated_ = now;
+  has_base_ = false;
+  buffer_msec_ = -1;
+  up_since_ = 0;
+}
+
+}  // namespace client
+}  // namespace fastotv
@@ -0,0 +1,98 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include <common/types.h>  // for time64_t
+
+namespace fastotv {
+namespace client {
+
+// Picks one of the urls of a channel, ordered best first as the epg lists them. A variant bitrate is learned from
+// what playback consumed while the variant played, until then it is taken for half of the better neighbour.
+// A variant is left for a worse one when the buffer runs low on a link which can't sustain it, or when frames are
+// dropped; a better one is tried when the buffer stays full. A demuxer waiting on full queues reads no faster than
+// the media bitrate, so a better variant is often only probed, a failed probe doubles the wait for the next one.
+class VariantSelector {
+ public:
+  enum {
+    safety_percent = 75,              // share of the throughput estimate a variant may use
+    low_buffer_msec = 3000,           // below, a variant the link can't sustain is left
+    high_buffer_msec = 10000,         // above, a better variant may be tried
+    up_switch_hold_msec = 10000,      // conditions for a probe have to last that long
+    max_up_switch_hold_msec = 160000,
+    min_switch_interval_msec = 4000,
+    learn_bitrate_msec = 5000,        // playback before the consumed bytes tell the bitrate
+    max_dropped_frames_per_sec = 2,
+    drops_penalty_msec = 60000,       // better variants than one dropping frames are not tried that long
+    max_drops_penalty_msec = 960000   // doubled every time the same variant drops again
+  };
+
+  struct Conditions {
+    Conditions();
+
+    common::time64_t now;
+    uint64_t throughput;     // estimate, bytes per second, zero when not measured
+    uint64_t demuxed_bytes;  // read by the demuxer, total
+    uint64_t queued_bytes;   // read but not played yet
+    size_t dropped_frames;   // total of the playing stream
+  };
+
+  explicit VariantSelector(size_t variants_count);
+
+  size_t GetVariantsCount() const;
+  void SetVariantBitrate(size_t variant, uint64_t bitrate);
+  bool IsVariantBitrateKnown(size_t variant) const;
+  uint64_t GetVariantBitrate(size_t variant) const;  // bytes per second, zero when nothing is known
+
+  size_t SelectInitial(uint64_t throughput) const;  // throughput last measured on any channel, zero if none
+  void Start(size_t variant, common::time64_t now);  // a stream of the variant is opened
+  size_t Update(const Conditions& conditions);  // variant to play from now on
+  size_t GetCurrent() const;
+  common::time64_t GetBufferMsec() const;  // of the last update, -1 while the bitrate is unknown
+
+ private:
+  size_t SelectSustainable(uint64_t throughput) const;
+  bool CanUseVariant(size_t variant, common::time64_t now) const;
+  void SwitchTo(size_t variant, common::time64_t now);
+
+  std::vector<uint64_t> bitrates_;  // zero until learned
+  std::vector<common::time64_t> up_switch_hold_;
+  size_t current_;
+  common::time64_t last_switched_;
+  bool has_base_;  // consumption of the variant is counted from the first update
+  common::time64_t base_time_;
+  uint64_t base_demuxed_bytes_;
+  uint64_t base_queued_bytes_;
+  common::time64_t last_updated_;
+  size_t last_dropped_frames_;
+  common::time64_t buffer_msec_;
+  common::time64_t up_since_;
+  bool probing_;  // the current variant was tried without throughput evidence
+  size_t drops_limit_;  // best variant allowed after drops
+  common::time64_t drops_limit_until_;
+  common::time64_t drops_penalty_;
+};
+
+}  // namespace client
+}  // namespace fastotv
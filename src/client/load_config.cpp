@@ -41,6 +41,15 @@
 
 #define CONFIG_SERVER_OPTIONS "server_options"
 #define CONFIG_SERVER_OPTIONS_SERVER_FIELD "server"
+#define CONFIG_SERVER_OPTIONS_RECONNECT_MIN_DELAY_FIELD "reconnect_min_delay"
+#define CONFIG_SERVER_OPTIONS_RECONNECT_MAX_DELAY_FIELD "reconnect_max_delay"
+#define CONFIG_SERVER_OPTIONS_CONNECT_TIMEOUT_FIELD "connect_timeout"
+#define CONFIG_SERVER_OPTIONS_REQUEST_TIMEOUT_FIELD "request_timeout"
+#define CONFIG_SERVER_OPTIONS_REQUEST_RETRIES_FIELD "request_retries"
+#define CONFIG_SERVER_OPTIONS_KEEPALIVE_INTERVAL_FIELD "keepalive_interval"
+#define CONFIG_SERVER_OPTIONS_ICON_PARALLELISM_FIELD "icon_parallelism"
+#define CONFIG_SERVER_OPTIONS_TLS_FIELD "tls"
+#define CONFIG_SERVER_OPTIONS_TLS_VERIFY_FIELD "tls_verify"
 
 #define CONFIG_MAIN_OPTIONS "main_options"
 #define CONFIG_MAIN_OPTIONS_LOG_LEVEL_FIELD "loglevel"
@@ -81,7 +90,15 @@
 
 /*
   [server_options]
-  server=fastotv.com:6000
+  server=fastotv.com:6000 [host:port, comma separated list or repeated key]
+  reconnect_min_delay=1000 [1, INT_MAX] msec
+  reconnect_max_delay=300000 [1, INT_MAX] msec
+  connect_timeout=10000 [1, INT_MAX] msec
+  request_timeout=15000 [1, INT_MAX] msec
+  request_retries=2 [0, 10]
+  icon_parallelism=4 [1, 16]
+  tls=false [true,false]
+  tls_verify=true [true,false]
 
   [user_options]
   login=anon@fastogt.com
@@ -135,9 +152,67 @@ int ini_handler_fasto(void* user, const char* section, const char* name, const c
 
 #define MATCH(s, n) strcmp(section, s) == 0 && strcmp(name, n) == 0
   if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_SERVER_FIELD)) {
-    common::net::HostAndPort hs;
-    if (common::ConvertFromString(value, &hs)) {
-      pconfig->server = hs;
+    std::vector<std::string> tokens;
+    size_t servers_count = common::Tokenize(value, ",", &tokens);
+    for (size_t i = 0; i < servers_count; ++i) {
+      common::net::HostAndPort hs;
+      if (common::ConvertFromString(tokens[i], &hs)) {
+        pconfig->servers.push_back(hs);
+      }
+    }
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_RECONNECT_MIN_DELAY_FIELD)) {
+    int delay;
+    if (parse_number(value, 1, std::numeric_limits<int>::max(), &delay)) {
+      pconfig->connection_options.reconnect_min_delay_msec = delay;
+    }
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_RECONNECT_MAX_DELAY_FIELD)) {
+    int delay;
+    if (parse_number(value, 1, std::numeric_limits<int>::max(), &delay)) {
+      pconfig->connection_options.reconnect_max_delay_msec = delay;
+    }
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_CONNECT_TIMEOUT_FIELD)) {
+    int timeout;
+    if (parse_number(value, 1, std::numeric_limits<int>::max(), &timeout)) {
+      pconfig->connection_options.connect_timeout_msec = timeout;
+    }
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_REQUEST_TIMEOUT_FIELD)) {
+    int timeout;
+    if (parse_number(value, 1, std::numeric_limits<int>::max(), &timeout)) {
+      pconfig->connection_options.request_timeout_msec = timeout;
+    }
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_REQUEST_RETRIES_FIELD)) {
+    int retries;
+    if (parse_number(value, 0, 10, &retries)) {
+      pconfig->connection_options.request_max_retries = retries;
+    }
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_KEEPALIVE_INTERVAL_FIELD)) {
+    int interval;
+    if (parse_number(value, 1, std::numeric_limits<int>::max(), &interval)) {
+      pconfig->connection_options.keepalive_interval_msec = interval;
+    }
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_ICON_PARALLELISM_FIELD)) {
+    int parallelism;
+    if (parse_number(value, 1, 16, &parallelism)) {
+      pconfig->connection_options.icon_fetch_parallelism = parallelism;
+    }
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_TLS_FIELD)) {
+    bool tls;
+    if (parse_bool(value, &tls)) {
+      pconfig->connection_options.tls = tls;
+    }
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_TLS_VERIFY_FIELD)) {
+    bool verify;
+    if (parse_bool(value, &verify)) {
+      pconfig->connection_options.tls_verify_peer = verify;
     }
     return 1;
   } else if (MATCH(CONFIG_USER_OPTIONS, CONFIG_USER_OPTIONS_LOGIN_FIELD)) {
@@ -337,6 +412,11 @@ common::ErrnoError load_config_file(const std::string& config_absolute_path, Fas
       WARNING_LOG() << "Can't open config file path: " << copy_config_absolute_path;
     }
   }
+
+  if (!options->connection_options.IsValid()) {
+    WARNING_LOG() << "Invalid connection options, defaults will be used.";
+    options->connection_options = inner::ConnectionOptions();
+  }
   return common::ErrnoError();
 }
 
@@ -352,8 +432,29 @@ common::ErrnoError save_config_file(const std::string& config_absolute_path, Fas
   }
 
   config_save_file.Write("[" CONFIG_SERVER_OPTIONS "]\n");
-  const std::string host_and_port_str = common::ConvertToString(options->server);
-  config_save_file.WriteFormated(CONFIG_SERVER_OPTIONS_SERVER_FIELD "=%s\n", host_and_port_str);
+  std::string servers_str;
+  for (size_t i = 0; i < options->servers.size(); ++i) {
+    servers_str += (i ? "," : "") + common::ConvertToString(options->servers[i]);
+  }
+  config_save_file.WriteFormated(CONFIG_SERVER_OPTIONS_SERVER_FIELD "=%s\n", servers_str);
+  config_save_file.WriteFormated(CONFIG_SERVER_OPTIONS_RECONNECT_MIN_DELAY_FIELD "=%d\n",
+                                 options->connection_options.reconnect_min_delay_msec);
+  config_save_file.WriteFormated(CONFIG_SERVER_OPTIONS_RECONNECT_MAX_DELAY_FIELD "=%d\n",
+                                 options->connection_options.reconnect_max_delay_msec);
+  config_save_file.WriteFormated(CONFIG_SERVER_OPTIONS_CONNECT_TIMEOUT_FIELD "=%d\n",
+                                 options->connection_options.connect_timeout_msec);
+  config_save_file.WriteFormated(CONFIG_SERVER_OPTIONS_REQUEST_TIMEOUT_FIELD "=%d\n",
+                                 options->connection_options.request_timeout_msec);
+  config_save_file.WriteFormated(CONFIG_SERVER_OPTIONS_REQUEST_RETRIES_FIELD "=%d\n",
+                                 options->connection_options.request_max_retries);
+  config_save_file.WriteFormated(CONFIG_SERVER_OPTIONS_KEEPALIVE_INTERVAL_FIELD "=%d\n",
+                                 options->connection_options.keepalive_interval_msec);
+  config_save_file.WriteFormated(CONFIG_SERVER_OPTIONS_ICON_PARALLELISM_FIELD "=%d\n",
+                                 options->connection_options.icon_fetch_parallelism);
+  config_save_file.WriteFormated(CONFIG_SERVER_OPTIONS_TLS_FIELD "=%s\n",
+                                 common::ConvertToString(options->connection_options.tls));
+  config_save_file.WriteFormated(CONFIG_SERVER_OPTIONS_TLS_VERIFY_FIELD "=%s\n",
+                                 common::ConvertToString(options->connection_options.tls_verify_peer));
 
   config_save_file.Write("[" CONFIG_USER_OPTIONS "]\n");
   config_save_file.WriteFormated(CONFIG_USER_OPTIONS_LOGIN_FIELD "=%s\n", options->auth_options.GetLogin());
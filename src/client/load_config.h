@@ -19,6 +19,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include <common/error.h>  // for Error
 #include <common/net/types.h>
@@ -27,12 +28,15 @@
 
 #include <fastotv/commands_info/auth_info.h>
 
+#include "client/inner/connection_options.h"
+
 namespace fastotv {
 namespace client {
 
 struct FastoTVConfig : public fastoplayer::TVConfig {
   commands_info::AuthInfo auth_options;
-  common::net::HostAndPort server;
+  std::vector<common::net::HostAndPort> servers;  // failover order doesn't matter, the fastest healthy one is used
+  inner::ConnectionOptions connection_options;
 };
 
 common::ErrnoError load_config_file(const std::string& config_absolute_path, FastoTVConfig* options) WARN_UNUSED_RESULT;
@@ -18,6 +18,10 @@
 
 #include "client/player.h"
 
+#include <stdlib.h>
+
+#include <algorithm>
+
 #if defined(OS_WIN)
 #include <windows.h>
 #endif
@@ -36,10 +40,20 @@
 // widgets
 #include <player/draw/draw.h>
 #include <player/gui/widgets/button.h>
-#include <player/gui/widgets/icon_label.h>
 
+#include "client/draw/glyph_atlas.h"
+#include "client/events/event_queue.h"
+#include "client/draw/overlay_layer.h"
+#include "client/gui/atlas_label.h"
 #include "client/ioservice.h"  // for IoService
+#include "client/live_stream/runtime_info_coalescer.h"
+#include "client/live_stream/icon_atlas.h"
+#include "client/live_stream/icon_fetcher.h"
+#include "client/live_stream/icon_loader.h"
+#include "client/live_stream/throughput_estimator.h"
+#include "client/live_stream/variant_selector.h"
 #include "client/utils.h"
+#include "client/worker_pool.h"
 
 #include "client/programs_window.h"
 
@@ -50,13 +64,25 @@
 #define IMG_LEFT_BUTTON_PATH_RELATIVE "share/resources/left_arrow.png"
 #define IMG_UP_BUTTON_PATH_RELATIVE "share/resources/up_arrow.png"
 #define IMG_DOWN_BUTTON_PATH_RELATIVE "share/resources/down_arrow.png"
+#define IMG_UNKNOWN_CHANNEL_PATH_RELATIVE "share/resources/unknown_channel.png"
 
 #define FONT_DIR "/share/fonts/"
 
 #define CACHE_FOLDER_NAME "cache"
+#define SERVERS_HISTORY_FILE_NAME "servers_history"
+#define TLS_SESSIONS_FILE_NAME "tls_sessions"
 
-#define FOOTER_HIDE_DELAY_MSEC 2000  // 2 sec
-#define KEYPAD_HIDE_DELAY_MSEC 3000  // 3 sec
+#define FOOTER_HIDE_DELAY_MSEC 2000         // 2 sec
+#define KEYPAD_HIDE_DELAY_MSEC 3000         // 3 sec
+#define RUNTIME_INFO_REFRESH_MSEC 10000     // 10 sec
+#define BANDWIDTH_PUBLISH_MSEC 1000         // 1 sec
+#define VARIANT_UPDATE_MSEC 1000            // 1 sec
+#define VARIANT_PREOPEN_TIMEOUT_MSEC 10000  // 10 sec
+
+#define WORKER_POOL_THREADS 4
+#define WORKER_POOL_MAX_QUEUED 4096  // enough for an icon download per channel
+#define EVENT_QUEUE_CAPACITY 4096
+#define EVENT_POOL_CAPACITY 1024
 
 namespace fastotv {
 namespace client {
@@ -79,6 +105,23 @@ fastoplayer::draw::SurfaceSaver* MakeSurfaceFromImageRelativePath(const std::str
   return fastoplayer::draw::MakeSurfaceFromPath(img_full_path);
 }
 
+inner::ConnectionOptions MakeConnectionOptions(const std::string& app_directory_absolute_path,
+                                               const inner::ConnectionOptions& connection_options) {
+  inner::ConnectionOptions options = connection_options;
+  options.tls_sessions_path = common::file_system::make_path(app_directory_absolute_path, TLS_SESSIONS_FILE_NAME);
+  return options;
+}
+
+uint64_t GetReadBytes(fastoplayer::media::VideoState* stream, fastoplayer::media::msec_t elapsed) {
+  const fastoplayer::media::stats_t stats = stream ? stream->GetStatistic() : fastoplayer::media::stats_t();
+  if (!stats) {
+    return 0;
+  }
+
+  const uint64_t rate = static_cast<uint64_t>(stats->GetVideoBandwidth()) + stats->GetAudioBandwidth();
+  return rate * elapsed / 1000;
+}
+
 }  // namespace
 
 const SDL_Color Player::failed_color = {193, 66, 66, Uint8(SDL_ALPHA_OPAQUE * 0.5)};
@@ -89,8 +132,9 @@ const SDL_Color Player::chat_color = fastoplayer::ISimplePlayer::stream_statisti
 const SDL_Color Player::info_channel_color = {98, 118, 217, Uint8(SDL_ALPHA_OPAQUE * 0.5)};
 
 Player::Player(const std::string& app_directory_absolute_path,
-               const common::net::HostAndPort& server,
+               const std::vector<common::net::HostAndPort>& servers,
                const commands_info::AuthInfo& ainf,
+               const inner::ConnectionOptions& connection_options,
                const fastoplayer::PlayerOptions& options,
                const fastoplayer::media::AppOptions& opt,
                const fastoplayer::media::ComplexOptions& copt)
@@ -101,10 +145,58 @@ Player::Player(const std::string& app_directory_absolute_path,
       left_arrow_button_texture_(nullptr),
       show_playlist_button_(nullptr),
       hide_playlist_button_(nullptr),
-      controller_(new IoService(ainf, server)),
+      runtime_updates_(new RuntimeInfoCoalescer([this]() {
+        fApp->PostEvent(new events::RuntimeChannelsUpdatedEvent(this, events::RuntimeChannelsUpdated()));
+      })),
+      events_(new events::EventQueue(
+          EVENT_QUEUE_CAPACITY,
+          [this]() { fApp->PostEvent(new events::EventsPendingEvent(this, events::EventsPending())); },
+          [](events::EventQueue::event_t* event) { fApp->PostEvent(event); })),
+      runtime_subscribed_streams_(),
+      controller_(new IoService(ainf,
+                                servers,
+                                common::file_system::make_path(app_directory_absolute_path, SERVERS_HISTORY_FILE_NAME),
+                                MakeConnectionOptions(app_directory_absolute_path, connection_options),
+                                runtime_updates_,
+                                events_)),
+      workers_(new WorkerPool(WORKER_POOL_THREADS, WORKER_POOL_MAX_QUEUED)),
       current_stream_pos_(0),
       play_list_(),
+      stream_index_(),
+      channel_icons_(new IconAtlas),
+      icon_loader_(new IconLoader(workers_)),
+      icon_fetcher_(new IconFetcher(workers_,
+                                    connection_options.icon_fetch_parallelism,
+                                    [this](const stream_id_t& sid, const std::string& path) {
+                                      const events::IconDownloadInfo inf(sid, path);
+                                      events_->Post<events::ChannelIconDownloadedEvent>(this, inf);
+                                    })),
+      runtime_info_last_requested_(0),
+      measured_stream_(nullptr),
+      measured_sid_(),
+      throughput_(new ThroughputEstimator),
+      received_bytes_(0),
+      demuxed_bytes_(0),
+      throughput_last_sampled_(0),
+      bandwidth_last_published_(0),
+      bandwidth_estimate_(0),
+      last_throughput_(0),
+      variant_selectors_(),
+      variants_last_updated_(0),
+      preopened_stream_(nullptr),
+      preopened_uri_(),
+      preopened_options_(),
+      preopened_variant_(0),
+      replaced_variant_(0),
+      preopened_at_(0),
+      text_atlas_(nullptr),
+      overlay_layer_(nullptr),
+      overlay_revisions_(),
+      overlay_pointer_(),
+      overlay_pointer_buttons_(0),
+      runtime_info_revision_(0),
       description_label_(nullptr),
+      footer_icon_id_(),
       footer_last_shown_(0),
       admin_label_(nullptr),
       admin_label_type_(admin_message_type_t::TEXT),
@@ -124,21 +216,39 @@ Player::Player(const std::string& app_directory_absolute_path,
 
   fApp->Subscribe(this, events::ClientAuthorizedEvent::EventType);
   fApp->Subscribe(this, events::ClientUnAuthorizedEvent::EventType);
+  fApp->Subscribe(this, events::ClientHandshakeEvent::EventType);
 
   fApp->Subscribe(this, events::ClientConfigChangeEvent::EventType);
   fApp->Subscribe(this, events::ReceiveChannelsEvent::EventType);
   fApp->Subscribe(this, events::ReceiveRuntimeChannelEvent::EventType);
+  fApp->Subscribe(this, events::ReceiveRuntimeChannelsEvent::EventType);
+  fApp->Subscribe(this, events::RuntimeChannelsUpdatedEvent::EventType);
+  fApp->Subscribe(this, events::EventsPendingEvent::EventType);
   fApp->Subscribe(this, events::NotificationTextEvent::EventType);
   fApp->Subscribe(this, events::NotificationShutdownEvent::EventType);
+  fApp->Subscribe(this, events::IconDecodedEvent::EventType);
+  fApp->Subscribe(this, events::ChannelIconDownloadedEvent::EventType);
+  fApp->Subscribe(this, events::BandwidthEstimationEvent::EventType);
+
+  // the events which come in bursts, before the network loop and the workers start posting
+  events_->AddPool<events::ReceiveRuntimeChannelEvent>(EVENT_POOL_CAPACITY);
+  events_->AddPool<events::ReceiveRuntimeChannelsEvent>(EVENT_POOL_CAPACITY);
+  events_->AddPool<events::NotificationTextEvent>(EVENT_POOL_CAPACITY);
+  events_->AddPool<events::ChannelIconDownloadedEvent>(EVENT_POOL_CAPACITY);
+
+  auto request_icon_cb = [this](const stream_id_t& sid, const std::string& path, int size) {
+    icon_loader_->Load(sid, path, size);
+  };
+  channel_icons_->SetRequestIconCallback(request_icon_cb);
 
   // descr window
-  description_label_ = new fastoplayer::gui::IconLabel(failed_color);
+  description_label_ = new gui::AtlasLabel(failed_color);
   description_label_->SetTextColor(text_color);
   description_label_->SetSpace(space_width);
   description_label_->SetText("Init");
 
   // admin window
-  admin_label_ = new fastoplayer::gui::IconLabel(failed_color);
+  admin_label_ = new gui::AtlasLabel(failed_color);
   admin_label_->SetTextColor(text_color);
   admin_label_->SetSpace(space_width);
   admin_label_->SetText("None");
@@ -157,7 +267,7 @@ Player::Player(const std::string& app_directory_absolute_path,
   admin_label_->SetMouseClickedCallback(admin_click_cb);
 
   // key_pad window
-  keypad_label_ = new fastoplayer::gui::Label(keypad_color);
+  keypad_label_ = new gui::AtlasLabel(keypad_color);
   keypad_label_->SetTextColor(text_color);
   keypad_label_->SetDrawType(fastoplayer::gui::Label::CENTER_TEXT);
 
@@ -206,7 +316,16 @@ Player::~Player() {
   destroy(&keypad_label_);
   destroy(&admin_label_);
   destroy(&description_label_);
+  destroy(&overlay_layer_);
+  destroy(&text_atlas_);
+  destroy(&throughput_);
+  destroy(&icon_fetcher_);
+  destroy(&icon_loader_);
+  destroy(&channel_icons_);
+  destroy(&workers_);
   destroy(&controller_);
+  destroy(&events_);
+  destroy(&runtime_updates_);
 }
 
 void Player::HandleEvent(event_t* event) {
@@ -225,6 +344,9 @@ void Player::HandleEvent(event_t* event) {
   } else if (event->GetEventType() == events::ClientUnAuthorizedEvent::EventType) {
     events::ClientUnAuthorizedEvent* unauth_event = static_cast<events::ClientUnAuthorizedEvent*>(event);
     HandleClientUnAuthorizedEvent(unauth_event);
+  } else if (event->GetEventType() == events::ClientHandshakeEvent::EventType) {
+    events::ClientHandshakeEvent* handshake_event = static_cast<events::ClientHandshakeEvent*>(event);
+    HandleClientHandshakeEvent(handshake_event);
   } else if (event->GetEventType() == events::ClientConfigChangeEvent::EventType) {
     events::ClientConfigChangeEvent* conf_change_event = static_cast<events::ClientConfigChangeEvent*>(event);
     HandleClientConfigChangeEvent(conf_change_event);
@@ -234,12 +356,30 @@ void Player::HandleEvent(event_t* event) {
   } else if (event->GetEventType() == events::ReceiveRuntimeChannelEvent::EventType) {
     events::ReceiveRuntimeChannelEvent* channel_event = static_cast<events::ReceiveRuntimeChannelEvent*>(event);
     HandleReceiveRuntimeChannelEvent(channel_event);
+  } else if (event->GetEventType() == events::ReceiveRuntimeChannelsEvent::EventType) {
+    events::ReceiveRuntimeChannelsEvent* channels_event = static_cast<events::ReceiveRuntimeChannelsEvent*>(event);
+    HandleReceiveRuntimeChannelsEvent(channels_event);
+  } else if (event->GetEventType() == events::RuntimeChannelsUpdatedEvent::EventType) {
+    events::RuntimeChannelsUpdatedEvent* updated_event = static_cast<events::RuntimeChannelsUpdatedEvent*>(event);
+    HandleRuntimeChannelsUpdatedEvent(updated_event);
+  } else if (event->GetEventType() == events::EventsPendingEvent::EventType) {
+    events::EventsPendingEvent* pending_event = static_cast<events::EventsPendingEvent*>(event);
+    HandleEventsPendingEvent(pending_event);
   } else if (event->GetEventType() == events::NotificationTextEvent::EventType) {
     events::NotificationTextEvent* notify_text_event = static_cast<events::NotificationTextEvent*>(event);
     HandleNotificationTextEvent(notify_text_event);
   } else if (event->GetEventType() == events::NotificationShutdownEvent::EventType) {
     events::NotificationShutdownEvent* notify_shut_event = static_cast<events::NotificationShutdownEvent*>(event);
     HandleNotificationShutdownEvent(notify_shut_event);
+  } else if (event->GetEventType() == events::IconDecodedEvent::EventType) {
+    events::IconDecodedEvent* icon_event = static_cast<events::IconDecodedEvent*>(event);
+    HandleIconDecodedEvent(icon_event);
+  } else if (event->GetEventType() == events::ChannelIconDownloadedEvent::EventType) {
+    events::ChannelIconDownloadedEvent* download_event = static_cast<events::ChannelIconDownloadedEvent*>(event);
+    HandleChannelIconDownloadedEvent(download_event);
+  } else if (event->GetEventType() == events::BandwidthEstimationEvent::EventType) {
+    events::BandwidthEstimationEvent* bandwidth_event = static_cast<events::BandwidthEstimationEvent*>(event);
+    HandleBandwidthEstimationEvent(bandwidth_event);
   }
 
   base_class::HandleEvent(event);
@@ -249,11 +389,19 @@ void Player::HandleExceptionEvent(event_t* event, common::Error err) {
   if (event->GetEventType() == events::ClientConnectedEvent::EventType) {
     // gui::events::ClientConnectedEvent* connect_event =
     //    static_cast<gui::events::ClientConnectedEvent*>(event);
-    SwitchToDisconnectModeCheckConfig();
+    if (GetCurrentState() == INIT_STATE) {  // background reconnects don't interrupt playback
+      SwitchToDisconnectModeCheckConfig();
+    }
   } else if (event->GetEventType() == events::ClientAuthorizedEvent::EventType) {
     // gui::events::ClientConnectedEvent* connect_event =
     //    static_cast<gui::events::ClientConnectedEvent*>(event);
-    SwitchToUnAuthorizeMode();
+    if (GetCurrentState() == INIT_STATE) {
+      SwitchToUnAuthorizeMode();
+    }
+  } else if (event->GetEventType() == events::ClientHandshakeEvent::EventType) {
+    if (GetCurrentState() == INIT_STATE) {
+      SwitchToDisconnectMode();
+    }
   } else if (event->GetEventType() == events::ClientServerInfoEvent::EventType) {
     events::ClientServerInfoEvent* serv_event = static_cast<events::ClientServerInfoEvent*>(event);
     HandleClientServerInfoEvent(serv_event);
@@ -279,10 +427,29 @@ void Player::HandlePreExecEvent(fastoplayer::gui::events::PreExecEvent* event) {
 
   const common::draw::Size icon_size(h, h);
 
+  destroy(&text_atlas_);
+  if (font) {
+    text_atlas_ = new draw::GlyphAtlas(font);
+  }
+  destroy(&overlay_layer_);
+  overlay_layer_ = new draw::OverlayLayer;
+
   description_label_->SetFont(font);
+  description_label_->SetTextAtlas(text_atlas_);
   admin_label_->SetFont(font);
+  admin_label_->SetTextAtlas(text_atlas_);
   keypad_label_->SetFont(font);
+  keypad_label_->SetTextAtlas(text_atlas_);
   programs_window_->SetFont(font);
+  programs_window_->SetTextAtlas(text_atlas_);
+  channel_icons_->SetCellSize(h);
+  const std::string placeholder_path =
+      common::file_system::make_path(MakeAbsoluteSourceDir(), IMG_UNKNOWN_CHANNEL_PATH_RELATIVE);
+  channel_icons_->SetPlaceholder(placeholder_path);
+  workers_->Start();
+  icon_loader_->Start();
+  icon_fetcher_->Start();
+  programs_window_->SetIconAtlas(channel_icons_);
   programs_window_->SetRowHeight(h);
 
   int pmin_size_width = keypad_width + h + space_width + h;  // number + icon + text
@@ -294,15 +461,18 @@ void Player::HandlePreExecEvent(fastoplayer::gui::events::PreExecEvent* event) {
 }
 
 void Player::HandleTimerEvent(fastoplayer::gui::events::TimerEvent* event) {
+  DrainEvents();
   fastoplayer::media::msec_t cur_time = fastoplayer::media::GetCurrentMsec();
   fastoplayer::media::msec_t diff_footer = cur_time - footer_last_shown_;
   if (description_label_->IsVisible() && diff_footer > FOOTER_HIDE_DELAY_MSEC) {
     description_label_->SetVisible(false);
+    InvalidateOverlay(FOOTER_OVERLAY);
   }
 
   fastoplayer::media::msec_t diff_admin = cur_time - admin_last_shown_;
   if (admin_label_->IsVisible() && diff_admin > admin_show_time_) {
     admin_label_->SetVisible(false);
+    InvalidateOverlay(ADMIN_OVERLAY);
   }
 
   fastoplayer::media::msec_t diff_keypad = cur_time - keypad_last_shown_;
@@ -310,6 +480,15 @@ void Player::HandleTimerEvent(fastoplayer::gui::events::TimerEvent* event) {
     ResetKeyPad();
   }
 
+  UpdatePreopenedVariant(cur_time);
+  SampleThroughput(cur_time);
+  UpdateVariant(cur_time);
+  UpdateRuntimeSubscription();
+  if (cur_time - runtime_info_last_requested_ > RUNTIME_INFO_REFRESH_MSEC) {
+    runtime_info_last_requested_ = cur_time;
+    RequestVisibleRuntimeInfo();
+  }
+
   base_class::HandleTimerEvent(event);
 }
 
@@ -322,7 +501,37 @@ void Player::HandlePostExecEvent(fastoplayer::gui::events::PostExecEvent* event)
     destroy(&right_arrow_button_texture_);
     destroy(&left_arrow_button_texture_);
     play_list_.clear();
+    stream_index_.clear();
+    variant_selectors_.clear();
   }
+
+  description_label_->SetTextAtlas(nullptr);
+  admin_label_->SetTextAtlas(nullptr);
+  keypad_label_->SetTextAtlas(nullptr);
+  programs_window_->SetTextAtlas(nullptr);
+  programs_window_->SetIconAtlas(nullptr);
+  description_label_->SetIconTexture(nullptr);
+  DropPreopenedVariant();
+  icon_fetcher_->Stop();
+  icon_loader_->Stop();
+  const IconFetcher::Stats icon_stats = icon_fetcher_->GetStats();
+  DEBUG_LOG() << "Icon fetcher: requests " << icon_stats.requests << ", connections " << icon_stats.connections_opened
+              << ", downloaded " << icon_stats.downloaded << ", not modified " << icon_stats.not_modified
+              << ", failed " << icon_stats.failed << ", max parallel " << icon_stats.max_active;
+  const WorkerPool::Metrics metrics = workers_->GetMetrics();
+  DEBUG_LOG() << "Worker pool: completed " << metrics.completed << ", rejected " << metrics.rejected << ", stolen "
+              << metrics.stolen << ", max queue depth " << metrics.max_queue_depth << ", wait avg/max "
+              << metrics.avg_wait_msec << "/" << metrics.max_wait_msec << " msec, run avg/max " << metrics.avg_run_msec
+              << "/" << metrics.max_run_msec << " msec";
+  workers_->Stop();
+  DrainEvents();
+  const events::EventQueue::Stats event_stats = events_->GetStats();
+  DEBUG_LOG() << "Event queue: posted " << event_stats.posted << ", pooled " << event_stats.pooled << ", overflowed "
+              << event_stats.overflowed << ", drains " << event_stats.drains << ", max depth " << event_stats.max_depth
+              << ", latency avg/max " << event_stats.avg_latency_usec << "/" << event_stats.max_latency_usec << " usec";
+  channel_icons_->Clear();
+  destroy(&overlay_layer_);
+  destroy(&text_atlas_);
   base_class::HandlePostExecEvent(event);
 }
 
@@ -400,8 +609,9 @@ void Player::HandleClientServerInfoEvent(events::ClientServerInfoEvent* event) {
 
 void Player::HandleClientConnectedEvent(events::ClientConnectedEvent* event) {
   UNUSED(event);
-  SwitchToAuthorizeMode();
-  controller_->ActivateRequest();
+  if (GetCurrentState() == INIT_STATE) {  // login and playlist requests are already pipelined by the handler
+    SwitchToAuthorizeMode();
+  }
 }
 
 void Player::HandleClientDisconnectedEvent(events::ClientDisconnectedEvent* event) {
@@ -424,12 +634,21 @@ void Player::HandleClientUnAuthorizedEvent(events::ClientUnAuthorizedEvent* even
   }
 }
 
+void Player::HandleClientHandshakeEvent(events::ClientHandshakeEvent* event) {
+  events::HandshakeInfo info = event->GetInfo();
+  auth_ = info.auth;
+  ApplyChannels(info.channels);
+}
+
 void Player::HandleClientConfigChangeEvent(events::ClientConfigChangeEvent* event) {
   UNUSED(event);
 }
 
 void Player::HandleReceiveChannelsEvent(events::ReceiveChannelsEvent* event) {
-  events::ChannelsMixInfo chan = event->GetInfo();
+  ApplyChannels(event->GetInfo());
+}
+
+void Player::ApplyChannels(const events::ChannelsMixInfo& chan) {
   // prepare cache folders
   const std::string cache_dir = common::file_system::make_path(app_directory_absolute_path_, CACHE_FOLDER_NAME);
   bool is_exist_cache_root = common::file_system::is_directory_exist(cache_dir);
@@ -442,14 +661,18 @@ void Player::HandleReceiveChannelsEvent(events::ReceiveChannelsEvent* event) {
     }
   }
 
+  // after a reconnect the playlist is rebuilt, keep the current channel selected
+  stream_id_t current_sid = fastoplayer::media::invalid_stream_id;
+  if (current_stream_pos_ < play_list_.size()) {
+    current_sid = play_list_[current_stream_pos_].GetChannelInfo().GetStreamID();
+  }
+  play_list_.clear();
+  stream_index_.clear();
+
   const auto channels = chan.channels.Get();
   for (const commands_info::ChannelInfo& ch : channels) {
     PlaylistEntry entry = PlaylistEntry(cache_dir, ch);
-    const std::string icon_path = entry.GetIconPath();
-    fastoplayer::draw::SurfaceSaver* surf = fastoplayer::draw::MakeSurfaceFromPath(icon_path);
-    channel_icon_t shared_surface(surf);
-    entry.SetIcon(shared_surface);
-    play_list_.push_back(entry);
+    AddToPlaylist(entry);
 
     if (is_exist_cache_root) {  // prepare cache folders for channels
       LoadChannelIcon(entry);
@@ -459,22 +682,52 @@ void Player::HandleReceiveChannelsEvent(events::ReceiveChannelsEvent* event) {
   const auto private_channels = chan.private_channels.Get();
   for (const commands_info::ChannelInfo& ch : private_channels) {
     PlaylistEntry entry = PlaylistEntry(cache_dir, ch);
-    const std::string icon_path = entry.GetIconPath();
-    fastoplayer::draw::SurfaceSaver* surf = fastoplayer::draw::MakeSurfaceFromPath(icon_path);
-    channel_icon_t shared_surface(surf);
-    entry.SetIcon(shared_surface);
-    play_list_.push_back(entry);
+    AddToPlaylist(entry);
 
     if (is_exist_cache_root) {  // prepare cache folders for channels
       LoadChannelIcon(entry);
     }
   }
 
-  SetVisiblePlaylist(true);
+  const bool is_refresh = GetCurrentState() == PLAYING_STATE;
+  size_t pos = 0;
+  if (FindStreamPos(current_sid, &pos)) {
+    current_stream_pos_ = pos;
+  } else if (current_stream_pos_ >= play_list_.size()) {
+    current_stream_pos_ = 0;
+  }
+
   programs_window_->SetPlaylist(&play_list_);
+  programs_window_->SetCurrentPositionInPlaylist(current_stream_pos_);
+  InvalidateOverlay(WATCHERS_OVERLAY);
+  if (is_refresh) {
+    return;
+  }
+
+  SetVisiblePlaylist(true);
   SwitchToPlayingMode();
 }
 
+void Player::AddToPlaylist(const PlaylistEntry& entry) {
+  const stream_id_t sid = entry.GetChannelInfo().GetStreamID();
+  const std::string icon_path = entry.GetIconPath();
+  if (common::file_system::is_file_exist(icon_path)) {  // otherwise registered when downloaded
+    channel_icons_->SetIconPath(sid, icon_path);
+  }
+  stream_index_[sid] = play_list_.size();
+  play_list_.push_back(entry);
+}
+
+bool Player::FindStreamPos(const stream_id_t& sid, size_t* pos) const {
+  auto it = stream_index_.find(sid);
+  if (it == stream_index_.end()) {
+    return false;
+  }
+
+  *pos = it->second;
+  return true;
+}
+
 void Player::LoadChannelIcon(const PlaylistEntry& entry) {
   const std::string channel_dir = entry.GetCacheDir();
   bool is_cache_channel_dir_exist = common::file_system::is_directory_exist(channel_dir);
@@ -498,11 +751,16 @@ void Player::LoadChannelIcon(const PlaylistEntry& entry) {
     return;
   }
 
+  if (IconFetcher::IsSupported(uri)) {  // revalidated even when cached
+    icon_fetcher_->Fetch(entry.GetChannelInfo().GetStreamID(), uri, entry.GetIconPath());
+    return;
+  }
+
   struct DownloadLimit {
     enum { timeout = 2 };
-    explicit DownloadLimit(IoService* controller) : controller_(controller), first_time_exec_(0) {}
+    explicit DownloadLimit(WorkerPool* workers) : workers_(workers), first_time_exec_(0) {}
     bool operator()() {
-      if (!controller_->IsRunning()) {
+      if (!workers_->IsRunning()) {
         return true;
       }
 
@@ -518,51 +776,281 @@ void Player::LoadChannelIcon(const PlaylistEntry& entry) {
     }
 
    private:
-    IoService* controller_;
+    WorkerPool* workers_;
     fastoplayer::media::msec_t first_time_exec_;
   };
 
-  DownloadLimit download_interrupt_cb(controller_);
-  auto load_image_cb = [download_interrupt_cb, entry, uri, channel_dir]() {
+  DownloadLimit download_interrupt_cb(workers_);
+  auto load_image_cb = [this, download_interrupt_cb, entry, uri]() {
     const std::string channel_icon_path = entry.GetIconPath();
-    if (!common::file_system::is_file_exist(channel_icon_path)) {  // if not exist trying to download
-      common::char_buffer_t buff;
-      bool is_file_downloaded = DownloadFileToBuffer(uri, &buff, download_interrupt_cb);
-      if (!is_file_downloaded) {
-        return;
-      }
-
-      const uint32_t fl = common::file_system::File::FLAG_CREATE | common::file_system::File::FLAG_WRITE |
-                          common::file_system::File::FLAG_OPEN_BINARY;
-      common::file_system::FileGuard<common::file_system::File> channel_icon_file;
-      common::ErrnoError err = channel_icon_file.Open(channel_icon_path, fl);
-      if (err) {
-        DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
-        return;
-      }
+    if (common::file_system::is_file_exist(channel_icon_path)) {  // already in cache
+      return;
+    }
 
-      size_t writed;
-      err = channel_icon_file.WriteBuffer(buff, &writed);
-      if (err) {
-        DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
-        return;
-      }
+    if (!DownloadFileToPath(uri, channel_icon_path, IconFetcher::max_icon_size, download_interrupt_cb)) {
+      return;
     }
+
+    const events::IconDownloadInfo inf(entry.GetChannelInfo().GetStreamID(), channel_icon_path);
+    events_->Post<events::ChannelIconDownloadedEvent>(this, inf);
   };
-  controller_->ExecInLoopThread(load_image_cb);
+  if (!workers_->Post(load_image_cb)) {
+    WARNING_LOG() << "Worker pool is full, icon of " << entry.GetChannelInfo().GetStreamID() << " skipped";
+  }
 }
 
 void Player::HandleReceiveRuntimeChannelEvent(events::ReceiveRuntimeChannelEvent* event) {
-  commands_info::RuntimeChannelInfo inf = event->GetInfo();
-  for (size_t i = 0; i < play_list_.size(); ++i) {
-    commands_info::ChannelInfo cinf = play_list_[i].GetChannelInfo();
-    if (inf.GetStreamID() == cinf.GetStreamID()) {
-      play_list_[i].SetRuntimeChannelInfo(inf);
-      break;
+  ApplyRuntimeChannelInfo(event->GetInfo());
+}
+
+void Player::HandleReceiveRuntimeChannelsEvent(events::ReceiveRuntimeChannelsEvent* event) {
+  const std::vector<commands_info::RuntimeChannelInfo> infos = event->GetInfo();
+  for (const commands_info::RuntimeChannelInfo& inf : infos) {
+    ApplyRuntimeChannelInfo(inf);
+  }
+}
+
+void Player::HandleRuntimeChannelsUpdatedEvent(events::RuntimeChannelsUpdatedEvent* event) {
+  UNUSED(event);
+  const std::vector<commands_info::RuntimeChannelInfo> infos = runtime_updates_->Take();
+  for (const commands_info::RuntimeChannelInfo& inf : infos) {
+    ApplyRuntimeChannelInfo(inf);
+  }
+}
+
+void Player::HandleBandwidthEstimationEvent(events::BandwidthEstimationEvent* event) {
+  const events::BandwidthEstimationInfo inf = event->GetInfo();
+  if (inf.sid != measured_sid_ || inf.bandwidth == bandwidth_estimate_) {  // posted before a channel switch
+    return;
+  }
+
+  bandwidth_estimate_ = inf.bandwidth;
+  InvalidateOverlay(BANDWIDTH_OVERLAY);
+}
+
+void Player::SampleThroughput(fastoplayer::media::msec_t cur_time) {
+  if (!measured_stream_ || GetCurrentState() != PLAYING_STATE) {
+    return;
+  }
+
+  // the read thread of a stream counts the bytes of the packets it reads from the input into per-second rates,
+  // they are integrated between the samples; a pre-opened variant shares the link, so its bytes count too
+  if (throughput_last_sampled_) {
+    const fastoplayer::media::msec_t elapsed = cur_time - throughput_last_sampled_;
+    const uint64_t demuxed = GetReadBytes(measured_stream_, elapsed);
+    demuxed_bytes_ += demuxed;
+    received_bytes_ += demuxed + GetReadBytes(preopened_stream_, elapsed);
+  }
+  throughput_last_sampled_ = cur_time;
+  throughput_->AddSample(cur_time, received_bytes_);
+  if (throughput_->HasEstimate()) {
+    last_throughput_ = throughput_->GetEstimate();
+  }
+
+  if (throughput_->HasEstimate() && cur_time - bandwidth_last_published_ >= BANDWIDTH_PUBLISH_MSEC) {
+    bandwidth_last_published_ = cur_time;
+    const events::BandwidthEstimationInfo inf(measured_sid_, static_cast<bandwidth_t>(throughput_->GetEstimate()));
+    fApp->PostEvent(new events::BandwidthEstimationEvent(this, inf));
+  }
+}
+
+size_t Player::SelectVariant(const stream_id_t& sid, size_t variants_count) {
+  auto it = variant_selectors_.find(sid);
+  if (it != variant_selectors_.end() && it->second.GetVariantsCount() != variants_count) {  // other urls now
+    variant_selectors_.erase(it);
+    it = variant_selectors_.end();
+  }
+  if (it == variant_selectors_.end()) {
+    it = variant_selectors_.insert(std::make_pair(sid, VariantSelector(variants_count))).first;
+  }
+
+  const size_t variant = it->second.SelectInitial(last_throughput_);
+  it->second.Start(variant, fastoplayer::media::GetCurrentMsec());
+  return variant;
+}
+
+void Player::UpdateVariant(fastoplayer::media::msec_t cur_time) {
+  if (!measured_stream_ || GetCurrentState() != PLAYING_STATE) {
+    return;
+  }
+  if (preopened_stream_ || cur_time - variants_last_updated_ < VARIANT_UPDATE_MSEC) {
+    return;
+  }
+
+  const auto it = variant_selectors_.find(measured_sid_);
+  const fastoplayer::media::stats_t stats = measured_stream_->GetStatistic();
+  if (it == variant_selectors_.end() || it->second.GetVariantsCount() < 2 || !stats) {
+    return;
+  }
+
+  variants_last_updated_ = cur_time;
+  VariantSelector::Conditions conditions;
+  conditions.now = cur_time;
+  conditions.throughput = throughput_->GetEstimate();
+  conditions.demuxed_bytes = demuxed_bytes_;
+  conditions.queued_bytes = static_cast<uint64_t>(stats->video_queue_size) + stats->audio_queue_size;
+  conditions.dropped_frames = stats->frame_drops_early + stats->frame_drops_late;
+  const size_t playing = it->second.GetCurrent();
+  const size_t variant = it->second.Update(conditions);
+  if (variant != playing && !SwitchVariant(variant, playing)) {
+    it->second.Start(playing, cur_time);
+  }
+}
+
+bool Player::SwitchVariant(size_t variant, size_t playing) {
+  PlaylistEntry entry;
+  if (!GetCurrentUrl(&entry)) {
+    return false;
+  }
+
+  commands_info::ChannelInfo url = entry.GetChannelInfo();
+  const stream_id_t sid = url.GetStreamID();
+  const commands_info::EpgInfo::urls_t urls = url.GetEpg().GetUrls();
+  if (sid != measured_sid_ || variant >= urls.size()) {
+    return false;
+  }
+
+  // same channel from another url: only its demuxer and video decoder are opened next to the playing stream, which
+  // goes on until the new url has decoded its first keyframe
+  fastoplayer::media::AppOptions copy = GetChannelStreamOptions(url);
+  fastoplayer::media::AppOptions probe = copy;
+  probe.enable_audio = false;
+  fastoplayer::media::VideoState* stream = base_class::CreateStream(sid, urls[variant], probe, copt_);
+  if (stream->Exec() == EXIT_FAILURE) {
+    destroy(&stream);
+    return false;
+  }
+
+  preopened_stream_ = stream;
+  preopened_uri_ = urls[variant];
+  preopened_options_ = copy;
+  preopened_variant_ = variant;
+  replaced_variant_ = playing;
+  preopened_at_ = fastoplayer::media::GetCurrentMsec();
+  return true;
+}
+
+void Player::UpdatePreopenedVariant(fastoplayer::media::msec_t cur_time) {
+  if (!preopened_stream_) {
+    return;
+  }
+
+  const auto it = variant_selectors_.find(measured_sid_);
+  const fastoplayer::media::stats_t stats = preopened_stream_->GetStatistic();
+  if (stats && stats->frame_processed) {  // decoding starts on a keyframe
+    // the url is live, it is opened with audio the way channels are: SetStream stops the playing stream before it
+    // starts the new one, the two never hold the audio device together; the live variants are cut on the same
+    // keyframes, so the new stream starts on the one just found. The playlist position, the footer and the
+    // throughput measured so far stay.
+    DropPreopenedVariant();
+    fastoplayer::media::VideoState* stream =
+        base_class::CreateStream(measured_sid_, preopened_uri_, preopened_options_, copt_);
+    const bandwidth_t bandwidth = bandwidth_estimate_;
+    measured_stream_ = stream;
+    SetStream(stream);
+    if (measured_stream_) {  // reset if the stream failed
+      bandwidth_estimate_ = bandwidth;
+    }
+    if (it != variant_selectors_.end()) {
+      it->second.Start(preopened_variant_, cur_time);
+    }
+    return;
+  }
+
+  if (cur_time - preopened_at_ >= VARIANT_PREOPEN_TIMEOUT_MSEC) {  // the playing variant goes on
+    DropPreopenedVariant();
+    if (it != variant_selectors_.end()) {
+      it->second.Start(replaced_variant_, cur_time);
+    }
+  }
+}
+
+void Player::DropPreopenedVariant() {
+  if (!preopened_stream_) {
+    return;
+  }
+
+  preopened_stream_->Abort();
+  destroy(&preopened_stream_);
+}
+
+void Player::HandleEventsPendingEvent(events::EventsPendingEvent* event) {
+  UNUSED(event);
+  DrainEvents();
+}
+
+void Player::DrainEvents() {
+  // bursts are folded before they reach the handlers: the newest runtime info per stream and the newest admin text,
+  // so the work per frame grows with the number of channels, not with the number of messages
+  RuntimeInfoCoalescer runtime(nullptr);
+  bool has_text = false;
+  commands_info::NotificationTextInfo text;
+  events_->Drain([this, &runtime, &has_text, &text](events::EventQueue::event_t* event) {
+    if (event->GetEventType() == events::ReceiveRuntimeChannelEvent::EventType) {
+      runtime.Push({static_cast<events::ReceiveRuntimeChannelEvent*>(event)->GetInfo()});
+    } else if (event->GetEventType() == events::ReceiveRuntimeChannelsEvent::EventType) {
+      runtime.Push(static_cast<events::ReceiveRuntimeChannelsEvent*>(event)->GetInfo());
+    } else if (event->GetEventType() == events::NotificationTextEvent::EventType) {
+      text = static_cast<events::NotificationTextEvent*>(event)->GetInfo();
+      has_text = true;
+    } else {
+      HandleEvent(event);
     }
+  });
+
+  const RuntimeInfoCoalescer::runtime_channels_t channels = runtime.Take();
+  if (!channels.empty()) {
+    events::ReceiveRuntimeChannelsEvent merged(this, channels);
+    HandleReceiveRuntimeChannelsEvent(&merged);
+  }
+  if (has_text) {
+    events::NotificationTextEvent newest(this, text);
+    HandleNotificationTextEvent(&newest);
   }
 }
 
+void Player::ApplyRuntimeChannelInfo(const commands_info::RuntimeChannelInfo& inf) {
+  size_t pos;
+  if (!FindStreamPos(inf.GetStreamID(), &pos)) {
+    return;
+  }
+
+  play_list_[pos].SetRuntimeChannelInfo(inf);
+  if (pos == current_stream_pos_) {  // only the watchers of the current channel are drawn
+    runtime_info_revision_++;
+  }
+}
+
+std::vector<stream_id_t> Player::GetRuntimeInfoStreams() {
+  if (GetCurrentState() != PLAYING_STATE) {
+    return std::vector<stream_id_t>();
+  }
+
+  std::vector<stream_id_t> sids = programs_window_->GetVisibleStreams();
+  PlaylistEntry entry;
+  if (GetCurrentUrl(&entry)) {
+    sids.push_back(entry.GetChannelInfo().GetStreamID());
+  }
+  std::sort(sids.begin(), sids.end());
+  sids.erase(std::unique(sids.begin(), sids.end()), sids.end());
+  return sids;
+}
+
+void Player::RequestVisibleRuntimeInfo() {
+  const std::vector<stream_id_t> sids = GetRuntimeInfoStreams();
+  controller_->RequestRuntimeChannelsInfo(sids);
+}
+
+void Player::UpdateRuntimeSubscription() {
+  const std::vector<stream_id_t> sids = GetRuntimeInfoStreams();
+  if (sids == runtime_subscribed_streams_) {
+    return;
+  }
+
+  runtime_subscribed_streams_ = sids;
+  controller_->SubscribeRuntimeChannelsInfo(sids);
+}
+
 void Player::HandleNotificationTextEvent(events::NotificationTextEvent* event) {
   const commands_info::NotificationTextInfo inf = event->GetInfo();
   StartShowAdminMessage(inf.GetText(), inf.GetType(), inf.GetShowTime());
@@ -573,6 +1061,25 @@ void Player::HandleNotificationShutdownEvent(events::NotificationShutdownEvent*
   Quit();
 }
 
+void Player::HandleIconDecodedEvent(events::IconDecodedEvent* event) {
+  const events::IconInfo inf = event->GetInfo();
+  channel_icons_->AddIcon(inf.sid, inf.icon.get());
+}
+
+void Player::HandleChannelIconDownloadedEvent(events::ChannelIconDownloadedEvent* event) {
+  const events::IconDownloadInfo inf = event->GetInfo();
+  size_t pos;
+  if (!FindStreamPos(inf.sid, &pos)) {  // playlist changed
+    return;
+  }
+
+  // decoded when visible, a refreshed icon replaces the decoded one
+  if (channel_icons_->HasIcon(inf.sid)) {
+    channel_icons_->RemoveIcon(inf.sid);
+  }
+  channel_icons_->SetIconPath(inf.sid, play_list_[pos].GetIconPath());
+}
+
 void Player::HandleKeyPressEvent(fastoplayer::gui::events::KeyPressEvent* event) {
   if (programs_window_->IsActived()) {
     return;
@@ -635,12 +1142,63 @@ void Player::HandleLircPressEvent(fastoplayer::gui::events::LircPressEvent* even
 }
 
 void Player::DrawInfo() {
+  SDL_Renderer* render = GetRenderer();
+  bool cached = false;
+  if (overlay_layer_ && render) {
+    TrackOverlayPointer();
+    overlay_layer_->SetLayout(GetDisplayRect(), fApp->IsCursorVisible());
+    draw::OverlayLayer::revisions_t revisions(overlay_revisions_, overlay_revisions_ + OVERLAY_WIDGETS_COUNT);
+    revisions.push_back(programs_window_->GetRevision());
+    revisions.push_back(channel_icons_->GetRevision());
+    revisions.push_back(runtime_info_revision_);
+    auto overlay_cb = [this](SDL_Renderer* layer_render) {
+      UNUSED(layer_render);
+      DrawOverlays();
+    };
+    cached = overlay_layer_->Draw(render, revisions, overlay_cb);
+  }
+
+  if (!cached) {
+    DrawOverlays();
+  }
+  base_class::DrawInfo();
+}
+
+void Player::InvalidateOverlay(OverlayWidget widget) {
+  overlay_revisions_[widget]++;
+}
+
+void Player::TrackOverlayPointer() {
+  // hover and clicks are handled by the programs list widgets, it is redrawn only for the pointer changes over it
+  SDL_Point point;
+  const Uint32 buttons = SDL_GetMouseState(&point.x, &point.y);
+  if (point.x == overlay_pointer_.x && point.y == overlay_pointer_.y && buttons == overlay_pointer_buttons_) {
+    return;
+  }
+
+  const SDL_Point prev = overlay_pointer_;
+  overlay_pointer_ = point;
+  overlay_pointer_buttons_ = buttons;
+  if (IsPointOverProgramsList(prev) || IsPointOverProgramsList(point)) {
+    InvalidateOverlay(PROGRAMS_OVERLAY);
+  }
+}
+
+bool Player::IsPointOverProgramsList(const SDL_Point& point) const {
+  const SDL_Rect programs_list_rect = GetProgramsListRect();
+  const SDL_Rect hide_button_rect = GetHideButtonPlayListRect();
+  const SDL_Rect show_button_rect = GetShowButtonPlayListRect();
+  return SDL_PointInRect(&point, &programs_list_rect) || SDL_PointInRect(&point, &hide_button_rect) ||
+         SDL_PointInRect(&point, &show_button_rect);
+}
+
+void Player::DrawOverlays() {
   DrawFooter();
   DrawKeyPad();
   DrawProgramsList();
   DrawWatchers();
+  DrawBandwidth();
   DrawAdminMessage();
-  base_class::DrawInfo();
 }
 
 SDL_Rect Player::GetFooterRect() const {
@@ -667,6 +1225,11 @@ SDL_Rect Player::GetWatcherRect() const {
   return hide_button_rect;
 }
 
+SDL_Rect Player::GetBandwidthRect() const {
+  const SDL_Rect watchers_rect = GetWatcherRect();
+  return {watchers_rect.x - watchers_rect.w * 4, watchers_rect.y, watchers_rect.w * 4, watchers_rect.h};
+}
+
 void Player::ToggleShowProgramsList() {
   SetVisiblePlaylist(!programs_window_->IsVisible());
 }
@@ -691,6 +1254,7 @@ SDL_Rect Player::GetShowButtonPlayListRect() const {
 }
 
 void Player::SetVisiblePlaylist(bool visible) {
+  InvalidateOverlay(PROGRAMS_OVERLAY);
   programs_window_->SetVisible(visible);
   hide_playlist_button_->SetVisible(visible);
   show_playlist_button_->SetVisible(!visible);
@@ -727,6 +1291,7 @@ void Player::HandleKeyPad(uint8_t key) {
   }
 
   keypad_label_->SetVisible(true);
+  InvalidateOverlay(KEYPAD_OVERLAY);
   fastoplayer::media::msec_t cur_time = fastoplayer::media::GetCurrentMsec();
   keypad_last_shown_ = cur_time;
   size_t nex_keypad_sym = cur_number * 10 + key;
@@ -749,6 +1314,7 @@ void Player::RemoveLastSymbolInKeypad() {
   }
 
   keypad_label_->SetText(common::ConvertToString(nex_keypad_sym));
+  InvalidateOverlay(KEYPAD_OVERLAY);
 }
 
 void Player::FinishKeyPadInput() {
@@ -776,6 +1342,7 @@ void Player::CreateStreamPosAfterKeypad(size_t pos) {
 void Player::ResetKeyPad() {
   keypad_label_->SetVisible(false);
   keypad_label_->ClearText();
+  InvalidateOverlay(KEYPAD_OVERLAY);
 }
 
 SDL_Rect Player::GetKeyPadRect() const {
@@ -815,11 +1382,32 @@ void Player::DrawWatchers() {
       SDL_Rect watchers_rect = GetWatcherRect();
       std::string watchers_str = common::ConvertToString(watchers);
       fastoplayer::draw::FillRectColor(render, watchers_rect, fastoplayer::draw::red_color);
-      fastoplayer::draw::DrawCenterTextInRect(render, watchers_str, font, text_color, watchers_rect);
+      if (text_atlas_) {
+        text_atlas_->DrawText(render, watchers_str, watchers_rect, text_color, fastoplayer::gui::Label::CENTER_TEXT);
+      } else {
+        fastoplayer::draw::DrawCenterTextInRect(render, watchers_str, font, text_color, watchers_rect);
+      }
     }
   }
 }
 
+void Player::DrawBandwidth() {
+  SDL_Renderer* render = GetRenderer();
+  TTF_Font* font = GetFont();
+  if (!font || !render || !fApp->IsCursorVisible() || !bandwidth_estimate_) {
+    return;
+  }
+
+  const SDL_Rect bandwidth_rect = GetBandwidthRect();
+  const std::string bandwidth_str = common::MemSPrintf("%.1f Mbit/s", bandwidth_estimate_ * 8 / 1000000.0);
+  fastoplayer::draw::FillRectColor(render, bandwidth_rect, stream_statistic_color);
+  if (text_atlas_) {
+    text_atlas_->DrawText(render, bandwidth_str, bandwidth_rect, text_color, fastoplayer::gui::Label::CENTER_TEXT);
+  } else {
+    fastoplayer::draw::DrawCenterTextInRect(render, bandwidth_str, font, text_color, bandwidth_rect);
+  }
+}
+
 void Player::DrawKeyPad() {
   SDL_Renderer* render = GetRenderer();
   TTF_Font* font = GetFont();
@@ -843,6 +1431,15 @@ void Player::DrawFooter() {
   int padding_left = footer_rect.w / 4;
   SDL_Rect banner_footer_rect = {footer_rect.x + padding_left, footer_rect.y, footer_rect.w - padding_left * 2,
                                  footer_rect.h};
+  if (!footer_icon_id_.empty()) {
+    SDL_Texture* icon = nullptr;
+    SDL_Rect icon_src;
+    if (channel_icons_->GetIcon(render, footer_icon_id_, &icon, &icon_src)) {
+      description_label_->SetIconTexture(icon, icon_src);
+    } else {
+      description_label_->SetIconTexture(nullptr);
+    }
+  }
   description_label_->SetRect(banner_footer_rect);
   description_label_->Draw(render);
 }
@@ -885,16 +1482,24 @@ void Player::InitWindow(const std::string& title, States status) {
   if (status != PLAYING_STATE) {
     description_label_->SetText(title);
   }
+  InvalidateOverlay(FOOTER_OVERLAY);
 
   base_class::InitWindow(title, status);
 }
 
 void Player::SetStatus(States new_state) {
+  if (new_state != PLAYING_STATE) {  // the stream is gone or about to be
+    DropPreopenedVariant();
+    measured_stream_ = nullptr;
+    bandwidth_estimate_ = 0;
+  }
   if (new_state == INIT_STATE) {
+    footer_icon_id_.clear();
     description_label_->SetDrawType(fastoplayer::gui::Label::CENTER_TEXT);
     description_label_->SetIconTexture(nullptr);
     description_label_->SetBackGroundColor(failed_color);
   } else if (new_state == FAILED_STATE) {
+    footer_icon_id_.clear();
     description_label_->SetDrawType(fastoplayer::gui::Label::CENTER_TEXT);
     description_label_->SetIconTexture(nullptr);
     description_label_->SetBackGroundColor(failed_color);
@@ -906,21 +1511,15 @@ void Player::SetStatus(States new_state) {
           "Title: %s\n"
           "Description: %s",
           descr.title, descr.description);
-      channel_icon_t icon = descr.icon;
-      if (icon) {
-        SDL_Renderer* render = GetRenderer();
-        TTF_Font* font = GetFont();
-
-        const SDL_Rect footer_rect = GetFooterRect();
-        description_label_->SetIconTexture(icon->GetTexture(render));
-        int h = fastoplayer::draw::CalcHeightFontPlaceByRowCount(font, DESCR_LINES_COUNT);
-        if (h > footer_rect.h) {
-          h = footer_rect.h;
-        }
-        description_label_->SetIconSize(common::draw::Size(h, h));
-      } else {
-        description_label_->SetIconTexture(nullptr);
+      TTF_Font* font = GetFont();
+      const SDL_Rect footer_rect = GetFooterRect();
+      // texture resolved from atlas in DrawFooter, placeholder until decoded
+      footer_icon_id_ = play_list_[current_stream_pos_].GetChannelInfo().GetStreamID();
+      int h = fastoplayer::draw::CalcHeightFontPlaceByRowCount(font, DESCR_LINES_COUNT);
+      if (h > footer_rect.h) {
+        h = footer_rect.h;
       }
+      description_label_->SetIconSize(common::draw::Size(h, h));
       description_label_->SetDrawType(fastoplayer::gui::Label::WRAPPED_TEXT);
       description_label_->SetText(footer_text);
       description_label_->SetBackGroundColor(info_channel_color);
@@ -929,6 +1528,10 @@ void Player::SetStatus(States new_state) {
     NOTREACHED();
   }
 
+  // the footer, watchers and bandwidth are of the new channel
+  InvalidateOverlay(FOOTER_OVERLAY);
+  InvalidateOverlay(WATCHERS_OVERLAY);
+  InvalidateOverlay(BANDWIDTH_OVERLAY);
   base_class::SetStatus(new_state);
 }
 
@@ -954,7 +1557,17 @@ fastoplayer::media::VideoState* Player::CreateStream(stream_id_t sid,
                                                      fastoplayer::media::AppOptions opt,
                                                      fastoplayer::media::ComplexOptions copt) {
   controller_->RequesRuntimeChannelInfo(sid);
-  return base_class::CreateStream(sid, uri, opt, copt);
+  DropPreopenedVariant();
+  fastoplayer::media::VideoState* stream = base_class::CreateStream(sid, uri, opt, copt);
+  // the new stream replaces the playing one, its throughput is measured from scratch
+  measured_stream_ = stream;
+  measured_sid_ = sid;
+  throughput_->Reset();
+  received_bytes_ = 0;
+  demuxed_bytes_ = 0;
+  throughput_last_sampled_ = 0;
+  bandwidth_estimate_ = 0;
+  return stream;
 }
 
 void Player::OnWindowCreated(SDL_Window* window, SDL_Renderer* render) {
@@ -1007,17 +1620,23 @@ fastoplayer::media::VideoState* Player::CreateStreamPos(size_t pos) {
   PlaylistEntry entry = play_list_[current_stream_pos_];
   commands_info::ChannelInfo url = entry.GetChannelInfo();
   stream_id_t sid = url.GetStreamID();
-  fastoplayer::media::AppOptions copy = GetStreamOptions();
-  copy.enable_audio = url.IsEnableVideo();
-  copy.enable_video = url.IsEnableAudio();
+  fastoplayer::media::AppOptions copy = GetChannelStreamOptions(url);
 
   programs_window_->SetCurrentPositionInPlaylist(current_stream_pos_);
   const commands_info::EpgInfo epg = url.GetEpg();
   const commands_info::EpgInfo::urls_t urls = epg.GetUrls();
-  fastoplayer::media::VideoState* stream = CreateStream(sid, urls[0], copy, copt_);
+  const size_t variant = SelectVariant(sid, urls.size());
+  fastoplayer::media::VideoState* stream = CreateStream(sid, urls[variant], copy, copt_);
   return stream;
 }
 
+fastoplayer::media::AppOptions Player::GetChannelStreamOptions(const commands_info::ChannelInfo& url) {
+  fastoplayer::media::AppOptions copy = GetStreamOptions();
+  copy.enable_audio = url.IsEnableVideo();
+  copy.enable_video = url.IsEnableAudio();
+  return copy;
+}
+
 size_t Player::GenerateNextPosition() const {
   if (current_stream_pos_ + 1 == play_list_.size()) {
     return 0;
@@ -1036,6 +1655,7 @@ size_t Player::GeneratePrevPosition() const {
 
 void Player::StartShowFooter() {
   description_label_->SetVisible(true);
+  InvalidateOverlay(FOOTER_OVERLAY);
   fastoplayer::media::msec_t cur_time = fastoplayer::media::GetCurrentMsec();
   footer_last_shown_ = cur_time;
 }
@@ -1044,6 +1664,7 @@ void Player::StartShowAdminMessage(const std::string& text, admin_message_type_t
   admin_label_->SetText(text);
   admin_label_type_ = type;
   admin_label_->SetVisible(true);
+  InvalidateOverlay(ADMIN_OVERLAY);
   fastoplayer::media::msec_t cur_time = fastoplayer::media::GetCurrentMsec();
   admin_last_shown_ = cur_time;
   admin_show_time_ = ttl;
@@ -18,25 +18,46 @@
 
 #pragma once
 
+#include <stdint.h>
+
+#include <map>
 #include <string>
 #include <vector>
 
 #include <player/isimple_player.h>
 
+#include "client/events/icon_events.h"
 #include "client/events/network_events.h"  // for BandwidthEstimationEvent
+#include "client/inner/connection_options.h"
 #include "client/live_stream/playlist_entry.h"
+#include "client/live_stream/variant_selector.h"
 
 namespace fastoplayer {
 namespace gui {
-class IconLabel;
 class Button;
 }  // namespace gui
 }  // namespace fastoplayer
 
 namespace fastotv {
 namespace client {
+namespace draw {
+class GlyphAtlas;
+class OverlayLayer;
+}
+namespace gui {
+class AtlasLabel;
+}
 
 class IoService;
+class IconAtlas;
+class IconFetcher;
+class IconLoader;
+class RuntimeInfoCoalescer;
+class ThroughputEstimator;
+class WorkerPool;
+namespace events {
+class EventQueue;
+}
 class ChatWindow;
 class ProgramsWindow;
 
@@ -52,8 +73,9 @@ class Player : public fastoplayer::ISimplePlayer {
   typedef fastoplayer::ISimplePlayer base_class;
   enum { footer_height = 60, keypad_height = 30, keypad_width = 60, min_key_pad_size = 0, max_keypad_size = 999 };
   Player(const std::string& app_directory_absolute_path,  // for runtime data (cache)
-         const common::net::HostAndPort& server,
+         const std::vector<common::net::HostAndPort>& servers,
          const commands_info::AuthInfo& ainf,
+         const inner::ConnectionOptions& connection_options,
          const fastoplayer::PlayerOptions& options,
          const fastoplayer::media::AppOptions& opt,
          const fastoplayer::media::ComplexOptions& copt);
@@ -77,11 +99,18 @@ class Player : public fastoplayer::ISimplePlayer {
   virtual void HandleClientDisconnectedEvent(events::ClientDisconnectedEvent* event);
   virtual void HandleClientAuthorizedEvent(events::ClientAuthorizedEvent* event);
   virtual void HandleClientUnAuthorizedEvent(events::ClientUnAuthorizedEvent* event);
+  virtual void HandleClientHandshakeEvent(events::ClientHandshakeEvent* event);
   virtual void HandleClientConfigChangeEvent(events::ClientConfigChangeEvent* event);
   virtual void HandleReceiveChannelsEvent(events::ReceiveChannelsEvent* event);
   virtual void HandleReceiveRuntimeChannelEvent(events::ReceiveRuntimeChannelEvent* event);
+  virtual void HandleReceiveRuntimeChannelsEvent(events::ReceiveRuntimeChannelsEvent* event);
+  virtual void HandleRuntimeChannelsUpdatedEvent(events::RuntimeChannelsUpdatedEvent* event);
+  virtual void HandleEventsPendingEvent(events::EventsPendingEvent* event);
   virtual void HandleNotificationTextEvent(events::NotificationTextEvent* event);
   virtual void HandleNotificationShutdownEvent(events::NotificationShutdownEvent *event);
+  virtual void HandleIconDecodedEvent(events::IconDecodedEvent* event);
+  virtual void HandleChannelIconDownloadedEvent(events::ChannelIconDownloadedEvent* event);
+  virtual void HandleBandwidthEstimationEvent(events::BandwidthEstimationEvent* event);
 
   void HandleKeyPressEvent(fastoplayer::gui::events::KeyPressEvent* event) override;
   void HandleLircPressEvent(fastoplayer::gui::events::LircPressEvent* event) override;
@@ -101,7 +130,21 @@ class Player : public fastoplayer::ISimplePlayer {
   void OnWindowCreated(SDL_Window* window, SDL_Renderer* render) override;
 
  private:
+  void ApplyChannels(const events::ChannelsMixInfo& chan);
+  void AddToPlaylist(const PlaylistEntry& entry);
+  bool FindStreamPos(const stream_id_t& sid, size_t* pos) const;
   void LoadChannelIcon(const PlaylistEntry& entry);
+  void ApplyRuntimeChannelInfo(const commands_info::RuntimeChannelInfo& inf);
+  std::vector<stream_id_t> GetRuntimeInfoStreams();
+  void RequestVisibleRuntimeInfo();
+  void UpdateRuntimeSubscription();
+  void DrainEvents();
+  void SampleThroughput(fastoplayer::media::msec_t cur_time);
+  size_t SelectVariant(const stream_id_t& sid, size_t variants_count);
+  void UpdateVariant(fastoplayer::media::msec_t cur_time);
+  bool SwitchVariant(size_t variant, size_t playing);
+  void UpdatePreopenedVariant(fastoplayer::media::msec_t cur_time);
+  void DropPreopenedVariant();
 
   typedef fastotv::commands_info::NotificationTextInfo::MessageType admin_message_type_t;
   void SetVisiblePlaylist(bool visible);
@@ -116,10 +159,25 @@ class Player : public fastoplayer::ISimplePlayer {
   void ResetKeyPad();
   SDL_Rect GetKeyPadRect() const;
 
+  enum OverlayWidget {
+    FOOTER_OVERLAY = 0,
+    KEYPAD_OVERLAY,
+    PROGRAMS_OVERLAY,
+    WATCHERS_OVERLAY,
+    BANDWIDTH_OVERLAY,
+    ADMIN_OVERLAY,
+    OVERLAY_WIDGETS_COUNT
+  };
+  void InvalidateOverlay(OverlayWidget widget);
+  void TrackOverlayPointer();
+  bool IsPointOverProgramsList(const SDL_Point& point) const;
+  void DrawOverlays();
+
   void DrawFooter();
   void DrawKeyPad();
   void DrawProgramsList();
   void DrawWatchers();
+  void DrawBandwidth();
   void DrawAdminMessage();
 
   void StartShowFooter();
@@ -129,6 +187,7 @@ class Player : public fastoplayer::ISimplePlayer {
   SDL_Rect GetAdminRect() const;
 
   SDL_Rect GetWatcherRect() const;
+  SDL_Rect GetBandwidthRect() const;
 
   void ToggleShowProgramsList();
   SDL_Rect GetProgramsListRect() const;
@@ -147,6 +206,7 @@ class Player : public fastoplayer::ISimplePlayer {
   fastoplayer::media::VideoState* CreateNextStream();
   fastoplayer::media::VideoState* CreatePrevStream();
   fastoplayer::media::VideoState* CreateStreamPos(size_t pos);
+  fastoplayer::media::AppOptions GetChannelStreamOptions(const commands_info::ChannelInfo& url);
 
   size_t GenerateNextPosition() const;
   size_t GeneratePrevPosition() const;
@@ -163,15 +223,50 @@ class Player : public fastoplayer::ISimplePlayer {
   fastoplayer::gui::Button* show_playlist_button_;
   fastoplayer::gui::Button* hide_playlist_button_;
 
+  RuntimeInfoCoalescer* runtime_updates_;
+  events::EventQueue* events_;  // hot events from the network loop and the workers
+  std::vector<stream_id_t> runtime_subscribed_streams_;
   IoService* controller_;
+  WorkerPool* workers_;  // blocking work, never the network loop
 
   size_t current_stream_pos_;
   std::vector<PlaylistEntry> play_list_;
-
-  fastoplayer::gui::IconLabel* description_label_;
+  std::map<stream_id_t, size_t> stream_index_;
+  IconAtlas* channel_icons_;
+  IconLoader* icon_loader_;
+  IconFetcher* icon_fetcher_;
+  fastoplayer::media::msec_t runtime_info_last_requested_;
+
+  fastoplayer::media::VideoState* measured_stream_;  // owned by the base class, null when not playing
+  stream_id_t measured_sid_;
+  ThroughputEstimator* throughput_;
+  uint64_t received_bytes_;  // read by the playing and the pre-opened stream, for the throughput estimate
+  uint64_t demuxed_bytes_;   // read by the playing stream, variant bitrates are learned from it
+  fastoplayer::media::msec_t throughput_last_sampled_;
+  fastoplayer::media::msec_t bandwidth_last_published_;
+  bandwidth_t bandwidth_estimate_;  // bytes per second, zero until measured
+  uint64_t last_throughput_;        // of any channel, the variant of the next one is picked from it
+  std::map<stream_id_t, VariantSelector> variant_selectors_;  // learned bitrates outlive a tune
+  fastoplayer::media::msec_t variants_last_updated_;
+  fastoplayer::media::VideoState* preopened_stream_;  // next variant of the playing channel, video only
+  common::uri::GURL preopened_uri_;
+  fastoplayer::media::AppOptions preopened_options_;  // the variant takes over with them
+  size_t preopened_variant_;
+  size_t replaced_variant_;
+  fastoplayer::media::msec_t preopened_at_;
+
+  draw::GlyphAtlas* text_atlas_;
+  draw::OverlayLayer* overlay_layer_;
+  uint64_t overlay_revisions_[OVERLAY_WIDGETS_COUNT];
+  SDL_Point overlay_pointer_;
+  Uint32 overlay_pointer_buttons_;
+  uint64_t runtime_info_revision_;  // of the current channel
+
+  gui::AtlasLabel* description_label_;
+  stream_id_t footer_icon_id_;
   fastoplayer::media::msec_t footer_last_shown_;
 
-  fastoplayer::gui::IconLabel* admin_label_;
+  gui::AtlasLabel* admin_label_;
   admin_message_type_t admin_label_type_;
   fastoplayer::media::msec_t admin_last_shown_;
   fastoplayer::media::msec_t admin_show_time_;
@@ -181,7 +276,7 @@ class Player : public fastoplayer::ISimplePlayer {
 
   const std::string app_directory_absolute_path_;
 
-  fastoplayer::gui::Label* keypad_label_;
+  gui::AtlasLabel* keypad_label_;
   fastoplayer::media::msec_t keypad_last_shown_;
 
   ProgramsWindow* programs_window_;
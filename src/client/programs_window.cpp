@@ -39,7 +39,8 @@ ProgramsWindow::ProgramsWindow(const SDL_Color& back_ground_color)
       text_color_(),
       proxy_clicked_cb_(),
       origin_(nullptr),
-      filtered_origin_() {
+      filtered_origin_(),
+      revision_(0) {
   SetTransparent(true);
 
   // playlist window
@@ -56,6 +57,7 @@ ProgramsWindow::ProgramsWindow(const SDL_Color& back_ground_color)
   text_input_box_->SetEnabled(true);
   text_input_box_->SetPlaceHolder(SEARCH_PLACEHOLDER);
   auto search_text_changed_cb = [this](const std::string& text) {
+    revision_++;
     filtered_origin_.clear();
     if (!origin_) {
       return;
@@ -103,45 +105,75 @@ bool ProgramsWindow::IsActived() const {
 }
 
 void ProgramsWindow::SetPlaylist(const PlaylistWindow::playlist_t* pl) {
+  revision_++;
   origin_ = pl;
   text_input_box_->ClearText();
 }
 
 void ProgramsWindow::SetTextColor(const SDL_Color& color) {
+  revision_++;
   plailist_window_->SetTextColor(color);
   text_color_ = color;
 }
 
 void ProgramsWindow::SetSelection(PlaylistWindow::Selection sel) {
+  revision_++;
   plailist_window_->SetSelection(sel);
 }
 
 void ProgramsWindow::SetFont(TTF_Font* font) {
+  revision_++;
   plailist_window_->SetFont(font);
   text_input_box_->SetFont(font);
   font_ = font;
 }
 
+void ProgramsWindow::SetTextAtlas(draw::GlyphAtlas* atlas) {
+  revision_++;
+  plailist_window_->SetTextAtlas(atlas);
+}
+
+void ProgramsWindow::SetIconAtlas(IconAtlas* icons) {
+  revision_++;
+  plailist_window_->SetIconAtlas(icons);
+}
+
 void ProgramsWindow::SetRowHeight(int row_height) {
+  revision_++;
   plailist_window_->SetRowHeight(row_height);
 }
 
 void ProgramsWindow::SetSelectionColor(const SDL_Color& sel) {
+  revision_++;
   plailist_window_->SetSelectionColor(sel);
 }
 
 void ProgramsWindow::SetDrawType(fastoplayer::gui::FontWindow::DrawType dt) {
+  revision_++;
   plailist_window_->SetDrawType(dt);
 }
 
 void ProgramsWindow::SetCurrentPositionSelectionColor(const SDL_Color& sel) {
+  revision_++;
   plailist_window_->SetActiveRowColor(sel);
 }
 
 void ProgramsWindow::SetCurrentPositionInPlaylist(size_t pos) {
+  revision_++;
   plailist_window_->SetActiveRow(pos);
 }
 
+uint64_t ProgramsWindow::GetRevision() const {
+  return revision_;
+}
+
+std::vector<stream_id_t> ProgramsWindow::GetVisibleStreams() const {
+  if (!IsVisible()) {
+    return std::vector<stream_id_t>();
+  }
+  return plailist_window_->GetVisibleStreams();
+}
+
 void ProgramsWindow::SetMouseClickedRowCallback(PlaylistWindow::mouse_clicked_row_callback_t cb) {
   proxy_clicked_cb_ = cb;
 }
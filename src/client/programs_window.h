@@ -18,6 +18,10 @@
 
 #pragma once
 
+#include <stdint.h>
+
+#include <vector>
+
 #include <player/gui/widgets/window.h>
 
 #include "client/live_stream/playlist_window.h"
@@ -31,6 +35,10 @@ class LineEdit;
 
 namespace fastotv {
 namespace client {
+namespace draw {
+class GlyphAtlas;
+}
+class IconAtlas;
 
 class ProgramsWindow : public fastoplayer::gui::Window {
  public:
@@ -52,6 +60,10 @@ class ProgramsWindow : public fastoplayer::gui::Window {
 
   void SetFont(TTF_Font* font);
 
+  void SetTextAtlas(draw::GlyphAtlas* atlas);
+
+  void SetIconAtlas(IconAtlas* icons);
+
   void SetRowHeight(int row_height);
 
   void SetSelectionColor(const SDL_Color& sel);
@@ -62,6 +74,11 @@ class ProgramsWindow : public fastoplayer::gui::Window {
 
   void SetCurrentPositionInPlaylist(size_t pos);
 
+  // changes with the rows or the search text, pointer hover is tracked by the owner
+  uint64_t GetRevision() const;
+
+  std::vector<stream_id_t> GetVisibleStreams() const;
+
   void Draw(SDL_Renderer* render) override;
 
  private:
@@ -77,6 +94,7 @@ class ProgramsWindow : public fastoplayer::gui::Window {
   PlaylistWindow::mouse_clicked_row_callback_t proxy_clicked_cb_;
   const PlaylistWindow::playlist_t* origin_;
   PlaylistWindow::playlist_t filtered_origin_;
+  uint64_t revision_;
 };
 
 }  // namespace client
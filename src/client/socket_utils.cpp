@@ -0,0 +1,111 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "client/socket_utils.h"
+
+#include <errno.h>
+
+#if defined(OS_WIN)
+#include <winsock2.h>
+#define poll WSAPoll
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+
+namespace fastotv {
+namespace client {
+
+int GetLastSocketError() {
+#if defined(OS_WIN)
+  return WSAGetLastError();
+#else
+  return errno;
+#endif
+}
+
+bool IsSocketWouldBlock(int err) {
+#if defined(OS_WIN)
+  return err == WSAEWOULDBLOCK;
+#else
+  return err == EAGAIN || err == EWOULDBLOCK;
+#endif
+}
+
+bool IsSocketConnectInProgress(int err) {
+#if defined(OS_WIN)
+  return err == WSAEWOULDBLOCK;
+#else
+  return err == EINPROGRESS;
+#endif
+}
+
+void CloseSocket(common::net::socket_descr_t fd) {
+#if defined(OS_WIN)
+  closesocket(fd);
+#else
+  ::close(fd);
+#endif
+}
+
+bool SetSocketBlocking(common::net::socket_descr_t fd, bool blocking) {
+#if defined(OS_WIN)
+  u_long mode = blocking ? 0 : 1;
+  return ioctlsocket(fd, FIONBIO, &mode) == 0;
+#else
+  const int flags = fcntl(fd, F_GETFL, 0);
+  if (flags == -1) {
+    return false;
+  }
+  return fcntl(fd, F_SETFL, blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK) != -1;
+#endif
+}
+
+common::ErrnoError WaitSocket(common::net::socket_descr_t fd, bool write, int timeout_msec) {
+  const common::time64_t deadline = GetSteadyMsec() + timeout_msec;
+  while (true) {
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = write ? POLLOUT : POLLIN;
+    pfd.revents = 0;
+    const int res = poll(&pfd, 1, static_cast<int>(std::max<common::time64_t>(deadline - GetSteadyMsec(), 0)));
+    if (res > 0) {
+      return common::ErrnoError();
+    }
+
+    if (res < 0 && GetLastSocketError() != EINTR) {
+      return common::make_errno_error(GetLastSocketError());
+    }
+
+    if (res == 0 && GetSteadyMsec() >= deadline) {
+      return common::make_errno_error(ETIMEDOUT);
+    }
+  }
+}
+
+common::time64_t GetSteadyMsec() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace client
+}  // namespace fastotv
@@ -0,0 +1,41 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <common/error.h>
+#include <common/net/types.h>  // for socket_descr_t
+#include <common/types.h>
+
+namespace fastotv {
+namespace client {
+
+// for the connections that drive their sockets themselves
+int GetLastSocketError();
+bool IsSocketWouldBlock(int err);
+bool IsSocketConnectInProgress(int err);
+void CloseSocket(common::net::socket_descr_t fd);
+bool SetSocketBlocking(common::net::socket_descr_t fd, bool blocking);
+// ETIMEDOUT when the socket isn't readable, or writable, within timeout_msec
+common::ErrnoError WaitSocket(common::net::socket_descr_t fd, bool write, int timeout_msec) WARN_UNUSED_RESULT;
+
+// monotonic, wall clock jumps must not expire timeouts
+common::time64_t GetSteadyMsec();
+
+}  // namespace client
+}  // namespace fastotv
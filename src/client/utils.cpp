@@ -18,6 +18,8 @@
 
 #include "client/utils.h"
 
+#include <stdio.h>  // for rename
+
 #include <string>
 
 extern "C" {
@@ -26,6 +28,9 @@ extern "C" {
 
 #include <player/media/types.h>
 
+#define DOWNLOAD_PART_EXTENSION ".part"
+#define DOWNLOAD_CHUNK_SIZE (16 * 1024)  // the only buffer, whatever the payload size
+
 namespace fastotv {
 namespace client {
 namespace {
@@ -46,8 +51,8 @@ class CallbackHolder {
 };
 }  // namespace
 
-bool DownloadFileToBuffer(const common::uri::GURL& uri, common::char_buffer_t* buff, quit_callback_t cb) {
-  if (!uri.is_valid() || !buff || !cb) {
+bool DownloadFileToPath(const common::uri::GURL& uri, const std::string& path, size_t max_size, quit_callback_t cb) {
+  if (!uri.is_valid() || path.empty() || !cb) {
     return false;
   }
 
@@ -56,33 +61,59 @@ bool DownloadFileToBuffer(const common::uri::GURL& uri, common::char_buffer_t* b
     return false;
   }
 
-  AVFormatContext* ic = avformat_alloc_context();
-  if (!ic) {
+  CallbackHolder holder(cb);
+  AVIOInterruptCB interrupt_cb;
+  interrupt_cb.callback = CallbackHolder::download_interrupt_callback;
+  interrupt_cb.opaque = &holder;
+  AVIOContext* io = nullptr;
+  if (avio_open2(&io, url_str.c_str(), AVIO_FLAG_READ, &interrupt_cb, nullptr) < 0) {
     return false;
   }
 
-  const char* in_filename = url_str.c_str();
-  CallbackHolder holder(cb);
-  ic->interrupt_callback.callback = CallbackHolder::download_interrupt_callback;
-  ic->interrupt_callback.opaque = &holder;
-  int open_result = avformat_open_input(&ic, in_filename, nullptr, nullptr);
-  if (open_result < 0) {
-    avformat_free_context(ic);
-    ic = nullptr;
+  const std::string part_path = path + DOWNLOAD_PART_EXTENSION;
+  FILE* part_file = fopen(part_path.c_str(), "wb");
+  if (!part_file) {
+    avio_closep(&io);
     return false;
   }
-  AVPacket pkt;
-  int ret = av_read_frame(ic, &pkt);
-  if (ret < 0) {
-    avformat_free_context(ic);
-    ic = nullptr;
+
+  unsigned char chunk[DOWNLOAD_CHUNK_SIZE];
+  size_t total = 0;
+  bool is_completed = false;
+  while (true) {
+    const int res = avio_read(io, chunk, sizeof(chunk));
+    if (res == AVERROR_EOF || res == 0) {
+      is_completed = total > 0;
+      break;
+    }
+    if (res < 0) {
+      break;
+    }
+
+    total += res;
+    if (total > max_size || fwrite(chunk, 1, res, part_file) != static_cast<size_t>(res)) {
+      break;
+    }
+  }
+  avio_closep(&io);
+
+  if (fclose(part_file) != 0) {
+    is_completed = false;
+  }
+  if (!is_completed) {
+    remove(part_path.c_str());
     return false;
   }
 
-  *buff = common::char_buffer_t(pkt.data, pkt.data + pkt.size);
-  av_packet_unref(&pkt);
-  avformat_free_context(ic);
-  ic = nullptr;
+  if (rename(part_path.c_str(), path.c_str()) == 0) {
+    return true;
+  }
+
+  // windows doesn't rename over an existing file
+  if (remove(path.c_str()) != 0 || rename(part_path.c_str(), path.c_str()) != 0) {
+    remove(part_path.c_str());
+    return false;
+  }
   return true;
 }
 
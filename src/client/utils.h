@@ -18,7 +18,10 @@
 
 #pragma once
 
+#include <stddef.h>
+
 #include <functional>
+#include <string>
 
 #include <common/types.h>
 #include <common/uri/gurl.h>
@@ -27,7 +30,9 @@ namespace fastotv {
 namespace client {
 
 typedef std::function<bool()> quit_callback_t;
-bool DownloadFileToBuffer(const common::uri::GURL& uri, common::char_buffer_t* buff, quit_callback_t cb);
+// streams uri into path + ".part" next to path and renames it over path once complete,
+// nothing is left behind when interrupted by cb, failed or larger than max_size bytes
+bool DownloadFileToPath(const common::uri::GURL& uri, const std::string& path, size_t max_size, quit_callback_t cb);
 
 }  // namespace client
 }  // namespace fastotv
@@ -28,11 +28,13 @@
 #include <player/draw/draw.h>
 #include <player/draw/surface_saver.h>
 
+#include "client/draw/glyph_atlas.h"
+
 namespace fastotv {
 namespace client {
 
 VodsWindow::VodsWindow(const SDL_Color& back_ground_color, Window* parent)
-    : base_class(back_ground_color, parent), play_list_(nullptr) {}
+    : base_class(back_ground_color, parent), play_list_(nullptr), atlas_(nullptr) {}
 
 VodsWindow::~VodsWindow() {}
 
@@ -44,6 +46,10 @@ const VodsWindow::playlist_t* VodsWindow::GetPlaylist() const {
   return play_list_;
 }
 
+void VodsWindow::SetTextAtlas(draw::GlyphAtlas* atlas) {
+  atlas_ = atlas;
+}
+
 size_t VodsWindow::GetRowCount() const {
   if (!play_list_) {
     return 0;
@@ -61,7 +67,7 @@ void VodsWindow::DrawRow(SDL_Renderer* render, size_t pos, bool active, bool hov
 
   SDL_Rect number_rect = {row_rect.x, row_rect.y, channel_number_width, row_rect.h};
   std::string number_str = common::ConvertToString(pos + 1);
-  DrawText(render, number_str, number_rect, VodsWindow::CENTER_TEXT);
+  DrawRowText(render, number_str, number_rect, VodsWindow::CENTER_TEXT);
 
   VodDescription descr = play_list_->operator[](pos).GetChannelDescription();
   channel_icon_t icon = descr.icon;
@@ -76,17 +82,32 @@ void VodsWindow::DrawRow(SDL_Renderer* render, size_t pos, bool active, bool hov
   shift += row_rect.h + space_width;  // in any case shift should be
 
   int text_width = row_rect.w - shift;
-  std::string title_line =
-      fastoplayer::draw::DotText(common::MemSPrintf("Title: %s", descr.title), GetFont(), text_width);
-  std::string description_line =
-      fastoplayer::draw::DotText(common::MemSPrintf("Description: %s", descr.description), GetFont(), text_width);
+  std::string title_line = DotRowText(common::MemSPrintf("Title: %s", descr.title), text_width);
+  std::string description_line = DotRowText(common::MemSPrintf("Description: %s", descr.description), text_width);
 
   std::string line_text = common::MemSPrintf(
       "%s\n"
       "%s",
       title_line, description_line);
   SDL_Rect text_rect = {row_rect.x + shift, row_rect.y, text_width, row_rect.h};
-  DrawText(render, line_text, text_rect, GetDrawType());
+  DrawRowText(render, line_text, text_rect, GetDrawType());
+}
+
+void VodsWindow::DrawRowText(SDL_Renderer* render, const std::string& text, const SDL_Rect& rect, DrawType dt) {
+  if (atlas_) {
+    atlas_->DrawText(render, text, rect, GetTextColor(), dt);
+    return;
+  }
+
+  DrawText(render, text, rect, dt);
+}
+
+std::string VodsWindow::DotRowText(const std::string& text, int width) {
+  if (atlas_) {
+    return atlas_->DotText(text, width);
+  }
+
+  return fastoplayer::draw::DotText(text, GetFont(), width);
 }
 
 }  // namespace client
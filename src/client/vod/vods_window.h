@@ -27,6 +27,9 @@
 
 namespace fastotv {
 namespace client {
+namespace draw {
+class GlyphAtlas;
+}
 
 class VodsWindow : public fastoplayer::gui::IListBox {
  public:
@@ -39,13 +42,19 @@ class VodsWindow : public fastoplayer::gui::IListBox {
   void SetPlaylist(const playlist_t* pl);
   const playlist_t* GetPlaylist() const;
 
+  void SetTextAtlas(draw::GlyphAtlas* atlas);
+
   size_t GetRowCount() const override;
 
  protected:
   void DrawRow(SDL_Renderer* render, size_t pos, bool active, bool hover, const SDL_Rect& row_rect) override;
 
  private:
+  void DrawRowText(SDL_Renderer* render, const std::string& text, const SDL_Rect& rect, DrawType dt);
+  std::string DotRowText(const std::string& text, int width);
+
   const playlist_t* play_list_;  // pointer
+  draw::GlyphAtlas* atlas_;
 };
 
 }  // namespace client
@@ -122,6 +122,10 @@ void VodsListWindow::SetFont(TTF_Font* font) {
   font_ = font;
 }
 
+void VodsListWindow::SetTextAtlas(draw::GlyphAtlas* atlas) {
+  plailist_window_->SetTextAtlas(atlas);
+}
+
 void VodsListWindow::SetRowHeight(int row_height) {
   plailist_window_->SetRowHeight(row_height);
 }
@@ -31,6 +31,9 @@ class LineEdit;
 
 namespace fastotv {
 namespace client {
+namespace draw {
+class GlyphAtlas;
+}
 
 class VodsListWindow : public fastoplayer::gui::Window {
  public:
@@ -52,6 +55,8 @@ class VodsListWindow : public fastoplayer::gui::Window {
 
   void SetFont(TTF_Font* font);
 
+  void SetTextAtlas(draw::GlyphAtlas* atlas);
+
   void SetRowHeight(int row_height);
 
   void SetSelectionColor(const SDL_Color& sel);
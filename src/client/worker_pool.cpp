@@ -0,0 +1,248 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "client/worker_pool.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include <common/threads/thread_manager.h>  // for THREAD_MANAGER
+
+#include "client/socket_utils.h"
+
+#define QUEUEING_WAIT_MSEC 1  // for a task counted but not queued yet
+
+namespace fastotv {
+namespace client {
+
+WorkerPool::Metrics::Metrics()
+    : queue_depth(0),
+      max_queue_depth(0),
+      completed(0),
+      rejected(0),
+      stolen(0),
+      avg_wait_msec(0),
+      max_wait_msec(0),
+      avg_run_msec(0),
+      max_run_msec(0) {}
+
+WorkerPool::WorkerPool(size_t workers_count, size_t max_queued)
+    : workers_count_(std::max<size_t>(workers_count, 1)),
+      max_queued_(max_queued),
+      queues_(),
+      pending_(0),
+      stop_(true),
+      next_queue_(0),
+      next_worker_(0),
+      sleep_mutex_(),
+      sleep_cond_(),
+      sleeping_(0),
+      metrics_mutex_(),
+      metrics_(),
+      total_wait_msec_(0),
+      total_run_msec_(0),
+      workers_() {
+  for (size_t i = 0; i < workers_count_; ++i) {
+    queues_.push_back(std::unique_ptr<Queue>(new Queue));
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  Stop();
+}
+
+void WorkerPool::Start() {
+  if (!stop_.exchange(false)) {
+    return;
+  }
+
+  pending_ = 0;
+  next_worker_ = 0;
+  for (size_t i = 0; i < workers_count_; ++i) {
+    auto worker = THREAD_MANAGER()->CreateThread(&WorkerPool::Work, this);
+    ignore_result(worker->Start());
+    workers_.push_back(worker);
+  }
+}
+
+void WorkerPool::Stop() {
+  stop_ = true;
+  WakeUp(true);
+
+  for (auto worker : workers_) {
+    worker->JoinAndGet();
+  }
+  workers_.clear();
+
+  for (auto& queue : queues_) {
+    std::unique_lock<std::mutex> queue_lock(queue->mutex);
+    pending_ -= queue->entries.size();
+    queue->entries.clear();
+  }
+}
+
+bool WorkerPool::IsRunning() const {
+  return !stop_;
+}
+
+bool WorkerPool::Post(task_t task) {
+  size_t depth = 0;
+  if (!stop_) {
+    depth = ++pending_;
+    if (depth > max_queued_) {
+      pending_--;
+      depth = 0;
+    }
+  }
+  if (!depth) {
+    std::unique_lock<std::mutex> metrics_lock(metrics_mutex_);
+    metrics_.rejected++;
+    return false;
+  }
+
+  // Stop sets stop_ before it drops the queues under their locks, so a task either gets in before its queue is
+  // dropped and is dropped with it, or sees stop_ here and takes its count back
+  Queue* queue = queues_[next_queue_++ % queues_.size()].get();
+  {
+    std::unique_lock<std::mutex> queue_lock(queue->mutex);
+    if (stop_) {
+      pending_--;
+      queue_lock.unlock();
+      std::unique_lock<std::mutex> metrics_lock(metrics_mutex_);
+      metrics_.rejected++;
+      return false;
+    }
+    queue->entries.push_back({task, GetSteadyMsec()});
+  }
+  WakeUp(false);
+
+  std::unique_lock<std::mutex> metrics_lock(metrics_mutex_);
+  metrics_.max_queue_depth = std::max(metrics_.max_queue_depth, depth);
+  return true;
+}
+
+WorkerPool::Metrics WorkerPool::GetMetrics() const {
+  Metrics result;
+  {
+    std::unique_lock<std::mutex> lock(metrics_mutex_);
+    result = metrics_;
+    if (metrics_.completed) {
+      result.avg_wait_msec = total_wait_msec_ / metrics_.completed;
+      result.avg_run_msec = total_run_msec_ / metrics_.completed;
+    }
+  }
+
+  result.queue_depth = pending_;
+  return result;
+}
+
+int WorkerPool::Work() {
+  const size_t worker = next_worker_++ % queues_.size();
+  while (!stop_) {
+    Entry entry;
+    bool stolen = false;
+    if (Pop(worker, &entry, &stolen)) {
+      const common::time64_t started_msec = GetSteadyMsec();
+      entry.task();
+      Account(entry, started_msec, GetSteadyMsec(), stolen);
+      continue;
+    }
+
+    Sleep();
+  }
+
+  return EXIT_SUCCESS;
+}
+
+bool WorkerPool::Pop(size_t worker, Entry* entry, bool* stolen) {
+  for (size_t i = 0; i < queues_.size(); ++i) {
+    Queue* queue = queues_[(worker + i) % queues_.size()].get();
+    {
+      std::unique_lock<std::mutex> queue_lock(queue->mutex);
+      if (queue->entries.empty()) {
+        continue;
+      }
+
+      if (i == 0) {
+        *entry = queue->entries.front();
+        queue->entries.pop_front();
+      } else {
+        *entry = queue->entries.back();
+        queue->entries.pop_back();
+      }
+    }
+
+    *stolen = i != 0;
+    pending_--;
+    return true;
+  }
+  return false;
+}
+
+void WorkerPool::Sleep() {
+  // sleeping_ goes up before pending_ is checked and a poster reads it after counting its task, so either the
+  // worker sees the task or the poster sees the sleeper and its notify waits for the worker to be in wait()
+  sleeping_++;
+  {
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    if (!stop_ && pending_) {  // counted, being queued right now, its poster wakes a sleeper once it is in
+      sleep_cond_.wait_for(lock, std::chrono::milliseconds(QUEUEING_WAIT_MSEC));
+    }
+    while (!stop_ && pending_ == 0) {
+      sleep_cond_.wait(lock);
+    }
+  }
+  sleeping_--;
+}
+
+void WorkerPool::WakeUp(bool all) {
+  if (!all && sleeping_ == 0) {
+    return;
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+  }
+  if (all) {
+    sleep_cond_.notify_all();
+  } else {
+    sleep_cond_.notify_one();
+  }
+}
+
+void WorkerPool::Account(const Entry& entry,
+                         common::time64_t started_msec,
+                         common::time64_t finished_msec,
+                         bool stolen) {
+  const common::time64_t wait_msec = started_msec - entry.queued_msec;
+  const common::time64_t run_msec = finished_msec - started_msec;
+  std::unique_lock<std::mutex> lock(metrics_mutex_);
+  metrics_.completed++;
+  if (stolen) {
+    metrics_.stolen++;
+  }
+  metrics_.max_wait_msec = std::max(metrics_.max_wait_msec, wait_msec);
+  metrics_.max_run_msec = std::max(metrics_.max_run_msec, run_msec);
+  total_wait_msec_ += wait_msec;
+  total_run_msec_ += run_msec;
+}
+
+}  // namespace client
+}  // namespace fastotv
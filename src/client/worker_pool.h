@@ -0,0 +1,115 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <common/types.h>  // for time64_t
+
+namespace common {
+namespace threads {
+template <typename RT>
+class Thread;
+}
+}  // namespace common
+
+namespace fastotv {
+namespace client {
+
+// Bounded pool for blocking work (downloads, decoding, cache writes) kept away from the ui and network loops.
+// Every worker owns a queue and takes its oldest task first, an idle worker steals the newest task of a busy one.
+// Posting and taking a task only lock the queue concerned, workers sleep when all queues are empty.
+// Posting fails instead of blocking when max_queued tasks are waiting.
+class WorkerPool {
+ public:
+  typedef std::function<void()> task_t;
+
+  struct Metrics {
+    Metrics();
+
+    size_t queue_depth;
+    size_t max_queue_depth;
+    uint64_t completed;
+    uint64_t rejected;
+    uint64_t stolen;
+    common::time64_t avg_wait_msec;  // queued until started
+    common::time64_t max_wait_msec;
+    common::time64_t avg_run_msec;
+    common::time64_t max_run_msec;
+  };
+
+  WorkerPool(size_t workers_count, size_t max_queued);
+  ~WorkerPool();
+
+  void Start();
+  void Stop();  // waits for running tasks, queued ones are dropped
+  bool IsRunning() const;
+
+  bool Post(task_t task);  // any thread, false if stopped or full
+  Metrics GetMetrics() const;
+
+ private:
+  struct Entry {
+    task_t task;
+    common::time64_t queued_msec;
+  };
+
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Entry> entries;
+  };
+
+  int Work();
+  bool Pop(size_t worker, Entry* entry, bool* stolen);
+  void Sleep();
+  void WakeUp(bool all);
+  void Account(const Entry& entry, common::time64_t started_msec, common::time64_t finished_msec, bool stolen);
+
+  const size_t workers_count_;
+  const size_t max_queued_;
+  std::vector<std::unique_ptr<Queue>> queues_;
+
+  std::atomic<size_t> pending_;  // counted before the task is queued, so posting never goes over max_queued_
+  std::atomic<bool> stop_;
+  std::atomic<size_t> next_queue_;
+  std::atomic<size_t> next_worker_;
+
+  std::mutex sleep_mutex_;  // workers sleep on it when pending_ is zero
+  std::condition_variable sleep_cond_;
+  std::atomic<size_t> sleeping_;
+
+  mutable std::mutex metrics_mutex_;
+  Metrics metrics_;
+  common::time64_t total_wait_msec_;
+  common::time64_t total_run_msec_;
+
+  std::vector<std::shared_ptr<common::threads::Thread<int>>> workers_;
+};
+
+}  // namespace client
+}  // namespace fastotv
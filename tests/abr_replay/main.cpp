@@ -0,0 +1,78 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <common/convert2string.h>
+
+#include "client/live_stream/variant_selector.h"
+#include "tests/abr_replay/trace_replay.h"
+
+// Replays a recorded throughput trace against a local stream described by its variants:
+// abr_replay tests/abr_replay/traces/lte_commute.trace 6000 3000 1500 700
+// bitrates in kbit/s, best first like the epg urls of the channel
+
+namespace {
+
+void PrintResult(const std::string& name, const fastotv::abr_replay::ReplayResult& result) {
+  std::cout << name << ": average " << result.average_bitrate * 8 / 1000 << " kbit/s, stalls " << result.stalls
+            << " (" << result.stalled_msec << " msec), switches " << result.switches << " ("
+            << result.switching_msec << " msec), played";
+  for (size_t i = 0; i < result.played_per_variant.size(); ++i) {
+    std::cout << " " << result.played_per_variant[i];
+  }
+  std::cout << " msec" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    std::cout << "Usage: " << argv[0] << " <trace> <kbit/s>..." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  fastotv::abr_replay::trace_t trace;
+  common::Error err = fastotv::abr_replay::LoadTrace(argv[1], &trace);
+  if (err) {
+    std::cout << err->GetDescription() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  fastotv::abr_replay::LocalStream stream;
+  for (int i = 2; i < argc; ++i) {
+    const long kbits = strtol(argv[i], nullptr, 10);
+    if (kbits <= 0) {
+      std::cout << "Invalid bitrate: " << argv[i] << std::endl;
+      return EXIT_FAILURE;
+    }
+    stream.bitrates.push_back(kbits * 1000 / 8);
+  }
+
+  fastotv::abr_replay::TraceReplay replay(stream, trace);
+  fastotv::client::VariantSelector selector(stream.bitrates.size());
+  PrintResult("adaptive", replay.Run(&selector, 0));
+  for (size_t i = 0; i < stream.bitrates.size(); ++i) {
+    PrintResult("variant " + common::ConvertToString(i), replay.RunFixed(i));
+  }
+  return EXIT_SUCCESS;
+}
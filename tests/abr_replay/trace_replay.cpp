@@ -0,0 +1,235 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tests/abr_replay/trace_replay.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "client/live_stream/throughput_estimator.h"
+#include "client/live_stream/variant_selector.h"
+
+namespace fastotv {
+namespace abr_replay {
+
+LocalStream::LocalStream()
+    : bitrates(),
+      dropping_variants(0),
+      dropped_frames_per_sec(0),
+      max_buffer_msec(15000),
+      startup_buffer_msec(1000),
+      keyframe_interval_msec(2000) {}
+
+common::Error LoadTrace(const std::string& path, trace_t* trace) {
+  if (!trace) {
+    return common::make_error_inval();
+  }
+
+  std::ifstream file(path);
+  if (!file) {
+    return common::make_error("Can't open trace: " + path);
+  }
+
+  trace_t result;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+
+    std::istringstream fields(line);
+    TracePoint point;
+    uint64_t kbits = 0;
+    if (!(fields >> point.at_msec >> kbits) || (!result.empty() && point.at_msec <= result.back().at_msec)) {
+      return common::make_error("Invalid trace line: " + line);
+    }
+    point.throughput = kbits * 1000 / 8;
+    result.push_back(point);
+  }
+
+  if (result.size() < 2) {
+    return common::make_error("Trace too short: " + path);
+  }
+
+  *trace = result;
+  return common::Error();
+}
+
+TraceReplay::Queue::Queue() : buffer_msec(0), discard_msec(0) {}
+
+ReplayResult::ReplayResult()
+    : initial_variant(0),
+      switches(0),
+      preopen_timeouts(0),
+      stalls(0),
+      stalled_msec(0),
+      switching_msec(0),
+      played_msec(0),
+      average_bitrate(0),
+      played_per_variant() {}
+
+TraceReplay::TraceReplay(const LocalStream& stream, const trace_t& trace) : stream_(stream), trace_(trace) {}
+
+ReplayResult TraceReplay::Run(client::VariantSelector* selector, uint64_t initial_throughput) const {
+  const size_t variant = selector->SelectInitial(initial_throughput);
+  return Replay(selector, variant);
+}
+
+ReplayResult TraceReplay::RunFixed(size_t variant) const {
+  return Replay(nullptr, variant);
+}
+
+ReplayResult TraceReplay::Replay(client::VariantSelector* selector, size_t variant) const {
+  ReplayResult result;
+  result.initial_variant = variant;
+  result.played_per_variant.resize(stream_.bitrates.size(), 0);
+  if (trace_.empty()) {
+    return result;
+  }
+
+  client::ThroughputEstimator estimator;
+  const common::time64_t start = trace_.front().at_msec;
+  const common::time64_t end = trace_.back().at_msec;
+  if (selector) {
+    selector->Start(variant, start);
+  }
+
+  uint64_t received_bytes = 0;  // of the playing and the pre-opened stream, like the player adds them up
+  uint64_t demuxed_bytes = 0;   // of the playing stream
+  Queue playing_queue;
+  double played_on_dropping = 0;
+  bool playing = false;
+  bool switching = false;  // the wait is for a new variant, not a stall
+  bool preopened = false;
+  size_t preopened_variant = 0;
+  Queue preopened_queue;
+  common::time64_t preopened_at = 0;
+  double bitrate_msec_sum = 0;
+  size_t point = 0;
+  for (common::time64_t now = start; now < end; now += step_msec) {
+    const common::time64_t step_end = now + step_msec;
+    const uint64_t bitrate = stream_.bitrates[variant];
+    double link_bytes = static_cast<double>(GetThroughput(now, &point)) * step_msec / 1000;
+    double preopened_bytes = 0;
+    if (preopened) {  // both streams share the link, what one doesn't take is left for the other
+      double share_bytes = link_bytes / 2;
+      link_bytes -= share_bytes;
+      preopened_bytes = Read(stream_.bitrates[preopened_variant], &preopened_queue, &share_bytes);
+      link_bytes += share_bytes;
+    }
+    const double bytes = Read(bitrate, &playing_queue, &link_bytes);
+    if (preopened) {
+      preopened_bytes += Read(stream_.bitrates[preopened_variant], &preopened_queue, &link_bytes);
+    }
+    received_bytes += static_cast<uint64_t>(bytes + preopened_bytes);
+    demuxed_bytes += static_cast<uint64_t>(bytes);
+
+    if (playing) {
+      if (playing_queue.buffer_msec >= step_msec) {
+        playing_queue.buffer_msec -= step_msec;
+        result.played_msec += step_msec;
+        result.played_per_variant[variant] += step_msec;
+        bitrate_msec_sum += static_cast<double>(bitrate) * step_msec;
+        if (variant < stream_.dropping_variants) {
+          played_on_dropping += step_msec;
+        }
+      } else {
+        playing = false;
+        result.stalls++;
+      }
+    } else if (playing_queue.buffer_msec >= stream_.startup_buffer_msec) {
+      playing = true;
+      switching = false;
+    } else if (switching) {
+      result.switching_msec += step_msec;
+    } else if (result.played_msec) {
+      result.stalled_msec += step_msec;
+    }
+
+    estimator.AddSample(step_end, received_bytes);
+    if (preopened) {
+      // on its first keyframe the playing stream stops and the variant is opened with audio, starting on that
+      // keyframe, the probe goes
+      if (preopened_queue.discard_msec == 0 && preopened_queue.buffer_msec > 0) {
+        variant = preopened_variant;
+        playing_queue = Queue();
+        played_on_dropping = 0;
+        playing = false;
+        switching = true;
+        preopened = false;
+        result.switches++;
+        selector->Start(variant, step_end);
+      } else if (step_end - preopened_at >= preopen_timeout_msec) {  // given up, the old variant goes on
+        preopened = false;
+        result.preopen_timeouts++;
+        selector->Start(variant, step_end);
+      }
+      continue;
+    }
+
+    if (!selector || (step_end - start) % update_msec) {
+      continue;
+    }
+
+    client::VariantSelector::Conditions conditions;
+    conditions.now = step_end;
+    conditions.throughput = estimator.GetEstimate();
+    conditions.demuxed_bytes = demuxed_bytes;
+    conditions.queued_bytes = static_cast<uint64_t>(playing_queue.buffer_msec * bitrate / 1000);
+    conditions.dropped_frames = static_cast<size_t>(played_on_dropping * stream_.dropped_frames_per_sec / 1000);
+    const size_t next = selector->Update(conditions);
+    if (next != variant) {  // pre-opened at a random point of its keyframe interval, the old one plays meanwhile
+      preopened = true;
+      preopened_variant = next;
+      preopened_queue = Queue();
+      preopened_queue.discard_msec = stream_.keyframe_interval_msec - step_end % stream_.keyframe_interval_msec;
+      preopened_at = step_end;
+    }
+  }
+
+  if (result.played_msec) {
+    result.average_bitrate = static_cast<uint64_t>(bitrate_msec_sum / result.played_msec);
+  }
+  return result;
+}
+
+double TraceReplay::Read(uint64_t bitrate, Queue* queue, double* link_bytes) const {
+  if (queue->buffer_msec >= stream_.max_buffer_msec) {
+    return 0;
+  }
+
+  const double room_bytes = (stream_.max_buffer_msec - queue->buffer_msec + queue->discard_msec) * bitrate / 1000;
+  const double bytes = std::min(*link_bytes, room_bytes);
+  const double media_msec = bytes * 1000 / bitrate;
+  const double discarded = std::min(queue->discard_msec, media_msec);
+  queue->discard_msec -= discarded;
+  queue->buffer_msec += media_msec - discarded;
+  *link_bytes -= bytes;
+  return bytes;
+}
+
+uint64_t TraceReplay::GetThroughput(common::time64_t at_msec, size_t* point) const {
+  while (*point + 1 < trace_.size() && trace_[*point + 1].at_msec <= at_msec) {
+    (*point)++;
+  }
+  return trace_[*point].throughput;
+}
+
+}  // namespace abr_replay
+}  // namespace fastotv
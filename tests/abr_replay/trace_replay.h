@@ -0,0 +1,105 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <common/error.h>
+#include <common/types.h>  // for time64_t
+
+namespace fastotv {
+namespace client {
+class VariantSelector;
+}  // namespace client
+
+namespace abr_replay {
+
+// A live channel served from this box the way the player reads it: the read thread stops on full queues, a new
+// stream plays once startup_buffer_msec is queued and what it reads before the first keyframe is thrown away.
+// A new variant is pre-opened without audio next to the playing one, the two share the link until the probe decodes
+// its first keyframe, then the playing stream stops and the variant is opened for real starting on that keyframe.
+struct LocalStream {
+  LocalStream();
+
+  std::vector<uint64_t> bitrates;  // bytes per second, best first like the epg urls
+  size_t dropping_variants;        // that many best variants drop frames on the box
+  size_t dropped_frames_per_sec;
+  common::time64_t max_buffer_msec;
+  common::time64_t startup_buffer_msec;
+  common::time64_t keyframe_interval_msec;
+};
+
+struct TracePoint {
+  common::time64_t at_msec;
+  uint64_t throughput;  // bytes per second until the next point
+};
+typedef std::vector<TracePoint> trace_t;
+
+// recorded traces, one "<msec> <kbit/s>" line per point, the last one marks the end, '#' starts a comment
+common::Error LoadTrace(const std::string& path, trace_t* trace) WARN_UNUSED_RESULT;
+
+struct ReplayResult {
+  ReplayResult();
+
+  size_t initial_variant;
+  size_t switches;
+  size_t preopen_timeouts;           // no keyframe of the pre-opened variant in time, the old one went on
+  size_t stalls;                     // playback ran dry, switches not counted
+  common::time64_t stalled_msec;
+  common::time64_t switching_msec;   // a new variant took over but didn't play yet
+  common::time64_t played_msec;
+  uint64_t average_bitrate;          // of the played media
+  std::vector<common::time64_t> played_per_variant;
+};
+
+// Replays a trace against a local stream on simulated time, sampled like the player timer: the received bytes go
+// through the same throughput estimator and the variant selector sees the same conditions as in the player.
+// It models the streams, no media is decoded.
+class TraceReplay {
+ public:
+  enum { step_msec = 100, update_msec = 1000, preopen_timeout_msec = 10000 };
+
+  TraceReplay(const LocalStream& stream, const trace_t& trace);
+
+  // initial_throughput as measured on the channel played before
+  ReplayResult Run(client::VariantSelector* selector, uint64_t initial_throughput) const;
+  ReplayResult RunFixed(size_t variant) const;  // no adaptation, what the player did before
+
+ private:
+  struct Queue {
+    Queue();
+
+    double buffer_msec;
+    double discard_msec;  // read before the first keyframe
+  };
+
+  ReplayResult Replay(client::VariantSelector* selector, size_t variant) const;
+  double Read(uint64_t bitrate, Queue* queue, double* link_bytes) const;  // bytes taken from the link
+  uint64_t GetThroughput(common::time64_t at_msec, size_t* point) const;
+
+  const LocalStream stream_;
+  const trace_t trace_;
+};
+
+}  // namespace abr_replay
+}  // namespace fastotv
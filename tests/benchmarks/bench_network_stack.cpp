@@ -0,0 +1,187 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <common/macros.h>
+#include <common/net/net.h>  // for socket_info
+
+#include "client/inner/inbound_message.h"
+#include "client/inner/inner_client.h"
+#include "tests/stand_in_server/stand_in_server.h"
+
+// Handshake latency and runtime info round trips of the client network stack against the local stand-in server.
+
+namespace {
+
+typedef fastotv::stand_in::StandInServer StandInServer;
+typedef fastotv::client::inner::InnerClient InnerClient;
+
+const size_t kHandshakeIterations = 20;
+const size_t kRuntimeRequests = 200;
+const size_t kRuntimeStreams = 20;
+
+InnerClient* Connect(const common::net::HostAndPort& host) {
+  const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return nullptr;
+  }
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = inet_addr(host.GetHost().c_str());
+  addr.sin_port = htons(host.GetPort());
+  if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+    ::close(fd);
+    return nullptr;
+  }
+  return new InnerClient(nullptr, common::net::socket_info(fd));
+}
+
+void Disconnect(InnerClient* client) {
+  ignore_result(client->Close());
+  delete client;
+}
+
+bool ReadResponses(InnerClient* client, size_t count) {
+  fastotv::client::inner::InboundMessage message;
+  std::string command;
+  for (size_t i = 0; i < count; ++i) {
+    if (client->ReadCommand(&command) ||
+        message.Parse(command.data(), command.size(), fastotv::client::inner::JSON_WIRE_FORMAT) ||
+        !message.IsResponse()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+double ElapsedMsec(std::chrono::steady_clock::time_point start) {
+  const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// connect, login, server info and channels, pipelined like the player does
+void RunHandshake(size_t channels_count) {
+  StandInServer::Script script;
+  script.channels_count = channels_count;
+  StandInServer server(script);
+  if (server.Start()) {
+    fprintf(stderr, "Start failed\n");
+    return;
+  }
+
+  fastotv::commands_info::AuthInfo auth;
+  auth.SetLogin("stand_in@fastotv.com");
+  auth.SetPassword("password");
+  auth.SetDeviceID("5f3a1c0000000000000001");
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kHandshakeIterations; ++i) {
+    InnerClient* client = Connect(server.GetHost());
+    if (!client) {
+      fprintf(stderr, "Connect failed\n");
+      return;
+    }
+
+    const bool ok = !client->Login(auth) && !client->GetServerInfo() && !client->GetChannels() &&
+                    ReadResponses(client, 3);
+    Disconnect(client);
+    if (!ok) {
+      fprintf(stderr, "Handshake failed\n");
+      return;
+    }
+  }
+
+  printf("handshake, channels: %5zu: %8.3f ms\n", channels_count, ElapsedMsec(start) / kHandshakeIterations);
+}
+
+void RunRuntimeInfo(int latency_msec) {
+  StandInServer::Script script;
+  script.latency_msec = latency_msec;
+  StandInServer server(script);
+  if (server.Start()) {
+    fprintf(stderr, "Start failed\n");
+    return;
+  }
+
+  std::vector<fastotv::stream_id_t> sids;
+  for (size_t i = 0; i < kRuntimeStreams; ++i) {
+    sids.push_back(StandInServer::MakeStreamID(i));
+  }
+
+  InnerClient* client = Connect(server.GetHost());
+  if (!client) {
+    fprintf(stderr, "Connect failed\n");
+    return;
+  }
+
+  const size_t requests = latency_msec ? kRuntimeRequests / 10 : kRuntimeRequests;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < requests; ++i) {
+    if (client->GetRuntimeChannelsInfo(sids) || !ReadResponses(client, 1)) {
+      fprintf(stderr, "Request failed\n");
+      Disconnect(client);
+      return;
+    }
+  }
+  const double sequential = requests * 1000 / ElapsedMsec(start);
+
+  start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < requests; ++i) {
+    if (client->GetRuntimeChannelsInfo(sids)) {
+      fprintf(stderr, "Request failed\n");
+      Disconnect(client);
+      return;
+    }
+  }
+  const bool ok = ReadResponses(client, requests);
+  const double pipelined = requests * 1000 / ElapsedMsec(start);
+  Disconnect(client);
+  if (!ok) {
+    fprintf(stderr, "Request failed\n");
+    return;
+  }
+
+  printf("runtime info, latency: %2d ms: sequential %9.1f req/s, pipelined %9.1f req/s\n", latency_msec, sequential,
+         pipelined);
+}
+
+}  // namespace
+
+int main() {
+  const size_t counts[] = {100, 1000, 5000};
+  for (size_t count : counts) {
+    RunHandshake(count);
+  }
+
+  const int latencies[] = {0, 10};
+  for (int latency : latencies) {
+    RunRuntimeInfo(latency);
+  }
+  return 0;
+}
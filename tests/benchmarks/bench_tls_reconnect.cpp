@@ -0,0 +1,190 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+
+#include <openssl/ssl.h>
+
+#include <common/macros.h>
+#include <common/net/net.h>  // for socket_info
+
+#include <fastotv/commands_info/auth_info.h>
+
+#include "client/inner/inbound_message.h"
+#include "client/inner/inner_client.h"
+#include "client/inner/tls_session_cache.h"
+#include "client/inner/tls_transport.h"
+#include "tests/stand_in_server/stand_in_server.h"
+#include "tests/stand_in_server/tls_front.h"
+
+// Reconnect time of the control channel: tcp connect, tls handshake and the login answer,
+// plain tcp against tls with a full handshake every time and tls resuming the cached session.
+
+namespace {
+
+typedef fastotv::stand_in::StandInServer StandInServer;
+typedef fastotv::stand_in::TlsFront TlsFront;
+typedef fastotv::client::inner::InnerClient InnerClient;
+typedef fastotv::client::inner::TlsSessionCache TlsSessionCache;
+typedef fastotv::client::inner::TlsTransport TlsTransport;
+
+const size_t kReconnects = 200;
+const int kHandshakeTimeoutMsec = 5000;
+
+// drives the non-blocking handshake the way the loop does, with poll in place of the loop
+common::ErrnoError Handshake(TlsTransport* tls, int fd) {
+  common::ErrnoError err = tls->StartHandshake(fd);
+  bool done = false;
+  while (!err) {
+    err = tls->ContinueHandshake(&done);
+    if (err || done) {
+      break;
+    }
+
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = tls->WantsWrite() ? POLLOUT : POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, kHandshakeTimeoutMsec) <= 0) {
+      return common::make_errno_error(ETIMEDOUT);
+    }
+  }
+  return err;
+}
+
+int ConnectSocket(const common::net::HostAndPort& host) {
+  const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return -1;
+  }
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = inet_addr(host.GetHost().c_str());
+  addr.sin_port = htons(host.GetPort());
+  if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// tls_ctx null means plain tcp
+bool Reconnect(SSL_CTX* tls_ctx, TlsSessionCache* sessions, const common::net::HostAndPort& host, bool* resumed) {
+  const int fd = ConnectSocket(host);
+  if (fd < 0) {
+    return false;
+  }
+
+  InnerClient client(nullptr, common::net::socket_info(fd));
+  if (tls_ctx) {
+    TlsTransport* tls = new TlsTransport(tls_ctx, sessions, host);
+    const int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    common::ErrnoError err = Handshake(tls, fd);
+    fcntl(fd, F_SETFL, flags);
+    if (err) {
+      delete tls;
+      ignore_result(client.Close());
+      return false;
+    }
+    *resumed = tls->IsResumed();
+    client.SetTls(tls);
+  }
+
+  fastotv::commands_info::AuthInfo auth;
+  auth.SetLogin("stand_in@fastotv.com");
+  auth.SetPassword("password");
+  auth.SetDeviceID("5f3a1c0000000000000001");
+  std::string command;
+  fastotv::client::inner::InboundMessage message;
+  const bool ok = !client.Login(auth) && !client.ReadCommand(&command) &&
+                  !message.Parse(command.data(), command.size(), fastotv::client::inner::JSON_WIRE_FORMAT) &&
+                  message.IsResponse();
+  if (client.GetTls()) {
+    client.GetTls()->Shutdown();
+  }
+  ignore_result(client.Close());
+  return ok;
+}
+
+double ElapsedMsec(std::chrono::steady_clock::time_point start) {
+  const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+void Run(const char* name, SSL_CTX* tls_ctx, TlsSessionCache* sessions, const common::net::HostAndPort& host) {
+  size_t resumed_count = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kReconnects; ++i) {
+    bool resumed = false;
+    if (!Reconnect(tls_ctx, sessions, host, &resumed)) {
+      fprintf(stderr, "%s: reconnect failed\n", name);
+      return;
+    }
+    if (resumed) {
+      resumed_count++;
+    }
+  }
+
+  printf("%-14s %8.3f ms per reconnect, resumed %zu/%zu\n", name, ElapsedMsec(start) / kReconnects, resumed_count,
+         kReconnects);
+}
+
+}  // namespace
+
+int main() {
+  StandInServer server((StandInServer::Script()));
+  if (server.Start()) {
+    fprintf(stderr, "Start failed\n");
+    return 1;
+  }
+
+  TlsFront front(server.GetHost());
+  if (front.Start(0)) {
+    fprintf(stderr, "Tls front start failed\n");
+    return 1;
+  }
+
+  SSL_CTX* tls_ctx = TlsTransport::CreateContext(false);  // self-signed front
+  if (!tls_ctx) {
+    fprintf(stderr, "Tls context failed\n");
+    return 1;
+  }
+
+  Run("plain tcp", nullptr, nullptr, server.GetHost());
+  Run("tls full", tls_ctx, nullptr, front.GetHost());
+  TlsSessionCache sessions((std::string()));
+  Run("tls resumed", tls_ctx, &sessions, front.GetHost());
+
+  front.Stop();
+  server.Stop();
+  SSL_CTX_free(tls_ctx);
+  return 0;
+}
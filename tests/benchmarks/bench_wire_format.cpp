@@ -0,0 +1,135 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+
+#include <chrono>
+#include <string>
+
+#include <json-c/json_object.h>
+#include <json-c/json_tokener.h>
+
+#include <common/convert2string.h>
+#include <common/macros.h>
+
+#include "client/inner/wire_format.h"
+
+// Compares the JSON text path with MessagePack on a GetChannels reply of realistic size.
+
+namespace {
+
+const size_t kIterations = 50;
+
+json_object* NewString(const std::string& str) {
+  return json_object_new_string(str.c_str());
+}
+
+json_object* MakeChannel(size_t i) {
+  const std::string num = common::ConvertToString(i);
+  json_object* jurls = json_object_new_array();
+  json_object_array_add(
+      jurls, NewString("http://cdn" + common::ConvertToString(i % 4) + ".fastotv.com/live/" + num + "/master.m3u8"));
+
+  json_object* jepg = json_object_new_object();
+  json_object_object_add(jepg, "id", NewString("epg_" + num));
+  json_object_object_add(jepg, "urls", jurls);
+  json_object_object_add(jepg, "display_name", NewString("Channel " + num + " HD"));
+  json_object_object_add(jepg, "icon", NewString("http://icons.fastotv.com/" + num + ".png"));
+  json_object_object_add(jepg, "programs", json_object_new_array());
+
+  json_object* jchannel = json_object_new_object();
+  json_object_object_add(jchannel, "id", NewString("5f3a1c0000" + num));
+  json_object_object_add(jchannel, "group", json_object_new_string(i % 2 ? "News" : "Sport"));
+  json_object_object_add(jchannel, "iarc", json_object_new_int(18));
+  json_object_object_add(jchannel, "favorite", json_object_new_boolean(0));
+  json_object_object_add(jchannel, "recent", json_object_new_int64(1650000000000LL + i));
+  json_object_object_add(jchannel, "interruption_time", json_object_new_int(0));
+  json_object_object_add(jchannel, "epg", jepg);
+  json_object_object_add(jchannel, "video", json_object_new_boolean(1));
+  json_object_object_add(jchannel, "audio", json_object_new_boolean(1));
+  return jchannel;
+}
+
+json_object* MakeChannelsReply(size_t count) {
+  json_object* jchannels = json_object_new_array();
+  for (size_t i = 0; i < count; ++i) {
+    json_object_array_add(jchannels, MakeChannel(i));
+  }
+
+  json_object* jresult = json_object_new_object();
+  json_object_object_add(jresult, "channels", jchannels);
+  json_object_object_add(jresult, "vods", json_object_new_array());
+  json_object_object_add(jresult, "private_channels", json_object_new_array());
+
+  json_object* jreply = json_object_new_object();
+  json_object_object_add(jreply, "jsonrpc", json_object_new_string("2.0"));
+  json_object_object_add(jreply, "id", json_object_new_string("00000003"));
+  json_object_object_add(jreply, "result", jresult);
+  return jreply;
+}
+
+template <typename F>
+double MeasureMsec(F func) {
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kIterations; ++i) {
+    func();
+  }
+  const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / kIterations;
+}
+
+void RunBenchmark(size_t channels_count) {
+  json_object* jreply = MakeChannelsReply(channels_count);
+  const std::string json = json_object_to_json_string_ext(jreply, JSON_C_TO_STRING_PLAIN);
+  std::string msgpack;
+  if (fastotv::client::inner::EncodeMsgPack(jreply, &msgpack)) {
+    fprintf(stderr, "Encode failed\n");
+    json_object_put(jreply);
+    return;
+  }
+
+  const double json_encode = MeasureMsec([jreply]() {
+    std::string out = json_object_to_json_string_ext(jreply, JSON_C_TO_STRING_PLAIN);
+  });
+  const double json_decode = MeasureMsec([&json]() { json_object_put(json_tokener_parse(json.c_str())); });
+  const double msgpack_encode = MeasureMsec([jreply]() {
+    std::string out;
+    ignore_result(fastotv::client::inner::EncodeMsgPack(jreply, &out));
+  });
+  const double msgpack_decode = MeasureMsec([&msgpack]() {
+    json_object* jout = nullptr;
+    ignore_result(fastotv::client::inner::DecodeMsgPack(msgpack.data(), msgpack.size(), &jout));
+    json_object_put(jout);
+  });
+  json_object_put(jreply);
+
+  printf("channels: %zu\n", channels_count);
+  printf("  json:    %8zu bytes, encode %8.3f ms, decode %8.3f ms\n", json.size(), json_encode, json_decode);
+  printf("  msgpack: %8zu bytes, encode %8.3f ms, decode %8.3f ms\n", msgpack.size(), msgpack_encode,
+         msgpack_decode);
+}
+
+}  // namespace
+
+int main() {
+  const size_t counts[] = {100, 1000, 5000};
+  for (size_t count : counts) {
+    RunBenchmark(count);
+  }
+  return 0;
+}
@@ -0,0 +1,123 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include <common/macros.h>
+
+#include "tests/stand_in_server/stand_in_server.h"
+#include "tests/stand_in_server/tls_front.h"
+
+// Runs the stand-in server on its own, so a real player can be pointed at it:
+// stand_in_server -port 6317 -channels 5000 -latency 50 -drop_every 10 -close_after 0 -slow_read 0 -write_piece 0
+//     -write_pause 0 -tls_port 6318
+// with tls_port the same server is also reachable over tls (self-signed, set tls_verify=false in the player)
+
+namespace {
+
+std::atomic<bool> g_quit(false);
+
+void quit_handler(int sig) {
+  UNUSED(sig);
+  g_quit = true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  fastotv::stand_in::StandInServer::Script script;
+  script.port = 6317;
+  uint16_t tls_port = 0;
+  for (int i = 1; i < argc - 1; i += 2) {
+    const long value = strtol(argv[i + 1], nullptr, 10);
+    if (strcmp(argv[i], "-port") == 0) {
+      script.port = static_cast<uint16_t>(value);
+    } else if (strcmp(argv[i], "-channels") == 0) {
+      script.channels_count = value;
+    } else if (strcmp(argv[i], "-latency") == 0) {
+      script.latency_msec = static_cast<int>(value);
+    } else if (strcmp(argv[i], "-drop_every") == 0) {
+      script.drop_every = value;
+    } else if (strcmp(argv[i], "-close_after") == 0) {
+      script.close_after_responses = value;
+    } else if (strcmp(argv[i], "-slow_read") == 0) {
+      script.slow_read_msec = static_cast<int>(value);
+    } else if (strcmp(argv[i], "-write_piece") == 0) {
+      script.write_piece_size = value;
+    } else if (strcmp(argv[i], "-write_pause") == 0) {
+      script.write_pause_msec = static_cast<int>(value);
+    } else if (strcmp(argv[i], "-tls_port") == 0) {
+      tls_port = static_cast<uint16_t>(value);
+    } else {
+      std::cout << "Unknown option: " << argv[i] << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  fastotv::stand_in::StandInServer server(script);
+  common::ErrnoError err = server.Start();
+  if (err) {
+    std::cout << "Can't start server: " << err->GetDescription() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  fastotv::stand_in::TlsFront tls_front(server.GetHost());
+  if (tls_port) {
+    err = tls_front.Start(tls_port);
+    if (err) {
+      std::cout << "Can't start tls front: " << err->GetDescription() << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cout << "Tls on " << tls_front.GetHost().GetHost() << ":" << tls_front.GetHost().GetPort() << std::endl;
+  }
+
+  signal(SIGINT, quit_handler);
+  signal(SIGTERM, quit_handler);
+  std::cout << "Listening on " << server.GetHost().GetHost() << ":" << server.GetHost().GetPort() << std::endl;
+
+  // watchers of the first channel change every second, server pings every ten
+  for (size_t tick = 1; !g_quit; ++tick) {
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    server.SetWatchers(fastotv::stand_in::StandInServer::MakeStreamID(0), tick % 100);
+    if (tick % 10 == 0) {
+      server.PingClients();
+    }
+  }
+
+  tls_front.Stop();
+  server.Stop();
+  const fastotv::stand_in::StandInServer::Stats stats = server.GetStats();
+  std::cout << "Connections: " << stats.accepted << ", requests: " << stats.requests
+            << ", responses: " << stats.responses << ", dropped: " << stats.dropped << std::endl;
+  for (const auto& method : stats.methods) {
+    std::cout << "  " << method.first << ": " << method.second << std::endl;
+  }
+  if (tls_port) {
+    const fastotv::stand_in::TlsFront::Stats tls_stats = tls_front.GetStats();
+    std::cout << "Tls handshakes: " << tls_stats.handshakes << ", resumed: " << tls_stats.resumed
+              << ", failed: " << tls_stats.failed << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
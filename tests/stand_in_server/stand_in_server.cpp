@@ -0,0 +1,478 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tests/stand_in_server/stand_in_server.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include <json-c/json_object.h>
+#include <json-c/json_tokener.h>
+
+#include <common/convert2string.h>
+#include <common/net/net.h>  // for socket_info
+
+#include <fastotv/client/client.h>
+#include <fastotv/commands/commands.h>
+#include <fastotv/commands_info/runtime_channel_info.h>
+#include <fastotv/commands_info/server_info.h>
+
+#include "client/inner/inbound_message.h"
+#include "client/inner/inner_client.h"
+
+#define STAND_IN_HOST "127.0.0.1"
+#define ACCEPT_POLL_MSEC 20
+
+namespace fastotv {
+namespace stand_in {
+
+namespace {
+
+protocol::response_t MakeResult(const protocol::sequance_id_t& id, const std::string& result) {
+  return protocol::response_t::MakeMessage(id,
+                                           common::protocols::json_rpc::JsonRPCMessage::MakeSuccessMessage(result));
+}
+
+protocol::response_t MakeSuccess(const protocol::sequance_id_t& id) {
+  return protocol::response_t::MakeMessage(id, common::protocols::json_rpc::JsonRPCMessage::MakeSuccessMessage());
+}
+
+protocol::response_t MakeError(const protocol::sequance_id_t& id, const std::string& text) {
+  return protocol::response_t::MakeError(id, common::protocols::json_rpc::JsonRPCError::MakeServerErrorFromText(text));
+}
+
+json_object* NewString(const std::string& str) {
+  return json_object_new_string(str.c_str());
+}
+
+json_object* MakeChannel(size_t i) {
+  const std::string num = common::ConvertToString(i);
+  json_object* jurls = json_object_new_array();
+  json_object_array_add(jurls, NewString("http://127.0.0.1/live/" + num + "/master.m3u8"));
+
+  json_object* jepg = json_object_new_object();
+  json_object_object_add(jepg, "id", NewString("epg_" + num));
+  json_object_object_add(jepg, "urls", jurls);
+  json_object_object_add(jepg, "display_name", NewString("Channel " + num));
+  json_object_object_add(jepg, "icon", NewString("http://127.0.0.1/icons/" + num + ".png"));
+  json_object_object_add(jepg, "programs", json_object_new_array());
+
+  json_object* jchannel = json_object_new_object();
+  json_object_object_add(jchannel, "id", NewString(StandInServer::MakeStreamID(i)));
+  json_object_object_add(jchannel, "group", json_object_new_string(i % 2 ? "News" : "Sport"));
+  json_object_object_add(jchannel, "iarc", json_object_new_int(18));
+  json_object_object_add(jchannel, "favorite", json_object_new_boolean(0));
+  json_object_object_add(jchannel, "recent", json_object_new_int64(0));
+  json_object_object_add(jchannel, "interruption_time", json_object_new_int(0));
+  json_object_object_add(jchannel, "epg", jepg);
+  json_object_object_add(jchannel, "video", json_object_new_boolean(1));
+  json_object_object_add(jchannel, "audio", json_object_new_boolean(1));
+  return jchannel;
+}
+
+void sleep_msec(int msec) {
+  if (msec > 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(msec));
+  }
+}
+
+class TricklingClient : public client::Client {
+ public:
+  TricklingClient(const common::net::socket_info& info, size_t piece_size, int pause_msec)
+      : client::Client(nullptr, info), piece_size_(piece_size), pause_msec_(pause_msec) {}
+
+ protected:
+  common::ErrnoError DoSingleWrite(const void* data, size_t size, size_t* nwrite_out) override {
+    const char* ptr = static_cast<const char*>(data);
+    size_t total = 0;
+    while (total < size) {
+      size_t nwrite = 0;
+      common::ErrnoError err = client::Client::DoSingleWrite(ptr + total, std::min(piece_size_, size - total), &nwrite);
+      if (err) {
+        return err;
+      }
+      total += nwrite;
+      sleep_msec(pause_msec_);
+    }
+
+    *nwrite_out = total;
+    return common::ErrnoError();
+  }
+
+ private:
+  const size_t piece_size_;
+  const int pause_msec_;
+};
+
+}  // namespace
+
+StandInServer::Script::Script()
+    : port(0),
+      channels_count(100),
+      latency_msec(0),
+      slow_read_msec(0),
+      write_piece_size(0),
+      write_pause_msec(0),
+      drop_every(0),
+      close_after_responses(0),
+      stall_after_responses(0),
+      reject_login(false),
+      batch_runtime_info(true),
+      subscriptions(true) {}
+
+StandInServer::Stats::Stats()
+    : accepted(0), requests(0), responses(0), dropped(0), client_responses(0), notifications(0), methods() {}
+
+StandInServer::Connection::Connection(client::Client* client)
+    : client(client), write_mutex(), subscribed(), responses(0), thread() {}
+
+StandInServer::Connection::~Connection() {
+  delete client;
+}
+
+StandInServer::StandInServer(const Script& script)
+    : script_(script),
+      listen_fd_(-1),
+      host_(),
+      stop_(false),
+      accept_thread_(),
+      mutex_(),
+      connections_(),
+      watchers_(),
+      channels_result_(MakeChannelsResult(script.channels_count)),
+      server_requests_(0),
+      stats_() {}
+
+StandInServer::~StandInServer() {
+  Stop();
+}
+
+common::ErrnoError StandInServer::Start() {
+  listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (listen_fd_ < 0) {
+    return common::make_errno_error(errno);
+  }
+
+  int on = 1;
+  setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = inet_addr(STAND_IN_HOST);
+  addr.sin_port = htons(script_.port);
+  socklen_t len = sizeof(addr);
+  if (::bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+      ::listen(listen_fd_, SOMAXCONN) != 0 ||
+      ::getsockname(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), &len) != 0) {
+    const int err = errno;
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+    return common::make_errno_error(err);
+  }
+
+  host_ = common::net::HostAndPort(STAND_IN_HOST, ntohs(addr.sin_port));
+  stop_ = false;
+  accept_thread_ = std::thread([this]() { AcceptLoop(); });
+  return common::ErrnoError();
+}
+
+void StandInServer::Stop() {
+  if (stop_.exchange(true) || listen_fd_ < 0) {
+    return;
+  }
+
+  accept_thread_.join();
+  ::close(listen_fd_);
+  listen_fd_ = -1;
+
+  std::vector<std::unique_ptr<Connection>> connections;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    connections.swap(connections_);
+  }
+  for (const auto& connection : connections) {  // wakes up the blocked reads
+    std::unique_lock<std::mutex> lock(connection->write_mutex);
+    if (connection->client->GetInfo().fd() != INVALID_DESCRIPTOR) {
+      ::shutdown(connection->client->GetInfo().fd(), SHUT_RDWR);
+    }
+  }
+  for (const auto& connection : connections) {
+    connection->thread.join();
+  }
+}
+
+common::net::HostAndPort StandInServer::GetHost() const {
+  return host_;
+}
+
+void StandInServer::SetWatchers(const stream_id_t& sid, size_t watchers) {
+  std::string runtime_info;
+  std::vector<Connection*> subscribers;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    watchers_[sid] = watchers;
+    runtime_info = MakeRuntimeInfo(sid);
+    for (const auto& connection : connections_) {
+      if (connection->subscribed.count(sid)) {
+        subscribers.push_back(connection.get());
+      }
+    }
+  }
+
+  const std::string params = "{\"channels\":[" + runtime_info + "]}";
+  for (Connection* connection : subscribers) {
+    if (!WriteRequest(connection, SERVER_RUNTIME_CHANNELS_INFO, params)) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      stats_.notifications++;
+    }
+  }
+}
+
+void StandInServer::PingClients() {
+  std::vector<Connection*> connections;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (const auto& connection : connections_) {
+      connections.push_back(connection.get());
+    }
+  }
+
+  std::string ping;
+  common::daemon::commands::ServerPingInfo ping_info;
+  if (ping_info.SerializeToString(&ping)) {
+    return;
+  }
+  for (Connection* connection : connections) {
+    ignore_result(WriteRequest(connection, SERVER_PING, ping));
+  }
+}
+
+StandInServer::Stats StandInServer::GetStats() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+std::string StandInServer::MakeChannelsResult(size_t channels_count) {
+  json_object* jchannels = json_object_new_array();
+  for (size_t i = 0; i < channels_count; ++i) {
+    json_object_array_add(jchannels, MakeChannel(i));
+  }
+
+  json_object* jresult = json_object_new_object();
+  json_object_object_add(jresult, "channels", jchannels);
+  json_object_object_add(jresult, "vods", json_object_new_array());
+  json_object_object_add(jresult, "private_channels", json_object_new_array());
+  const std::string result = json_object_to_json_string_ext(jresult, JSON_C_TO_STRING_PLAIN);
+  json_object_put(jresult);
+  return result;
+}
+
+stream_id_t StandInServer::MakeStreamID(size_t i) {
+  return "stream_" + common::ConvertToString(i);
+}
+
+void StandInServer::AcceptLoop() {
+  while (!stop_) {
+    struct pollfd pfd = {listen_fd_, POLLIN, 0};
+    if (::poll(&pfd, 1, ACCEPT_POLL_MSEC) <= 0) {
+      continue;
+    }
+
+    const int fd = ::accept(listen_fd_, nullptr, nullptr);
+    if (fd < 0) {
+      continue;
+    }
+
+    // blocking socket, the connection thread reads whole commands
+    const common::net::socket_info info(fd);
+    client::Client* client = script_.write_piece_size
+                                 ? new TricklingClient(info, script_.write_piece_size, script_.write_pause_msec)
+                                 : new client::Client(nullptr, info);
+    Connection* connection = new Connection(client);
+    std::unique_lock<std::mutex> lock(mutex_);
+    stats_.accepted++;
+    connections_.emplace_back(connection);
+    connection->thread = std::thread([this, connection]() { Serve(connection); });
+  }
+}
+
+void StandInServer::Serve(Connection* connection) {
+  client::inner::InboundMessage message;
+  std::string command;
+  while (!stop_) {
+    sleep_msec(script_.slow_read_msec);
+    common::ErrnoError err = connection->client->ReadCommand(&command);
+    if (err) {
+      break;
+    }
+
+    if (message.Parse(command.data(), command.size(), client::inner::JSON_WIRE_FORMAT)) {  // clients only send json
+      continue;
+    }
+
+    if (message.IsResponse()) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      stats_.client_responses++;
+      continue;
+    }
+
+    if (!message.IsRequest()) {
+      continue;
+    }
+
+    bool drop = false;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      stats_.requests++;
+      stats_.methods[message.GetMethod()]++;
+      drop = script_.drop_every && stats_.requests % script_.drop_every == 0;
+      drop |= script_.stall_after_responses && connection->responses >= script_.stall_after_responses;
+      if (drop) {
+        stats_.dropped++;
+      }
+    }
+    if (drop) {
+      continue;
+    }
+
+    std::string params;
+    if (message.GetParams()) {
+      params = json_object_to_json_string_ext(message.GetParams(), JSON_C_TO_STRING_PLAIN);
+    }
+    sleep_msec(script_.latency_msec);
+    const protocol::response_t response = HandleRequest(connection, message.GetID(), message.GetMethod(), params);
+    {
+      std::unique_lock<std::mutex> lock(connection->write_mutex);
+      err = connection->client->WriteResponse(response);
+    }
+    if (err) {
+      break;
+    }
+
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      stats_.responses++;
+    }
+    connection->responses++;
+    if (script_.close_after_responses && connection->responses >= script_.close_after_responses) {
+      break;
+    }
+  }
+
+  std::unique_lock<std::mutex> lock(connection->write_mutex);
+  ::shutdown(connection->client->GetInfo().fd(), SHUT_RDWR);
+  ignore_result(connection->client->Close());
+}
+
+protocol::response_t StandInServer::HandleRequest(Connection* connection,
+                                                  const protocol::sequance_id_t& id,
+                                                  const std::string& method,
+                                                  const std::string& params) {
+  if (method == CLIENT_LOGIN || method == CLIENT_ACTIVATE_DEVICE) {
+    return script_.reject_login ? MakeError(id, "User not found") : MakeSuccess(id);
+  } else if (method == CLIENT_PING) {
+    std::string pong;
+    common::daemon::commands::ServerPingInfo ping_info;
+    if (ping_info.SerializeToString(&pong)) {
+      return MakeError(id, "Ping serialization failed");
+    }
+    return MakeResult(id, pong);
+  } else if (method == CLIENT_GET_SERVER_INFO) {
+    std::string server_info;
+    if (commands_info::ServerInfo().SerializeToString(&server_info)) {
+      return MakeError(id, "Server info serialization failed");
+    }
+    return MakeResult(id, server_info);
+  } else if (method == CLIENT_GET_CHANNELS) {
+    return MakeResult(id, channels_result_);
+  } else if (method == CLIENT_GET_RUNTIME_CHANNEL_INFO) {
+    json_object* jparams = json_tokener_parse(params.c_str());
+    json_object* jid = nullptr;
+    stream_id_t sid;
+    if (jparams && json_object_object_get_ex(jparams, "id", &jid)) {
+      sid = json_object_get_string(jid);
+    }
+    json_object_put(jparams);
+    std::unique_lock<std::mutex> lock(mutex_);
+    return MakeResult(id, MakeRuntimeInfo(sid));
+  } else if (method == CLIENT_GET_RUNTIME_CHANNELS_INFO) {
+    std::vector<stream_id_t> sids;
+    if (!script_.batch_runtime_info) {
+      return MakeError(id, "Unknown method");
+    }
+    if (client::inner::InnerClient::ParseRuntimeChannelsRequest(params, &sids)) {
+      return MakeError(id, "Invalid params");
+    }
+
+    std::string result = "[";
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < sids.size(); ++i) {
+      result += (i ? "," : "") + MakeRuntimeInfo(sids[i]);
+    }
+    return MakeResult(id, result + "]");
+  } else if (method == CLIENT_SUBSCRIBE_RUNTIME_CHANNELS_INFO) {
+    std::vector<stream_id_t> sids;
+    if (!script_.subscriptions) {
+      return MakeError(id, "Unknown method");
+    }
+    if (client::inner::InnerClient::ParseRuntimeChannelsRequest(params, &sids)) {
+      return MakeError(id, "Invalid params");
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    connection->subscribed = std::set<stream_id_t>(sids.begin(), sids.end());
+    return MakeSuccess(id);
+  }
+
+  // set_wire_format and set_compression too: the stand-in answers like a server which only speaks plain json
+  return MakeError(id, "Unknown method");
+}
+
+std::string StandInServer::MakeRuntimeInfo(const stream_id_t& sid) const {
+  auto it = watchers_.find(sid);
+  const commands_info::RuntimeChannelInfo info(sid, it == watchers_.end() ? 0 : it->second);
+  std::string info_str;
+  if (info.SerializeToString(&info_str)) {
+    return "{}";
+  }
+  return info_str;
+}
+
+common::ErrnoError StandInServer::WriteRequest(Connection* connection,
+                                               const std::string& method,
+                                               const std::string& params) {
+  protocol::request_t req;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    req.id = "s" + common::ConvertToString(++server_requests_);
+  }
+  req.method = method;
+  req.params = params;
+  std::unique_lock<std::mutex> lock(connection->write_mutex);
+  return connection->client->WriteRequest(req);
+}
+
+}  // namespace stand_in
+}  // namespace fastotv
@@ -0,0 +1,130 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <common/error.h>
+#include <common/net/types.h>
+
+#include <fastotv/protocol/types.h>
+#include <fastotv/types.h>
+
+namespace fastotv {
+namespace client {
+class Client;
+}
+namespace stand_in {
+
+// Local stand-in for the FastoTV backend: accepts clients on 127.0.0.1 and speaks the client protocol through
+// the same protocol library the player uses, so framing is identical to a real server. Every connection is
+// served by its own thread, requests are answered in order. The script decides payload sizes and faults.
+class StandInServer {
+ public:
+  struct Script {
+    Script();
+
+    uint16_t port;                 // zero picks a free one
+    size_t channels_count;         // size of the get_channels result
+    int latency_msec;              // every response waits this long, like a server busy with the request
+    int slow_read_msec;            // pause before every read, the client's writes pile up in the socket
+    size_t write_piece_size;       // writes go out in pieces of that many bytes, zero at once
+    int write_pause_msec;          // after every piece, so the client reads a frame split across segments
+    size_t drop_every;             // every n-th request is left unanswered, zero never
+    size_t close_after_responses;  // connection is closed after that many responses, zero never
+    size_t stall_after_responses;  // later requests of the connection are read but never answered, zero never
+    bool reject_login;
+    bool batch_runtime_info;  // older servers answer get_runtime_channels_info with an error
+    bool subscriptions;       // same for subscribe_runtime_channels_info
+  };
+
+  struct Stats {
+    Stats();
+
+    size_t accepted;
+    size_t requests;
+    size_t responses;
+    size_t dropped;
+    size_t client_responses;  // answers to requests made by the server, e.g. pongs
+    size_t notifications;
+    std::map<std::string, size_t> methods;  // requests by method
+  };
+
+  explicit StandInServer(const Script& script);
+  ~StandInServer();
+
+  common::ErrnoError Start() WARN_UNUSED_RESULT;
+  void Stop();  // closes every connection
+  common::net::HostAndPort GetHost() const;
+
+  // watchers reported by runtime info requests, pushed to every connection subscribed to sid
+  void SetWatchers(const stream_id_t& sid, size_t watchers);
+  void PingClients();
+  Stats GetStats() const;
+
+  static std::string MakeChannelsResult(size_t channels_count);
+  static stream_id_t MakeStreamID(size_t i);
+
+ private:
+  struct Connection {
+    explicit Connection(client::Client* client);
+    ~Connection();
+
+    client::Client* const client;
+    std::mutex write_mutex;  // the connection thread answers, other threads push
+    std::set<stream_id_t> subscribed;
+    size_t responses;
+    std::thread thread;
+  };
+
+  void AcceptLoop();
+  void Serve(Connection* connection);
+  protocol::response_t HandleRequest(Connection* connection,
+                                     const protocol::sequance_id_t& id,
+                                     const std::string& method,
+                                     const std::string& params);
+  std::string MakeRuntimeInfo(const stream_id_t& sid) const;
+  common::ErrnoError WriteRequest(Connection* connection, const std::string& method, const std::string& params);
+
+  const Script script_;
+  int listen_fd_;
+  common::net::HostAndPort host_;
+  std::atomic<bool> stop_;
+  std::thread accept_thread_;
+
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<Connection>> connections_;
+  std::map<stream_id_t, size_t> watchers_;
+  std::string channels_result_;
+  size_t server_requests_;
+  Stats stats_;
+};
+
+}  // namespace stand_in
+}  // namespace fastotv
@@ -0,0 +1,313 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tests/stand_in_server/tls_front.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+#define TLS_FRONT_HOST "127.0.0.1"
+#define POLL_MSEC 20
+#define CERTIFICATE_DAYS 1
+
+namespace fastotv {
+namespace stand_in {
+
+namespace {
+
+EVP_PKEY* generate_key() {
+  EVP_PKEY* key = nullptr;
+  EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+  if (ctx && EVP_PKEY_keygen_init(ctx) > 0 && EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx, NID_X9_62_prime256v1) > 0) {
+    EVP_PKEY_keygen(ctx, &key);
+  }
+  EVP_PKEY_CTX_free(ctx);
+  return key;
+}
+
+X509* make_self_signed(EVP_PKEY* key) {
+  X509* cert = X509_new();
+  if (!cert) {
+    return nullptr;
+  }
+
+  X509_set_version(cert, 2);
+  ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+  X509_gmtime_adj(X509_get_notBefore(cert), 0);
+  X509_gmtime_adj(X509_get_notAfter(cert), CERTIFICATE_DAYS * 24 * 60 * 60);
+  X509_set_pubkey(cert, key);
+  X509_NAME* name = X509_get_subject_name(cert);
+  X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>(TLS_FRONT_HOST), -1,
+                             -1, 0);
+  X509_set_issuer_name(cert, name);
+  if (!X509_sign(cert, key, EVP_sha256())) {
+    X509_free(cert);
+    return nullptr;
+  }
+  return cert;
+}
+
+bool write_all(int fd, const char* data, size_t size) {
+  while (size) {
+    const ssize_t res = ::write(fd, data, size);
+    if (res <= 0) {
+      return false;
+    }
+    data += res;
+    size -= res;
+  }
+  return true;
+}
+
+bool ssl_write_all(SSL* ssl, const char* data, size_t size) {
+  while (size) {
+    const int res = SSL_write(ssl, data, static_cast<int>(size));
+    if (res <= 0) {
+      return false;
+    }
+    data += res;
+    size -= res;
+  }
+  return true;
+}
+
+}  // namespace
+
+TlsFront::Stats::Stats() : handshakes(0), resumed(0), failed(0) {}
+
+TlsFront::Tunnel::Tunnel(int fd) : fd(fd), backend_fd(-1), ssl(nullptr), thread() {}
+
+TlsFront::Tunnel::~Tunnel() {
+  if (ssl) {
+    SSL_free(ssl);
+  }
+  if (backend_fd >= 0) {
+    ::close(backend_fd);
+  }
+  ::close(fd);
+}
+
+TlsFront::TlsFront(const common::net::HostAndPort& backend)
+    : backend_(backend),
+      tls_ctx_(nullptr),
+      listen_fd_(-1),
+      host_(),
+      stop_(false),
+      accept_thread_(),
+      mutex_(),
+      tunnels_(),
+      stats_() {}
+
+TlsFront::~TlsFront() {
+  Stop();
+  if (tls_ctx_) {
+    SSL_CTX_free(tls_ctx_);
+  }
+}
+
+common::ErrnoError TlsFront::Start(uint16_t port) {
+  if (!tls_ctx_) {
+    common::ErrnoError err = CreateContext();
+    if (err) {
+      return err;
+    }
+  }
+
+  listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (listen_fd_ < 0) {
+    return common::make_errno_error(errno);
+  }
+
+  int on = 1;
+  setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = inet_addr(TLS_FRONT_HOST);
+  addr.sin_port = htons(port);
+  socklen_t len = sizeof(addr);
+  if (::bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+      ::listen(listen_fd_, SOMAXCONN) != 0 ||
+      ::getsockname(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), &len) != 0) {
+    const int err = errno;
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+    return common::make_errno_error(err);
+  }
+
+  host_ = common::net::HostAndPort(TLS_FRONT_HOST, ntohs(addr.sin_port));
+  stop_ = false;
+  accept_thread_ = std::thread([this]() { AcceptLoop(); });
+  return common::ErrnoError();
+}
+
+void TlsFront::Stop() {
+  if (stop_.exchange(true) || listen_fd_ < 0) {
+    return;
+  }
+
+  accept_thread_.join();
+  ::close(listen_fd_);
+  listen_fd_ = -1;
+
+  std::vector<std::unique_ptr<Tunnel>> tunnels;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    tunnels.swap(tunnels_);
+  }
+  for (const auto& tunnel : tunnels) {  // wakes up the blocked handshakes and reads
+    ::shutdown(tunnel->fd, SHUT_RDWR);
+  }
+  for (const auto& tunnel : tunnels) {
+    tunnel->thread.join();
+  }
+}
+
+common::net::HostAndPort TlsFront::GetHost() const {
+  return host_;
+}
+
+TlsFront::Stats TlsFront::GetStats() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+common::ErrnoError TlsFront::CreateContext() {
+  tls_ctx_ = SSL_CTX_new(TLS_server_method());
+  if (!tls_ctx_) {
+    return common::make_errno_error("Can't create tls context", ENOMEM);
+  }
+
+  EVP_PKEY* key = generate_key();
+  X509* cert = key ? make_self_signed(key) : nullptr;
+  const bool ok = cert && SSL_CTX_use_certificate(tls_ctx_, cert) == 1 && SSL_CTX_use_PrivateKey(tls_ctx_, key) == 1;
+  X509_free(cert);
+  EVP_PKEY_free(key);
+  if (!ok) {
+    SSL_CTX_free(tls_ctx_);
+    tls_ctx_ = nullptr;
+    return common::make_errno_error("Can't make certificate", EINVAL);
+  }
+
+  // tls 1.2 clients resume by session id, 1.3 ones by ticket
+  static const unsigned char session_id_context[] = "stand_in";
+  SSL_CTX_set_session_id_context(tls_ctx_, session_id_context, sizeof(session_id_context) - 1);
+  SSL_CTX_set_session_cache_mode(tls_ctx_, SSL_SESS_CACHE_SERVER);
+  return common::ErrnoError();
+}
+
+void TlsFront::AcceptLoop() {
+  while (!stop_) {
+    struct pollfd pfd = {listen_fd_, POLLIN, 0};
+    if (::poll(&pfd, 1, POLL_MSEC) <= 0) {
+      continue;
+    }
+
+    const int fd = ::accept(listen_fd_, nullptr, nullptr);
+    if (fd < 0) {
+      continue;
+    }
+
+    Tunnel* tunnel = new Tunnel(fd);
+    std::unique_lock<std::mutex> lock(mutex_);
+    tunnels_.emplace_back(tunnel);
+    tunnel->thread = std::thread([this, tunnel]() { Serve(tunnel); });
+  }
+}
+
+void TlsFront::Serve(Tunnel* tunnel) {
+  tunnel->ssl = SSL_new(tls_ctx_);
+  bool ok = tunnel->ssl && SSL_set_fd(tunnel->ssl, tunnel->fd) == 1 && SSL_accept(tunnel->ssl) == 1;
+  if (ok) {
+    tunnel->backend_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr(backend_.GetHost().c_str());
+    addr.sin_port = htons(backend_.GetPort());
+    ok = tunnel->backend_fd >= 0 &&
+         ::connect(tunnel->backend_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0;
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!ok) {
+      stats_.failed++;
+    } else {
+      stats_.handshakes++;
+      if (SSL_session_reused(tunnel->ssl)) {
+        stats_.resumed++;
+      }
+    }
+  }
+  ERR_clear_error();
+  if (ok) {
+    Pump(tunnel);
+  }
+  ::shutdown(tunnel->fd, SHUT_RDWR);
+}
+
+void TlsFront::Pump(Tunnel* tunnel) {
+  char buffer[16 * 1024];
+  while (!stop_) {
+    // records already decrypted don't make the socket readable again
+    if (!SSL_pending(tunnel->ssl)) {
+      struct pollfd pfds[2] = {{tunnel->fd, POLLIN, 0}, {tunnel->backend_fd, POLLIN, 0}};
+      const int res = ::poll(pfds, 2, POLL_MSEC);
+      if (res < 0 && errno != EINTR) {
+        return;
+      }
+      if (res <= 0) {
+        continue;
+      }
+
+      if (pfds[1].revents) {
+        const ssize_t size = ::read(tunnel->backend_fd, buffer, sizeof(buffer));
+        if (size <= 0 || !ssl_write_all(tunnel->ssl, buffer, size)) {
+          return;
+        }
+      }
+      if (!pfds[0].revents) {
+        continue;
+      }
+    }
+
+    const int size = SSL_read(tunnel->ssl, buffer, sizeof(buffer));
+    if (size <= 0) {
+      if (SSL_get_error(tunnel->ssl, size) == SSL_ERROR_WANT_READ) {  // only a post-handshake message
+        continue;
+      }
+      return;
+    }
+    if (!write_all(tunnel->backend_fd, buffer, size)) {
+      return;
+    }
+  }
+}
+
+}  // namespace stand_in
+}  // namespace fastotv
@@ -0,0 +1,89 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <common/error.h>
+#include <common/net/types.h>
+
+typedef struct ssl_st SSL;
+typedef struct ssl_ctx_st SSL_CTX;
+
+namespace fastotv {
+namespace stand_in {
+
+// TLS terminating front for a plain stand-in server, like a load balancer in front of the real backend.
+// Uses a self-signed certificate made at start, so clients have to skip peer verification. Session tickets
+// are on, every tunnel reports whether the client resumed.
+class TlsFront {
+ public:
+  struct Stats {
+    Stats();
+
+    size_t handshakes;
+    size_t resumed;
+    size_t failed;
+  };
+
+  explicit TlsFront(const common::net::HostAndPort& backend);
+  ~TlsFront();
+
+  common::ErrnoError Start(uint16_t port) WARN_UNUSED_RESULT;  // zero picks a free port
+  void Stop();                                                 // closes every tunnel
+  common::net::HostAndPort GetHost() const;
+  Stats GetStats() const;
+
+ private:
+  struct Tunnel {
+    explicit Tunnel(int fd);
+    ~Tunnel();
+
+    const int fd;
+    int backend_fd;
+    SSL* ssl;
+    std::thread thread;
+  };
+
+  common::ErrnoError CreateContext();
+  void AcceptLoop();
+  void Serve(Tunnel* tunnel);
+  void Pump(Tunnel* tunnel);
+
+  const common::net::HostAndPort backend_;
+  SSL_CTX* tls_ctx_;
+  int listen_fd_;
+  common::net::HostAndPort host_;
+  std::atomic<bool> stop_;
+  std::thread accept_thread_;
+
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<Tunnel>> tunnels_;
+  Stats stats_;
+};
+
+}  // namespace stand_in
+}  // namespace fastotv
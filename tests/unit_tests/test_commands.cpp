@@ -1,4 +1,4 @@
-/*  Copyright (C) 2014-2019 FastoGT. All right reserved.
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
 
     This file is part of FastoTV.
 
@@ -18,9 +18,13 @@
 
 #include <gtest/gtest.h>
 
-#include "client/commands.h"
+#include "client/inner/inner_client.h"
 
 TEST(Client, TestCommands) {
-  const auto req = fastotv::client::GetChannelsRequest(std::string("11"));
-  ASSERT_TRUE(req.IsValid());
+  std::vector<fastotv::stream_id_t> sids;
+  ASSERT_FALSE(fastotv::client::inner::InnerClient::ParseRuntimeChannelsRequest("{\"ids\":[\"11\",\"12\"]}", &sids));
+  ASSERT_EQ(sids.size(), 2u);
+  ASSERT_EQ(sids[0], "11");
+  ASSERT_TRUE(fastotv::client::inner::InnerClient::ParseRuntimeChannelsRequest("{\"id\":\"11\"}", &sids));
+  ASSERT_TRUE(fastotv::client::inner::InnerClient::ParseRuntimeChannelsRequest("{", &sids));
 }
@@ -0,0 +1,169 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "client/events/event_pool.h"
+#include "client/events/lock_free_ring.h"
+
+namespace {
+
+const size_t kProducersCount = 4;
+const uint64_t kPerProducer = 200000;
+
+struct TestEvent {
+  static std::atomic<int> alive;
+
+  TestEvent(int sender, const std::string& info) : sender(sender), info(info) { alive++; }
+  ~TestEvent() { alive--; }
+
+  int sender;
+  std::string info;
+};
+
+std::atomic<int> TestEvent::alive(0);
+
+}  // namespace
+
+TEST(LockFreeRing, FullAndEmpty) {
+  fastotv::client::events::LockFreeRing<int> ring(3);
+  ASSERT_EQ(ring.GetCapacity(), 4u);
+
+  int value = 0;
+  ASSERT_FALSE(ring.Pop(&value));
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(ring.Push(i));
+  }
+  ASSERT_FALSE(ring.Push(4));
+  ASSERT_EQ(ring.GetSize(), 4u);
+
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(ring.Pop(&value));
+    ASSERT_EQ(value, i);
+  }
+  ASSERT_FALSE(ring.Pop(&value));
+  ASSERT_TRUE(ring.Push(5));
+  ASSERT_TRUE(ring.Pop(&value));
+  ASSERT_EQ(value, 5);
+}
+
+TEST(LockFreeRing, ManyProducersKeepTheirOrder) {
+  fastotv::client::events::LockFreeRing<uint64_t> ring(1024);
+  std::atomic<size_t> full(0);
+  std::vector<std::thread> producers;
+  for (uint64_t producer = 0; producer < kProducersCount; ++producer) {
+    producers.emplace_back([&ring, &full, producer]() {
+      for (uint64_t i = 0; i < kPerProducer; ++i) {
+        while (!ring.Push(producer << 32 | i)) {
+          full++;
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  // the main thread plays the consumer
+  std::vector<uint64_t> next(kProducersCount, 0);
+  uint64_t popped = 0;
+  while (popped < kProducersCount * kPerProducer) {
+    uint64_t value = 0;
+    if (!ring.Pop(&value)) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    const uint64_t producer = value >> 32;
+    ASSERT_LT(producer, kProducersCount);
+    ASSERT_EQ(value & 0xFFFFFFFF, next[producer]);
+    next[producer]++;
+    popped++;
+  }
+
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  uint64_t value = 0;
+  ASSERT_FALSE(ring.Pop(&value));
+  ASSERT_EQ(ring.GetSize(), 0u);
+}
+
+TEST(EventPool, ReusesSlots) {
+  {
+    fastotv::client::events::EventPool<TestEvent> pool(2);
+    TestEvent* first = pool.Acquire(1, "first");
+    TestEvent* second = pool.Acquire(2, "second");
+    ASSERT_TRUE(first && second);
+    ASSERT_EQ(first->info, "first");
+    ASSERT_EQ(TestEvent::alive.load(), 2);
+    ASSERT_TRUE(pool.Acquire(3, "third") == nullptr);
+
+    pool.Release(first);
+    ASSERT_EQ(TestEvent::alive.load(), 1);
+    TestEvent* third = pool.Acquire(3, "third");
+    ASSERT_TRUE(third == first);
+    ASSERT_EQ(third->sender, 3);
+    pool.Release(second);
+    pool.Release(third);
+  }
+  ASSERT_EQ(TestEvent::alive.load(), 0);
+}
+
+TEST(EventPool, ProducersAcquireConsumerReleases) {
+  fastotv::client::events::EventPool<TestEvent> pool(64);
+  fastotv::client::events::LockFreeRing<TestEvent*> ring(64);
+  std::atomic<size_t> exhausted(0);
+  std::vector<std::thread> producers;
+  for (size_t producer = 0; producer < kProducersCount; ++producer) {
+    producers.emplace_back([&, producer]() {
+      for (size_t i = 0; i < kPerProducer / 10; ++i) {
+        TestEvent* event = nullptr;
+        while (!(event = pool.Acquire(static_cast<int>(producer), "runtime info"))) {
+          exhausted++;
+          std::this_thread::yield();
+        }
+        while (!ring.Push(event)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  size_t released = 0;
+  while (released < kProducersCount * (kPerProducer / 10)) {
+    TestEvent* event = nullptr;
+    if (!ring.Pop(&event)) {
+      std::this_thread::yield();
+      continue;
+    }
+    ASSERT_EQ(event->info, "runtime info");
+    pool.Release(event);
+    released++;
+  }
+
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  ASSERT_EQ(TestEvent::alive.load(), 0);
+}
@@ -0,0 +1,434 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <common/convert2string.h>
+
+#include "client/live_stream/icon_fetcher.h"
+#include "client/worker_pool.h"
+
+namespace {
+
+const int kServeDelayMsec = 50;
+
+// Stand-in for an icon host: HTTP/1.1 with keep-alive, every response takes kServeDelayMsec.
+// The ETag only depends on the version, so a client sending it for another url would wrongly get 304.
+// /moved<rest> is answered with 302 to the redirect target followed by <rest>, /loop redirects to itself.
+class IconServer {
+ public:
+  IconServer()
+      : listen_fd_(-1),
+        port_(0),
+        stop_(false),
+        version_(1),
+        accepted_(0),
+        requests_(0),
+        not_modified_(0),
+        active_(0),
+        max_active_(0),
+        redirect_target_() {}
+
+  ~IconServer() { Stop(); }
+
+  bool Start() {
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+      return false;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t len = sizeof(addr);
+    if (::bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(listen_fd_, 16) != 0 ||
+        ::getsockname(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), &len) != 0) {
+      return false;
+    }
+
+    port_ = ntohs(addr.sin_port);
+    accept_thread_ = std::thread([this]() { AcceptLoop(); });
+    return true;
+  }
+
+  void Stop() {
+    if (stop_.exchange(true)) {
+      return;
+    }
+
+    if (accept_thread_.joinable()) {
+      accept_thread_.join();
+    }
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      for (int fd : connections_) {
+        ::shutdown(fd, SHUT_RDWR);
+      }
+    }
+    for (std::thread& thread : connection_threads_) {
+      thread.join();
+    }
+    ::close(listen_fd_);
+  }
+
+  std::string GetUrl(const std::string& path) const {
+    return "http://127.0.0.1:" + common::ConvertToString(port_) + path;
+  }
+
+  void SetVersion(int version) { version_ = version; }
+  void SetRedirectTarget(const std::string& url) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    redirect_target_ = url;
+  }
+
+  size_t GetAcceptedCount() const { return accepted_; }
+  size_t GetRequestsCount() const { return requests_; }
+  size_t GetNotModifiedCount() const { return not_modified_; }
+  size_t GetMaxActive() const { return max_active_; }
+
+  static std::string MakeBody(const std::string& path, int version) {
+    return "icon " + path + " v" + common::ConvertToString(version);
+  }
+
+ private:
+  void AcceptLoop() {
+    while (!stop_) {
+      struct pollfd pfd = {listen_fd_, POLLIN, 0};
+      if (::poll(&pfd, 1, 20) <= 0) {
+        continue;
+      }
+
+      const int fd = ::accept(listen_fd_, nullptr, nullptr);
+      if (fd < 0) {
+        continue;
+      }
+
+      accepted_++;
+      std::unique_lock<std::mutex> lock(mutex_);
+      connections_.push_back(fd);
+      connection_threads_.push_back(std::thread([this, fd]() { Serve(fd); }));
+    }
+  }
+
+  void Serve(int fd) {
+    std::string input;
+    char buff[4096];
+    while (true) {
+      size_t end;
+      while ((end = input.find("\r\n\r\n")) == std::string::npos) {
+        const ssize_t res = ::recv(fd, buff, sizeof(buff), 0);
+        if (res <= 0) {
+          ::close(fd);
+          return;
+        }
+        input.append(buff, res);
+      }
+
+      const std::string request = input.substr(0, end);
+      input.erase(0, end + 4);
+      const size_t path_begin = request.find(' ') + 1;
+      const std::string path = request.substr(path_begin, request.find(' ', path_begin) - path_begin);
+      requests_++;
+
+      const size_t active = ++active_;
+      size_t max_active = max_active_;
+      while (active > max_active && !max_active_.compare_exchange_weak(max_active, active)) {
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(kServeDelayMsec));
+      active_--;
+
+      const int version = version_;
+      const std::string etag = "\"v" + common::ConvertToString(version) + "\"";
+      std::string response;
+      std::string location;
+      if (path.compare(0, 6, "/moved") == 0) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        location = redirect_target_ + path.substr(6);
+      } else if (path == "/loop") {
+        location = path;  // relative
+      }
+      if (!location.empty()) {
+        response = "HTTP/1.1 302 Found\r\nLocation: " + location + "\r\nContent-Length: 5\r\n\r\nmoved";
+      } else if (request.find("If-None-Match: " + etag) != std::string::npos) {
+        not_modified_++;
+        response = "HTTP/1.1 304 Not Modified\r\nETag: " + etag + "\r\n\r\n";
+      } else {
+        const std::string body = MakeBody(path, version);
+        response = "HTTP/1.1 200 OK\r\nETag: " + etag + "\r\nContent-Type: image/png\r\nContent-Length: " +
+                   common::ConvertToString(body.size()) + "\r\n\r\n" + body;
+      }
+      if (::send(fd, response.data(), response.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(response.size())) {
+        ::close(fd);
+        return;
+      }
+    }
+  }
+
+  int listen_fd_;
+  uint16_t port_;
+  std::atomic<bool> stop_;
+  std::atomic<int> version_;
+  std::atomic<size_t> accepted_;
+  std::atomic<size_t> requests_;
+  std::atomic<size_t> not_modified_;
+  std::atomic<size_t> active_;
+  std::atomic<size_t> max_active_;
+  std::thread accept_thread_;
+  std::mutex mutex_;
+  std::vector<int> connections_;
+  std::vector<std::thread> connection_threads_;
+  std::string redirect_target_;
+};
+
+std::string MakeTempDir() {
+  char dir[] = "/tmp/icon_fetcher_XXXXXX";
+  return mkdtemp(dir) ? dir : std::string();
+}
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  std::stringstream content;
+  content << file.rdbuf();
+  return content.str();
+}
+
+bool WaitForFetches(const fastotv::client::IconFetcher& fetcher, size_t count) {
+  for (int i = 0; i < 1000; ++i) {
+    const fastotv::client::IconFetcher::Stats stats = fetcher.GetStats();
+    if (stats.downloaded + stats.not_modified + stats.failed >= count) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return false;
+}
+
+class FetchedCounter {
+ public:
+  FetchedCounter() : count_(0) {}
+
+  fastotv::client::IconFetcher::fetched_callback_t GetCallback() {
+    return [this](const fastotv::stream_id_t&, const std::string&) { count_++; };
+  }
+  size_t GetCount() const { return count_; }
+
+ private:
+  std::atomic<size_t> count_;
+};
+
+}  // namespace
+
+TEST(IconFetcher, FetchesInParallelOverReusedConnections) {
+  const size_t kIcons = 12;
+  const size_t kParallel = 3;
+
+  IconServer server;
+  ASSERT_TRUE(server.Start());
+  const std::string dir = MakeTempDir();
+  ASSERT_FALSE(dir.empty());
+
+  fastotv::client::WorkerPool pool(4, 64);
+  pool.Start();
+  FetchedCounter fetched;
+  fastotv::client::IconFetcher fetcher(&pool, kParallel, fetched.GetCallback());
+  fetcher.Start();
+  for (size_t i = 0; i < kIcons; ++i) {
+    const std::string name = "/icon/" + common::ConvertToString(i);
+    fetcher.Fetch(common::ConvertToString(i), common::uri::GURL(server.GetUrl(name)),
+                  dir + "/" + common::ConvertToString(i) + ".png");
+  }
+  ASSERT_TRUE(WaitForFetches(fetcher, kIcons));
+
+  const fastotv::client::IconFetcher::Stats stats = fetcher.GetStats();
+  ASSERT_EQ(stats.downloaded, kIcons);
+  ASSERT_EQ(stats.failed, 0u);
+  ASSERT_EQ(fetched.GetCount(), kIcons);
+  ASSERT_GE(server.GetMaxActive(), 2u);
+  ASSERT_LE(server.GetMaxActive(), kParallel);
+  ASSERT_LE(server.GetAcceptedCount(), kParallel);
+  ASSERT_LE(stats.connections_opened, kParallel);
+  ASSERT_EQ(server.GetRequestsCount(), kIcons);
+  for (size_t i = 0; i < kIcons; ++i) {
+    const std::string name = "/icon/" + common::ConvertToString(i);
+    ASSERT_EQ(ReadFile(dir + "/" + common::ConvertToString(i) + ".png"), IconServer::MakeBody(name, 1));
+  }
+
+  fetcher.Stop();
+  pool.Stop();
+  server.Stop();
+}
+
+TEST(IconFetcher, RevalidatesCachedIcon) {
+  IconServer server;
+  ASSERT_TRUE(server.Start());
+  const std::string dir = MakeTempDir();
+  ASSERT_FALSE(dir.empty());
+
+  fastotv::client::WorkerPool pool(2, 64);
+  pool.Start();
+  FetchedCounter fetched;
+  fastotv::client::IconFetcher fetcher(&pool, 2, fetched.GetCallback());
+  fetcher.Start();
+
+  const std::string path = dir + "/icon.png";
+  const common::uri::GURL url(server.GetUrl("/icon/1"));
+  fetcher.Fetch("1", url, path);
+  ASSERT_TRUE(WaitForFetches(fetcher, 1));
+  ASSERT_EQ(fetched.GetCount(), 1u);
+
+  fetcher.Fetch("1", url, path);
+  ASSERT_TRUE(WaitForFetches(fetcher, 2));
+  ASSERT_EQ(fetcher.GetStats().not_modified, 1u);
+  ASSERT_EQ(server.GetNotModifiedCount(), 1u);
+  ASSERT_EQ(fetched.GetCount(), 1u);
+  ASSERT_EQ(ReadFile(path), IconServer::MakeBody("/icon/1", 1));
+
+  server.SetVersion(2);
+  fetcher.Fetch("1", url, path);
+  ASSERT_TRUE(WaitForFetches(fetcher, 3));
+  ASSERT_EQ(fetcher.GetStats().downloaded, 2u);
+  ASSERT_EQ(fetched.GetCount(), 2u);
+  ASSERT_EQ(ReadFile(path), IconServer::MakeBody("/icon/1", 2));
+  ASSERT_EQ(server.GetAcceptedCount(), 1u);
+
+  fetcher.Stop();
+  pool.Stop();
+  server.Stop();
+}
+
+TEST(IconFetcher, RefetchesWhenUrlChanged) {
+  IconServer server;
+  ASSERT_TRUE(server.Start());
+  const std::string dir = MakeTempDir();
+  ASSERT_FALSE(dir.empty());
+
+  fastotv::client::WorkerPool pool(2, 64);
+  pool.Start();
+  FetchedCounter fetched;
+  fastotv::client::IconFetcher fetcher(&pool, 2, fetched.GetCallback());
+  fetcher.Start();
+
+  const std::string path = dir + "/icon.png";
+  fetcher.Fetch("1", common::uri::GURL(server.GetUrl("/old/1")), path);
+  ASSERT_TRUE(WaitForFetches(fetcher, 1));
+
+  fetcher.Fetch("1", common::uri::GURL(server.GetUrl("/new/1")), path);
+  ASSERT_TRUE(WaitForFetches(fetcher, 2));
+  ASSERT_EQ(fetcher.GetStats().downloaded, 2u);
+  ASSERT_EQ(server.GetNotModifiedCount(), 0u);
+  ASSERT_EQ(fetched.GetCount(), 2u);
+  ASSERT_EQ(ReadFile(path), IconServer::MakeBody("/new/1", 1));
+
+  fetcher.Stop();
+  pool.Stop();
+  server.Stop();
+}
+
+TEST(IconFetcher, FollowsRedirectsToAnotherHost) {
+  const size_t kIcons = 3;
+
+  IconServer origin;
+  ASSERT_TRUE(origin.Start());
+  IconServer cdn;
+  ASSERT_TRUE(cdn.Start());
+  origin.SetRedirectTarget(cdn.GetUrl("/icon"));
+  const std::string dir = MakeTempDir();
+  ASSERT_FALSE(dir.empty());
+
+  fastotv::client::WorkerPool pool(2, 64);
+  pool.Start();
+  FetchedCounter fetched;
+  fastotv::client::IconFetcher fetcher(&pool, 1, fetched.GetCallback());
+  fetcher.Start();
+  for (size_t i = 0; i < kIcons; ++i) {
+    const std::string name = "/" + common::ConvertToString(i);
+    fetcher.Fetch(common::ConvertToString(i), common::uri::GURL(origin.GetUrl("/moved" + name)),
+                  dir + "/" + common::ConvertToString(i) + ".png");
+  }
+  ASSERT_TRUE(WaitForFetches(fetcher, kIcons));
+
+  const fastotv::client::IconFetcher::Stats stats = fetcher.GetStats();
+  ASSERT_EQ(stats.downloaded, kIcons);
+  ASSERT_EQ(stats.redirects, kIcons);
+  ASSERT_EQ(stats.requests, 2 * kIcons);
+  ASSERT_EQ(fetched.GetCount(), kIcons);
+  for (size_t i = 0; i < kIcons; ++i) {
+    const std::string name = "/icon/" + common::ConvertToString(i);
+    ASSERT_EQ(ReadFile(dir + "/" + common::ConvertToString(i) + ".png"), IconServer::MakeBody(name, 1));
+  }
+
+  // one kept alive connection per host, the redirect body did not end up in an icon
+  ASSERT_EQ(origin.GetAcceptedCount(), 1u);
+  ASSERT_EQ(cdn.GetAcceptedCount(), 1u);
+  ASSERT_EQ(stats.connections_opened, 2u);
+
+  fetcher.Stop();
+  pool.Stop();
+  origin.Stop();
+  cdn.Stop();
+}
+
+TEST(IconFetcher, GivesUpOnRedirectLoop) {
+  IconServer server;
+  ASSERT_TRUE(server.Start());
+  const std::string dir = MakeTempDir();
+  ASSERT_FALSE(dir.empty());
+
+  fastotv::client::WorkerPool pool(2, 64);
+  pool.Start();
+  FetchedCounter fetched;
+  fastotv::client::IconFetcher fetcher(&pool, 1, fetched.GetCallback());
+  fetcher.Start();
+
+  const std::string path = dir + "/icon.png";
+  fetcher.Fetch("1", common::uri::GURL(server.GetUrl("/loop")), path);
+  ASSERT_TRUE(WaitForFetches(fetcher, 1));
+
+  const fastotv::client::IconFetcher::Stats stats = fetcher.GetStats();
+  ASSERT_EQ(stats.failed, 1u);
+  ASSERT_EQ(stats.redirects, static_cast<size_t>(fastotv::client::IconFetcher::max_redirects));
+  ASSERT_EQ(server.GetRequestsCount(), static_cast<size_t>(fastotv::client::IconFetcher::max_redirects) + 1);
+  ASSERT_EQ(fetched.GetCount(), 0u);
+  ASSERT_FALSE(std::ifstream(path).good());
+  ASSERT_FALSE(std::ifstream(path + ".part").good());
+
+  fetcher.Stop();
+  pool.Stop();
+  server.Stop();
+}
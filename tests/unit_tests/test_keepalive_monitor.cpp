@@ -0,0 +1,113 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "client/inner/keepalive_monitor.h"
+
+TEST(KeepAliveMonitor, SmoothsRtt) {
+  fastotv::client::inner::KeepAliveMonitor monitor(30000);
+  monitor.Reset(0);
+  ASSERT_FALSE(monitor.IsPingDue(29999));
+  ASSERT_TRUE(monitor.IsPingDue(30000));
+  ASSERT_FALSE(monitor.PongReceived("1", 30000));
+
+  monitor.PingSent("1", 30000);
+  ASSERT_TRUE(monitor.PongReceived("1", 30100));
+  ASSERT_EQ(monitor.GetSmoothedRtt(), 100);
+  ASSERT_EQ(monitor.GetRttVariance(), 50);
+  ASSERT_EQ(monitor.GetRto(), fastotv::client::inner::KeepAliveMonitor::min_rto_msec);
+
+  monitor.PingSent("2", 60000);
+  ASSERT_TRUE(monitor.PongReceived("2", 60900));
+  ASSERT_EQ(monitor.GetLastRtt(), 900);
+  ASSERT_EQ(monitor.GetSmoothedRtt(), 200);
+  ASSERT_EQ(monitor.GetRttVariance(), 237);
+  ASSERT_EQ(monitor.GetRto(), 1148);
+}
+
+TEST(KeepAliveMonitor, MatchesPongsById) {
+  fastotv::client::inner::KeepAliveMonitor monitor(30000);
+  monitor.Reset(0);
+  monitor.PingSent("1", 30000);
+  monitor.PingSent("2", 33000);
+
+  // the second probe is answered first, its rtt is not taken from the first send time
+  ASSERT_TRUE(monitor.PongReceived("2", 33200));
+  ASSERT_EQ(monitor.GetLastRtt(), 200);
+  ASSERT_FALSE(monitor.PongReceived("2", 33300));
+  ASSERT_FALSE(monitor.PongReceived("3", 33300));
+  ASSERT_TRUE(monitor.PongReceived("1", 33400));
+  ASSERT_EQ(monitor.GetLastRtt(), 3400);
+}
+
+TEST(KeepAliveMonitor, DeclaresSilentPeerDeadWithBackoff) {
+  fastotv::client::inner::KeepAliveMonitor monitor(30000);
+  monitor.Reset(0);
+  monitor.PingSent("0", 30000);
+  ASSERT_TRUE(monitor.PongReceived("0", 30100));
+  const common::time64_t rto = monitor.GetRto();
+
+  common::time64_t now = 60000;
+  size_t probes = 0;
+  monitor.PingSent(std::to_string(++probes), now);
+  while (true) {  // as the keepalive timer of the handler does
+    now += 100;
+    if (monitor.IsPeerDead(now)) {
+      break;
+    }
+    if (monitor.IsPingDue(now)) {
+      monitor.PingSent(std::to_string(++probes), now);
+    }
+  }
+  ASSERT_EQ(probes, 3u);
+  ASSERT_EQ(monitor.GetMissedCount(now), 3u);
+  ASSERT_EQ(monitor.GetRto(), 4 * rto);  // doubled for every probe in a row
+  ASSERT_GE(now - 60000, 7 * rto);
+  ASSERT_LE(now - 60000, 7 * rto + 300);
+
+  monitor.Reset(now);
+  ASSERT_FALSE(monitor.IsPeerDead(now + 30000));
+}
+
+TEST(KeepAliveMonitor, InboundDataProvesLife) {
+  fastotv::client::inner::KeepAliveMonitor monitor(30000);
+  monitor.Reset(0);
+  monitor.PingSent("0", 30000);
+  ASSERT_TRUE(monitor.PongReceived("0", 30100));
+  const common::time64_t rto = monitor.GetRto();
+
+  // a long reply keeps the server from answering the probes, but its data arrives
+  monitor.PingSent("1", 60000);
+  ASSERT_TRUE(monitor.IsPingDue(60000 + rto));
+  monitor.PingSent("2", 60000 + rto);
+  monitor.DataReceived(60000 + rto + 500);
+  ASSERT_EQ(monitor.GetRto(), rto);
+  ASSERT_EQ(monitor.GetMissedCount(60000 + 10 * rto), 0u);
+  ASSERT_FALSE(monitor.IsPeerDead(60000 + 10 * rto));
+
+  // idle again, the next ping is due an interval after the data
+  ASSERT_FALSE(monitor.IsPingDue(60000 + rto + 500 + 29999));
+  ASSERT_TRUE(monitor.IsPingDue(60000 + rto + 500 + 30000));
+
+  // the late pongs still give rtt samples
+  ASSERT_TRUE(monitor.PongReceived("1", 60000 + rto + 600));
+  ASSERT_EQ(monitor.GetLastRtt(), rto + 600);
+}
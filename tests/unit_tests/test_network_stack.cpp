@@ -0,0 +1,438 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <common/convert2string.h>
+
+#include <fastotv/commands/commands.h>
+#include <fastotv/commands_info/auth_info.h>
+
+#include "client/events/network_events.h"
+#include "client/inner/connection_options.h"
+#include "client/inner/inner_tcp_handler.h"
+#include "client/inner/inner_tcp_server.h"
+#include "client/inner/payload_compression.h"
+#include "tests/stand_in_server/stand_in_server.h"
+#include "tests/stand_in_server/tls_front.h"
+
+// The real connection handler on its own loop against the stand-in server, checked by the events it posts.
+
+namespace {
+
+typedef fastotv::stand_in::StandInServer StandInServer;
+typedef fastotv::stand_in::TlsFront TlsFront;
+typedef fastotv::client::inner::ConnectionOptions ConnectionOptions;
+typedef fastoplayer::gui::events::Event Event;
+namespace events = fastotv::client::events;
+
+const int kEventTimeoutMsec = 5000;
+
+fastotv::commands_info::AuthInfo MakeAuth() {
+  fastotv::commands_info::AuthInfo auth;
+  auth.SetLogin("stand_in@fastotv.com");
+  auth.SetPassword("password");
+  auth.SetDeviceID("5f3a1c0000000000000001");
+  return auth;
+}
+
+// login, wire format, compression when built with zstd, server info, channels
+size_t HandshakeRequestsCount() {
+  return fastotv::client::inner::PayloadDecoder::IsSupported() ? 5 : 4;
+}
+
+std::string HostToString(const common::net::HostAndPort& host) {
+  return common::ConvertToString(host);
+}
+
+// records what the handler posts to the application instead of posting it
+class ObservedHandler : public fastotv::client::inner::InnerTcpHandler {
+ public:
+  typedef fastotv::client::inner::InnerTcpHandler base_class;
+
+  struct Posted {
+    EventsType type;
+    common::Error err;  // set for exception events
+    std::shared_ptr<Event> event;
+  };
+
+  ObservedHandler(const std::vector<common::net::HostAndPort>& servers, const ConnectionOptions& options)
+      : base_class(servers, std::string(), MakeAuth(), options, nullptr, nullptr),
+        mutex_(),
+        cond_(),
+        posted_(),
+        taken_(0) {}
+
+  // the first event of the type posted after the one returned last time, the ones in between are skipped
+  bool WaitFor(EventsType type, Posted* posted) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(kEventTimeoutMsec);
+    while (true) {
+      for (size_t i = taken_; i < posted_.size(); ++i) {
+        if (posted_[i].type == type) {
+          *posted = posted_[i];
+          taken_ = i + 1;
+          return true;
+        }
+      }
+      if (cond_.wait_until(lock, until) == std::cv_status::timeout) {
+        return false;
+      }
+    }
+  }
+
+  size_t CountPosted(EventsType type) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    size_t count = 0;
+    for (const Posted& posted : posted_) {
+      count += posted.type == type;
+    }
+    return count;
+  }
+
+  template <typename T>
+  static const T* As(const Posted& posted) {
+    return static_cast<const T*>(posted.event.get());
+  }
+
+ protected:
+  void PostEvent(Event* event) override { Record(event, common::Error()); }
+  void PostExceptionEvent(Event* event, common::Error err) override { Record(event, err); }
+
+ private:
+  void Record(Event* event, common::Error err) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    posted_.push_back({event->GetEventType(), err, std::shared_ptr<Event>(event)});
+    cond_.notify_all();
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::vector<Posted> posted_;
+  size_t taken_;
+};
+
+// the network thread of the player: the handler connects as soon as the loop runs
+class NetworkThread {
+ public:
+  explicit NetworkThread(ObservedHandler* handler) : handler_(handler), loop_(handler), thread_() {
+    thread_ = std::thread([this]() { ignore_result(loop_.Exec()); });
+  }
+
+  ~NetworkThread() {
+    Exec([this]() {  // the handler closes its connection before the loop goes away
+      handler_->DisConnect(common::Error());
+      loop_.Stop();
+    });
+    thread_.join();
+  }
+
+  void Exec(std::function<void()> func) { loop_.ExecInLoopThread(func); }
+
+  void Reconnect() {
+    Exec([this]() { handler_->Connect(&loop_); });
+  }
+
+ private:
+  ObservedHandler* const handler_;
+  fastotv::client::inner::InnerTcpServer loop_;
+  std::thread thread_;
+};
+
+// accepted by the kernel but never served, a tls handshake with it never completes
+class SilentServer {
+ public:
+  SilentServer() : fd_(::socket(AF_INET, SOCK_STREAM, 0)), host_() {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    socklen_t len = sizeof(addr);
+    if (fd_ >= 0 && ::bind(fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0 &&
+        ::listen(fd_, SOMAXCONN) == 0 && ::getsockname(fd_, reinterpret_cast<struct sockaddr*>(&addr), &len) == 0) {
+      host_ = common::net::HostAndPort("127.0.0.1", ntohs(addr.sin_port));
+    }
+  }
+
+  ~SilentServer() {
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+  }
+
+  common::net::HostAndPort GetHost() const { return host_; }
+
+ private:
+  const int fd_;
+  common::net::HostAndPort host_;
+};
+
+ConnectionOptions MakeTlsOptions() {
+  ConnectionOptions options;
+  options.tls = true;
+  options.tls_verify_peer = false;  // the front has a self-signed certificate
+  return options;
+}
+
+}  // namespace
+
+TEST(NetworkStack, PipelinedHandshake) {
+  StandInServer::Script script;
+  script.channels_count = 100;
+  StandInServer server(script);
+  ASSERT_FALSE(server.Start());
+
+  ObservedHandler handler({server.GetHost()}, ConnectionOptions());
+  NetworkThread network(&handler);
+
+  ObservedHandler::Posted posted;
+  ASSERT_TRUE(handler.WaitFor(CLIENT_CONNECT_EVENT, &posted));
+  ASSERT_FALSE(posted.err);
+  ASSERT_EQ(HostToString(ObservedHandler::As<events::ClientConnectedEvent>(posted)->GetInfo().host),
+            HostToString(server.GetHost()));
+
+  ASSERT_TRUE(handler.WaitFor(CLIENT_HANDSHAKE_EVENT, &posted));
+  ASSERT_FALSE(posted.err);
+  const events::HandshakeInfo info = ObservedHandler::As<events::ClientHandshakeEvent>(posted)->GetInfo();
+  ASSERT_EQ(info.auth.GetLogin(), MakeAuth().GetLogin());
+  ASSERT_EQ(info.channels.channels.Get().size(), script.channels_count);
+
+  // one round of requests, the server does not know the wire format and the client stays on json
+  const StandInServer::Stats stats = server.GetStats();
+  ASSERT_EQ(stats.accepted, 1u);
+  ASSERT_EQ(stats.requests, HandshakeRequestsCount());
+  ASSERT_EQ(stats.methods.at(CLIENT_LOGIN), 1u);
+  ASSERT_EQ(stats.methods.at(CLIENT_SET_WIRE_FORMAT), 1u);
+  ASSERT_EQ(stats.methods.at(CLIENT_GET_CHANNELS), 1u);
+}
+
+TEST(NetworkStack, RejectedLoginFailsTheHandshake) {
+  StandInServer::Script script;
+  script.reject_login = true;
+  StandInServer server(script);
+  ASSERT_FALSE(server.Start());
+
+  ObservedHandler handler({server.GetHost()}, ConnectionOptions());
+  NetworkThread network(&handler);
+
+  ObservedHandler::Posted posted;
+  ASSERT_TRUE(handler.WaitFor(CLIENT_AUTHORIZED_EVENT, &posted));
+  ASSERT_TRUE(posted.err);
+}
+
+TEST(NetworkStack, ExpiredRequestIsResent) {
+  StandInServer::Script script;
+  script.drop_every = HandshakeRequestsCount();  // the first get_channels is never answered
+  StandInServer server(script);
+  ASSERT_FALSE(server.Start());
+
+  ConnectionOptions options;
+  options.request_timeout_msec = 100;
+  options.request_max_retries = 1;
+  ObservedHandler handler({server.GetHost()}, options);
+  NetworkThread network(&handler);
+
+  ObservedHandler::Posted posted;
+  ASSERT_TRUE(handler.WaitFor(CLIENT_HANDSHAKE_EVENT, &posted));
+  ASSERT_FALSE(posted.err);
+  ASSERT_EQ(ObservedHandler::As<events::ClientHandshakeEvent>(posted)->GetInfo().channels.channels.Get().size(),
+            script.channels_count);
+
+  const StandInServer::Stats stats = server.GetStats();
+  ASSERT_EQ(stats.dropped, 1u);
+  ASSERT_EQ(stats.methods.at(CLIENT_GET_CHANNELS), 2u);
+}
+
+TEST(NetworkStack, ExpiredRequestWithoutRetriesFailsTheHandshake) {
+  StandInServer::Script script;
+  script.drop_every = HandshakeRequestsCount();
+  StandInServer server(script);
+  ASSERT_FALSE(server.Start());
+
+  ConnectionOptions options;
+  options.request_timeout_msec = 100;
+  options.request_max_retries = 0;
+  ObservedHandler handler({server.GetHost()}, options);
+  NetworkThread network(&handler);
+
+  // answered by the handler as if the server rejected it
+  ObservedHandler::Posted posted;
+  ASSERT_TRUE(handler.WaitFor(CLIENT_HANDSHAKE_EVENT, &posted));
+  ASSERT_TRUE(posted.err);
+  ASSERT_EQ(server.GetStats().methods.at(CLIENT_GET_CHANNELS), 1u);
+}
+
+TEST(NetworkStack, ExpiredLoginReconnects) {
+  StandInServer::Script script;
+  script.drop_every = 1;  // nothing is answered
+  StandInServer server(script);
+  ASSERT_FALSE(server.Start());
+
+  ConnectionOptions options;
+  options.request_timeout_msec = 100;
+  options.request_max_retries = 1;
+  options.reconnect_min_delay_msec = 100;
+  ObservedHandler handler({server.GetHost()}, options);
+  NetworkThread network(&handler);
+
+  // a login without an answer is a broken connection, not a rejected one
+  ObservedHandler::Posted posted;
+  ASSERT_TRUE(handler.WaitFor(CLIENT_CONNECT_EVENT, &posted));
+  ASSERT_TRUE(handler.WaitFor(CLIENT_DISCONNECT_EVENT, &posted));
+  ASSERT_TRUE(handler.WaitFor(CLIENT_CONNECT_EVENT, &posted));
+  ASSERT_FALSE(posted.err);
+  ASSERT_EQ(handler.CountPosted(CLIENT_AUTHORIZED_EVENT), 0u);
+  const StandInServer::Stats stats = server.GetStats();
+  ASSERT_LE(stats.methods.at(CLIENT_LOGIN), stats.accepted);  // never sent twice on a connection
+}
+
+TEST(NetworkStack, StalledServerIsClosed) {
+  StandInServer::Script script;
+  script.stall_after_responses = HandshakeRequestsCount() + 2;  // answers two pings, then goes quiet
+  StandInServer server(script);
+  ASSERT_FALSE(server.Start());
+
+  ConnectionOptions options;
+  options.keepalive_interval_msec = 100;
+  options.reconnect_min_delay_msec = 60000;  // one connection is enough
+  options.reconnect_max_delay_msec = 60000;
+  ObservedHandler handler({server.GetHost()}, options);
+  NetworkThread network(&handler);
+
+  ObservedHandler::Posted posted;
+  ASSERT_TRUE(handler.WaitFor(CLIENT_HANDSHAKE_EVENT, &posted));
+  ASSERT_FALSE(posted.err);
+
+  // a few rto without a pong, the tcp connection itself stays up
+  const auto started = std::chrono::steady_clock::now();
+  const auto until = started + std::chrono::seconds(20);
+  bool closed = false;
+  while (!closed && std::chrono::steady_clock::now() < until) {
+    closed = handler.WaitFor(CLIENT_DISCONNECT_EVENT, &posted);
+  }
+  ASSERT_TRUE(closed);
+  const StandInServer::Stats stats = server.GetStats();
+  ASSERT_GE(stats.methods.at(CLIENT_PING), 3u);
+  ASSERT_EQ(stats.responses, script.stall_after_responses);
+}
+
+TEST(NetworkStack, FasterServerWinsTheRace) {
+  StandInServer::Script script;
+  StandInServer server(script);
+  ASSERT_FALSE(server.Start());
+  TlsFront front(server.GetHost());
+  ASSERT_FALSE(front.Start(0));
+  SilentServer silent;
+
+  // the silent server is tried first, its tls handshake hangs and the front joins after the stagger
+  ObservedHandler handler({silent.GetHost(), front.GetHost()}, MakeTlsOptions());
+  NetworkThread network(&handler);
+
+  ObservedHandler::Posted posted;
+  ASSERT_TRUE(handler.WaitFor(CLIENT_CONNECT_EVENT, &posted));
+  ASSERT_FALSE(posted.err);
+  ASSERT_EQ(HostToString(ObservedHandler::As<events::ClientConnectedEvent>(posted)->GetInfo().host),
+            HostToString(front.GetHost()));
+  ASSERT_TRUE(handler.WaitFor(CLIENT_HANDSHAKE_EVENT, &posted));
+  ASSERT_FALSE(posted.err);
+}
+
+TEST(NetworkStack, TlsUpgradeAndResumption) {
+  StandInServer::Script script;
+  StandInServer server(script);
+  ASSERT_FALSE(server.Start());
+  TlsFront front(server.GetHost());
+  ASSERT_FALSE(front.Start(0));
+
+  ObservedHandler handler({front.GetHost()}, MakeTlsOptions());
+  NetworkThread network(&handler);
+
+  ObservedHandler::Posted posted;
+  ASSERT_TRUE(handler.WaitFor(CLIENT_HANDSHAKE_EVENT, &posted));
+  ASSERT_FALSE(posted.err);
+  ASSERT_EQ(ObservedHandler::As<events::ClientHandshakeEvent>(posted)->GetInfo().channels.channels.Get().size(),
+            script.channels_count);
+
+  network.Reconnect();  // the session of the first connection is offered again
+  ASSERT_TRUE(handler.WaitFor(CLIENT_DISCONNECT_EVENT, &posted));
+  ASSERT_TRUE(handler.WaitFor(CLIENT_HANDSHAKE_EVENT, &posted));
+  ASSERT_FALSE(posted.err);
+
+  const TlsFront::Stats stats = front.GetStats();
+  ASSERT_EQ(stats.handshakes, 2u);
+  ASSERT_EQ(stats.resumed, 1u);
+  ASSERT_EQ(server.GetStats().accepted, 2u);
+}
+
+TEST(NetworkStack, ChannelsSplitAcrossSegments) {
+  StandInServer::Script script;
+  script.channels_count = 1000;
+  script.write_piece_size = 1024;
+  script.write_pause_msec = 1;
+  StandInServer server(script);
+  ASSERT_FALSE(server.Start());
+  ASSERT_GT(StandInServer::MakeChannelsResult(script.channels_count).size(), 64 * script.write_piece_size);
+
+  ObservedHandler handler({server.GetHost()}, ConnectionOptions());
+  NetworkThread network(&handler);
+
+  // the client reads each frame as it trickles in, not as a broken connection
+  ObservedHandler::Posted posted;
+  ASSERT_TRUE(handler.WaitFor(CLIENT_HANDSHAKE_EVENT, &posted));
+  ASSERT_FALSE(posted.err);
+  ASSERT_EQ(ObservedHandler::As<events::ClientHandshakeEvent>(posted)->GetInfo().channels.channels.Get().size(),
+            script.channels_count);
+  ASSERT_EQ(server.GetStats().accepted, 1u);
+}
+
+TEST(NetworkStack, TlsChannelsSplitAcrossSegments) {
+  StandInServer::Script script;
+  script.channels_count = 1000;
+  script.write_piece_size = 1024;
+  script.write_pause_msec = 1;
+  StandInServer server(script);
+  ASSERT_FALSE(server.Start());
+  TlsFront front(server.GetHost());
+  ASSERT_FALSE(front.Start(0));
+
+  ObservedHandler handler({front.GetHost()}, MakeTlsOptions());
+  NetworkThread network(&handler);
+
+  ObservedHandler::Posted posted;
+  ASSERT_TRUE(handler.WaitFor(CLIENT_HANDSHAKE_EVENT, &posted));
+  ASSERT_FALSE(posted.err);
+  ASSERT_EQ(ObservedHandler::As<events::ClientHandshakeEvent>(posted)->GetInfo().channels.channels.Get().size(),
+            script.channels_count);
+  ASSERT_EQ(front.GetStats().handshakes, 1u);
+  ASSERT_EQ(server.GetStats().accepted, 1u);
+}
@@ -0,0 +1,159 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+
+#include <string>
+
+#include <json-c/json_object.h>
+#include <json-c/json_tokener.h>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "client/inner/payload_compression.h"
+
+typedef fastotv::client::inner::PayloadDecoder PayloadDecoder;
+
+namespace {
+
+// {"encoding": "zstd", "data": data}
+json_object* MakeEncoded(const std::string& data) {
+  json_object* jresult = json_object_new_object();
+  json_object_object_add(jresult, "encoding", json_object_new_string(PAYLOAD_CODEC_ZSTD));
+  json_object_object_add(jresult, "data", json_object_new_string_len(data.data(), static_cast<int>(data.size())));
+  return jresult;
+}
+
+#ifdef HAVE_ZSTD
+std::string Compress(const std::string& text) {
+  std::string frame(ZSTD_compressBound(text.size()), '\0');
+  const size_t size = ZSTD_compress(&frame[0], frame.size(), text.data(), text.size(), 3);
+  frame.resize(ZSTD_isError(size) ? 0 : size);
+  return frame;
+}
+
+std::string Base64(const std::string& data) {
+  static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  size_t i = 0;
+  for (; i + 2 < data.size(); i += 3) {
+    const uint32_t n = (uint8_t(data[i]) << 16) | (uint8_t(data[i + 1]) << 8) | uint8_t(data[i + 2]);
+    out += {alphabet[n >> 18], alphabet[(n >> 12) & 63], alphabet[(n >> 6) & 63], alphabet[n & 63]};
+  }
+  if (i + 1 == data.size()) {
+    const uint32_t n = uint8_t(data[i]) << 16;
+    out += {alphabet[n >> 18], alphabet[(n >> 12) & 63], '=', '='};
+  } else if (i + 2 == data.size()) {
+    const uint32_t n = (uint8_t(data[i]) << 16) | (uint8_t(data[i + 1]) << 8);
+    out += {alphabet[n >> 18], alphabet[(n >> 12) & 63], alphabet[(n >> 6) & 63], '='};
+  }
+  return out;
+}
+
+std::string MakeChannels(size_t count) {
+  std::string text = "{\"channels\":[";
+  for (size_t i = 0; i < count; ++i) {
+    text += (i ? ",{\"id\":\"" : "{\"id\":\"") + std::to_string(i) + "\",\"name\":\"Channel\"}";
+  }
+  return text + "]}";
+}
+#endif
+
+}  // namespace
+
+TEST(PayloadDecoder, PlainResultIsPassedThrough) {
+  PayloadDecoder decoder;
+  json_object* jresult = json_tokener_parse("{\"channels\":[]}");
+  json_object* jout = nullptr;
+  ASSERT_FALSE(decoder.ParseResult(jresult, fastotv::client::inner::JSON_WIRE_FORMAT, &jout));
+  ASSERT_EQ(jout, jresult);
+  json_object_put(jout);
+  json_object_put(jresult);
+
+  jresult = MakeEncoded("x");
+  jout = nullptr;
+  json_object_object_add(jresult, "encoding", json_object_new_string("brotli"));
+  ASSERT_TRUE(decoder.ParseResult(jresult, fastotv::client::inner::JSON_WIRE_FORMAT, &jout));
+  json_object_put(jresult);
+}
+
+#ifdef HAVE_ZSTD
+TEST(PayloadDecoder, BinaryFrameInMsgPackAndBase64InJson) {
+  const std::string text = MakeChannels(1000);
+  const std::string frame = Compress(text);
+  ASSERT_FALSE(frame.empty());
+
+  PayloadDecoder decoder;
+  json_object* jbinary = MakeEncoded(frame);
+  json_object* jout = nullptr;
+  ASSERT_FALSE(decoder.ParseResult(jbinary, fastotv::client::inner::MSGPACK_WIRE_FORMAT, &jout));
+  ASSERT_EQ(json_object_array_length(json_object_object_get(jout, "channels")), 1000u);
+  json_object_put(jout);
+
+  // raw bytes are not base64
+  ASSERT_TRUE(decoder.ParseResult(jbinary, fastotv::client::inner::JSON_WIRE_FORMAT, &jout));
+  json_object_put(jbinary);
+
+  json_object* jtext = MakeEncoded(Base64(frame));
+  jout = nullptr;
+  ASSERT_FALSE(decoder.ParseResult(jtext, fastotv::client::inner::JSON_WIRE_FORMAT, &jout));
+  ASSERT_EQ(json_object_array_length(json_object_object_get(jout, "channels")), 1000u);
+  json_object_put(jout);
+  json_object_put(jtext);
+}
+
+TEST(PayloadDecoder, DecompressedSizeIsCapped) {
+  // compresses to a few kilobytes
+  const std::string text = "{\"padding\":\"" + std::string(PayloadDecoder::max_decompressed_size, ' ') + "\"}";
+  const std::string frame = Compress(text);
+  ASSERT_FALSE(frame.empty());
+  ASSERT_LT(frame.size(), 64u * 1024);
+
+  PayloadDecoder decoder;
+  json_object* jresult = MakeEncoded(frame);
+  json_object* jout = nullptr;
+  ASSERT_TRUE(decoder.ParseResult(jresult, fastotv::client::inner::MSGPACK_WIRE_FORMAT, &jout));
+  ASSERT_EQ(jout, nullptr);
+
+  // a frame without the content size in its header is stopped while decompressing
+  ZSTD_CCtx* cctx = ZSTD_createCCtx();
+  ZSTD_CCtx_setParameter(cctx, ZSTD_c_contentSizeFlag, 0);
+  std::string streamed(ZSTD_compressBound(text.size()), '\0');
+  const size_t streamed_size = ZSTD_compress2(cctx, &streamed[0], streamed.size(), text.data(), text.size());
+  ZSTD_freeCCtx(cctx);
+  ASSERT_FALSE(ZSTD_isError(streamed_size));
+  streamed.resize(streamed_size);
+  ASSERT_EQ(ZSTD_getFrameContentSize(streamed.data(), streamed.size()), ZSTD_CONTENTSIZE_UNKNOWN);
+
+  json_object* jstreamed = MakeEncoded(streamed);
+  ASSERT_TRUE(decoder.ParseResult(jstreamed, fastotv::client::inner::MSGPACK_WIRE_FORMAT, &jout));
+  ASSERT_EQ(jout, nullptr);
+
+  // the decoder is still usable
+  json_object* jsmall = MakeEncoded(Compress(MakeChannels(1)));
+  ASSERT_FALSE(decoder.ParseResult(jsmall, fastotv::client::inner::MSGPACK_WIRE_FORMAT, &jout));
+  json_object_put(jout);
+  json_object_put(jsmall);
+  json_object_put(jstreamed);
+  json_object_put(jresult);
+}
+#endif
@@ -0,0 +1,73 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "client/inner/request_deadlines.h"
+
+namespace {
+
+fastotv::protocol::request_t MakeRequest(const std::string& id, const std::string& method) {
+  fastotv::protocol::request_t req;
+  req.id = id;
+  req.method = method;
+  return req;
+}
+
+}  // namespace
+
+TEST(RequestDeadlines, ExpiresInDeadlineOrder) {
+  fastotv::client::inner::RequestDeadlines deadlines;
+  deadlines.Add(MakeRequest("1", "login"), 0, 300);
+  deadlines.Add(MakeRequest("2", "get_server_info"), 0, 100);
+  deadlines.Add(MakeRequest("3", "get_channels"), 1, 200);
+
+  common::time64_t next = 0;
+  ASSERT_TRUE(deadlines.GetNextDeadline(&next));
+  ASSERT_EQ(next, 100);
+
+  fastotv::client::inner::RequestDeadlines::Pending expired;
+  ASSERT_FALSE(deadlines.PopExpired(99, &expired));
+  ASSERT_TRUE(deadlines.PopExpired(250, &expired));
+  ASSERT_EQ(expired.request.method, "get_server_info");
+  ASSERT_TRUE(deadlines.PopExpired(250, &expired));
+  ASSERT_EQ(expired.request.method, "get_channels");
+  ASSERT_EQ(expired.attempt, 1u);
+  ASSERT_FALSE(deadlines.PopExpired(250, &expired));
+  ASSERT_EQ(deadlines.GetPendingCount(), 1u);
+}
+
+TEST(RequestDeadlines, AnsweredRequestsNeverExpire) {
+  fastotv::client::inner::RequestDeadlines deadlines;
+  deadlines.Add(MakeRequest("1", "get_server_info"), 0, 100);
+  deadlines.Add(MakeRequest("2", "get_channels"), 0, 200);
+
+  ASSERT_TRUE(deadlines.Remove(MakeRequest("1", "").id));
+  ASSERT_FALSE(deadlines.Remove(MakeRequest("7", "").id));
+
+  common::time64_t next = 0;
+  ASSERT_TRUE(deadlines.GetNextDeadline(&next));
+  ASSERT_EQ(next, 200);
+
+  fastotv::client::inner::RequestDeadlines::Pending expired;
+  ASSERT_TRUE(deadlines.PopExpired(1000, &expired));
+  ASSERT_EQ(expired.request.method, "get_channels");
+  ASSERT_FALSE(deadlines.GetNextDeadline(&next));
+}
@@ -0,0 +1,200 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <common/convert2string.h>
+#include <common/sprintf.h>
+
+#include "client/inner/inbound_message.h"
+#include "client/inner/inner_client.h"
+#include "client/live_stream/runtime_info_coalescer.h"
+
+namespace {
+
+const size_t kStreamsCount = 20;
+const size_t kRoundsCount = 5000;
+
+fastotv::stream_id_t MakeStreamID(size_t i) {
+  return "stream_" + common::ConvertToString(i);
+}
+
+// Stand-in for the server end of the subscription: pushes runtime_channels_info notifications,
+// one line each, as fast as the socket accepts them.
+class PushServer {
+ public:
+  explicit PushServer(int fd) : fd_(fd) {}
+
+  void Run(size_t streams, size_t rounds) {
+    for (size_t round = 0; round < rounds; ++round) {
+      std::string channels;
+      for (size_t i = 0; i < streams; ++i) {
+        fastotv::commands_info::RuntimeChannelInfo chan(MakeStreamID(i), round);
+        std::string chan_str;
+        ASSERT_FALSE(chan.SerializeToString(&chan_str));
+        channels += (i ? "," : "") + chan_str;
+      }
+
+      const std::string line = common::MemSPrintf(
+          "{\"jsonrpc\":\"2.0\",\"method\":\"" SERVER_RUNTIME_CHANNELS_INFO "\",\"params\":{\"channels\":[%s]}}\n",
+          channels);
+      ASSERT_TRUE(WriteAll(line));
+    }
+    ::shutdown(fd_, SHUT_WR);
+  }
+
+ private:
+  bool WriteAll(const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+      ssize_t res = ::write(fd_, data.data() + written, data.size() - written);
+      if (res <= 0) {
+        return false;
+      }
+      written += res;
+    }
+    return true;
+  }
+
+  const int fd_;
+};
+
+// client side: what InnerTcpHandler does with a received notification
+void ReadNotifications(int fd, fastotv::client::RuntimeInfoCoalescer* coalescer, size_t* notifications) {
+  fastotv::client::inner::InboundMessage message;
+  std::string buffer;
+  char chunk[4096];
+  ssize_t res;
+  while ((res = ::read(fd, chunk, sizeof(chunk))) > 0) {
+    buffer.append(chunk, res);
+    size_t pos;
+    while ((pos = buffer.find('\n')) != std::string::npos) {
+      const std::string line = buffer.substr(0, pos);
+      buffer.erase(0, pos + 1);
+
+      ASSERT_FALSE(message.Parse(line.data(), line.size(), fastotv::client::inner::JSON_WIRE_FORMAT));
+      ASSERT_TRUE(message.IsRequest());
+      ASSERT_EQ(message.GetMethod(), SERVER_RUNTIME_CHANNELS_INFO);
+
+      fastotv::client::inner::InnerClient::runtime_channels_t channels;
+      ASSERT_FALSE(
+          fastotv::client::inner::InnerClient::ParseRuntimeChannelsNotification(message.GetParams(), &channels));
+      message.Clear();
+      coalescer->Push(channels);
+      (*notifications)++;
+    }
+  }
+}
+
+}  // namespace
+
+TEST(RuntimeInfoCoalescer, KeepsLatestPerStream) {
+  size_t notified = 0;
+  fastotv::client::RuntimeInfoCoalescer coalescer([&notified]() { notified++; });
+
+  typedef fastotv::commands_info::RuntimeChannelInfo RuntimeChannelInfo;
+  coalescer.Push({RuntimeChannelInfo("1", 1), RuntimeChannelInfo("2", 1)});
+  coalescer.Push({RuntimeChannelInfo("1", 5)});
+  ASSERT_EQ(notified, 1u);
+
+  auto channels = coalescer.Take();
+  ASSERT_EQ(channels.size(), 2u);
+  ASSERT_EQ(channels[0].GetStreamID(), "1");
+  ASSERT_EQ(channels[0].GetWatchersCount(), 5u);
+  ASSERT_EQ(channels[1].GetWatchersCount(), 1u);
+  ASSERT_TRUE(coalescer.Take().empty());
+
+  coalescer.Push({RuntimeChannelInfo("2", 7)});
+  ASSERT_EQ(notified, 2u);
+}
+
+TEST(RuntimeInfoCoalescer, FoldsReplyBurstWithoutCallback) {
+  // how the player folds one drain of runtime info replies
+  fastotv::client::RuntimeInfoCoalescer coalescer(nullptr);
+  typedef fastotv::commands_info::RuntimeChannelInfo RuntimeChannelInfo;
+  for (size_t round = 0; round < kRoundsCount; ++round) {
+    coalescer.Push({RuntimeChannelInfo(MakeStreamID(round % kStreamsCount), round)});
+  }
+
+  auto channels = coalescer.Take();
+  ASSERT_EQ(channels.size(), kStreamsCount);
+  for (const auto& chan : channels) {
+    ASSERT_GE(chan.GetWatchersCount(), kRoundsCount - kStreamsCount);
+  }
+}
+
+TEST(RuntimeInfoCoalescer, KeepsUpWithPushServer) {
+  int fds[2];
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+  std::atomic<size_t> wakeups(0);
+  fastotv::client::RuntimeInfoCoalescer coalescer([&wakeups]() { wakeups++; });
+
+  PushServer server(fds[0]);
+  std::thread server_thread([&server]() { server.Run(kStreamsCount, kRoundsCount); });
+
+  std::atomic<bool> reader_done(false);
+  size_t notifications = 0;
+  std::thread reader_thread([&]() {
+    ReadNotifications(fds[1], &coalescer, &notifications);
+    reader_done = true;
+  });
+
+  // main thread plays the ui loop: one drain per frame
+  std::map<fastotv::stream_id_t, size_t> watchers;
+  size_t frames = 0;
+  size_t ui_updates = 0;
+  while (true) {
+    const bool done = reader_done;
+    auto channels = coalescer.Take();
+    if (!channels.empty()) {
+      ui_updates++;
+    }
+    for (const auto& chan : channels) {
+      watchers[chan.GetStreamID()] = chan.GetWatchersCount();
+    }
+    if (done) {
+      break;
+    }
+    frames++;
+    std::this_thread::sleep_for(std::chrono::milliseconds(16));
+  }
+
+  server_thread.join();
+  reader_thread.join();
+  ::close(fds[0]);
+  ::close(fds[1]);
+
+  ASSERT_EQ(notifications, kRoundsCount);
+  ASSERT_LE(ui_updates, frames + 1);
+  ASSERT_LE(wakeups.load(), ui_updates + 1);
+  ASSERT_EQ(watchers.size(), kStreamsCount);
+  for (size_t i = 0; i < kStreamsCount; ++i) {
+    ASSERT_EQ(watchers[MakeStreamID(i)], kRoundsCount - 1);
+  }
+}
@@ -0,0 +1,82 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+
+#include <vector>
+
+#include "client/inner/server_selector.h"
+
+namespace {
+
+std::vector<common::net::HostAndPort> MakeServers() {
+  return {common::net::HostAndPort("eu.fastotv.com", 6000), common::net::HostAndPort("us.fastotv.com", 6000),
+          common::net::HostAndPort("asia.fastotv.com", 6000)};
+}
+
+}  // namespace
+
+TEST(ServerSelector, RanksByLatencyAndCoolsDownFailures) {
+  fastotv::client::inner::ServerSelector selector(MakeServers());
+  ASSERT_EQ(selector.Rank(0), std::vector<size_t>({0, 1, 2}));
+
+  selector.ConnectSucceeded(0, 120);
+  selector.ConnectSucceeded(1, 40);
+  selector.ConnectSucceeded(2, 80);
+  ASSERT_EQ(selector.Rank(0), std::vector<size_t>({1, 2, 0}));
+
+  const common::time64_t now = 1000000;
+  selector.ConnectFailed(1, now);
+  ASSERT_FALSE(selector.IsHealthy(1, now));
+  ASSERT_EQ(selector.Rank(now), std::vector<size_t>({2, 0, 1}));
+
+  selector.ConnectFailed(2, now);
+  selector.ConnectFailed(2, now);
+  selector.ConnectFailed(0, now);
+  ASSERT_FALSE(selector.HasHealthy(now));
+  ASSERT_EQ(selector.Rank(now), std::vector<size_t>({0, 1, 2}));  // two failures of 2 cool down longer
+
+  const common::time64_t later = now + fastotv::client::inner::ServerSelector::failure_cooldown_msec;
+  ASSERT_TRUE(selector.IsHealthy(1, later));
+  ASSERT_FALSE(selector.IsHealthy(2, later));
+
+  selector.ConnectSucceeded(1, 40);
+  ASSERT_TRUE(selector.IsHealthy(1, now));
+}
+
+TEST(ServerSelector, HistorySurvivesRestart) {
+  const std::string path = "servers_history_test";
+  {
+    fastotv::client::inner::ServerSelector selector(MakeServers());
+    selector.ConnectSucceeded(2, 25);
+    selector.ConnectFailed(0, 500);
+    ASSERT_FALSE(selector.Save(path));
+  }
+
+  std::vector<common::net::HostAndPort> servers = MakeServers();
+  servers.erase(servers.begin() + 1);  // removed from the config meanwhile
+  fastotv::client::inner::ServerSelector selector(servers);
+  ASSERT_FALSE(selector.Load(path));
+  ASSERT_EQ(selector.GetStats(0).consecutive_failures, 1u);
+  ASSERT_EQ(selector.GetStats(0).last_failure_msec, 500);
+  ASSERT_EQ(selector.GetStats(1).connect_latency_msec, 25);
+  ASSERT_EQ(selector.Rank(500), std::vector<size_t>({1, 0}));
+  remove(path.c_str());
+}
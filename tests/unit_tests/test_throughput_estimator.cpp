@@ -0,0 +1,94 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include "client/live_stream/throughput_estimator.h"
+
+namespace {
+
+typedef fastotv::client::ThroughputEstimator ThroughputEstimator;
+
+// demuxer reading bytes_per_sec, sampled every 100 msec like the player timer
+common::time64_t Feed(ThroughputEstimator* estimator,
+                      common::time64_t now,
+                      common::time64_t duration_msec,
+                      uint64_t bytes_per_sec,
+                      uint64_t* total_bytes) {
+  const common::time64_t end = now + duration_msec;
+  for (; now < end; now += 100) {
+    *total_bytes += bytes_per_sec / 10;
+    estimator->AddSample(now + 100, *total_bytes);
+  }
+  return now;
+}
+
+}  // namespace
+
+TEST(ThroughputEstimator, ConvergesToSteadyRate) {
+  ThroughputEstimator estimator;
+  uint64_t total = 0;
+  estimator.AddSample(0, total);
+  ASSERT_FALSE(estimator.HasEstimate());
+  ASSERT_EQ(estimator.GetEstimate(), 0u);
+
+  Feed(&estimator, 0, 5000, 1000000, &total);
+  ASSERT_TRUE(estimator.HasEstimate());
+  ASSERT_GE(estimator.GetWindowsCount(), 9u);
+  ASSERT_GE(estimator.GetEstimate(), 990000u);  // zero start corrected
+  ASSERT_LE(estimator.GetEstimate(), 1010000u);
+}
+
+TEST(ThroughputEstimator, FollowsDropsFastAndPeaksSlowly) {
+  ThroughputEstimator estimator;
+  uint64_t total = 0;
+  estimator.AddSample(0, total);
+  common::time64_t now = Feed(&estimator, 0, 20000, 1000000, &total);
+
+  now = Feed(&estimator, now, 2000, 250000, &total);
+  ASSERT_LT(estimator.GetFastEstimate(), estimator.GetSlowEstimate());
+  ASSERT_EQ(estimator.GetEstimate(), estimator.GetFastEstimate());
+  ASSERT_LE(estimator.GetEstimate(), 650000u);  // half way down after one fast half life
+
+  now = Feed(&estimator, now, 20000, 1000000, &total);
+  Feed(&estimator, now, 2000, 4000000, &total);
+  ASSERT_EQ(estimator.GetEstimate(), estimator.GetSlowEstimate());
+  ASSERT_LE(estimator.GetEstimate(), 1500000u);
+}
+
+TEST(ThroughputEstimator, SkipsIdleWindowsAndRestartsOnNewStream) {
+  ThroughputEstimator estimator;
+  uint64_t total = 0;
+  estimator.AddSample(0, total);
+  common::time64_t now = Feed(&estimator, 0, 5000, 1000000, &total);
+  const size_t windows = estimator.GetWindowsCount();
+  const uint64_t estimate = estimator.GetEstimate();
+
+  // queues are full, the demuxer trickles
+  now = Feed(&estimator, now, 5000, 10000, &total);
+  ASSERT_EQ(estimator.GetWindowsCount(), windows);
+  ASSERT_EQ(estimator.GetEstimate(), estimate);
+
+  // counter of the next stream starts from zero
+  estimator.AddSample(now, 0);
+  ASSERT_FALSE(estimator.HasEstimate());
+  total = 0;
+  Feed(&estimator, now, 1000, 500000, &total);
+  ASSERT_TRUE(estimator.HasEstimate());
+  ASSERT_LE(estimator.GetEstimate(), 510000u);
+}
@@ -0,0 +1,189 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <openssl/ssl.h>
+
+#include <common/net/net.h>  // for socket_info
+
+#include <fastotv/commands_info/auth_info.h>
+
+#include "client/inner/inbound_message.h"
+#include "client/inner/inner_client.h"
+#include "client/inner/tls_session_cache.h"
+#include "client/inner/tls_transport.h"
+#include "tests/stand_in_server/stand_in_server.h"
+#include "tests/stand_in_server/tls_front.h"
+
+// The control channel over tls against the stand-in server behind a tls front.
+
+namespace {
+
+typedef fastotv::stand_in::StandInServer StandInServer;
+typedef fastotv::stand_in::TlsFront TlsFront;
+typedef fastotv::client::inner::InnerClient InnerClient;
+typedef fastotv::client::inner::TlsSessionCache TlsSessionCache;
+typedef fastotv::client::inner::TlsTransport TlsTransport;
+
+const int kHandshakeTimeoutMsec = 2000;
+
+// drives the non-blocking handshake the way the loop does, with poll in place of the loop
+common::ErrnoError Handshake(TlsTransport* tls, int fd) {
+  common::ErrnoError err = tls->StartHandshake(fd);
+  bool done = false;
+  while (!err) {
+    err = tls->ContinueHandshake(&done);
+    if (err || done) {
+      break;
+    }
+
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = tls->WantsWrite() ? POLLOUT : POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, kHandshakeTimeoutMsec) <= 0) {
+      return common::make_errno_error(ETIMEDOUT);
+    }
+  }
+  return err;
+}
+
+int ConnectSocket(const common::net::HostAndPort& host) {
+  const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return -1;
+  }
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = inet_addr(host.GetHost().c_str());
+  addr.sin_port = htons(host.GetPort());
+  if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// tcp, tls and a login answered by the stand-in, true if the session was resumed
+bool Login(SSL_CTX* tls_ctx, TlsSessionCache* sessions, const common::net::HostAndPort& host, bool* resumed) {
+  const int fd = ConnectSocket(host);
+  if (fd < 0) {
+    return false;
+  }
+
+  // non-blocking for the handshake like in the player, so the timeout holds, blocking reads afterwards
+  InnerClient client(nullptr, common::net::socket_info(fd));
+  TlsTransport* tls = new TlsTransport(tls_ctx, sessions, host);
+  const int flags = fcntl(fd, F_GETFL, 0);
+  fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+  common::ErrnoError err = Handshake(tls, fd);
+  fcntl(fd, F_SETFL, flags);
+  if (err) {
+    delete tls;
+    ignore_result(client.Close());
+    return false;
+  }
+  *resumed = tls->IsResumed();
+  client.SetTls(tls);
+
+  fastotv::commands_info::AuthInfo auth;
+  auth.SetLogin("stand_in@fastotv.com");
+  auth.SetPassword("password");
+  auth.SetDeviceID("5f3a1c0000000000000001");
+  std::string command;
+  fastotv::client::inner::InboundMessage message;
+  const bool ok = !client.Login(auth) && !client.ReadCommand(&command) &&
+                  !message.Parse(command.data(), command.size(), fastotv::client::inner::JSON_WIRE_FORMAT) &&
+                  message.IsResponse() && !message.IsError();
+  tls->Shutdown();
+  ignore_result(client.Close());
+  return ok;
+}
+
+}  // namespace
+
+TEST(TlsSession, ResumesFromDiskCache) {
+  StandInServer server((StandInServer::Script()));
+  ASSERT_FALSE(server.Start());
+  TlsFront front(server.GetHost());
+  ASSERT_FALSE(front.Start(0));
+
+  SSL_CTX* tls_ctx = TlsTransport::CreateContext(false);  // self-signed front
+  ASSERT_TRUE(tls_ctx);
+  const std::string path = "tls_sessions_test";
+  remove(path.c_str());
+
+  bool resumed = true;
+  {
+    TlsSessionCache sessions(path);
+    ASSERT_TRUE(sessions.Load());  // no file yet
+    ASSERT_TRUE(Login(tls_ctx, &sessions, front.GetHost(), &resumed));
+    ASSERT_FALSE(resumed);
+    ASSERT_EQ(sessions.GetCount(), 1u);
+  }
+
+  struct stat st;
+  ASSERT_EQ(stat(path.c_str(), &st), 0);
+  ASSERT_EQ(st.st_mode & 0777, 0600u);  // resumption secrets
+
+  // as after a restart of the player
+  TlsSessionCache sessions(path);
+  ASSERT_FALSE(sessions.Load());
+  ASSERT_EQ(sessions.GetCount(), 1u);
+  ASSERT_TRUE(Login(tls_ctx, &sessions, front.GetHost(), &resumed));
+  ASSERT_TRUE(resumed);
+
+  ASSERT_TRUE(Login(tls_ctx, nullptr, front.GetHost(), &resumed));
+  ASSERT_FALSE(resumed);
+
+  front.Stop();
+  const TlsFront::Stats stats = front.GetStats();
+  ASSERT_EQ(stats.handshakes, 3u);
+  ASSERT_EQ(stats.resumed, 1u);
+  SSL_CTX_free(tls_ctx);
+  remove(path.c_str());
+}
+
+TEST(TlsSession, DoesNotDowngradeToPlainServer) {
+  StandInServer server((StandInServer::Script()));
+  ASSERT_FALSE(server.Start());
+
+  SSL_CTX* tls_ctx = TlsTransport::CreateContext(false);
+  ASSERT_TRUE(tls_ctx);
+  TlsSessionCache sessions((std::string()));
+  bool resumed = false;
+  ASSERT_FALSE(Login(tls_ctx, &sessions, server.GetHost(), &resumed));
+  ASSERT_EQ(sessions.GetCount(), 0u);
+  ASSERT_EQ(server.GetStats().responses, 0u);
+  SSL_CTX_free(tls_ctx);
+}
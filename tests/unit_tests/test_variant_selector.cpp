@@ -0,0 +1,176 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "client/live_stream/variant_selector.h"
+#include "tests/abr_replay/trace_replay.h"
+
+namespace {
+
+typedef fastotv::client::VariantSelector VariantSelector;
+
+// 6, 3, 1.5 and 0.7 Mbit/s
+const uint64_t kLadder[] = {750000, 375000, 187500, 87500};
+const size_t kVariantsCount = sizeof(kLadder) / sizeof(kLadder[0]);
+
+fastotv::abr_replay::LocalStream MakeLocalStream() {
+  fastotv::abr_replay::LocalStream stream;
+  stream.bitrates.assign(kLadder, kLadder + kVariantsCount);
+  return stream;
+}
+
+fastotv::abr_replay::trace_t LoadTrace(const std::string& name) {
+  fastotv::abr_replay::trace_t trace;
+  common::Error err = fastotv::abr_replay::LoadTrace(std::string(ABR_TRACES_DIR) + "/" + name, &trace);
+  EXPECT_FALSE(err);
+  return trace;
+}
+
+}  // namespace
+
+TEST(VariantSelector, AssumesUnknownBitratesFromNeighbours) {
+  VariantSelector selector(kVariantsCount);
+  ASSERT_EQ(selector.GetVariantBitrate(0), 0u);
+  ASSERT_EQ(selector.SelectInitial(1000000), 0u);  // nothing to compare, the first url as before
+
+  selector.SetVariantBitrate(1, kLadder[1]);
+  ASSERT_FALSE(selector.IsVariantBitrateKnown(0));
+  ASSERT_EQ(selector.GetVariantBitrate(0), kLadder[1] * 2);
+  ASSERT_EQ(selector.GetVariantBitrate(3), kLadder[1] / 4);
+  ASSERT_EQ(selector.GetVariantBitrate(kVariantsCount), 0u);
+}
+
+TEST(VariantSelector, SelectsInitialVariantFromLastThroughput) {
+  VariantSelector selector(kVariantsCount);
+  for (size_t i = 0; i < kVariantsCount; ++i) {
+    selector.SetVariantBitrate(i, kLadder[i]);
+  }
+
+  ASSERT_EQ(selector.SelectInitial(1000000), 0u);
+  ASSERT_EQ(selector.SelectInitial(300000), 2u);
+  ASSERT_EQ(selector.SelectInitial(10000), kVariantsCount - 1);
+
+  selector.Start(2, 0);
+  ASSERT_EQ(selector.SelectInitial(0), 2u);  // never measured, the variant played last
+}
+
+TEST(VariantSelector, LeavesVariantDroppingFrames) {
+  VariantSelector selector(kVariantsCount);
+  selector.Start(0, 0);
+
+  VariantSelector::Conditions conditions;
+  conditions.throughput = kLadder[0] * 4;
+  for (common::time64_t now = 1000; now <= VariantSelector::min_switch_interval_msec; now += 1000) {
+    conditions.now = now;
+    conditions.dropped_frames += 1;
+    ASSERT_EQ(selector.Update(conditions), 0u);
+  }
+
+  conditions.now += 1000;
+  conditions.dropped_frames += 10;
+  ASSERT_EQ(selector.Update(conditions), 1u);
+  ASSERT_EQ(selector.SelectInitial(kLadder[0] * 4), 1u);  // not before the penalty is over
+}
+
+TEST(TraceReplay, KeepsBestVariantOnSteadyLink) {
+  fastotv::abr_replay::TraceReplay replay(MakeLocalStream(), LoadTrace("dsl_steady.trace"));
+  VariantSelector selector(kVariantsCount);
+  const fastotv::abr_replay::ReplayResult result = replay.Run(&selector, 0);
+  ASSERT_EQ(result.switches, 0u);
+  ASSERT_EQ(result.stalls, 0u);
+  ASSERT_EQ(result.average_bitrate, kLadder[0]);
+  ASSERT_TRUE(selector.IsVariantBitrateKnown(0));
+  ASSERT_GE(selector.GetVariantBitrate(0), kLadder[0] * 95 / 100);
+  ASSERT_LE(selector.GetVariantBitrate(0), kLadder[0] * 105 / 100);
+}
+
+TEST(TraceReplay, StepsDownForCongestionAndBack) {
+  const fastotv::abr_replay::LocalStream replay_stream = MakeLocalStream();
+  fastotv::abr_replay::TraceReplay replay(replay_stream, LoadTrace("home_wifi_evening.trace"));
+  const fastotv::abr_replay::ReplayResult best = replay.RunFixed(0);
+  ASSERT_GT(best.stalls, 0u);
+
+  VariantSelector selector(kVariantsCount);
+  const fastotv::abr_replay::ReplayResult result = replay.Run(&selector, 0);
+  ASSERT_EQ(result.stalls, 0u);
+  // the playing variant goes on until the pre-opened one has a keyframe, then only the new one buffers
+  ASSERT_LE(result.switching_msec, static_cast<common::time64_t>(result.switches) * replay_stream.startup_buffer_msec);
+  ASSERT_GE(result.switches, 2u);
+  ASSERT_LE(result.switches, 4u);
+  ASSERT_GT(result.played_per_variant[1], 0);
+  ASSERT_EQ(selector.GetCurrent(), 0u);
+  ASSERT_GE(result.average_bitrate, kLadder[0] * 9 / 10);
+}
+
+TEST(TraceReplay, FollowsFluctuatingLink) {
+  fastotv::abr_replay::TraceReplay replay(MakeLocalStream(), LoadTrace("lte_commute.trace"));
+  VariantSelector selector(kVariantsCount);
+  const fastotv::abr_replay::ReplayResult result = replay.Run(&selector, 0);
+
+  // more than the variant which barely keeps up, with fewer stalls than any fixed variant better than it;
+  // every switch waits for the new variant to buffer, so the waiting only beats the best fixed variant
+  const fastotv::abr_replay::ReplayResult fixed = replay.RunFixed(2);
+  ASSERT_GT(result.average_bitrate, fixed.average_bitrate);
+  for (size_t i = 0; i + 2 < kVariantsCount; ++i) {
+    ASSERT_LT(result.stalled_msec, replay.RunFixed(i).stalled_msec);
+  }
+  ASSERT_LT(result.stalled_msec + result.switching_msec, replay.RunFixed(0).stalled_msec);
+  ASSERT_LE(result.switches, 15u);
+}
+
+TEST(TraceReplay, BacksOffVariantDroppingFrames) {
+  fastotv::abr_replay::LocalStream stream = MakeLocalStream();
+  stream.dropping_variants = 1;
+  stream.dropped_frames_per_sec = 10;
+  fastotv::abr_replay::TraceReplay replay(stream, LoadTrace("dsl_steady.trace"));
+  VariantSelector selector(kVariantsCount);
+  const fastotv::abr_replay::ReplayResult result = replay.Run(&selector, 0);
+  ASSERT_EQ(result.stalls, 0u);
+  ASSERT_LE(result.switches, 5u);  // retried after one penalty, then after twice as long
+  ASSERT_LT(result.played_per_variant[0], result.played_msec / 10);
+  ASSERT_EQ(result.played_per_variant[2], 0);
+}
+
+TEST(TraceReplay, KeepsPlayingVariantWhenPreopenTimesOut) {
+  // congestion makes the selector step down, then the link all but dies before the new variant has a keyframe
+  const struct {
+    common::time64_t at_msec;
+    uint64_t kbits;
+  } points[] = {{0, 8000}, {20000, 2000}, {27000, 100}, {40000, 100}};
+  fastotv::abr_replay::trace_t trace;
+  for (size_t i = 0; i < sizeof(points) / sizeof(points[0]); ++i) {
+    fastotv::abr_replay::TracePoint point;
+    point.at_msec = points[i].at_msec;
+    point.throughput = points[i].kbits * 1000 / 8;
+    trace.push_back(point);
+  }
+
+  fastotv::abr_replay::TraceReplay replay(MakeLocalStream(), trace);
+  VariantSelector selector(kVariantsCount);
+  const fastotv::abr_replay::ReplayResult result = replay.Run(&selector, 0);
+  ASSERT_EQ(result.preopen_timeouts, 1u);
+  ASSERT_EQ(result.switches, 0u);
+  ASSERT_EQ(result.switching_msec, 0);
+  ASSERT_EQ(selector.GetCurrent(), 0u);  // restarted on the playing variant after the timeout
+  for (size_t i = 1; i < kVariantsCount; ++i) {
+    ASSERT_EQ(result.played_per_variant[i], 0);
+  }
+}
@@ -0,0 +1,158 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <json-c/json_object.h>
+#include <json-c/json_tokener.h>
+
+#include "client/inner/inbound_message.h"
+#include "client/inner/wire_format.h"
+
+namespace {
+
+const char kReply[] =
+    "{\"jsonrpc\":\"2.0\",\"id\":\"00000007\",\"result\":{\"channels\":[{\"id\":\"5f3a1c\",\"name\":\"News\","
+    "\"position\":-40000,\"timeshift\":1700000000000,\"ratio\":1.5,\"enabled\":true,\"icon\":null,\"tags\":[]}],"
+    "\"count\":1}}";
+
+std::string Encode(const char* json) {
+  json_object* jobj = json_tokener_parse(json);
+  std::string out;
+  common::Error err = fastotv::client::inner::EncodeMsgPack(jobj, &out);
+  json_object_put(jobj);
+  return err ? std::string() : out;
+}
+
+bool Decodes(const std::string& data) {
+  json_object* jobj = nullptr;
+  common::Error err = fastotv::client::inner::DecodeMsgPack(data.data(), data.size(), &jobj);
+  json_object_put(jobj);
+  return !err;
+}
+
+std::string NestedArrays(size_t depth) {
+  return std::string(depth, '\x91') + '\xc0';  // [[[...[null]...]]]
+}
+
+}  // namespace
+
+TEST(WireFormat, RoundTrip) {
+  const std::string encoded = Encode(kReply);
+  ASSERT_FALSE(encoded.empty());
+  ASSERT_EQ(fastotv::client::inner::DetectWireFormat(encoded.data(), encoded.size()),
+            fastotv::client::inner::MSGPACK_WIRE_FORMAT);
+  ASSERT_EQ(fastotv::client::inner::DetectWireFormat(kReply, sizeof(kReply) - 1),
+            fastotv::client::inner::JSON_WIRE_FORMAT);
+
+  json_object* jdecoded = nullptr;
+  ASSERT_FALSE(fastotv::client::inner::DecodeMsgPack(encoded.data(), encoded.size(), &jdecoded));
+  json_object* jresult = nullptr;
+  ASSERT_TRUE(json_object_object_get_ex(jdecoded, "result", &jresult));
+  json_object* jchannel = json_object_array_get_idx(json_object_object_get(jresult, "channels"), 0);
+  ASSERT_EQ(json_object_get_int64(json_object_object_get(jchannel, "position")), -40000);
+  ASSERT_EQ(json_object_get_int64(json_object_object_get(jchannel, "timeshift")), 1700000000000);
+  ASSERT_EQ(json_object_get_double(json_object_object_get(jchannel, "ratio")), 1.5);
+  ASSERT_TRUE(json_object_get_boolean(json_object_object_get(jchannel, "enabled")));
+  ASSERT_STREQ(json_object_get_string(json_object_object_get(jchannel, "name")), "News");
+
+  // encoding what was decoded gives the same bytes
+  std::string reencoded;
+  ASSERT_FALSE(fastotv::client::inner::EncodeMsgPack(jdecoded, &reencoded));
+  json_object_put(jdecoded);
+  ASSERT_EQ(reencoded, encoded);
+}
+
+TEST(WireFormat, LongStringsAndContainers) {
+  std::string json = "{\"text\":\"" + std::string(70000, 'x') + "\",\"items\":[";
+  for (int i = 0; i < 300; ++i) {
+    json += (i ? "," : "") + std::to_string(i * 1000);
+  }
+  json += "]}";
+
+  const std::string encoded = Encode(json.c_str());
+  ASSERT_FALSE(encoded.empty());
+  json_object* jdecoded = nullptr;
+  ASSERT_FALSE(fastotv::client::inner::DecodeMsgPack(encoded.data(), encoded.size(), &jdecoded));
+  ASSERT_EQ(json_object_get_string_len(json_object_object_get(jdecoded, "text")), 70000);
+  json_object* jitems = json_object_object_get(jdecoded, "items");
+  ASSERT_EQ(json_object_array_length(jitems), 300u);
+  ASSERT_EQ(json_object_get_int64(json_object_array_get_idx(jitems, 299)), 299000);
+  json_object_put(jdecoded);
+}
+
+TEST(WireFormat, TruncatedDocumentIsRejected) {
+  const std::string encoded = Encode(kReply);
+  ASSERT_FALSE(encoded.empty());
+  for (size_t size = 0; size < encoded.size(); ++size) {
+    ASSERT_FALSE(Decodes(encoded.substr(0, size))) << "prefix of " << size << " bytes";
+  }
+
+  // a length which claims more than what is left
+  ASSERT_FALSE(Decodes(std::string("\xdb\xff\xff\xff\xff" "abc", 8)));
+  ASSERT_FALSE(Decodes(std::string("\xdd\x00\x01\x00\x00\xc0", 6)));
+}
+
+TEST(WireFormat, DepthIsLimited) {
+  ASSERT_TRUE(Decodes(NestedArrays(64)));
+  ASSERT_FALSE(Decodes(NestedArrays(65)));
+  ASSERT_FALSE(Decodes(NestedArrays(100000)));
+
+  json_object* jroot = json_object_new_array();
+  json_object* jlast = jroot;
+  for (size_t i = 0; i < 65; ++i) {
+    json_object* jitem = json_object_new_array();
+    json_object_array_add(jlast, jitem);
+    jlast = jitem;
+  }
+  std::string out;
+  ASSERT_TRUE(fastotv::client::inner::EncodeMsgPack(jroot, &out));
+  json_object_put(jroot);
+}
+
+TEST(WireFormat, MapKeysMustBeStrings) {
+  ASSERT_TRUE(Decodes(std::string("\x81\xa1k\x01", 4)));
+  ASSERT_FALSE(Decodes(std::string("\x81\x01\x02", 3)));
+  ASSERT_FALSE(Decodes(std::string("\x81\xc0\x02", 3)));
+  ASSERT_FALSE(Decodes(std::string("\x81\x91\xa1k\x02", 5)));
+}
+
+TEST(WireFormat, TrailingDataIsRejected) {
+  const std::string encoded = Encode(kReply);
+  ASSERT_FALSE(encoded.empty());
+  ASSERT_TRUE(Decodes(encoded));
+  ASSERT_FALSE(Decodes(encoded + '\xc0'));
+  ASSERT_FALSE(Decodes(encoded + encoded));
+}
+
+TEST(WireFormat, InboundMessageDecodesByNegotiatedFormat) {
+  const std::string encoded = Encode(kReply);
+  fastotv::client::inner::InboundMessage message;
+  ASSERT_FALSE(message.Parse(encoded.data(), encoded.size(), fastotv::client::inner::MSGPACK_WIRE_FORMAT));
+  ASSERT_TRUE(message.IsResponse());
+  ASSERT_EQ(message.GetID(), "00000007");
+
+  ASSERT_FALSE(message.Parse(kReply, sizeof(kReply) - 1, fastotv::client::inner::JSON_WIRE_FORMAT));
+  ASSERT_TRUE(message.IsResponse());
+
+  // not sniffed: a message in the other format is an error
+  ASSERT_TRUE(message.Parse(encoded.data(), encoded.size(), fastotv::client::inner::JSON_WIRE_FORMAT));
+  ASSERT_TRUE(message.Parse(kReply, sizeof(kReply) - 1, fastotv::client::inner::MSGPACK_WIRE_FORMAT));
+}
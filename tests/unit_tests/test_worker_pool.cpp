@@ -0,0 +1,124 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "client/worker_pool.h"
+
+TEST(WorkerPool, RunsEveryTaskAndStealsFromBlockedWorker) {
+  fastotv::client::WorkerPool pool(2, 1000);
+  pool.Start();
+
+  // the first task blocks its worker, tasks queued behind it have to be stolen by the other one
+  std::mutex gate_mutex;
+  std::condition_variable gate_cond;
+  bool gate_open = false;
+  ASSERT_TRUE(pool.Post([&]() {
+    std::unique_lock<std::mutex> lock(gate_mutex);
+    while (!gate_open) {
+      gate_cond.wait(lock);
+    }
+  }));
+
+  std::atomic<size_t> done(0);
+  const size_t tasks_count = 200;
+  for (size_t i = 0; i < tasks_count; ++i) {
+    ASSERT_TRUE(pool.Post([&done]() { done++; }));
+  }
+  while (done != tasks_count) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(gate_mutex);
+    gate_open = true;
+  }
+  gate_cond.notify_all();
+  pool.Stop();
+
+  const fastotv::client::WorkerPool::Metrics metrics = pool.GetMetrics();
+  ASSERT_EQ(metrics.completed, tasks_count + 1);
+  ASSERT_GT(metrics.stolen, 0u);
+  ASSERT_EQ(metrics.queue_depth, 0u);
+  ASSERT_GE(metrics.max_queue_depth, 1u);
+}
+
+TEST(WorkerPool, RejectsWhenFullOrStopped) {
+  fastotv::client::WorkerPool pool(1, 2);
+  ASSERT_FALSE(pool.Post([]() {}));
+
+  pool.Start();
+  std::mutex gate_mutex;
+  gate_mutex.lock();
+  std::atomic<bool> started(false);
+  ASSERT_TRUE(pool.Post([&]() {
+    started = true;
+    std::lock_guard<std::mutex> lock(gate_mutex);
+  }));
+  while (!started) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  ASSERT_TRUE(pool.Post([]() {}));
+  ASSERT_TRUE(pool.Post([]() {}));
+  ASSERT_FALSE(pool.Post([]() {}));
+  ASSERT_EQ(pool.GetMetrics().queue_depth, 2u);
+
+  gate_mutex.unlock();
+  pool.Stop();
+  ASSERT_FALSE(pool.IsRunning());
+  ASSERT_EQ(pool.GetMetrics().rejected, 2u);
+}
+
+TEST(WorkerPool, PostRacingStopLeavesNothingCounted) {
+  fastotv::client::WorkerPool pool(2, 100000);
+  for (size_t round = 0; round < 20; ++round) {
+    pool.Start();
+    std::atomic<bool> posting(true);
+    std::vector<std::thread> posters;
+    for (size_t i = 0; i < 4; ++i) {
+      posters.emplace_back([&]() {
+        while (posting) {
+          pool.Post([]() {});
+        }
+      });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    pool.Stop();
+    posting = false;
+    for (auto& poster : posters) {
+      poster.join();
+    }
+    ASSERT_EQ(pool.GetMetrics().queue_depth, 0u);
+  }
+
+  pool.Start();
+  std::atomic<bool> done(false);
+  ASSERT_TRUE(pool.Post([&done]() { done = true; }));
+  while (!done) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  pool.Stop();
+}